@@ -0,0 +1,39 @@
+#!/usr/bin/env bash
+# Author: Aleksandr Loshkarev
+#
+# Compare wall time of the one-clang-tidy-per-TU xargs recipe from the README
+# with hl-tidy-run over the same compile database.
+#
+# Usage:
+#   bench/compare_runners.sh <build dir> [checks]
+#
+# <build dir> must contain compile_commands.json, HlTidyModule.so and
+# hl-tidy-run.  Run it twice: the first hl-tidy-run records per-file timings
+# that the second uses to order the TUs.
+
+set -euo pipefail
+
+BUILD_DIR=${1:?usage: $0 <build dir> [checks]}
+CHECKS=${2:-'-*,hl-*'}
+CLANG_TIDY=${CLANG_TIDY:-clang-tidy}
+JOBS=${JOBS:-$(nproc)}
+
+FILES=$(python3 -c 'import json, sys
+print("\n".join(sorted({e["file"] for e in json.load(open(sys.argv[1]))})))' \
+  "$BUILD_DIR/compile_commands.json")
+
+start=$(date +%s.%N)
+echo "$FILES" | xargs -P"$JOBS" -I{} \
+  "$CLANG_TIDY" -load "$BUILD_DIR/HlTidyModule.so" -checks="$CHECKS" \
+    -p "$BUILD_DIR" -quiet {} >/dev/null 2>&1 || true
+xargs_wall=$(echo "$(date +%s.%N) - $start" | bc)
+
+start=$(date +%s.%N)
+"$BUILD_DIR/hl-tidy-run" -p "$BUILD_DIR" -j "$JOBS" -checks="$CHECKS" \
+  -quiet >/dev/null 2>&1 || true
+run_wall=$(echo "$(date +%s.%N) - $start" | bc)
+
+printf 'TUs:          %d\n' "$(echo "$FILES" | wc -l)"
+printf 'jobs:         %d\n' "$JOBS"
+printf 'xargs:        %.2fs\n' "$xargs_wall"
+printf 'hl-tidy-run:  %.2fs\n' "$run_wall"
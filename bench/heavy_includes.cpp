@@ -0,0 +1,84 @@
+// Author: Aleksandr Loshkarev
+//
+// Matcher-time benchmark input: a translation unit that pulls in most of the
+// standard library and uses a handful of the types the checks look for.
+// Almost all of the AST comes from system headers, so the profile is
+// dominated by how cheaply each matcher rejects declarations it does not
+// care about.
+//
+// Run with bench/profile_matchers.sh.
+
+#include <algorithm>
+#include <any>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <forward_list>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <queue>
+#include <random>
+#include <regex>
+#include <set>
+#include <shared_mutex>
+#include <sstream>
+#include <stack>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace bench {
+
+struct Order {
+  std::string Symbol;
+  std::map<int, double> Levels;
+  std::set<int> Ids;
+  std::list<int> Fills;
+  std::shared_ptr<int> Owner;
+  std::function<void(int)> OnFill;
+  std::any Extra;
+};
+
+int parse(const std::string &S) { return std::stoi(S); }
+
+std::string render(const Order &O) {
+  std::ostringstream OS;
+  OS << O.Symbol << ' ' << O.Levels.size();
+  return OS.str();
+}
+
+bool matches(const std::string &S) {
+  static const std::regex Re("[A-Z]+");
+  return std::regex_match(S, Re);
+}
+
+int sum(const std::vector<Order> &Orders) {
+  std::vector<int> Out;
+  for (const Order &O : Orders)
+    for (int Id : O.Ids)
+      Out.push_back(Id);
+  if (Orders.size() && Orders.front().Levels.find(1) !=
+                           Orders.front().Levels.end())
+    std::cout << "found" << std::endl;
+  return std::accumulate(Out.begin(), Out.end(), 0);
+}
+
+} // namespace bench
@@ -0,0 +1,494 @@
+#!/usr/bin/env python3
+# Author: Aleksandr Loshkarev
+"""Synthetic scaling benchmark for the hl-tidy plugin.
+
+Generates parameterised translation units, runs every hl-* check alone and
+all of them together over each one, and records wall time, matcher time
+(from clang-tidy's -store-check-profile) and peak RSS as JSON.
+
+Scenario parameters (see --scenario):
+  N  number of functions
+  D  loop nesting depth inside each function
+  M  number of container declarations
+  T  template instantiation fan-out
+  H  1 to include a large slice of the standard library, 0 otherwise
+
+Project mode (--project N) instead generates a compile database of N such
+TUs and measures parse plus analysis time of a whole hl-tidy-run over it,
+once per file-sharing mode: every TU on its own, files shared between TUs,
+and files plus include-prefix PCHs shared.  Every fourth TU includes one more
+header, so two prefixes are in play.
+
+Examples:
+  hl_tidy_bench.py --plugin build/HlTidyModule.so --output bench.json
+  hl_tidy_bench.py --plugin build/HlTidyModule.so --output skip-sys.json \\
+      --module-option ExcludeSystemHeaders=true
+  hl_tidy_bench.py --plugin build/HlTidyModule.so --output new.json \\
+      --baseline bench/baseline.json --max-regression 15
+  hl_tidy_bench.py --project 1000 --hl-tidy-run build/hl-tidy-run \\
+      --scenario N=5,D=2,M=4,T=1,H=1 --output project.json
+"""
+
+import argparse
+import glob
+import json
+import os
+import platform
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+DEFAULT_SCENARIOS = [
+    "N=50,D=2,M=20,T=4,H=1",
+    "N=200,D=4,M=100,T=16,H=1",
+    "N=400,D=8,M=200,T=32,H=1",
+]
+
+HEAVY_INCLUDES = [
+    "algorithm", "any", "array", "atomic", "chrono", "condition_variable",
+    "deque", "forward_list", "fstream", "functional", "future", "iomanip",
+    "iostream", "list", "map", "memory", "mutex", "numeric", "optional",
+    "queue", "random", "regex", "set", "shared_mutex", "sstream", "stack",
+    "string", "string_view", "thread", "tuple", "type_traits",
+    "unordered_map", "unordered_set", "utility", "variant", "vector",
+]
+
+# Headers needed by the generated code itself, included even when H=0.
+BASE_INCLUDES = [
+    "any", "functional", "iostream", "list", "map", "memory", "set",
+    "sstream", "string", "vector",
+]
+
+# Project mode: per-TU scenario and the sharing modes compared.
+DEFAULT_PROJECT_SCENARIO = "N=5,D=2,M=4,T=1,H=1"
+
+PROJECT_MODES = [
+    ("separate", ["-share-files=false", "-share-preambles=false"]),
+    ("shared-files", ["-share-preambles=false"]),
+    ("shared-files+pch", []),
+]
+
+CONTAINER_TYPES = [
+    "std::map<int, int>",
+    "std::set<int>",
+    "std::list<int>",
+    "std::vector<int>",
+    "std::function<void(int)>",
+    "std::shared_ptr<int>",
+    "std::any",
+    "std::multimap<int, double>",
+]
+
+
+# --------------------------------------------------------------------------- #
+# Generator
+# --------------------------------------------------------------------------- #
+
+def parse_scenario(text):
+    params = {"N": 50, "D": 2, "M": 20, "T": 4, "H": 1}
+    for item in filter(None, text.split(",")):
+        key, _, value = item.partition("=")
+        key = key.strip().upper()
+        if key not in params:
+            raise ValueError("unknown scenario parameter '%s'" % key)
+        params[key] = int(value)
+    return params
+
+
+def scenario_name(params):
+    return ",".join("%s=%d" % (k, params[k]) for k in "NDMTH")
+
+
+def generate_tu(params, extra_includes=()):
+    """Return the source of a synthetic TU for the given parameters."""
+    out = []
+    includes = (HEAVY_INCLUDES if params["H"] else BASE_INCLUDES) + \
+        list(extra_includes)
+    out.extend("#include <%s>" % h for h in includes)
+    out.append("")
+    out.append("namespace gen {")
+    out.append("")
+    out.append("struct Base {")
+    out.append("  virtual ~Base() = default;")
+    out.append("  virtual int step(int) = 0;")
+    out.append("};")
+    out.append("")
+
+    # M container declarations, spread over a few holder structs so that
+    # both field and variable matchers have work to do.
+    out.append("struct Holder {")
+    for i in range(params["M"]):
+        out.append("  %s Field%d;" % (CONTAINER_TYPES[i % len(CONTAINER_TYPES)],
+                                      i))
+    out.append("};")
+    out.append("")
+    for i in range(params["M"]):
+        out.append("static %s Global%d;" %
+                   (CONTAINER_TYPES[i % len(CONTAINER_TYPES)], i))
+    out.append("")
+
+    # T template instantiations, each with a loop in its body.
+    out.append("template <int I> struct Node {")
+    out.append("  std::vector<int> Values;")
+    out.append("  std::map<int, int> Index;")
+    out.append("  int run(Base *B, int Count) {")
+    out.append("    int Acc = 0;")
+    out.append("    for (int K = 0; K < Count; ++K) {")
+    out.append("      Values.push_back(K + I);")
+    out.append("      Acc += B->step(K);")
+    out.append("      if (Index.find(K) != Index.end())")
+    out.append("        ++Acc;")
+    out.append("    }")
+    out.append("    return Acc;")
+    out.append("  }")
+    out.append("};")
+    out.append("")
+    for i in range(params["T"]):
+        out.append("template struct Node<%d>;" % i)
+    out.append("")
+
+    # N functions with D nested loops.
+    depth = max(params["D"], 1)
+    for f in range(params["N"]):
+        out.append("int func%d(Base *B, const std::string &S, "
+                   "std::map<int, int> &M, int Count) {" % f)
+        out.append("  std::vector<int> Out;")
+        out.append("  int Acc = std::stoi(S);")
+        indent = "  "
+        for d in range(depth):
+            var = "I%d" % d
+            if d % 3 == 1:
+                out.append("%swhile (Acc < Count * %d) {" % (indent, d + 1))
+                out.append("%s  ++Acc;" % indent)
+            elif d % 3 == 2:
+                out.append("%sfor (int %s : Out) {" % (indent, var))
+                out.append("%s  Acc ^= %s;" % (indent, var))
+            else:
+                out.append("%sfor (int %s = 0; %s < Count; ++%s) {" %
+                           (indent, var, var, var))
+            indent += "  "
+        out.append("%sOut.push_back(Acc);" % indent)
+        out.append("%sAcc += B->step(Acc);" % indent)
+        out.append("%sif (M.find(Acc) != M.end())" % indent)
+        out.append("%s  Acc += M.count(Acc);" % indent)
+        for d in range(depth):
+            indent = indent[:-2]
+            out.append("%s}" % indent)
+        out.append("  if (Acc < 0)")
+        out.append("    std::cout << \"neg \" << Acc << std::endl;")
+        out.append("  std::ostringstream OS;")
+        out.append("  OS << Acc;")
+        out.append("  return static_cast<int>(OS.str().size()) + Acc;")
+        out.append("}")
+        out.append("")
+
+    out.append("} // namespace gen")
+    out.append("")
+    return "\n".join(out)
+
+
+# --------------------------------------------------------------------------- #
+# Runner
+# --------------------------------------------------------------------------- #
+
+def list_hl_checks(clang_tidy, plugin):
+    proc = subprocess.run(
+        [clang_tidy, "-load", plugin, "-checks=-*,hl-*", "-list-checks"],
+        stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True,
+        check=True)
+    return sorted(line.strip() for line in proc.stdout.splitlines()
+                  if line.strip().startswith("hl-"))
+
+
+def module_config(options):
+    """Build a -config value from KEY=VALUE hl-module options."""
+    entries = []
+    for option in options:
+        key, _, value = option.partition("=")
+        entries.append("{key: hl-module.%s, value: '%s'}" % (key, value))
+    return "{CheckOptions: [%s]}" % ", ".join(entries)
+
+
+def run_clang_tidy(clang_tidy, plugin, checks, source, std, extra_args,
+                   module_options=()):
+    """Run clang-tidy once; return (wall_s, matcher_s, peak_rss_kb)."""
+    profile_dir = tempfile.mkdtemp(prefix="hl-bench-profile-")
+    try:
+        cmd = [clang_tidy, "-load", plugin, "-checks=-*," + checks,
+               "-enable-check-profile", "-store-check-profile=" + profile_dir]
+        if module_options:
+            cmd.append("-config=" + module_config(module_options))
+        cmd += [source, "--", "-std=" + std] + extra_args
+        with tempfile.TemporaryFile() as stderr:
+            start = time.perf_counter()
+            proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL,
+                                    stderr=stderr)
+            # Reap the child ourselves so that its rusage (peak RSS) is
+            # reported for this process alone.
+            _, status, usage = os.wait4(proc.pid, 0)
+            wall = time.perf_counter() - start
+            proc.returncode = os.waitstatus_to_exitcode(status)
+            if proc.returncode not in (0, 1):
+                stderr.seek(0)
+                raise RuntimeError(
+                    "clang-tidy failed (%d): %s" %
+                    (proc.returncode,
+                     stderr.read().decode(errors="replace")[-2000:]))
+        matcher = 0.0
+        for path in glob.glob(os.path.join(profile_dir, "*.json")):
+            with open(path) as f:
+                profile = json.load(f).get("profile", {})
+            for key, value in profile.items():
+                # Keys look like "time.clang-tidy.<check>.wall".
+                if key.endswith(".wall") and ".hl-" in key:
+                    matcher += value
+        return wall, matcher, usage.ru_maxrss
+    finally:
+        shutil.rmtree(profile_dir, ignore_errors=True)
+
+
+def best_of(repeat, fn):
+    """Run fn() `repeat` times; keep the fastest wall/matcher, largest RSS."""
+    walls, matchers, rss = [], [], []
+    for _ in range(repeat):
+        wall, matcher, peak = fn()
+        walls.append(wall)
+        if matcher is not None:
+            matchers.append(matcher)
+        if peak is not None:
+            rss.append(peak)
+    return {
+        "wall_s": round(min(walls), 4),
+        "matcher_s": round(min(matchers), 4) if matchers else None,
+        "peak_rss_kb": max(rss) if rss else None,
+    }
+
+
+def generate_project(work_dir, count, params, std, extra_args):
+    """Write `count` TUs and their compile_commands.json; return the dir."""
+    project = os.path.join(work_dir, "project")
+    os.makedirs(project, exist_ok=True)
+    commands = []
+    for i in range(count):
+        tu_params = dict(params, N=params["N"] + i % 5)
+        extra = ["filesystem"] if i % 4 == 3 else []
+        source = os.path.join(project, "tu%04d.cpp" % i)
+        with open(source, "w") as f:
+            f.write(generate_tu(tu_params, extra))
+        commands.append({
+            "directory": project,
+            "file": source,
+            "arguments": ["clang++", "-std=" + std] + extra_args +
+                         ["-c", source, "-o", source + ".o"],
+        })
+    with open(os.path.join(project, "compile_commands.json"), "w") as f:
+        json.dump(commands, f, indent=1)
+    return project
+
+
+def run_hl_tidy_run(binary, project, checks, jobs, mode_flags,
+                    module_options=()):
+    """Run hl-tidy-run once over `project`; return (wall_s, None, rss_kb)."""
+    timings = tempfile.mkdtemp(prefix="hl-bench-timings-")
+    try:
+        # A fresh timings file per run, so no mode orders its TUs with
+        # knowledge from another.
+        cmd = [binary, "-p", project, "-checks=-*," + checks, "-quiet",
+               "-timings=" + os.path.join(timings, "t.json")] + mode_flags
+        if jobs:
+            cmd.append("-j=%d" % jobs)
+        if module_options:
+            cmd.append("-config=" + module_config(module_options))
+        with tempfile.TemporaryFile() as stderr:
+            start = time.perf_counter()
+            proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL,
+                                    stderr=stderr)
+            _, status, usage = os.wait4(proc.pid, 0)
+            wall = time.perf_counter() - start
+            if os.waitstatus_to_exitcode(status) not in (0, 1):
+                stderr.seek(0)
+                raise RuntimeError(
+                    "hl-tidy-run failed: %s" %
+                    stderr.read().decode(errors="replace")[-2000:])
+        return wall, None, usage.ru_maxrss
+    finally:
+        shutil.rmtree(timings, ignore_errors=True)
+
+
+def run_project_benchmark(args):
+    params = parse_scenario((args.scenario or [DEFAULT_PROJECT_SCENARIO])[0])
+    work_dir = args.work_dir or tempfile.mkdtemp(prefix="hl-bench-")
+    os.makedirs(work_dir, exist_ok=True)
+    project = generate_project(work_dir, args.project, params, args.std,
+                               args.extra_arg)
+    checks = args.checks or "hl-*"
+    name = "project=%d,%s" % (args.project, scenario_name(params))
+
+    results = []
+    for label, flags in PROJECT_MODES:
+        sys.stderr.write("[bench] %-40s %s\n" % (label, name))
+        stats = best_of(args.repeat, lambda: run_hl_tidy_run(
+            args.hl_tidy_run, project, checks, args.jobs, flags,
+            args.module_option))
+        stats.update({"scenario": name, "checks": label})
+        results.append(stats)
+
+    return {
+        "meta": {
+            "hl_tidy_run": os.path.abspath(args.hl_tidy_run),
+            "std": args.std,
+            "repeat": args.repeat,
+            "jobs": args.jobs,
+            "module_options": args.module_option,
+            "host": platform.node(),
+            "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        },
+        "results": results,
+    }
+
+
+def run_benchmark(args):
+    checks = list_hl_checks(args.clang_tidy, args.plugin)
+    if args.checks:
+        wanted = set(args.checks.split(","))
+        checks = [c for c in checks if c in wanted]
+    if not checks:
+        sys.exit("error: no hl-* checks found in %s" % args.plugin)
+
+    work_dir = args.work_dir or tempfile.mkdtemp(prefix="hl-bench-")
+    os.makedirs(work_dir, exist_ok=True)
+
+    results = []
+    for text in args.scenario or DEFAULT_SCENARIOS:
+        params = parse_scenario(text)
+        name = scenario_name(params)
+        source = os.path.join(work_dir, "bench_%s.cpp" %
+                              name.replace(",", "_").replace("=", ""))
+        with open(source, "w") as f:
+            f.write(generate_tu(params))
+
+        runs = [(c, c) for c in checks] + [("all", "hl-*")]
+        for label, pattern in runs:
+            sys.stderr.write("[bench] %-40s %s\n" % (label, name))
+            stats = best_of(args.repeat, lambda: run_clang_tidy(
+                args.clang_tidy, args.plugin, pattern, source, args.std,
+                args.extra_arg, args.module_option))
+            stats.update({"scenario": name, "checks": label})
+            results.append(stats)
+
+    return {
+        "meta": {
+            "plugin": os.path.abspath(args.plugin),
+            "clang_tidy": args.clang_tidy,
+            "std": args.std,
+            "repeat": args.repeat,
+            "module_options": args.module_option,
+            "host": platform.node(),
+            "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        },
+        "results": results,
+    }
+
+
+# --------------------------------------------------------------------------- #
+# Baseline comparison
+# --------------------------------------------------------------------------- #
+
+METRICS = ("matcher_s", "wall_s", "peak_rss_kb")
+
+
+def compare(current, baseline, max_regression, min_delta_s):
+    """Print a comparison table; return the list of regressions."""
+    base = {(r["scenario"], r["checks"]): r for r in baseline["results"]}
+    regressions = []
+    for cur in current["results"]:
+        old = base.get((cur["scenario"], cur["checks"]))
+        if not old:
+            continue
+        for metric in METRICS:
+            before, after = old.get(metric), cur.get(metric)
+            if not before or after is None:
+                continue
+            change = 100.0 * (after - before) / before
+            # Ignore sub-noise timing changes on tiny inputs.
+            noisy = metric.endswith("_s") and after - before < min_delta_s
+            if change > max_regression and not noisy:
+                regressions.append((cur["scenario"], cur["checks"], metric,
+                                    before, after, change))
+    for scenario, checks, metric, before, after, change in regressions:
+        print("REGRESSION %-40s %-26s %-11s %10.4g -> %10.4g (%+.1f%%)" %
+              (checks, scenario, metric, before, after, change))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawTextHelpFormatter)
+    parser.add_argument("--plugin",
+                        help="path to HlTidyModule.so (not needed with "
+                             "--project)")
+    parser.add_argument("--clang-tidy", default="clang-tidy",
+                        help="clang-tidy binary (default: %(default)s)")
+    parser.add_argument("--output", help="write results JSON here")
+    parser.add_argument("--project", type=int, metavar="N",
+                        help="benchmark hl-tidy-run over a generated "
+                             "project of N TUs instead")
+    parser.add_argument("--hl-tidy-run",
+                        help="hl-tidy-run binary for --project")
+    parser.add_argument("--jobs", type=int, default=0,
+                        help="hl-tidy-run threads for --project "
+                             "(default: all cores)")
+    parser.add_argument("--scenario", action="append",
+                        help="scenario such as 'N=200,D=4,M=100,T=16,H=1' "
+                             "(repeatable)")
+    parser.add_argument("--checks",
+                        help="comma-separated subset of checks to run alone")
+    parser.add_argument("--std", default="c++20",
+                        help="language standard (default: %(default)s)")
+    parser.add_argument("--extra-arg", action="append", default=[],
+                        help="extra compiler argument (repeatable)")
+    parser.add_argument("--module-option", action="append", default=[],
+                        metavar="KEY=VALUE",
+                        help="hl-module option for every run, e.g. "
+                             "ExcludeSystemHeaders=true (repeatable)")
+    parser.add_argument("--repeat", type=int, default=3,
+                        help="runs per measurement, best kept "
+                             "(default: %(default)s)")
+    parser.add_argument("--work-dir", help="keep generated TUs here")
+    parser.add_argument("--baseline", help="baseline results JSON to compare "
+                                           "against")
+    parser.add_argument("--max-regression", type=float, default=10.0,
+                        help="allowed slowdown in percent "
+                             "(default: %(default)s)")
+    parser.add_argument("--min-delta", type=float, default=0.02,
+                        help="ignore timing changes below this many seconds "
+                             "(default: %(default)s)")
+    args = parser.parse_args()
+    if args.project and not args.hl_tidy_run:
+        parser.error("--project requires --hl-tidy-run")
+    if not args.project and not args.plugin:
+        parser.error("--plugin is required")
+
+    current = (run_project_benchmark(args) if args.project
+               else run_benchmark(args))
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(current, f, indent=2)
+            f.write("\n")
+    else:
+        json.dump(current, sys.stdout, indent=2)
+        sys.stdout.write("\n")
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        if compare(current, baseline, args.max_regression, args.min_delta):
+            return 1
+        print("No regressions above %.1f%%." % args.max_regression)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
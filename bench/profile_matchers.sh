@@ -0,0 +1,29 @@
+#!/usr/bin/env bash
+# Author: Aleksandr Loshkarev
+#
+# Print per-check matcher time for the hl-* checks on a header-heavy TU.
+#
+# Usage:
+#   bench/profile_matchers.sh <path/to/HlTidyModule.so> [input.cpp] [-- flags]
+#
+# Compare two builds by running the script against each plugin; the
+# interesting column is the "user" time of each hl-* check, which is spent
+# inside that check's matchers and check() callback.
+
+set -euo pipefail
+
+PLUGIN=${1:?usage: $0 <HlTidyModule.so> [input.cpp] [-- compiler flags]}
+shift
+INPUT=${1:-"$(dirname "$0")/heavy_includes.cpp"}
+[[ $# -gt 0 ]] && shift
+[[ ${1:-} == "--" ]] && shift
+FLAGS=("$@")
+[[ ${#FLAGS[@]} -eq 0 ]] && FLAGS=(-std=c++20)
+
+CLANG_TIDY=${CLANG_TIDY:-clang-tidy}
+
+"$CLANG_TIDY" -load "$PLUGIN" \
+  -checks='-*,hl-*' \
+  -enable-check-profile \
+  "$INPUT" -- "${FLAGS[@]}" 2>&1 >/dev/null |
+  grep -E 'Wall Time|Total|  hl-' || true
@@ -0,0 +1,337 @@
+//===--- HlTidyCheck.cpp - Common base for all hl-* checks ------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "HlTidyCheck.h"
+#include "utils/FunctionIndex.h"
+#include "utils/LoopContext.h"
+#include "utils/ModuleOptions.h"
+
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/Basic/SourceManager.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <chrono>
+
+namespace hl {
+namespace tidy {
+
+/// Node ID of the translation-unit match that consults the result cache,
+/// applies the path filter and hands the AST to the export, the profile
+/// weighting, the hot-path scoping and the cost model.
+static constexpr llvm::StringLiteral ScopeNodeId = "hl-module-scope";
+
+HlTidyCheck::HlTidyCheck(llvm::StringRef Name,
+                         clang::tidy::ClangTidyContext *Context)
+    : ClangTidyCheck(Name, Context), Context(Context),
+      Paths(*Context),
+      Deduplicate(utils::getModuleFlag(*Context, "Deduplicate", false)),
+      HotPaths(*Context),
+      Sink(utils::MetricsSink::acquire(*Context)),
+      Cache(utils::CacheSession::acquire(*Context)),
+      Export(utils::ExportSession::acquire(*Context)),
+      Profile(utils::Profile::acquire(*Context)), Costs(*Context),
+      Ranking(utils::CostReport::acquire(*Context)),
+      Coverage(utils::Coverage::acquire(*Context)) {
+  if (Cache)
+    Cache->addCheck(Name);
+  if (Profile)
+    llvm::StringRef(
+        utils::getModuleOption(*Context, "ProfileMinHotness", "0"))
+        .trim()
+        .getAsDouble(MinHotness);
+  if (Coverage)
+    llvm::StringRef(utils::getModuleOption(*Context, "CoverageMinCount", "0"))
+        .trim()
+        .getAsInteger(10, MinLoopIterations);
+}
+
+HlTidyCheck::~HlTidyCheck() {
+  if (Sink && (Metrics.Callbacks || Metrics.Deduplicated))
+    Sink->add(getID(), Metrics);
+}
+
+HlDiag HlTidyCheck::diag(clang::SourceLocation Loc,
+                         llvm::StringRef Description,
+                         clang::DiagnosticIDs::Level Level) {
+  if (Level == clang::DiagnosticIDs::Note) {
+    if (DroppingNotes)
+      return HlDiag();
+    return emit(Loc, Description, Level, Annotations());
+  }
+
+  DroppingNotes = false;
+  Annotations Annotated;
+  if (HotPaths.isEnabled() && AST && isHotPathScoped()) {
+    Level = HotPaths.classify(*AST, Loc, Level, Annotated.HotRoot);
+    if (Level == clang::DiagnosticIDs::Ignored) {
+      DroppingNotes = true;
+      return HlDiag();
+    }
+  }
+
+  Annotated.Hotness = hotnessAt(Loc);
+  if (Annotated.Hotness && *Annotated.Hotness < MinHotness) {
+    DroppingNotes = true;
+    return HlDiag();
+  }
+  Annotated.Score = scoreAt(Loc, Annotated.Hotness);
+  return emit(Loc, Description, Level, Annotated);
+}
+
+HlDiag HlTidyCheck::emit(clang::SourceLocation Loc,
+                         llvm::StringRef Description,
+                         clang::DiagnosticIDs::Level Level,
+                         const Annotations &Annotated) {
+  // Only the terminal shows the annotations.  The cache recomputes them on
+  // replay and the export carries them as fields, so that the fingerprint
+  // does not change with the profile, the cost model or the hot set.
+  std::string Shown = Description.str();
+  llvm::raw_string_ostream OS(Shown);
+  if (Annotated.HotRoot) {
+    // '%' is escaped for the diagnostic formatter.
+    OS << " [hot path from '";
+    for (char C : *Annotated.HotRoot) {
+      if (C == '%')
+        OS << '%';
+      OS << C;
+    }
+    OS << "']";
+  }
+  if (Annotated.Hotness)
+    OS << " [" << llvm::format("%.1f", *Annotated.Hotness)
+       << "%% of profile samples]";
+  if (Annotated.Score)
+    OS << " [cost " << llvm::format("%.0f", *Annotated.Score) << ": "
+       << utils::costName(occurrenceCost()) << "]";
+  OS.flush();
+
+  if (Sink)
+    Metrics.countDiagnostic(Level);
+  std::unique_ptr<utils::CachedDiagnostic> Record;
+  if (Cache)
+    Record = Cache->record(getID(), Loc, Description, Level);
+  std::unique_ptr<utils::ExportedDiagnostic> Exported;
+  if (Export)
+    Exported = Export->record(getID(), Loc, Description, Level);
+  if (Exported) {
+    Exported->Hotness = Annotated.Hotness;
+    Exported->Cost = Annotated.Score;
+    Exported->HotRoot = Annotated.HotRoot;
+  }
+  std::unique_ptr<utils::RankedFinding> Ranked;
+  if (Ranking && Annotated.Score)
+    Ranked = Ranking->record(getID(), Loc, Description, *Annotated.Score);
+  return HlDiag(ClangTidyCheck::diag(Loc, Shown, Level), Cache.get(),
+                std::move(Record), Export.get(), std::move(Exported),
+                Ranking.get(), std::move(Ranked));
+}
+
+std::optional<double>
+HlTidyCheck::hotnessAt(clang::SourceLocation Loc) const {
+  if (!Profile || !AST || Loc.isInvalid())
+    return std::nullopt;
+  const utils::FunctionIndex &Functions = utils::FunctionIndex::get(*AST);
+  const clang::FunctionDecl *FD = Functions.enclosing(Loc);
+  if (!FD)
+    return std::nullopt;
+  return Profile->hotness(Functions.profileNames(FD)).value_or(0.0);
+}
+
+std::optional<double>
+HlTidyCheck::scoreAt(clang::SourceLocation Loc,
+                     std::optional<double> Hotness) const {
+  utils::Cost Kind = occurrenceCost();
+  if (!Costs.isEnabled() || Kind == utils::Cost::None)
+    return std::nullopt;
+  unsigned Depth = 0;
+  if (AST && Loc.isValid())
+    Depth = utils::LoopContext::get(*AST).depthAt(Loc);
+  return Costs.score(Kind, Depth, Hotness, executionsAt(Loc));
+}
+
+std::optional<utils::LoopExecution>
+HlTidyCheck::loopExecution(const clang::Stmt *Loop) const {
+  if (!Coverage || !AST || !Loop)
+    return std::nullopt;
+  return utils::CoverageIndex::get(*AST, *Coverage).loop(Loop);
+}
+
+std::optional<uint64_t>
+HlTidyCheck::executionsAt(clang::SourceLocation Loc) const {
+  if (!Coverage || !AST)
+    return std::nullopt;
+  return utils::CoverageIndex::get(*AST, *Coverage).countAt(Loc);
+}
+
+void HlTidyCheck::noteLoopExecution(clang::SourceLocation Loc,
+                                    const utils::LoopExecution &Executed) {
+  std::string Text;
+  llvm::raw_string_ostream OS(Text);
+  OS << "the loop body ran " << Executed.Iterations
+     << " times in the coverage run";
+  if (std::optional<uint64_t> Trips = Executed.averageTripCount())
+    OS << " (" << *Trips << " iterations per entry on average)";
+  diag(Loc, Text, clang::DiagnosticIDs::Note);
+}
+
+HlDiag HlTidyCheck::diag(llvm::StringRef Description,
+                         clang::DiagnosticIDs::Level Level) {
+  if (Level != clang::DiagnosticIDs::Note)
+    DroppingNotes = false;
+  else if (DroppingNotes)
+    return HlDiag();
+  if (Sink)
+    Metrics.countDiagnostic(Level);
+  std::unique_ptr<utils::CachedDiagnostic> Record;
+  if (Cache)
+    Record = Cache->record(getID(), clang::SourceLocation(), Description,
+                           Level);
+  std::unique_ptr<utils::ExportedDiagnostic> Exported;
+  if (Export)
+    Exported = Export->record(getID(), clang::SourceLocation(), Description,
+                              Level);
+  return HlDiag(ClangTidyCheck::diag(Description, Level), Cache.get(),
+                std::move(Record), Export.get(), std::move(Exported));
+}
+
+std::optional<clang::TraversalKind>
+HlTidyCheck::getCheckTraversalKind() const {
+  if (Deduplicate && !requiresInstantiations())
+    return clang::TK_IgnoreUnlessSpelledInSource;
+  return ClangTidyCheck::getCheckTraversalKind();
+}
+
+void HlTidyCheck::registerModuleMatchers(
+    clang::ast_matchers::MatchFinder *Finder) {
+  using namespace clang::ast_matchers;
+  // The TranslationUnitDecl is matched before its children are traversed,
+  // and the traversal reads the scope only after that, so narrowing it here
+  // takes effect for this very pass.
+  if (Paths.isEnabled() || Cache || Export || Profile ||
+      HotPaths.isEnabled() || HotPaths.writesSummary() || Costs.isEnabled() ||
+      Coverage)
+    Finder->addMatcher(translationUnitDecl().bind(ScopeNodeId), this);
+}
+
+void HlTidyCheck::registerModulePPCallbacks(const clang::SourceManager &SM,
+                                            clang::Preprocessor *PP) {
+  if (Cache)
+    Cache->attach(SM, *PP);
+  if (Export)
+    Export->attach(SM, PP->getLangOpts());
+  if (Ranking)
+    Ranking->attach(SM);
+}
+
+bool HlTidyCheck::isDuplicate(
+    const clang::ast_matchers::MatchFinder::MatchResult &Result) {
+  const clang::SourceManager &SM = *Result.SourceManager;
+  llvm::SmallString<128> Key;
+  llvm::raw_svector_ostream OS(Key);
+  bool HasLocation = false;
+  // getMap() is ordered by ID, so equal matches produce equal keys.
+  for (const auto &Bound : Result.Nodes.getMap()) {
+    clang::SourceLocation Loc = Bound.second.getSourceRange().getBegin();
+    if (Loc.isValid()) {
+      Loc = SM.getSpellingLoc(Loc);
+      HasLocation = true;
+    }
+    OS << Bound.first << ':' << Loc.getRawEncoding() << ';';
+  }
+  // Without any location there is nothing to key on; never drop the match.
+  return HasLocation && !SeenMatches.insert(Key).second;
+}
+
+void HlTidyCheck::replayCached() {
+  for (const utils::CachedDiagnostic &Cached : Cache->hits()) {
+    if (Cached.Check != getID())
+      continue;
+    clang::SourceLocation Loc;
+    if (Cached.Loc)
+      Loc = Cache->decode(*Cached.Loc);
+    // The level was recorded after hot-path scoping, and dropped warnings
+    // were never recorded; only the annotations are computed again.
+    Annotations Annotated;
+    if (Cached.Level != clang::DiagnosticIDs::Note) {
+      if (HotPaths.isEnabled() && AST && isHotPathScoped())
+        HotPaths.classify(*AST, Loc, Cached.Level, Annotated.HotRoot);
+      Annotated.Hotness = hotnessAt(Loc);
+      Annotated.Score = scoreAt(Loc, Annotated.Hotness);
+    }
+    HlDiag D = emit(Loc, Cached.Description, Cached.Level, Annotated);
+    for (const utils::CachedArg &Arg : Cached.Args) {
+      switch (Arg.Kind) {
+      case utils::CachedArg::String:
+        D << llvm::StringRef(Arg.Text);
+        break;
+      case utils::CachedArg::Signed:
+        D << static_cast<int>(Arg.Value);
+        break;
+      case utils::CachedArg::Unsigned:
+        D << static_cast<unsigned>(Arg.Value);
+        break;
+      }
+    }
+    for (const utils::CachedRange &Range : Cached.Ranges)
+      D << Cache->decode(Range);
+    for (const utils::CachedFixIt &Fix : Cached.FixIts) {
+      clang::FixItHint Hint;
+      Hint.RemoveRange = Cache->decode(Fix.Remove);
+      Hint.CodeToInsert = Fix.Code;
+      Hint.BeforePreviousInsertions = Fix.BeforePreviousInsertions;
+      D << Hint;
+    }
+    if (Cached.Suggested)
+      D << *Cached.Suggested;
+  }
+}
+
+void HlTidyCheck::run(
+    const clang::ast_matchers::MatchFinder::MatchResult &Result) {
+  if (Result.Nodes.getNodeAs<clang::TranslationUnitDecl>(ScopeNodeId)) {
+    AST = Result.Context;
+    if (Export)
+      Export->setASTContext(*Result.Context);
+    // Before the cache lookup: a hit still has to contribute to the index.
+    HotPaths.writeSummary(*Result.Context, Profile.get());
+    // Every check sees this node; the first lookup decides for all of them.
+    if (Cache && Cache->lookup(*Result.Context, *Context)) {
+      replayCached();
+      if (Cache->skipsTraversal())
+        return;
+    }
+    if (Paths.isEnabled())
+      Paths.applyTo(*Result.Context);
+    return;
+  }
+
+  if (Cache && Cache->isHit())
+    return;
+
+  if (Deduplicate && isDuplicate(Result)) {
+    if (Sink)
+      ++Metrics.Deduplicated;
+    return;
+  }
+
+  if (!Sink) {
+    check(Result);
+    return;
+  }
+
+  ++Metrics.Callbacks;
+  for (const auto &Bound : Result.Nodes.getMap())
+    ++Metrics.BoundIds[Bound.first];
+
+  uint64_t DiagsBefore = Metrics.Warnings + Metrics.Notes;
+  auto Start = std::chrono::steady_clock::now();
+  check(Result);
+  Metrics.CallbackTime += std::chrono::steady_clock::now() - Start;
+  if (Metrics.Warnings + Metrics.Notes == DiagsBefore)
+    ++Metrics.EarlyReturns;
+}
+
+} // namespace tidy
+} // namespace hl
@@ -0,0 +1,351 @@
+//===--- HlTidyCheck.h - Common base for all hl-* checks --------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// Every hl-* check derives from HlTidyCheck instead of ClangTidyCheck
+// directly.  The base class is the one place where cross-cutting behaviour
+// is added to all checks without touching each of them:
+//
+//   - instrumentation (utils/CheckMetrics.h), enabled by
+//     `hl-module.MetricsDir`: it wraps every check() callback to count bound
+//     node IDs, time the callback and count the diagnostics it emits.
+//   - deduplication, enabled by `hl-module.Deduplicate`: checks only see
+//     code as spelled in the source (primary templates, no instantiations),
+//     and a match whose bound nodes have the same spelling locations as an
+//     earlier match (another expansion of the same macro, another
+//     instantiation for checks that opt out) is dropped before check().
+//     Checks that can only see their pattern in instantiated code override
+//     requiresInstantiations().
+//   - path filtering (utils/TraversalScope.h), enabled by
+//     `hl-module.ExcludeSystemHeaders`, `AnalyzedPaths` or `ExcludedPaths`:
+//     excluded top-level declarations are removed from the traversal scope
+//     before any matcher runs.
+//   - result caching (utils/ResultCache.h), enabled by `hl-module.CacheFile`:
+//     diagnostics are recorded as they are emitted and, for an unchanged TU,
+//     replayed from the cache instead of running the matchers.
+//   - structured export (utils/DiagnosticExport.h), enabled by
+//     `hl-module.ExportDir`: every warning and its notes are streamed to a
+//     per-TU NDJSON or SARIF file as they are emitted.
+//   - profile weighting (utils/Profile.h), enabled by
+//     `hl-module.ProfileFile`: each warning inside a function is annotated
+//     with the function's share of the profile, and warnings below
+//     `hl-module.ProfileMinHotness` are dropped together with their notes.
+//   - hot-path scoping (utils/HotPath.h), enabled by
+//     `hl-module.HotPathScoping`, `HotFunctions` or `HotIndex`: warnings of
+//     checks that override isHotPathScoped() are reported at `HotPathLevel`
+//     in functions reachable from a hot entry point and at `ColdPathLevel`
+//     elsewhere.  With `hl-module.SummaryDir`, each TU also writes its call
+//     summary for hl-tidy-index (utils/SummaryIndex.h).
+//   - cost scoring (utils/CostModel.h), enabled by `hl-module.CostModel` or
+//     `CostReport`: warnings of checks that override occurrenceCost() are
+//     annotated with an estimated cost, and the most expensive ones are
+//     listed per TU and per run.
+//   - coverage counts (utils/Coverage.h), enabled by `hl-module.CoverageFile`:
+//     loop-scoped checks ask loopExecution() how often a loop ran, drop
+//     findings in loops below `hl-module.CoverageMinCount` and report the
+//     counts in a note; the cost model uses line counts instead of assumed
+//     trip counts.
+//
+// Checks are registered through ModuleCheck<>, which adds the module-wide
+// matchers and preprocessor callbacks next to the check's own.
+//
+// Checks keep implementing registerMatchers() and check() as usual and call
+// diag() unqualified, which resolves to the overloads below.  They return an
+// HlDiag, which streams like a DiagnosticBuilder.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_CHECK_H
+#define HL_TIDY_CHECK_H
+
+#include "utils/CheckMetrics.h"
+#include "utils/CostModel.h"
+#include "utils/Coverage.h"
+#include "utils/DiagnosticExport.h"
+#include "utils/HotPath.h"
+#include "utils/Profile.h"
+#include "utils/ResultCache.h"
+#include "utils/TraversalScope.h"
+
+#include "clang-tidy/ClangTidyCheck.h"
+#include "llvm/ADT/StringSet.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace hl {
+namespace tidy {
+
+/// A DiagnosticBuilder that also records what is streamed into it when the
+/// result cache is recording, the export is enabled or the cost report
+/// ranks it.  Arguments the cache
+/// cannot store make the TU uncacheable instead of being replayed wrongly.
+/// A default-constructed HlDiag is a dropped diagnostic that ignores what is
+/// streamed into it.
+class HlDiag {
+public:
+  HlDiag() : Cache(nullptr), Export(nullptr), Ranking(nullptr) {}
+  HlDiag(clang::DiagnosticBuilder Builder, utils::CacheSession *Cache,
+         std::unique_ptr<utils::CachedDiagnostic> Record,
+         utils::ExportSession *Export,
+         std::unique_ptr<utils::ExportedDiagnostic> Exported,
+         utils::CostReport *Ranking = nullptr,
+         std::unique_ptr<utils::RankedFinding> Ranked = nullptr)
+      : Builder(std::in_place, std::move(Builder)), Cache(Cache),
+        Record(std::move(Record)), Export(Export),
+        Exported(std::move(Exported)), Ranking(Ranking),
+        Ranked(std::move(Ranked)) {}
+  HlDiag(const HlDiag &) = delete;
+  HlDiag &operator=(const HlDiag &) = delete;
+  ~HlDiag() {
+    // Builder emits the diagnostic right after this, so committing here
+    // keeps the cache and the export in emission order.
+    if (Record)
+      Cache->commit(std::move(Record));
+    if (Exported)
+      Export->commit(std::move(Exported));
+    if (Ranked)
+      Ranking->commit(std::move(Ranked));
+  }
+
+  template <typename T> const HlDiag &operator<<(const T &Value) const {
+    if (!Builder)
+      return *this;
+    *Builder << Value;
+    if (Record)
+      recordValue(Value);
+    if (Exported)
+      exportValue(Value);
+    if (Ranked)
+      rankValue(Value);
+    return *this;
+  }
+
+  /// Record the alternative a note recommends for the cache and the
+  /// export; the text of the diagnostic is not affected.
+  const HlDiag &operator<<(const utils::Suggestion &Suggested) const {
+    if (!Builder)
+      return *this;
+    if (Record)
+      Cache->addSuggestion(*Record, Suggested);
+    if (Exported)
+      Export->addSuggestion(*Exported, Suggested);
+    return *this;
+  }
+
+private:
+  template <typename T> void recordValue(const T &Value) const {
+    if constexpr (std::is_convertible_v<const T &, llvm::StringRef>)
+      Cache->addString(*Record, Value);
+    else if constexpr (std::is_integral_v<T> && sizeof(T) <= sizeof(int))
+      Cache->addInteger(*Record, std::is_signed_v<T>,
+                        static_cast<int64_t>(Value));
+    else if constexpr (std::is_same_v<T, clang::FixItHint>)
+      Cache->addFixIt(*Record, Value);
+    else if constexpr (std::is_same_v<T, clang::CharSourceRange>)
+      Cache->addRange(*Record, Value);
+    else if constexpr (std::is_same_v<T, clang::SourceRange>)
+      Cache->addRange(*Record, clang::CharSourceRange::getTokenRange(Value));
+    else
+      Cache->markUncacheable();
+  }
+
+  template <typename T> void exportValue(const T &Value) const {
+    if constexpr (std::is_convertible_v<const T &, llvm::StringRef>)
+      Export->addArgument(*Exported, llvm::StringRef(Value).str());
+    else if constexpr (std::is_integral_v<T>)
+      Export->addArgument(*Exported, std::to_string(Value));
+    else if constexpr (std::is_same_v<T, clang::FixItHint>)
+      Export->addFixIt(*Exported, Value);
+    // Ranges only highlight; they are not part of the exported record.
+  }
+
+  template <typename T> void rankValue(const T &Value) const {
+    if constexpr (std::is_convertible_v<const T &, llvm::StringRef>)
+      Ranking->addArgument(*Ranked, llvm::StringRef(Value).str());
+    else if constexpr (std::is_integral_v<T>)
+      Ranking->addArgument(*Ranked, std::to_string(Value));
+  }
+
+  std::optional<clang::DiagnosticBuilder> Builder;
+  utils::CacheSession *Cache;
+  std::unique_ptr<utils::CachedDiagnostic> Record;
+  utils::ExportSession *Export;
+  std::unique_ptr<utils::ExportedDiagnostic> Exported;
+  utils::CostReport *Ranking;
+  std::unique_ptr<utils::RankedFinding> Ranked;
+};
+
+class HlTidyCheck : public clang::tidy::ClangTidyCheck {
+public:
+  HlTidyCheck(llvm::StringRef Name, clang::tidy::ClangTidyContext *Context);
+  ~HlTidyCheck() override;
+
+  /// Same as ClangTidyCheck::diag(), but counted by the instrumentation,
+  /// recorded by the result cache, exported, weighted by the profile and
+  /// scored by the cost model.
+  HlDiag
+  diag(clang::SourceLocation Loc, llvm::StringRef Description,
+       clang::DiagnosticIDs::Level Level = clang::DiagnosticIDs::Warning);
+  HlDiag
+  diag(llvm::StringRef Description,
+       clang::DiagnosticIDs::Level Level = clang::DiagnosticIDs::Warning);
+
+  std::optional<clang::TraversalKind> getCheckTraversalKind() const override;
+
+  /// Register the matchers that implement module-wide behaviour.  Called by
+  /// ModuleCheck after the check's own registerMatchers().
+  void registerModuleMatchers(clang::ast_matchers::MatchFinder *Finder);
+
+  /// Register the preprocessor callbacks that implement module-wide
+  /// behaviour.  Called by ModuleCheck after the check's own
+  /// registerPPCallbacks().
+  void registerModulePPCallbacks(const clang::SourceManager &SM,
+                                 clang::Preprocessor *PP);
+
+protected:
+  clang::tidy::ClangTidyContext &getContext() const { return *Context; }
+
+  /// Return true if the check needs to see template instantiations, e.g.
+  /// because it matches member calls on containers whose type depends on a
+  /// template parameter.  Such checks keep the default traversal under
+  /// hl-module.Deduplicate and rely on location-based deduplication only.
+  virtual bool requiresInstantiations() const { return false; }
+
+  /// Return true if the check's findings only matter on the request path,
+  /// so that hot-path scoping escalates them inside the hot set and demotes
+  /// them outside it.
+  virtual bool isHotPathScoped() const { return false; }
+
+  /// What one occurrence of the flagged code costs at runtime; the cost
+  /// model scores the check's warnings from it.  None leaves them unscored.
+  virtual utils::Cost occurrenceCost() const { return utils::Cost::None; }
+
+  /// What the coverage run saw of \p Loop; nullopt without coverage data
+  /// for it.
+  std::optional<utils::LoopExecution>
+  loopExecution(const clang::Stmt *Loop) const;
+
+  /// Coverage count of the line \p Loc is on, if known.
+  std::optional<uint64_t> executionsAt(clang::SourceLocation Loc) const;
+
+  /// True if \p Executed shows fewer loop iterations than
+  /// hl-module.CoverageMinCount, so that findings in the loop are dropped.
+  bool isRarelyRun(const std::optional<utils::LoopExecution> &Executed) const {
+    return Executed && Executed->Iterations < MinLoopIterations;
+  }
+
+  /// Attach the observed counts of a loop to the last warning, as a note at
+  /// \p Loc.
+  void noteLoopExecution(clang::SourceLocation Loc,
+                         const utils::LoopExecution &Executed);
+
+private:
+  /// Wraps check() with the instrumentation.  ClangTidyCheck::run() only
+  /// forwards to check(), so nothing is lost by overriding it.
+  void run(const clang::ast_matchers::MatchFinder::MatchResult &Result)
+      override;
+
+  clang::tidy::ClangTidyContext *Context;
+
+  /// Return true if a match with the same bound-node spelling locations
+  /// was already passed to check().
+  bool isDuplicate(
+      const clang::ast_matchers::MatchFinder::MatchResult &Result);
+
+  /// Emit this check's diagnostics from a cache hit.
+  void replayCached();
+
+  /// What the module adds to a warning.
+  struct Annotations {
+    /// Profile hotness of the enclosing function.
+    std::optional<double> Hotness;
+    /// Cost-model score.
+    std::optional<double> Score;
+    /// Hot entry point the enclosing function is reached from.
+    std::optional<std::string> HotRoot;
+  };
+
+  /// Emit a diagnostic without filtering it: counted, recorded, exported
+  /// and ranked with \p Annotated as separate fields, and shown with them
+  /// appended to \p Description.
+  HlDiag emit(clang::SourceLocation Loc, llvm::StringRef Description,
+              clang::DiagnosticIDs::Level Level,
+              const Annotations &Annotated);
+
+  /// Profile hotness of the function containing \p Loc; 0 if the profile
+  /// has no samples for it, nullopt without a profile or function.
+  std::optional<double> hotnessAt(clang::SourceLocation Loc) const;
+
+  /// Cost-model score of a warning at \p Loc; nullopt if the model is off
+  /// or the check declares no cost.
+  std::optional<double> scoreAt(clang::SourceLocation Loc,
+                                std::optional<double> Hotness) const;
+
+  /// hl-module.ExcludeSystemHeaders / AnalyzedPaths / ExcludedPaths
+  utils::PathFilter Paths;
+
+  /// hl-module.Deduplicate
+  bool Deduplicate;
+  /// Keys of matches already passed to check(); see isDuplicate().
+  llvm::StringSet<> SeenMatches;
+
+  /// hl-module.HotPathScoping / HotFunctions / HotPathLevel / ColdPathLevel
+  utils::HotPathScope HotPaths;
+
+  /// Null unless hl-module.MetricsDir is set.
+  std::shared_ptr<utils::MetricsSink> Sink;
+  utils::CheckMetrics Metrics;
+
+  /// Null unless hl-module.CacheFile is set.
+  std::shared_ptr<utils::CacheSession> Cache;
+
+  /// Null unless hl-module.ExportDir is set.
+  std::shared_ptr<utils::ExportSession> Export;
+
+  /// Null unless hl-module.ProfileFile is set and could be loaded.
+  std::shared_ptr<const utils::Profile> Profile;
+  /// hl-module.ProfileMinHotness, in percent.
+  double MinHotness = 0;
+  /// hl-module.CostModel / CostLoopIterations
+  utils::CostModel Costs;
+  /// Null unless hl-module.CostReport is set.
+  std::shared_ptr<utils::CostReport> Ranking;
+
+  /// Null unless hl-module.CoverageFile is set and could be loaded.
+  std::shared_ptr<const utils::Coverage> Coverage;
+  /// hl-module.CoverageMinCount
+  uint64_t MinLoopIterations = 0;
+
+  /// True while the notes of a dropped warning are arriving.
+  bool DroppingNotes = false;
+
+  /// The TU being analysed; set by the translation-unit match.
+  clang::ASTContext *AST = nullptr;
+};
+
+/// Final check type registered with clang-tidy: \p CheckT plus the
+/// module-wide matchers and preprocessor callbacks from HlTidyCheck.
+template <typename CheckT> class ModuleCheck final : public CheckT {
+public:
+  using CheckT::CheckT;
+
+  void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override {
+    CheckT::registerMatchers(Finder);
+    this->registerModuleMatchers(Finder);
+  }
+
+  void registerPPCallbacks(const clang::SourceManager &SM,
+                           clang::Preprocessor *PP,
+                           clang::Preprocessor *ModuleExpanderPP) override {
+    CheckT::registerPPCallbacks(SM, PP, ModuleExpanderPP);
+    this->registerModulePPCallbacks(SM, PP);
+  }
+};
+
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_CHECK_H
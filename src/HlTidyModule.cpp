@@ -10,8 +10,10 @@
 //===----------------------------------------------------------------------===//
 
 #include "HlTidyModule.h"
+#include "HlTidyCheck.h"
 
 // Core performance checks (C++17 baseline).
+#include "checks/AtomicMemoryOrderCheck.h"
 #include "checks/AvoidCoutCerrCheck.h"
 #include "checks/AvoidDynamicCastCheck.h"
 #include "checks/AvoidStdAnyCheck.h"
@@ -20,6 +22,11 @@
 #include "checks/AvoidStdFunctionCheck.h"
 #include "checks/AvoidStdRegexCheck.h"
 #include "checks/AvoidVirtualInLoopCheck.h"
+#include "checks/BlockingUnderLockCheck.h"
+#include "checks/ContainerInLoopBodyCheck.h"
+#include "checks/FalseSharingCheck.h"
+#include "checks/LargeByValueParamCheck.h"
+#include "checks/LockInLoopCheck.h"
 #include "checks/PreferEmplaceCheck.h"
 #include "checks/PreferFromCharsCheck.h"
 #include "checks/PreferNoexceptMoveCheck.h"
@@ -27,6 +34,9 @@
 #include "checks/PreferStringViewCheck.h"
 #include "checks/PreferUniquePtrCheck.h"
 #include "checks/PreferVectorOverListCheck.h"
+#include "checks/RangeForCopyCheck.h"
+#include "checks/StringConcatInLoopCheck.h"
+#include "checks/StructLayoutCheck.h"
 
 // C++20 modernisation checks.
 #include "checks/PreferContainsCheck.h"
@@ -53,86 +63,113 @@
 namespace hl {
 namespace tidy {
 
+/// Register \p CheckT wrapped in ModuleCheck, so that it also gets the
+/// module-wide matchers (see HlTidyCheck).
+template <typename CheckT>
+static void
+registerHlCheck(clang::tidy::ClangTidyCheckFactories &CheckFactories,
+                llvm::StringRef Name) {
+  CheckFactories.registerCheck<ModuleCheck<CheckT>>(Name);
+}
+
 void HlTidyModule::addCheckFactories(
     clang::tidy::ClangTidyCheckFactories &CheckFactories) {
 
   // -----------------------------------------------------------------------
   // Core performance checks — always relevant for high-load services.
   // -----------------------------------------------------------------------
-  CheckFactories.registerCheck<checks::AvoidStdFunctionCheck>(
-      "hl-perf-avoid-std-function");
-  CheckFactories.registerCheck<checks::AvoidStdRegexCheck>(
-      "hl-perf-avoid-std-regex");
-  CheckFactories.registerCheck<checks::AvoidStdEndlCheck>(
-      "hl-perf-avoid-std-endl");
-  CheckFactories.registerCheck<checks::PreferVectorOverListCheck>(
-      "hl-perf-prefer-vector");
-  CheckFactories.registerCheck<checks::PreferStringViewCheck>(
-      "hl-perf-prefer-string-view");
-  CheckFactories.registerCheck<checks::PreferFromCharsCheck>(
-      "hl-perf-prefer-from-chars");
-  CheckFactories.registerCheck<checks::AvoidStdAnyCheck>(
-      "hl-perf-avoid-std-any");
-  CheckFactories.registerCheck<checks::PreferUniquePtrCheck>(
-      "hl-perf-prefer-unique-ptr");
-  CheckFactories.registerCheck<checks::PreferReserveCheck>(
-      "hl-perf-prefer-reserve");
-  CheckFactories.registerCheck<checks::AvoidDynamicCastCheck>(
-      "hl-perf-avoid-dynamic-cast");
-  CheckFactories.registerCheck<checks::AvoidStdBindCheck>(
-      "hl-perf-avoid-std-bind");
-  CheckFactories.registerCheck<checks::PreferEmplaceCheck>(
-      "hl-perf-prefer-emplace");
-  CheckFactories.registerCheck<checks::PreferNoexceptMoveCheck>(
-      "hl-perf-prefer-noexcept-move");
-  CheckFactories.registerCheck<checks::AvoidCoutCerrCheck>(
-      "hl-perf-avoid-cout-cerr");
-  CheckFactories.registerCheck<checks::AvoidVirtualInLoopCheck>(
-      "hl-perf-avoid-virtual-in-loop");
+  registerHlCheck<checks::AvoidStdFunctionCheck>(
+      CheckFactories, "hl-perf-avoid-std-function");
+  registerHlCheck<checks::AvoidStdRegexCheck>(
+      CheckFactories, "hl-perf-avoid-std-regex");
+  registerHlCheck<checks::AvoidStdEndlCheck>(
+      CheckFactories, "hl-perf-avoid-std-endl");
+  registerHlCheck<checks::PreferVectorOverListCheck>(
+      CheckFactories, "hl-perf-prefer-vector");
+  registerHlCheck<checks::PreferStringViewCheck>(
+      CheckFactories, "hl-perf-prefer-string-view");
+  registerHlCheck<checks::PreferFromCharsCheck>(
+      CheckFactories, "hl-perf-prefer-from-chars");
+  registerHlCheck<checks::AvoidStdAnyCheck>(
+      CheckFactories, "hl-perf-avoid-std-any");
+  registerHlCheck<checks::PreferUniquePtrCheck>(
+      CheckFactories, "hl-perf-prefer-unique-ptr");
+  registerHlCheck<checks::PreferReserveCheck>(
+      CheckFactories, "hl-perf-prefer-reserve");
+  registerHlCheck<checks::AvoidDynamicCastCheck>(
+      CheckFactories, "hl-perf-avoid-dynamic-cast");
+  registerHlCheck<checks::AvoidStdBindCheck>(
+      CheckFactories, "hl-perf-avoid-std-bind");
+  registerHlCheck<checks::PreferEmplaceCheck>(
+      CheckFactories, "hl-perf-prefer-emplace");
+  registerHlCheck<checks::PreferNoexceptMoveCheck>(
+      CheckFactories, "hl-perf-prefer-noexcept-move");
+  registerHlCheck<checks::AvoidCoutCerrCheck>(
+      CheckFactories, "hl-perf-avoid-cout-cerr");
+  registerHlCheck<checks::AvoidVirtualInLoopCheck>(
+      CheckFactories, "hl-perf-avoid-virtual-in-loop");
+  registerHlCheck<checks::ContainerInLoopBodyCheck>(
+      CheckFactories, "hl-perf-container-in-loop-body");
+  registerHlCheck<checks::RangeForCopyCheck>(
+      CheckFactories, "hl-perf-range-for-copy");
+  registerHlCheck<checks::LargeByValueParamCheck>(
+      CheckFactories, "hl-perf-large-by-value-param");
+  registerHlCheck<checks::StructLayoutCheck>(
+      CheckFactories, "hl-perf-struct-layout");
+  registerHlCheck<checks::FalseSharingCheck>(
+      CheckFactories, "hl-perf-false-sharing");
+  registerHlCheck<checks::AtomicMemoryOrderCheck>(
+      CheckFactories, "hl-perf-atomic-memory-order");
+  registerHlCheck<checks::LockInLoopCheck>(
+      CheckFactories, "hl-perf-lock-in-loop");
+  registerHlCheck<checks::BlockingUnderLockCheck>(
+      CheckFactories, "hl-perf-blocking-under-lock");
+  registerHlCheck<checks::StringConcatInLoopCheck>(
+      CheckFactories, "hl-perf-string-concat-in-loop");
 
   // -----------------------------------------------------------------------
   // C++20 modernisation — active only when -std=c++20 or later.
   // -----------------------------------------------------------------------
-  CheckFactories.registerCheck<checks::PreferJthreadCheck>(
-      "hl-modernize-prefer-jthread");
-  CheckFactories.registerCheck<checks::PreferFormatCheck>(
-      "hl-modernize-prefer-format");
-  CheckFactories.registerCheck<checks::PreferSpanCheck>(
-      "hl-modernize-prefer-span");
-  CheckFactories.registerCheck<checks::PreferStartsEndsWithCheck>(
-      "hl-modernize-prefer-starts-ends-with");
-  CheckFactories.registerCheck<checks::PreferContainsCheck>(
-      "hl-modernize-prefer-contains");
-  CheckFactories.registerCheck<checks::PreferEraseIfCheck>(
-      "hl-modernize-prefer-erase-if");
+  registerHlCheck<checks::PreferJthreadCheck>(
+      CheckFactories, "hl-modernize-prefer-jthread");
+  registerHlCheck<checks::PreferFormatCheck>(
+      CheckFactories, "hl-modernize-prefer-format");
+  registerHlCheck<checks::PreferSpanCheck>(
+      CheckFactories, "hl-modernize-prefer-span");
+  registerHlCheck<checks::PreferStartsEndsWithCheck>(
+      CheckFactories, "hl-modernize-prefer-starts-ends-with");
+  registerHlCheck<checks::PreferContainsCheck>(
+      CheckFactories, "hl-modernize-prefer-contains");
+  registerHlCheck<checks::PreferEraseIfCheck>(
+      CheckFactories, "hl-modernize-prefer-erase-if");
 
   // -----------------------------------------------------------------------
   // C++23 modernisation — active only when -std=c++23 or later.
   // -----------------------------------------------------------------------
-  CheckFactories.registerCheck<checks::PreferExpectedCheck>(
-      "hl-modernize-prefer-expected");
-  CheckFactories.registerCheck<checks::PreferFlatContainersCheck>(
-      "hl-modernize-prefer-flat-containers");
-  CheckFactories.registerCheck<checks::PreferMoveOnlyFunctionCheck>(
-      "hl-modernize-prefer-move-only-function");
-  CheckFactories.registerCheck<checks::PreferUnreachableCheck>(
-      "hl-modernize-prefer-unreachable");
-  CheckFactories.registerCheck<checks::PreferToUnderlyingCheck>(
-      "hl-modernize-prefer-to-underlying");
-  CheckFactories.registerCheck<checks::PreferPrintCheck>(
-      "hl-modernize-prefer-print");
+  registerHlCheck<checks::PreferExpectedCheck>(
+      CheckFactories, "hl-modernize-prefer-expected");
+  registerHlCheck<checks::PreferFlatContainersCheck>(
+      CheckFactories, "hl-modernize-prefer-flat-containers");
+  registerHlCheck<checks::PreferMoveOnlyFunctionCheck>(
+      CheckFactories, "hl-modernize-prefer-move-only-function");
+  registerHlCheck<checks::PreferUnreachableCheck>(
+      CheckFactories, "hl-modernize-prefer-unreachable");
+  registerHlCheck<checks::PreferToUnderlyingCheck>(
+      CheckFactories, "hl-modernize-prefer-to-underlying");
+  registerHlCheck<checks::PreferPrintCheck>(
+      CheckFactories, "hl-modernize-prefer-print");
 
   // -----------------------------------------------------------------------
   // C++26 modernisation — active only when -std=c++26 or later.
   // -----------------------------------------------------------------------
-  CheckFactories.registerCheck<checks::PreferFunctionRefCheck>(
-      "hl-modernize-prefer-function-ref");
-  CheckFactories.registerCheck<checks::PreferInplaceVectorCheck>(
-      "hl-modernize-prefer-inplace-vector");
-  CheckFactories.registerCheck<checks::PreferCopyableFunctionCheck>(
-      "hl-modernize-prefer-copyable-function");
-  CheckFactories.registerCheck<checks::PreferHiveCheck>(
-      "hl-modernize-prefer-hive");
+  registerHlCheck<checks::PreferFunctionRefCheck>(
+      CheckFactories, "hl-modernize-prefer-function-ref");
+  registerHlCheck<checks::PreferInplaceVectorCheck>(
+      CheckFactories, "hl-modernize-prefer-inplace-vector");
+  registerHlCheck<checks::PreferCopyableFunctionCheck>(
+      CheckFactories, "hl-modernize-prefer-copyable-function");
+  registerHlCheck<checks::PreferHiveCheck>(
+      CheckFactories, "hl-modernize-prefer-hive");
 }
 
 } // namespace tidy
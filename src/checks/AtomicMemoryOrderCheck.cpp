@@ -0,0 +1,562 @@
+//===--- AtomicMemoryOrderCheck.cpp -*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "AtomicMemoryOrderCheck.h"
+#include "utils/LoopContext.h"
+#include "utils/StdSymbols.h"
+#include "utils/TranslationUnitCache.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclTemplate.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/Lex/Lexer.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringSwitch.h"
+
+#include <optional>
+#include <string>
+
+using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+namespace {
+
+enum class OpKind { Load, Store, Update, Exchange, CompareExchange, Wait };
+
+/// An operation on an atomic object.
+struct Operation {
+  OpKind Kind;
+  /// The atomic, or a pointer to it for `p->load()`.
+  const clang::Expr *Object;
+  bool Arrow = false;
+  /// ++, --, +=, -=, fetch_add and fetch_sub.
+  bool Arithmetic = false;
+  /// Uses the default memory_order_seq_cst.
+  bool Implicit = false;
+  /// Member function that takes an explicit order: the operation itself,
+  /// or what an operator or conversion does, e.g. "fetch_add" for `++`.
+  llvm::StringRef Method;
+  /// Argument that is the default order of a member function call.
+  const clang::Expr *DefaultOrder = nullptr;
+  /// Stored, exchanged or added value; null for ++ and --.
+  const clang::Expr *Operand = nullptr;
+  /// How diagnostics name the operation: "++", "load()".
+  std::string Spelling;
+  /// Where it is reported: the operator, the member name, or the start of
+  /// an implicitly converted object.
+  clang::SourceLocation Loc;
+};
+
+bool isAtomicType(clang::QualType T, clang::ASTContext &Ctx) {
+  const clang::CXXRecordDecl *RD = T->getAsCXXRecordDecl();
+  return RD && utils::StdSymbols::get(Ctx).is(
+                   RD, {StdSymbol::Atomic, StdSymbol::AtomicFlag});
+}
+
+std::optional<Operation> classifyOperation(const clang::Expr *E,
+                                           clang::ASTContext &Ctx) {
+  Operation Op;
+  if (const auto *Call = llvm::dyn_cast<clang::CXXOperatorCallExpr>(E)) {
+    if (Call->getNumArgs() == 0 ||
+        !isAtomicType(Call->getArg(0)->IgnoreParenImpCasts()->getType(), Ctx))
+      return std::nullopt;
+    Op.Object = Call->getArg(0)->IgnoreParenImpCasts();
+    Op.Implicit = true;
+    Op.Loc = Call->getOperatorLoc();
+    if (Call->getNumArgs() == 2)
+      Op.Operand = Call->getArg(1);
+    Op.Kind = OpKind::Update;
+    switch (Call->getOperator()) {
+    case clang::OO_PlusPlus:
+      Op.Operand = nullptr;
+      Op.Arithmetic = true;
+      Op.Method = "fetch_add";
+      Op.Spelling = "++";
+      break;
+    case clang::OO_MinusMinus:
+      Op.Operand = nullptr;
+      Op.Arithmetic = true;
+      Op.Method = "fetch_sub";
+      Op.Spelling = "--";
+      break;
+    case clang::OO_PlusEqual:
+      Op.Arithmetic = true;
+      Op.Method = "fetch_add";
+      Op.Spelling = "+=";
+      break;
+    case clang::OO_MinusEqual:
+      Op.Arithmetic = true;
+      Op.Method = "fetch_sub";
+      Op.Spelling = "-=";
+      break;
+    case clang::OO_AmpEqual:
+      Op.Method = "fetch_and";
+      Op.Spelling = "&=";
+      break;
+    case clang::OO_PipeEqual:
+      Op.Method = "fetch_or";
+      Op.Spelling = "|=";
+      break;
+    case clang::OO_CaretEqual:
+      Op.Method = "fetch_xor";
+      Op.Spelling = "^=";
+      break;
+    case clang::OO_Equal:
+      Op.Kind = OpKind::Store;
+      Op.Method = "store";
+      Op.Spelling = "=";
+      break;
+    default:
+      return std::nullopt;
+    }
+    return Op;
+  }
+
+  const auto *Call = llvm::dyn_cast<clang::CXXMemberCallExpr>(E);
+  if (!Call || !Call->getMethodDecl() || !Call->getImplicitObjectArgument())
+    return std::nullopt;
+  const clang::CXXMethodDecl *MD = Call->getMethodDecl();
+  Op.Object = Call->getImplicitObjectArgument()->IgnoreParenImpCasts();
+  clang::QualType T = Op.Object->getType();
+  if (T->isPointerType()) {
+    T = T->getPointeeType();
+    Op.Arrow = true;
+  }
+  if (!isAtomicType(T, Ctx))
+    return std::nullopt;
+
+  if (llvm::isa<clang::CXXConversionDecl>(MD)) {
+    Op.Kind = OpKind::Load;
+    Op.Implicit = true;
+    Op.Method = "load";
+    Op.Spelling = "implicit load";
+    Op.Loc = Op.Object->getBeginLoc();
+    return Op;
+  }
+  if (!MD->getIdentifier())
+    return std::nullopt;
+  // Index of the memory_order parameter; compare_exchange_* with a single
+  // order has it third.
+  struct Shape {
+    OpKind Kind;
+    unsigned OrderIndex;
+    bool Arithmetic;
+  };
+  std::optional<Shape> S =
+      llvm::StringSwitch<std::optional<Shape>>(MD->getName())
+          .Case("load", Shape{OpKind::Load, 0, false})
+          .Case("test", Shape{OpKind::Load, 0, false})
+          .Case("store", Shape{OpKind::Store, 1, false})
+          .Case("clear", Shape{OpKind::Store, 0, false})
+          .Case("exchange", Shape{OpKind::Exchange, 1, false})
+          .Case("test_and_set", Shape{OpKind::Exchange, 0, false})
+          .Cases("fetch_add", "fetch_sub", Shape{OpKind::Update, 1, true})
+          .Cases("fetch_and", "fetch_or", "fetch_xor",
+                 Shape{OpKind::Update, 1, false})
+          .Cases("fetch_max", "fetch_min", Shape{OpKind::Update, 1, false})
+          .Cases("compare_exchange_weak", "compare_exchange_strong",
+                 Shape{OpKind::CompareExchange, 2, false})
+          .Case("wait", Shape{OpKind::Wait, 1, false})
+          .Default(std::nullopt);
+  if (!S || Call->getNumArgs() <= S->OrderIndex)
+    return std::nullopt;
+  Op.Kind = S->Kind;
+  Op.Arithmetic = S->Arithmetic;
+  Op.Method = MD->getName();
+  Op.Spelling = (MD->getName() + "()").str();
+  Op.Loc = Call->getExprLoc();
+  const clang::Expr *Order = Call->getArg(S->OrderIndex);
+  Op.Implicit = llvm::isa<clang::CXXDefaultArgExpr>(Order);
+  if (Op.Implicit)
+    Op.DefaultOrder = Order;
+  if (S->OrderIndex == 1)
+    Op.Operand = Call->getArg(0);
+  return Op;
+}
+
+/// The variable or field an atomic expression names, if any.  Elements of
+/// an array count as the array.
+const clang::ValueDecl *objectDecl(const clang::Expr *Object) {
+  Object = Object->IgnoreParenImpCasts();
+  if (const auto *Subscript = llvm::dyn_cast<clang::ArraySubscriptExpr>(Object))
+    Object = Subscript->getBase()->IgnoreParenImpCasts();
+  if (const auto *Ref = llvm::dyn_cast<clang::DeclRefExpr>(Object))
+    if (const auto *Var = llvm::dyn_cast<clang::VarDecl>(Ref->getDecl()))
+      return Var->getCanonicalDecl();
+  if (const auto *Member = llvm::dyn_cast<clang::MemberExpr>(Object))
+    if (const auto *Field =
+            llvm::dyn_cast<clang::FieldDecl>(Member->getMemberDecl()))
+      return Field->getCanonicalDecl();
+  return nullptr;
+}
+
+enum class ResultUse { Discarded, Condition, Value };
+
+/// What the code does with the value of \p E.
+ResultUse resultUse(const clang::Expr *E, clang::ASTContext &Ctx) {
+  const clang::Stmt *Child = E;
+  clang::DynTypedNodeList Parents = Ctx.getParents(*Child);
+  while (!Parents.empty()) {
+    const clang::Stmt *Parent = Parents[0].get<clang::Stmt>();
+    if (!Parent)
+      return ResultUse::Value;
+    // Comparisons and negations pass the value on to a condition.
+    const auto *BO = llvm::dyn_cast<clang::BinaryOperator>(Parent);
+    const auto *UO = llvm::dyn_cast<clang::UnaryOperator>(Parent);
+    if (llvm::isa<clang::ParenExpr, clang::ImplicitCastExpr,
+                  clang::ExprWithCleanups, clang::MaterializeTemporaryExpr>(
+            Parent) ||
+        (BO && (BO->isComparisonOp() || BO->isLogicalOp())) ||
+        (UO && UO->getOpcode() == clang::UO_LNot)) {
+      Child = Parent;
+      Parents = Ctx.getParents(*Child);
+      continue;
+    }
+    if (BO && BO->getOpcode() == clang::BO_Comma)
+      return BO->getLHS() == Child ? ResultUse::Discarded : ResultUse::Value;
+    if (const auto *Cast = llvm::dyn_cast<clang::CastExpr>(Parent))
+      return Cast->getType()->isVoidType() ? ResultUse::Discarded
+                                           : ResultUse::Value;
+    if (llvm::isa<clang::CompoundStmt>(Parent))
+      return ResultUse::Discarded;
+    if (const auto *If = llvm::dyn_cast<clang::IfStmt>(Parent))
+      return If->getCond() == Child ? ResultUse::Condition
+                                    : ResultUse::Discarded;
+    if (const auto *While = llvm::dyn_cast<clang::WhileStmt>(Parent))
+      return While->getCond() == Child ? ResultUse::Condition
+                                       : ResultUse::Discarded;
+    if (const auto *Do = llvm::dyn_cast<clang::DoStmt>(Parent))
+      return Do->getCond() == Child ? ResultUse::Condition
+                                    : ResultUse::Discarded;
+    if (const auto *For = llvm::dyn_cast<clang::ForStmt>(Parent)) {
+      if (For->getCond() == Child)
+        return ResultUse::Condition;
+      return For->getInc() == Child || For->getBody() == Child
+                 ? ResultUse::Discarded
+                 : ResultUse::Value;
+    }
+    if (const auto *Range = llvm::dyn_cast<clang::CXXForRangeStmt>(Parent))
+      return Range->getBody() == Child ? ResultUse::Discarded
+                                       : ResultUse::Value;
+    if (const auto *Cond =
+            llvm::dyn_cast<clang::AbstractConditionalOperator>(Parent))
+      return Cond->getCond() == Child ? ResultUse::Condition
+                                      : ResultUse::Value;
+    return ResultUse::Value;
+  }
+  return ResultUse::Value;
+}
+
+bool isZero(const clang::Expr *E) {
+  const auto *Literal =
+      llvm::dyn_cast_or_null<clang::IntegerLiteral>(E->IgnoreParenImpCasts());
+  return Literal && Literal->getValue() == 0;
+}
+
+/// What the translation unit does with each atomic variable and field.
+class AtomicRoles {
+public:
+  explicit AtomicRoles(clang::ASTContext &Ctx);
+
+  /// True if \p D is only updated arithmetically and reset to zero, with
+  /// the results discarded: a statistic that orders no other memory in
+  /// this translation unit.
+  bool isCounter(const clang::ValueDecl *D) const {
+    auto It = Objects.find(D);
+    return It != Objects.end() && It->second.Counts &&
+           !It->second.Synchronizes;
+  }
+
+  /// True if every reference to the atomic variable \p Var is one of its
+  /// operations: its address is not taken, no reference is bound to it and
+  /// no lambda captures it, so nothing reaches it through a pointer.
+  bool onlyOperatedOn(const clang::VarDecl *Var) const {
+    auto It = Objects.find(Var->getCanonicalDecl());
+    return It != Objects.end() && !It->second.Captured &&
+           It->second.References == It->second.Operations;
+  }
+
+  /// Number of operations on the local atomic \p Var if nothing but those
+  /// operations refers to it, so that no other thread can reach it; zero
+  /// otherwise.
+  unsigned privateOperations(const clang::VarDecl *Var) const {
+    if (!onlyOperatedOn(Var))
+      return 0;
+    return Objects.find(Var->getCanonicalDecl())->second.Operations;
+  }
+
+private:
+  friend class RoleCollector;
+
+  struct Info {
+    bool Counts = false;
+    bool Synchronizes = false;
+    bool Captured = false;
+    unsigned References = 0;
+    unsigned Operations = 0;
+  };
+
+  llvm::DenseMap<const clang::ValueDecl *, Info> Objects;
+};
+
+class RoleCollector : public clang::RecursiveASTVisitor<RoleCollector> {
+public:
+  RoleCollector(AtomicRoles &Roles, clang::ASTContext &Ctx)
+      : Roles(Roles), Ctx(Ctx) {}
+
+  bool shouldVisitTemplateInstantiations() const { return true; }
+
+  bool VisitCXXOperatorCallExpr(clang::CXXOperatorCallExpr *E) {
+    record(E);
+    return true;
+  }
+
+  bool VisitCXXMemberCallExpr(clang::CXXMemberCallExpr *E) {
+    record(E);
+    return true;
+  }
+
+  bool VisitDeclRefExpr(clang::DeclRefExpr *E) {
+    const auto *Var = llvm::dyn_cast<clang::VarDecl>(E->getDecl());
+    if (!Var || !isAtomicType(Var->getType(), Ctx))
+      return true;
+    AtomicRoles::Info &Info = Roles.Objects[Var->getCanonicalDecl()];
+    ++Info.References;
+    if (E->refersToEnclosingVariableOrCapture())
+      Info.Captured = true;
+    return true;
+  }
+
+private:
+  void record(const clang::Expr *E) {
+    std::optional<Operation> Op = classifyOperation(E, Ctx);
+    if (!Op)
+      return;
+    const clang::ValueDecl *Object = objectDecl(Op->Object);
+    if (!Object)
+      return;
+    AtomicRoles::Info &Info = Roles.Objects[Object];
+    if (llvm::isa<clang::DeclRefExpr>(Op->Object) && !Op->Arrow)
+      ++Info.Operations;
+    // Resetting to zero orders nothing by itself; a loaded value that is
+    // used at all, even just returned or stored, may decide whether other
+    // memory is read.
+    ResultUse Use = resultUse(E, Ctx);
+    bool Neutral =
+        (Op->Kind == OpKind::Load && Use == ResultUse::Discarded) ||
+        (Op->Kind == OpKind::Store && Op->Operand && isZero(Op->Operand));
+    if (Op->Arithmetic && Use == ResultUse::Discarded)
+      Info.Counts = true;
+    else if (!Neutral)
+      Info.Synchronizes = true;
+  }
+
+  AtomicRoles &Roles;
+  clang::ASTContext &Ctx;
+};
+
+AtomicRoles::AtomicRoles(clang::ASTContext &Ctx) {
+  RoleCollector Collector(*this, Ctx);
+  Collector.TraverseAST(Ctx);
+}
+
+/// Source text of \p E, or an empty string inside macros.
+std::string sourceText(const clang::Expr *E, clang::ASTContext &Ctx) {
+  clang::CharSourceRange Range =
+      clang::CharSourceRange::getTokenRange(E->getSourceRange());
+  if (Range.getBegin().isMacroID() || Range.getEnd().isMacroID())
+    return {};
+  return clang::Lexer::getSourceText(Range, Ctx.getSourceManager(),
+                                     Ctx.getLangOpts())
+      .str();
+}
+
+/// Replaces \p E, an operator or conversion, or completes the call with a
+/// relaxed order.
+std::optional<clang::FixItHint> relaxedFix(const clang::Expr *E,
+                                           const Operation &Op,
+                                           clang::ASTContext &Ctx) {
+  constexpr llvm::StringLiteral Relaxed = "std::memory_order_relaxed";
+  if (const auto *Call = llvm::dyn_cast<clang::CXXMemberCallExpr>(E);
+      Call && Op.DefaultOrder) {
+    clang::SourceLocation RParen = Call->getRParenLoc();
+    if (RParen.isMacroID())
+      return std::nullopt;
+    bool First = Call->getArg(0) == Op.DefaultOrder;
+    return clang::FixItHint::CreateInsertion(
+        RParen, ((First ? "" : ", ") + Relaxed).str());
+  }
+
+  std::string Object = sourceText(Op.Object, Ctx);
+  if (Object.empty())
+    return std::nullopt;
+  if (!llvm::isa<clang::DeclRefExpr, clang::MemberExpr,
+                 clang::ArraySubscriptExpr, clang::ParenExpr>(Op.Object))
+    Object = "(" + Object + ")";
+  Object += Op.Arrow ? "->" : ".";
+  if (Op.Kind == OpKind::Load)
+    return clang::FixItHint::CreateReplacement(
+        Op.Object->getSourceRange(),
+        Object + "load(" + Relaxed.str() + ")");
+
+  // fetch_add returns the old value and ++ the new one, so only rewrite
+  // operators whose result is unused.
+  if (resultUse(E, Ctx) != ResultUse::Discarded)
+    return std::nullopt;
+  std::string Operand = Op.Operand ? sourceText(Op.Operand, Ctx) : "1";
+  if (Operand.empty() || E->getBeginLoc().isMacroID() ||
+      E->getEndLoc().isMacroID())
+    return std::nullopt;
+  return clang::FixItHint::CreateReplacement(
+      E->getSourceRange(),
+      Object + Op.Method.str() + "(" + Operand + ", " + Relaxed.str() + ")");
+}
+
+} // namespace
+
+AtomicMemoryOrderCheck::AtomicMemoryOrderCheck(
+    llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
+    : HlTidyCheck(Name, Context) {}
+
+void AtomicMemoryOrderCheck::registerMatchers(MatchFinder *Finder) {
+  auto AtomicType = hasUnqualifiedDesugaredType(recordType(hasDeclaration(
+      namedDecl(isStdSymbol({StdSymbol::Atomic, StdSymbol::AtomicFlag})))));
+  Finder->addMatcher(
+      cxxOperatorCallExpr(
+          hasArgument(0, ignoringParenImpCasts(hasType(AtomicType))))
+          .bind("operation"),
+      this);
+  Finder->addMatcher(
+      cxxMemberCallExpr(on(anyOf(hasType(AtomicType),
+                                 hasType(pointsTo(AtomicType)))))
+          .bind("operation"),
+      this);
+  Finder->addMatcher(
+      varDecl(hasLocalStorage(), unless(parmVarDecl()), hasType(AtomicType))
+          .bind("local"),
+      this);
+}
+
+void AtomicMemoryOrderCheck::check(const MatchFinder::MatchResult &Result) {
+  if (const auto *E = Result.Nodes.getNodeAs<clang::Expr>("operation"))
+    checkOperation(E, *Result.Context);
+  else if (const auto *Var = Result.Nodes.getNodeAs<clang::VarDecl>("local"))
+    checkLocal(Var, *Result.Context);
+}
+
+void AtomicMemoryOrderCheck::checkOperation(const clang::Expr *E,
+                                            clang::ASTContext &Ctx) {
+  std::optional<Operation> Op = classifyOperation(E, Ctx);
+  if (!Op || !Op->Implicit || Op->Loc.isMacroID())
+    return;
+  const AtomicRoles &Roles = utils::getPerTU<AtomicRoles>(Ctx);
+  const clang::ValueDecl *Object = objectDecl(Op->Object);
+  // Locals only one thread can reach are reported once, at the declaration.
+  if (const auto *Var = llvm::dyn_cast_or_null<clang::VarDecl>(Object))
+    if (Var->hasLocalStorage() && !Op->Arrow && Roles.privateOperations(Var))
+      return;
+
+  const clang::Stmt *Loop = utils::LoopContext::get(Ctx).innermostLoop(E);
+  std::optional<utils::LoopExecution> Executed;
+  if (Loop) {
+    Executed = loopExecution(Loop);
+    if (isRarelyRun(Executed))
+      return;
+  }
+  bool Counter = Object && Roles.isCounter(Object);
+  if (!Counter && !Loop)
+    return;
+
+  std::string Name = sourceText(Op->Object, Ctx);
+  if (Name.empty())
+    Name = Object ? Object->getNameAsString() : "atomic";
+  if (Op->Arrow)
+    Name = "*" + Name;
+
+  if (Counter) {
+    // Other translation units may order memory through a field or an
+    // atomic with external linkage, and other code through a pointer or
+    // reference to it, so only what this one sees whole is rewritten: a
+    // local or internal atomic that is referred to only by its operations,
+    // or a load whose value is not used.
+    const auto *Var = llvm::dyn_cast_or_null<clang::VarDecl>(Object);
+    bool Internal = !Op->Arrow && Var &&
+                    (Var->hasLocalStorage() || !Var->isExternallyVisible());
+    bool Contained =
+        (Internal && Roles.onlyOperatedOn(Var)) ||
+        (Op->Kind == OpKind::Load &&
+         resultUse(E, Ctx) == ResultUse::Discarded);
+    {
+      auto D = diag(Op->Loc,
+                    "'%0' on counter '%1' uses the default seq_cst "
+                    "ordering%2; this translation unit only updates '%1', "
+                    "never using it to order other memory, so "
+                    "std::memory_order_relaxed is enough");
+      D << Op->Spelling << Name << (Loop ? " inside a loop" : "");
+      if (Contained)
+        if (std::optional<clang::FixItHint> Fix = relaxedFix(E, *Op, Ctx))
+          D << *Fix;
+    }
+    if (!Contained)
+      diag(Op->Arrow ? Op->Loc : Object->getLocation(),
+           "not rewritten automatically: '%0' %1",
+           clang::DiagnosticIDs::Note)
+          << Name
+          << (Internal ? "is captured by reference or has its address taken, "
+                         "so code using it through a pointer may rely on its "
+                         "ordering"
+                       : "is reachable from other translation units, which "
+                         "may use it to order memory");
+  } else {
+    bool Load = Op->Kind == OpKind::Load || Op->Kind == OpKind::Wait;
+    llvm::StringRef Suggested = Load                       ? "acquire"
+                                : Op->Kind == OpKind::Store ? "release"
+                                                            : "acq_rel";
+    diag(Op->Loc,
+         "'%0' on '%1' inside a loop uses the default seq_cst ordering, "
+         "%2; std::memory_order_%3 is enough unless the algorithm needs a "
+         "single total order over several atomics")
+        << Op->Spelling << Name
+        << (Load ? "which adds a barrier on every iteration on ARM and POWER"
+                 : "a full fence on every iteration")
+        << Suggested;
+  }
+  if (Executed)
+    noteLoopExecution(Op->Loc, *Executed);
+}
+
+void AtomicMemoryOrderCheck::checkLocal(const clang::VarDecl *Var,
+                                        clang::ASTContext &Ctx) {
+  if (Var->getLocation().isMacroID() || Var->isTemplated())
+    return;
+  unsigned Operations =
+      utils::getPerTU<AtomicRoles>(Ctx).privateOperations(Var);
+  if (Operations == 0)
+    return;
+
+  std::string Plain = "bool";
+  if (const auto *Spec =
+          llvm::dyn_cast<clang::ClassTemplateSpecializationDecl>(
+              Var->getType()->getAsCXXRecordDecl()))
+    if (Spec->getTemplateArgs().size() != 0 &&
+        Spec->getTemplateArgs()[0].getKind() ==
+            clang::TemplateArgument::Type)
+      Plain = Spec->getTemplateArgs()[0].getAsType().getAsString(
+          Ctx.getPrintingPolicy());
+  diag(Var->getLocation(),
+       "'%0' is a local atomic that never leaves this function: no other "
+       "thread can reach it, so its %1 operations pay for locked "
+       "instructions and fences for nothing; use a plain '%2'")
+      << Var->getName() << Operations << Plain;
+}
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
@@ -0,0 +1,70 @@
+//===--- AtomicMemoryOrderCheck.h - hl-perf-atomic-memory-order *- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// Flags operations on std::atomic and std::atomic_flag that use the default
+// memory_order_seq_cst: `counter++`, `flag.load()`, `x.store(v)`, implicit
+// conversions.  A sequentially consistent store or read-modify-write is a
+// full fence on x86, and every seq_cst access adds barriers on ARM and
+// POWER.  Not every such operation is reported; they are graded by what the
+// translation unit does with the atomic:
+//
+//   - a local atomic that never leaves its function -- not captured by
+//     reference, its address not taken, not passed anywhere -- is only
+//     touched by one thread: it is reported once, suggesting a plain
+//     variable;
+//   - a counter -- only updated with ++, --, +=, -=, fetch_add or fetch_sub
+//     and reset to 0, the results discarded; a load whose value is used at
+//     all, even just returned or stored, may order other memory -- orders
+//     nothing in this translation unit: every seq_cst operation on it is
+//     reported.  The std::memory_order_relaxed fix-it is only offered for
+//     local atomics and those with internal linkage, which no other
+//     translation unit can use, when nothing but those operations refers
+//     to them (no address taken, reference bound or lambda capture), and
+//     for loads whose value is discarded;
+//   - any other seq_cst operation inside a loop is reported with the
+//     acquire, release or acq_rel order that is usually enough, and no
+//     fix-it, since some algorithms need the single total order.
+//
+// References:
+//   - Herb Sutter, "atomic<> Weapons" (C++ and Beyond 2012)
+//   - https://en.cppreference.com/w/cpp/atomic/memory_order
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_CHECKS_ATOMIC_MEMORY_ORDER_CHECK_H
+#define HL_TIDY_CHECKS_ATOMIC_MEMORY_ORDER_CHECK_H
+
+#include "HlTidyCheck.h"
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+class AtomicMemoryOrderCheck : public HlTidyCheck {
+public:
+  AtomicMemoryOrderCheck(llvm::StringRef Name,
+                         clang::tidy::ClangTidyContext *Context);
+
+  bool isLanguageVersionSupported(const clang::LangOptions &LangOpts) const override {
+    return LangOpts.CPlusPlus11;
+  }
+
+  void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
+  void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// A locked instruction or a fence per operation.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::AtomicRMW;
+  }
+
+private:
+  void checkOperation(const clang::Expr *E, clang::ASTContext &Ctx);
+  void checkLocal(const clang::VarDecl *Var, clang::ASTContext &Ctx);
+};
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_CHECKS_ATOMIC_MEMORY_ORDER_CHECK_H
@@ -5,8 +5,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -14,22 +17,22 @@ namespace checks {
 
 AvoidCoutCerrCheck::AvoidCoutCerrCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void AvoidCoutCerrCheck::registerMatchers(MatchFinder *Finder) {
   // Match references to std::cout.
   Finder->addMatcher(
-      declRefExpr(to(namedDecl(hasName("::std::cout")))).bind("cout_ref"),
+      declRefExpr(to(namedDecl(isStdSymbol(StdSymbol::Cout)))).bind("cout_ref"),
       this);
 
   // Match references to std::cerr.
   Finder->addMatcher(
-      declRefExpr(to(namedDecl(hasName("::std::cerr")))).bind("cerr_ref"),
+      declRefExpr(to(namedDecl(isStdSymbol(StdSymbol::Cerr)))).bind("cerr_ref"),
       this);
 
   // Match references to std::clog.
   Finder->addMatcher(
-      declRefExpr(to(namedDecl(hasName("::std::clog")))).bind("clog_ref"),
+      declRefExpr(to(namedDecl(isStdSymbol(StdSymbol::Clog)))).bind("clog_ref"),
       this);
 }
 
@@ -66,7 +69,8 @@ void AvoidCoutCerrCheck::check(const MatchFinder::MatchResult &Result) {
   diag(Loc,
        "for non-logging output, consider fmt::print or std::format "
        "(C++20) with explicit file descriptor writes",
-       clang::DiagnosticIDs::Note);
+       clang::DiagnosticIDs::Note)
+      << utils::Suggestion{"fmt::print", ""};
 }
 
 } // namespace checks
@@ -22,13 +22,13 @@
 #ifndef HL_TIDY_CHECKS_AVOID_COUT_CERR_CHECK_H
 #define HL_TIDY_CHECKS_AVOID_COUT_CERR_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class AvoidCoutCerrCheck : public clang::tidy::ClangTidyCheck {
+class AvoidCoutCerrCheck : public HlTidyCheck {
 public:
   AvoidCoutCerrCheck(llvm::StringRef Name,
                      clang::tidy::ClangTidyContext *Context);
@@ -39,6 +39,15 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// Console output only contends on the request path.
+  bool isHotPathScoped() const override { return true; }
+
+  /// Each insertion takes the stream lock.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::StreamLock;
+  }
 };
 
 } // namespace checks
@@ -14,7 +14,7 @@ namespace checks {
 
 AvoidDynamicCastCheck::AvoidDynamicCastCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void AvoidDynamicCastCheck::registerMatchers(MatchFinder *Finder) {
   Finder->addMatcher(
@@ -41,7 +41,8 @@ void AvoidDynamicCastCheck::check(
   diag(Cast->getExprLoc(),
        "Chromium, LLVM, and most game engines build with -fno-rtti; "
        "consider CRTP for compile-time polymorphism",
-       clang::DiagnosticIDs::Note);
+       clang::DiagnosticIDs::Note)
+      << utils::Suggestion{"CRTP", ""};
 }
 
 } // namespace checks
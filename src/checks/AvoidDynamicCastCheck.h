@@ -17,13 +17,13 @@
 #ifndef HL_TIDY_CHECKS_AVOID_DYNAMIC_CAST_CHECK_H
 #define HL_TIDY_CHECKS_AVOID_DYNAMIC_CAST_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class AvoidDynamicCastCheck : public clang::tidy::ClangTidyCheck {
+class AvoidDynamicCastCheck : public HlTidyCheck {
 public:
   AvoidDynamicCastCheck(llvm::StringRef Name,
                         clang::tidy::ClangTidyContext *Context);
@@ -34,6 +34,12 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// dynamic_cast walks the type_info hierarchy.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::RttiLookup;
+  }
 };
 
 } // namespace checks
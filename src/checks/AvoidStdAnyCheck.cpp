@@ -5,8 +5,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -14,27 +17,30 @@ namespace checks {
 
 AvoidStdAnyCheck::AvoidStdAnyCheck(llvm::StringRef Name,
                                    clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void AvoidStdAnyCheck::registerMatchers(MatchFinder *Finder) {
   // Variable declarations with std::any type.
   Finder->addMatcher(
-      varDecl(hasType(namedDecl(hasName("::std::any")))).bind("any_var"),
+      varDecl(hasType(namedDecl(isStdSymbol(StdSymbol::Any))))
+          .bind("any_var"),
       this);
 
   // Field declarations.
   Finder->addMatcher(
-      fieldDecl(hasType(namedDecl(hasName("::std::any")))).bind("any_field"),
+      fieldDecl(hasType(namedDecl(isStdSymbol(StdSymbol::Any))))
+          .bind("any_field"),
       this);
 
   // Function parameters.
   Finder->addMatcher(
-      parmVarDecl(hasType(namedDecl(hasName("::std::any")))).bind("any_param"),
+      parmVarDecl(hasType(namedDecl(isStdSymbol(StdSymbol::Any))))
+          .bind("any_param"),
       this);
 
   // Calls to std::any_cast (indicates std::any usage).
   Finder->addMatcher(
-      callExpr(callee(functionDecl(hasName("::std::any_cast"))))
+      callExpr(callee(functionDecl(isStdSymbol(StdSymbol::AnyCast))))
           .bind("any_cast"),
       this);
 }
@@ -69,7 +75,8 @@ void AvoidStdAnyCheck::check(const MatchFinder::MatchResult &Result) {
   diag(Loc,
        "if the type set is truly open, consider template-based "
        "polymorphism or a custom type-erased wrapper with SBO",
-       clang::DiagnosticIDs::Note);
+       clang::DiagnosticIDs::Note)
+      << utils::Suggestion{"template-based polymorphism", ""};
 }
 
 } // namespace checks
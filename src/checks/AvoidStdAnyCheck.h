@@ -13,13 +13,13 @@
 #ifndef HL_TIDY_CHECKS_AVOID_STD_ANY_CHECK_H
 #define HL_TIDY_CHECKS_AVOID_STD_ANY_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class AvoidStdAnyCheck : public clang::tidy::ClangTidyCheck {
+class AvoidStdAnyCheck : public HlTidyCheck {
 public:
   AvoidStdAnyCheck(llvm::StringRef Name,
                    clang::tidy::ClangTidyContext *Context);
@@ -30,6 +30,16 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// std::any_cast<T>(A) on a dependent operand is an unresolved call
+  /// until instantiated.
+  bool requiresInstantiations() const override { return true; }
+
+  /// std::any stores anything above its small buffer on the heap.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::HeapAllocation;
+  }
 };
 
 } // namespace checks
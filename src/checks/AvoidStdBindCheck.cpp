@@ -5,8 +5,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -14,25 +17,25 @@ namespace checks {
 
 AvoidStdBindCheck::AvoidStdBindCheck(llvm::StringRef Name,
                                      clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void AvoidStdBindCheck::registerMatchers(MatchFinder *Finder) {
   // Match calls to std::bind.
   Finder->addMatcher(
-      callExpr(callee(functionDecl(hasName("::std::bind"))))
+      callExpr(callee(functionDecl(isStdSymbol(StdSymbol::Bind))))
           .bind("bind_call"),
       this);
 
   // Match calls to std::bind_front (C++20) — less problematic but still
   // prefer lambdas for consistency and inlining.
   Finder->addMatcher(
-      callExpr(callee(functionDecl(hasName("::std::bind_front"))))
+      callExpr(callee(functionDecl(isStdSymbol(StdSymbol::BindFront))))
           .bind("bind_front_call"),
       this);
 
   // Match calls to std::bind_back (C++23).
   Finder->addMatcher(
-      callExpr(callee(functionDecl(hasName("::std::bind_back"))))
+      callExpr(callee(functionDecl(isStdSymbol(StdSymbol::BindBack))))
           .bind("bind_back_call"),
       this);
 }
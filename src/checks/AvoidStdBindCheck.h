@@ -22,13 +22,13 @@
 #ifndef HL_TIDY_CHECKS_AVOID_STD_BIND_CHECK_H
 #define HL_TIDY_CHECKS_AVOID_STD_BIND_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class AvoidStdBindCheck : public clang::tidy::ClangTidyCheck {
+class AvoidStdBindCheck : public HlTidyCheck {
 public:
   AvoidStdBindCheck(llvm::StringRef Name,
                     clang::tidy::ClangTidyContext *Context);
@@ -39,6 +39,16 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// std::bind with dependent arguments is an unresolved call until
+  /// instantiated.
+  bool requiresInstantiations() const override { return true; }
+
+  /// The bound callable is invoked through a pointer.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::IndirectCall;
+  }
 };
 
 } // namespace checks
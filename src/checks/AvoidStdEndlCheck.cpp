@@ -6,8 +6,11 @@
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 #include "clang/Lex/Lexer.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -15,12 +18,12 @@ namespace checks {
 
 AvoidStdEndlCheck::AvoidStdEndlCheck(llvm::StringRef Name,
                                      clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void AvoidStdEndlCheck::registerMatchers(MatchFinder *Finder) {
   // Match any reference to std::endl.
   Finder->addMatcher(
-      declRefExpr(to(namedDecl(hasName("::std::endl")))).bind("endl"),
+      declRefExpr(to(namedDecl(isStdSymbol(StdSymbol::Endl)))).bind("endl"),
       this);
 }
 
@@ -39,13 +42,16 @@ void AvoidStdEndlCheck::check(const MatchFinder::MatchResult &Result) {
       EndlRef->getSourceRange());
   auto EndlText = clang::Lexer::getSourceText(Range, SM, LO);
 
-  auto D = diag(Loc,
-                "std::endl forces a stream flush on every call; "
-                "use '\\n' instead — up to 10x faster in I/O-intensive code");
+  {
+    // Scoped so the warning is emitted before the note below.
+    auto D = diag(Loc,
+                  "std::endl forces a stream flush on every call; "
+                  "use '\\n' instead — up to 10x faster in I/O-intensive code");
 
-  // Provide a FixIt hint: replace std::endl → '\n'.
-  if (!EndlText.empty()) {
-    D << clang::FixItHint::CreateReplacement(Range, "'\\n'");
+    // Provide a FixIt hint: replace std::endl → '\n'.
+    if (!EndlText.empty()) {
+      D << clang::FixItHint::CreateReplacement(Range, "'\\n'");
+    }
   }
 
   diag(Loc,
@@ -15,13 +15,13 @@
 #ifndef HL_TIDY_CHECKS_AVOID_STD_ENDL_CHECK_H
 #define HL_TIDY_CHECKS_AVOID_STD_ENDL_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class AvoidStdEndlCheck : public clang::tidy::ClangTidyCheck {
+class AvoidStdEndlCheck : public HlTidyCheck {
 public:
   AvoidStdEndlCheck(llvm::StringRef Name,
                     clang::tidy::ClangTidyContext *Context);
@@ -32,6 +32,16 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// `s << std::endl` on a dependent stream names std::endl through an
+  /// unresolved lookup until instantiated.
+  bool requiresInstantiations() const override { return true; }
+
+  /// Each std::endl flushes the stream: a write() syscall.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::StreamFlush;
+  }
 };
 
 } // namespace checks
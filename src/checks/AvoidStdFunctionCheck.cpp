@@ -7,8 +7,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -16,24 +19,24 @@ namespace checks {
 
 AvoidStdFunctionCheck::AvoidStdFunctionCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void AvoidStdFunctionCheck::registerMatchers(MatchFinder *Finder) {
   // Match variable declarations whose type is std::function<...>.
   Finder->addMatcher(
-      varDecl(hasType(namedDecl(hasName("::std::function"))))
+      varDecl(hasType(namedDecl(isStdSymbol(StdSymbol::Function))))
           .bind("var"),
       this);
 
   // Match function parameters typed as std::function<...>.
   Finder->addMatcher(
-      parmVarDecl(hasType(namedDecl(hasName("::std::function"))))
+      parmVarDecl(hasType(namedDecl(isStdSymbol(StdSymbol::Function))))
           .bind("param"),
       this);
 
   // Match field declarations (class members).
   Finder->addMatcher(
-      fieldDecl(hasType(namedDecl(hasName("::std::function"))))
+      fieldDecl(hasType(namedDecl(isStdSymbol(StdSymbol::Function))))
           .bind("field"),
       this);
 
@@ -41,7 +44,7 @@ void AvoidStdFunctionCheck::registerMatchers(MatchFinder *Finder) {
   // Use hasUnderlyingType to match the aliased type.
   Finder->addMatcher(
       typeAliasDecl(hasUnderlyingType(
-          hasDeclaration(namedDecl(hasName("::std::function")))))
+          hasDeclaration(namedDecl(isStdSymbol(StdSymbol::Function)))))
           .bind("alias"),
       this);
 }
@@ -89,14 +92,16 @@ void AvoidStdFunctionCheck::check(
     diag(Loc,
          "if ownership transfer is needed, consider "
          "std::move_only_function (C++23) — avoids copy overhead",
-         clang::DiagnosticIDs::Note);
+         clang::DiagnosticIDs::Note)
+        << utils::Suggestion{"std::move_only_function", "C++23"};
   }
 
   if (utils::hasAtLeast(Std, utils::CppStandard::Cpp26)) {
     diag(Loc,
          "for non-owning callable parameters, consider "
          "std::function_ref (C++26) — zero-overhead type-erased reference",
-         clang::DiagnosticIDs::Note);
+         clang::DiagnosticIDs::Note)
+        << utils::Suggestion{"std::function_ref", "C++26"};
   }
 
   // If the project is limited to C++17/20, mention future alternatives.
@@ -17,13 +17,13 @@
 #ifndef HL_TIDY_CHECKS_AVOID_STD_FUNCTION_CHECK_H
 #define HL_TIDY_CHECKS_AVOID_STD_FUNCTION_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class AvoidStdFunctionCheck : public clang::tidy::ClangTidyCheck {
+class AvoidStdFunctionCheck : public HlTidyCheck {
 public:
   AvoidStdFunctionCheck(llvm::StringRef Name,
                         clang::tidy::ClangTidyContext *Context);
@@ -34,6 +34,15 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// The allocation and indirect call only matter on the request path.
+  bool isHotPathScoped() const override { return true; }
+
+  /// Constructing a std::function from a large callable allocates.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::HeapAllocation;
+  }
 };
 
 } // namespace checks
@@ -5,8 +5,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -14,25 +17,24 @@ namespace checks {
 
 AvoidStdRegexCheck::AvoidStdRegexCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void AvoidStdRegexCheck::registerMatchers(MatchFinder *Finder) {
+  auto RegexType = namedDecl(isStdSymbol(
+      {StdSymbol::BasicRegex, StdSymbol::Regex, StdSymbol::WRegex}));
+
   // Match construction of std::regex / std::basic_regex.
   Finder->addMatcher(
-      cxxConstructExpr(hasType(namedDecl(matchesName("::std::(basic_)?regex"))))
-          .bind("regex_ctor"),
-      this);
+      cxxConstructExpr(hasType(RegexType)).bind("regex_ctor"), this);
 
   // Match variable declarations of regex type.
-  Finder->addMatcher(
-      varDecl(hasType(namedDecl(matchesName("::std::(basic_)?regex"))))
-          .bind("regex_var"),
-      this);
+  Finder->addMatcher(varDecl(hasType(RegexType)).bind("regex_var"), this);
 
   // Match calls to std::regex_search, std::regex_match, std::regex_replace.
   Finder->addMatcher(
       callExpr(callee(functionDecl(
-                   matchesName("::std::regex_(search|match|replace)"))))
+                   isStdSymbol({StdSymbol::RegexSearch, StdSymbol::RegexMatch,
+                                StdSymbol::RegexReplace}))))
           .bind("regex_call"),
       this);
 }
@@ -66,7 +68,8 @@ void AvoidStdRegexCheck::check(const MatchFinder::MatchResult &Result) {
   diag(Loc,
        "for simple string matching consider std::string::find(), "
        "std::string_view::find(), or hand-written parsers",
-       clang::DiagnosticIDs::Note);
+       clang::DiagnosticIDs::Note)
+      << utils::Suggestion{"std::string::find()", ""};
 }
 
 } // namespace checks
@@ -19,13 +19,13 @@
 #ifndef HL_TIDY_CHECKS_AVOID_STD_REGEX_CHECK_H
 #define HL_TIDY_CHECKS_AVOID_STD_REGEX_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class AvoidStdRegexCheck : public clang::tidy::ClangTidyCheck {
+class AvoidStdRegexCheck : public HlTidyCheck {
 public:
   AvoidStdRegexCheck(llvm::StringRef Name,
                      clang::tidy::ClangTidyContext *Context);
@@ -36,6 +36,19 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// std::regex_search() with dependent arguments is an unresolved call
+  /// until instantiated.
+  bool requiresInstantiations() const override { return true; }
+
+  /// A regex built once at startup is harmless; one per request is not.
+  bool isHotPathScoped() const override { return true; }
+
+  /// Each std::regex construction compiles the pattern.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::RegexConstruction;
+  }
 };
 
 } // namespace checks
@@ -2,6 +2,7 @@
 // Author: Aleksandr Loshkarev
 
 #include "AvoidVirtualInLoopCheck.h"
+#include "utils/LoopContext.h"
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
@@ -14,46 +15,20 @@ namespace checks {
 
 AvoidVirtualInLoopCheck::AvoidVirtualInLoopCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void AvoidVirtualInLoopCheck::registerMatchers(MatchFinder *Finder) {
-  // Match virtual method calls inside any loop construct.
-  auto VirtualCallMatcher =
-      cxxMemberCallExpr(
-          on(hasType(pointsTo(cxxRecordDecl()))),
-          callee(cxxMethodDecl(isVirtual())))
-          .bind("vcall_in_loop");
-
-  // Also match calls through references.
-  auto VirtualCallRefMatcher =
+  // Match virtual method calls through a pointer or a reference.  Whether the
+  // call runs once per loop iteration is answered by the shared LoopContext
+  // in check(), so every call site is visited once no matter how many loops
+  // surround it.
+  Finder->addMatcher(
       cxxMemberCallExpr(
-          on(hasType(references(cxxRecordDecl()))),
+          on(anyOf(hasType(pointsTo(cxxRecordDecl())),
+                   hasType(references(cxxRecordDecl())))),
           callee(cxxMethodDecl(isVirtual())))
-          .bind("vcall_in_loop");
-
-  // For loops.
-  Finder->addMatcher(
-      forStmt(hasDescendant(VirtualCallMatcher)), this);
-  Finder->addMatcher(
-      forStmt(hasDescendant(VirtualCallRefMatcher)), this);
-
-  // While loops.
-  Finder->addMatcher(
-      whileStmt(hasDescendant(VirtualCallMatcher)), this);
-  Finder->addMatcher(
-      whileStmt(hasDescendant(VirtualCallRefMatcher)), this);
-
-  // Do-while loops.
-  Finder->addMatcher(
-      doStmt(hasDescendant(VirtualCallMatcher)), this);
-  Finder->addMatcher(
-      doStmt(hasDescendant(VirtualCallRefMatcher)), this);
-
-  // Range-for loops.
-  Finder->addMatcher(
-      cxxForRangeStmt(hasDescendant(VirtualCallMatcher)), this);
-  Finder->addMatcher(
-      cxxForRangeStmt(hasDescendant(VirtualCallRefMatcher)), this);
+          .bind("vcall_in_loop"),
+      this);
 }
 
 void AvoidVirtualInLoopCheck::check(
@@ -67,6 +42,14 @@ void AvoidVirtualInLoopCheck::check(
   if (!Method)
     return;
 
+  const clang::Stmt *Loop =
+      utils::LoopContext::get(*Result.Context).innermostLoop(VCall);
+  if (!Loop)
+    return;
+  std::optional<utils::LoopExecution> Executed = loopExecution(Loop);
+  if (isRarelyRun(Executed))
+    return;
+
   diag(VCall->getExprLoc(),
        "virtual call to '%0' inside a loop: indirect dispatch prevents "
        "inlining and causes branch predictor misses")
@@ -75,12 +58,16 @@ void AvoidVirtualInLoopCheck::check(
   diag(VCall->getExprLoc(),
        "consider CRTP, std::variant + std::visit, or 'if constexpr' "
        "with type tags for compile-time dispatch",
-       clang::DiagnosticIDs::Note);
+       clang::DiagnosticIDs::Note)
+      << utils::Suggestion{"CRTP", ""};
 
   diag(VCall->getExprLoc(),
        "if dynamic dispatch is required, cache the function pointer "
        "before the loop or batch-process by concrete type",
        clang::DiagnosticIDs::Note);
+
+  if (Executed)
+    noteLoopExecution(VCall->getExprLoc(), *Executed);
 }
 
 } // namespace checks
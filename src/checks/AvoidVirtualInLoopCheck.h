@@ -25,13 +25,13 @@
 #ifndef HL_TIDY_CHECKS_AVOID_VIRTUAL_IN_LOOP_CHECK_H
 #define HL_TIDY_CHECKS_AVOID_VIRTUAL_IN_LOOP_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class AvoidVirtualInLoopCheck : public clang::tidy::ClangTidyCheck {
+class AvoidVirtualInLoopCheck : public HlTidyCheck {
 public:
   AvoidVirtualInLoopCheck(llvm::StringRef Name,
                           clang::tidy::ClangTidyContext *Context);
@@ -42,6 +42,15 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// Calls through a T* only resolve to a virtual method once T is known.
+  bool requiresInstantiations() const override { return true; }
+
+  /// Each iteration pays an indirect call.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::IndirectCall;
+  }
 };
 
 } // namespace checks
@@ -0,0 +1,207 @@
+//===--- BlockingUnderLockCheck.cpp - hl-perf-blocking-under-lock ---------===//
+// Author: Aleksandr Loshkarev
+
+#include "BlockingUnderLockCheck.h"
+#include "utils/CriticalSections.h"
+#include "utils/StdSymbols.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include <string>
+
+using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+namespace {
+
+constexpr llvm::StringLiteral DefaultBlockingFunctions =
+    "::read;::write;::pread;::pwrite;::readv;::writev;"
+    "::fsync;::fdatasync;::sync;::open;::openat;::close;"
+    "::fopen;::fclose;::fread;::fwrite;::fflush;::fgets;::fputs;::puts;"
+    "::printf;::fprintf;"
+    "::send;::sendto;::sendmsg;::recv;::recvfrom;::recvmsg;"
+    "::connect;::accept;::accept4;::poll;::select;::epoll_wait;"
+    "::sleep;::usleep;::nanosleep;"
+    "::std::this_thread::sleep_for;::std::this_thread::sleep_until;"
+    "::getaddrinfo;::gethostbyname;::gethostbyname_r;::gethostbyaddr;"
+    "::system;::popen;::pclose;::waitpid";
+
+/// std::ifstream, std::ofstream or std::fstream.
+auto fileStreamType() {
+  return hasUnqualifiedDesugaredType(recordType(hasDeclaration(
+      namedDecl(isStdSymbol({StdSymbol::BasicFstream, StdSymbol::BasicIfstream,
+                             StdSymbol::BasicOfstream})))));
+}
+
+/// How diagnostics name a file stream type.
+llvm::StringRef fileStreamName(clang::QualType T, clang::ASTContext &Ctx) {
+  const clang::CXXRecordDecl *RD =
+      T.getNonReferenceType()->getAsCXXRecordDecl();
+  std::optional<StdSymbol> S =
+      RD ? utils::StdSymbols::get(Ctx).classify(RD) : std::nullopt;
+  if (S == StdSymbol::BasicIfstream)
+    return "std::ifstream";
+  if (S == StdSymbol::BasicOfstream)
+    return "std::ofstream";
+  return "std::fstream";
+}
+
+/// How diagnostics name the global stream \p Stream refers to.
+llvm::StringRef standardStreamName(const clang::DeclRefExpr *Stream,
+                                   clang::ASTContext &Ctx) {
+  std::optional<StdSymbol> S =
+      utils::StdSymbols::get(Ctx).classify(Stream->getDecl());
+  if (S == StdSymbol::Cerr)
+    return "std::cerr";
+  if (S == StdSymbol::Clog)
+    return "std::clog";
+  return "std::cout";
+}
+
+} // namespace
+
+BlockingUnderLockCheck::BlockingUnderLockCheck(
+    llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
+    : HlTidyCheck(Name, Context),
+      BlockingFunctions(
+          Options.get("BlockingFunctions", DefaultBlockingFunctions)) {}
+
+void BlockingUnderLockCheck::registerMatchers(MatchFinder *Finder) {
+  llvm::SmallVector<llvm::StringRef, 48> Names;
+  for (llvm::StringRef Name :
+       llvm::split(llvm::StringRef(BlockingFunctions), ';')) {
+    Name = Name.trim();
+    if (!Name.empty())
+      Names.push_back(Name);
+  }
+
+  // Whether a lock is held is decided in check() by
+  // utils::enclosingCriticalSection().
+  if (!Names.empty())
+    Finder->addMatcher(
+        callExpr(callee(functionDecl(hasAnyName(Names)))).bind("blocking"),
+        this);
+
+  // The streams hl-perf-avoid-cout-cerr reports: one reference per
+  // insertion chain.
+  Finder->addMatcher(
+      declRefExpr(to(namedDecl(isStdSymbol(
+                      {StdSymbol::Cout, StdSymbol::Cerr, StdSymbol::Clog}))))
+          .bind("stream"),
+      this);
+
+  // File stream I/O: the member calls that read, write, flush, open, close
+  // or seek (not is_open(), good() and other state queries), and the
+  // innermost call of an insertion or extraction chain (or std::getline)
+  // that takes the stream.  Opening one is a construction with a file name.
+  Finder->addMatcher(
+      cxxMemberCallExpr(on(expr(hasType(fileStreamType())).bind("file")),
+                        callee(cxxMethodDecl(hasAnyName(
+                            "read", "write", "get", "getline", "put", "flush",
+                            "open", "close", "seekg", "seekp"))),
+                        unless(callee(functionDecl(hasAnyName(Names)))))
+          .bind("file_call"),
+      this);
+  Finder->addMatcher(
+      callExpr(unless(cxxMemberCallExpr()),
+               hasAnyArgument(ignoringParenImpCasts(
+                   expr(hasType(fileStreamType())).bind("file"))),
+               unless(callee(functionDecl(hasAnyName(Names)))))
+          .bind("file_call"),
+      this);
+  Finder->addMatcher(
+      cxxConstructExpr(hasType(fileStreamType()),
+                       hasArgument(0, unless(hasType(fileStreamType()))))
+          .bind("file_open"),
+      this);
+
+  Finder->addMatcher(cxxNewExpr().bind("allocation"), this);
+  Finder->addMatcher(
+      callExpr(callee(functionDecl(hasAnyName(
+                   "::malloc", "::calloc", "::realloc", "::aligned_alloc",
+                   "::posix_memalign", "::strdup", "::std::make_shared",
+                   "::std::make_unique", "::std::allocate_shared"))))
+          .bind("allocation"),
+      this);
+}
+
+void BlockingUnderLockCheck::check(const MatchFinder::MatchResult &Result) {
+  clang::ASTContext &Ctx = *Result.Context;
+  const clang::Stmt *S = nullptr;
+  clang::SourceLocation Loc;
+  std::string What;
+
+  if (const auto *Call = Result.Nodes.getNodeAs<clang::CallExpr>("blocking")) {
+    S = Call;
+    Loc = Call->getBeginLoc();
+    What = "'" + Call->getDirectCallee()->getQualifiedNameAsString() +
+           "' can block in the kernel";
+  } else if (const auto *Ref =
+                 Result.Nodes.getNodeAs<clang::DeclRefExpr>("stream")) {
+    S = Ref;
+    Loc = Ref->getExprLoc();
+    What = "output to '" + standardStreamName(Ref, Ctx).str() +
+           "' takes the stream lock and can block on the terminal or pipe";
+  } else if (const auto *Call =
+                 Result.Nodes.getNodeAs<clang::CallExpr>("file_call")) {
+    const auto *Stream = Result.Nodes.getNodeAs<clang::Expr>("file");
+    S = Call;
+    Loc = Call->getExprLoc();
+    What = "'" + fileStreamName(Stream->getType(), Ctx).str() +
+           "' I/O can block on the disk";
+  } else if (const auto *Open =
+                 Result.Nodes.getNodeAs<clang::CXXConstructExpr>("file_open")) {
+    S = Open;
+    Loc = Open->getLocation();
+    What = "opening a '" + fileStreamName(Open->getType(), Ctx).str() +
+           "' can block on the disk";
+  } else if (const auto *New =
+                 Result.Nodes.getNodeAs<clang::CXXNewExpr>("allocation")) {
+    // Placement new constructs in storage that is already there.
+    if (New->getOperatorNew() &&
+        New->getOperatorNew()->isReservedGlobalPlacementOperator())
+      return;
+    S = New;
+    Loc = New->getBeginLoc();
+    What = "'new' can take the allocator's lock or fault in pages";
+  } else if (const auto *Call =
+                 Result.Nodes.getNodeAs<clang::CallExpr>("allocation")) {
+    S = Call;
+    Loc = Call->getBeginLoc();
+    What = "'" + Call->getDirectCallee()->getQualifiedNameAsString() +
+           "' allocates, and can take the allocator's lock or fault in pages";
+  }
+  if (!S || Loc.isMacroID())
+    return;
+
+  std::optional<utils::CriticalSection> Section =
+      utils::enclosingCriticalSection(S, Ctx);
+  if (!Section)
+    return;
+  std::string Mutex = utils::mutexSpelling(*Section, Ctx);
+
+  {
+    auto D = diag(Loc, "%0 while '%1' is held: every other thread that "
+                       "needs '%1' waits for it too; do it before taking "
+                       "the lock or after releasing it");
+    D << What << Mutex;
+  }
+  std::string By = Section->Kind.str();
+  if (Section->Guard)
+    By += " '" + Section->Guard->getNameAsString() + "'";
+  diag(Section->Acquire->getBeginLoc(), "'%0' is locked here by %1",
+       clang::DiagnosticIDs::Note)
+      << Mutex << By;
+}
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
@@ -0,0 +1,68 @@
+//===--- BlockingUnderLockCheck.h - hl-perf-blocking-under-lock -*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// Flags calls that can block or allocate while a mutex is held.  Every
+// other thread that needs the mutex waits for the system call too, so a
+// millisecond fsync() under a request lock is a millisecond stall for the
+// whole pool.  Reported, once per call and naming the innermost lock:
+//
+//   - calls to the functions listed in `BlockingFunctions`, a
+//     semicolon-separated list of qualified names (default: POSIX file and
+//     socket I/O, fsync, stdio, sleeps, DNS lookups, system/popen);
+//   - output to std::cout, std::cerr and std::clog, the streams
+//     hl-perf-avoid-cout-cerr reports everywhere;
+//   - opening, reading, writing, flushing, seeking and closing a
+//     std::ifstream, std::ofstream or std::fstream (not querying its
+//     state);
+//   - new-expressions, the malloc family and std::make_shared /
+//     std::make_unique, which can take the allocator's lock or fault in
+//     pages.
+//
+// What runs under a lock is computed by utils/CriticalSections.h.
+//
+// References:
+//   - Herb Sutter, "Effective Concurrency: Avoid Calling Unknown Code While
+//     Inside a Critical Section"
+//   - CERT CON05-C: Do not perform operations that can block while holding
+//     a lock
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_CHECKS_BLOCKING_UNDER_LOCK_CHECK_H
+#define HL_TIDY_CHECKS_BLOCKING_UNDER_LOCK_CHECK_H
+
+#include "HlTidyCheck.h"
+
+#include <string>
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+class BlockingUnderLockCheck : public HlTidyCheck {
+public:
+  BlockingUnderLockCheck(llvm::StringRef Name,
+                         clang::tidy::ClangTidyContext *Context);
+
+  bool isLanguageVersionSupported(const clang::LangOptions &LangOpts) const override {
+    return LangOpts.CPlusPlus11;
+  }
+
+  void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
+  void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// A system call, paid again by every thread waiting for the lock.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::BlockingCall;
+  }
+
+private:
+  std::string BlockingFunctions;
+};
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_CHECKS_BLOCKING_UNDER_LOCK_CHECK_H
@@ -0,0 +1,355 @@
+//===--- ContainerInLoopBodyCheck.cpp -*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "ContainerInLoopBodyCheck.h"
+#include "utils/LoopContext.h"
+#include "utils/StdSymbols.h"
+#include "utils/VariableUses.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/ParentMapContext.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/Lex/Lexer.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringSwitch.h"
+
+using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+namespace {
+
+llvm::StringRef containerName(StdSymbol Kind) {
+  switch (Kind) {
+  case StdSymbol::BasicString:
+    return "std::string";
+  case StdSymbol::Deque:
+    return "std::deque";
+  case StdSymbol::UnorderedMap:
+    return "std::unordered_map";
+  case StdSymbol::Vector:
+    return "std::vector";
+  default:
+    return "std::ostringstream";
+  }
+}
+
+/// True if the loop header declares \p DS rather than the body.
+bool isLoopHeader(const clang::Stmt *Loop, const clang::DeclStmt *DS) {
+  if (const auto *For = llvm::dyn_cast<clang::CXXForRangeStmt>(Loop))
+    return For->getLoopVarStmt() == DS;
+  if (const auto *For = llvm::dyn_cast<clang::ForStmt>(Loop))
+    return For->getConditionVariableDeclStmt() == DS;
+  if (const auto *While = llvm::dyn_cast<clang::WhileStmt>(Loop))
+    return While->getConditionVariableDeclStmt() == DS;
+  return false;
+}
+
+/// True if \p Modifier adds elements or characters to a \p Kind container.
+bool grows(const clang::FunctionDecl *Modifier, StdSymbol Kind) {
+  if (!Modifier)
+    return false;
+  // Out-parameters: std::getline(), operator<<(ostream &, ...), user code.
+  if (!llvm::isa<clang::CXXMethodDecl>(Modifier))
+    return true;
+  switch (Modifier->getOverloadedOperator()) {
+  case clang::OO_PlusEqual:
+  case clang::OO_LessLess:
+  case clang::OO_Equal:
+    return true;
+  case clang::OO_Subscript:
+    return Kind == StdSymbol::UnorderedMap;
+  case clang::OO_None:
+    break;
+  default:
+    return false;
+  }
+  if (!Modifier->getIdentifier())
+    return false;
+  return llvm::StringSwitch<bool>(Modifier->getName())
+      .Cases("push_back", "emplace_back", "push_front", "emplace_front", true)
+      .Cases("insert", "emplace", "emplace_hint", "try_emplace", true)
+      .Cases("insert_or_assign", "append", "assign", "resize", true)
+      .Cases("write", "put", "str", true)
+      .Default(false);
+}
+
+/// Explicit constructor arguments of \p Var's initializer, or nullopt if it
+/// is not initialized by a constructor call (e.g. from a function result).
+std::optional<unsigned> constructorArguments(const clang::VarDecl *Var) {
+  const clang::Expr *Init = Var->getInit();
+  if (!Init)
+    return 0;
+  const auto *Construct =
+      llvm::dyn_cast<clang::CXXConstructExpr>(Init->IgnoreImplicit());
+  if (!Construct)
+    return std::nullopt;
+  return static_cast<unsigned>(
+      llvm::count_if(Construct->arguments(), [](const clang::Expr *Arg) {
+        return !llvm::isa<clang::CXXDefaultArgExpr>(Arg);
+      }));
+}
+
+/// True if constructing \p Var already allocates: a copy, a size, an
+/// initializer list.  A short literal fits a string's inline buffer.
+bool initializerAllocates(const clang::VarDecl *Var) {
+  std::optional<unsigned> Args = constructorArguments(Var);
+  if (!Args || *Args == 0)
+    return false;
+  const auto *Construct =
+      llvm::cast<clang::CXXConstructExpr>(Var->getInit()->IgnoreImplicit());
+  if (*Args == 1)
+    if (const auto *Literal = llvm::dyn_cast<clang::StringLiteral>(
+            Construct->getArg(0)->IgnoreParenImpCasts()))
+      return Literal->getLength() >= 16;
+  return true;
+}
+
+/// The stream at the left end of a chain of operator<< calls.
+const clang::Expr *streamOf(const clang::Expr *E) {
+  E = E->IgnoreParenImpCasts();
+  while (const auto *Op = llvm::dyn_cast<clang::CXXOperatorCallExpr>(E)) {
+    if (Op->getOperator() != clang::OO_LessLess || Op->getNumArgs() != 2)
+      break;
+    E = Op->getArg(0)->IgnoreParenImpCasts();
+  }
+  return E;
+}
+
+/// True if \p Loop may change the formatting state of \p Stream: it
+/// applies a manipulator other than endl, ends and flush, calls flags(),
+/// setf(), unsetf(), precision(), width(), fill(), imbue() or copyfmt(), or
+/// hands the stream to a function other than operator<<.  str("") and
+/// clear() keep all of that state.
+bool changesFormatting(const clang::VarDecl *Stream, const clang::Stmt *Loop,
+                       const utils::VariableUses &Uses,
+                       clang::ASTContext &Ctx) {
+  if (llvm::any_of(Uses.Modifiers, [](const clang::FunctionDecl *Modifier) {
+        return Modifier && !llvm::isa<clang::CXXMethodDecl>(Modifier) &&
+               Modifier->getOverloadedOperator() != clang::OO_LessLess;
+      }))
+    return true;
+  auto IsStream = [Stream](const clang::Expr *E) {
+    const auto *Ref = llvm::dyn_cast<clang::DeclRefExpr>(streamOf(E));
+    return Ref && Ref->getDecl() == Stream;
+  };
+  auto Manipulator = ignoringImplicit(anyOf(
+      declRefExpr(to(functionDecl(
+          unless(hasAnyName("::std::endl", "::std::ends", "::std::flush"))))),
+      callExpr(callee(functionDecl(hasAnyName(
+          "::std::setprecision", "::std::setw", "::std::setfill",
+          "::std::setbase", "::std::setiosflags", "::std::resetiosflags"))))));
+  for (const BoundNodes &Node : match(
+           findAll(cxxOperatorCallExpr(hasOverloadedOperatorName("<<"),
+                                       argumentCountIs(2),
+                                       hasArgument(1, Manipulator))
+                       .bind("op")),
+           *Loop, Ctx))
+    if (IsStream(Node.getNodeAs<clang::CXXOperatorCallExpr>("op")->getArg(0)))
+      return true;
+  for (const BoundNodes &Node : match(
+           findAll(cxxMemberCallExpr(
+                       callee(cxxMethodDecl(hasAnyName(
+                           "flags", "setf", "unsetf", "precision", "width",
+                           "fill", "imbue", "copyfmt"))),
+                       unless(argumentCountIs(0)))
+                       .bind("call")),
+           *Loop, Ctx))
+    if (IsStream(Node.getNodeAs<clang::CXXMemberCallExpr>("call")
+                     ->getImplicitObjectArgument()))
+      return true;
+  return false;
+}
+
+/// Body of the function or lambda around \p S.
+const clang::Stmt *enclosingBody(const clang::Stmt *S, clang::ASTContext &Ctx) {
+  clang::DynTypedNodeList Parents = Ctx.getParents(*S);
+  while (!Parents.empty()) {
+    if (const auto *Lambda = Parents[0].get<clang::LambdaExpr>())
+      return Lambda->getBody();
+    if (const auto *FD = Parents[0].get<clang::FunctionDecl>())
+      return FD->getBody();
+    Parents = Ctx.getParents(Parents[0]);
+  }
+  return nullptr;
+}
+
+/// True if declaring \p Var in front of \p Loop, inside \p Block, names the
+/// same thing everywhere it is used: no other variable of the function has
+/// its name, \p Block does not use the name for something else, and the
+/// loop declares no types its declaration could mention.
+bool canHoist(const clang::VarDecl *Var, const clang::Stmt *Loop,
+              const clang::CompoundStmt *Block, clang::ASTContext &Ctx) {
+  const clang::Stmt *Body = enclosingBody(Loop, Ctx);
+  if (!Body)
+    return false;
+  std::string Name = Var->getName().str();
+  auto Other = namedDecl(hasName(Name), unless(equalsNode(Var)));
+  if (!match(findAll(varDecl(Other)), *Body, Ctx).empty())
+    return false;
+  if (!match(findAll(expr(anyOf(declRefExpr(to(Other)),
+                                memberExpr(member(hasName(Name)))))),
+             *Block, Ctx)
+           .empty())
+    return false;
+  return match(findAll(decl(anyOf(typedefNameDecl(),
+                                  tagDecl(unless(cxxRecordDecl(isLambda())))))),
+               *Loop, Ctx)
+      .empty();
+}
+
+} // namespace
+
+ContainerInLoopBodyCheck::ContainerInLoopBodyCheck(
+    llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
+    : HlTidyCheck(Name, Context) {}
+
+void ContainerInLoopBodyCheck::registerMatchers(MatchFinder *Finder) {
+  // Match every local container declaration; check() keeps the ones that
+  // run once per iteration of a loop, via the shared LoopContext.
+  Finder->addMatcher(
+      declStmt(
+          forEach(varDecl(hasLocalStorage(), unless(parmVarDecl()),
+                          hasType(qualType(
+                              unless(isConstQualified()),
+                              hasCanonicalType(hasDeclaration(namedDecl(
+                                  isStdSymbol({StdSymbol::Vector,
+                                               StdSymbol::BasicString,
+                                               StdSymbol::UnorderedMap,
+                                               StdSymbol::Deque,
+                                               StdSymbol::BasicOstringstream,
+                                               StdSymbol::Ostringstream})))))))
+                      .bind("var")))
+          .bind("decl"),
+      this);
+}
+
+void ContainerInLoopBodyCheck::check(const MatchFinder::MatchResult &Result) {
+  const auto *DS = Result.Nodes.getNodeAs<clang::DeclStmt>("decl");
+  const auto *Var = Result.Nodes.getNodeAs<clang::VarDecl>("var");
+  if (!DS || !Var)
+    return;
+
+  clang::ASTContext &Ctx = *Result.Context;
+  const clang::Stmt *Loop = utils::LoopContext::get(Ctx).innermostLoop(DS);
+  if (!Loop || isLoopHeader(Loop, DS))
+    return;
+
+  const clang::CXXRecordDecl *Record =
+      Var->getType().getCanonicalType()->getAsCXXRecordDecl();
+  std::optional<StdSymbol> Kind = utils::StdSymbols::get(Ctx).classify(Record);
+  if (!Kind)
+    return;
+
+  // A container whose storage is moved out each iteration has to be
+  // allocated again anyway.
+  utils::VariableUses Uses = utils::analyzeUses(Var, Loop, Ctx);
+  if (Uses.Moved)
+    return;
+  bool Filled =
+      initializerAllocates(Var) ||
+      llvm::any_of(Uses.Modifiers, [&](const clang::FunctionDecl *Modifier) {
+        return grows(Modifier, *Kind);
+      });
+  if (!Filled)
+    return;
+
+  std::optional<utils::LoopExecution> Executed = loopExecution(Loop);
+  if (isRarelyRun(Executed))
+    return;
+
+  bool IsStream = *Kind == StdSymbol::BasicOstringstream ||
+                  *Kind == StdSymbol::Ostringstream;
+  std::string Reset = Var->getName().str() +
+                      (IsStream ? ".str(\"\"); " + Var->getName().str() +
+                                      ".clear();"
+                                : ".clear();");
+
+  const clang::SourceManager &SM = *Result.SourceManager;
+  const clang::LangOptions &LO = Ctx.getLangOpts();
+  std::optional<unsigned> Args = constructorArguments(Var);
+  bool DefaultConstructed = Args && *Args == 0;
+  bool Formatted = IsStream && changesFormatting(Var, Loop, Uses, Ctx);
+  bool Fixable = false;
+  {
+    // Scoped so the warning is emitted before the notes below.
+    auto D = diag(Var->getLocation(),
+                  "%0 '%1' is constructed and destroyed on every loop "
+                  "iteration, allocating fresh storage each time; declare it "
+                  "before the loop and %2 to reuse its capacity")
+             << containerName(*Kind) << Var->getName()
+             << (IsStream ? "reset it with str(\"\") and clear()"
+                          : "clear() it on each iteration");
+
+    const auto *Block = [&]() -> const clang::CompoundStmt * {
+      clang::DynTypedNodeList Parents = Ctx.getParents(*Loop);
+      return Parents.empty() ? nullptr
+                             : Parents[0].get<clang::CompoundStmt>();
+    }();
+    Fixable = DefaultConstructed && !Uses.Escaped && !Formatted &&
+              DS->isSingleDecl() && Block && !DS->getBeginLoc().isMacroID() &&
+              !DS->getEndLoc().isMacroID() &&
+              !Loop->getBeginLoc().isMacroID() &&
+              canHoist(Var, Loop, Block, Ctx);
+    if (Fixable) {
+      auto Range = clang::CharSourceRange::getTokenRange(DS->getSourceRange());
+      llvm::StringRef Declaration = clang::Lexer::getSourceText(Range, SM, LO);
+      if (!Declaration.empty())
+        D << clang::FixItHint::CreateInsertion(
+                 Loop->getBeginLoc(),
+                 (Declaration + "\n" +
+                  clang::Lexer::getIndentationForLine(Loop->getBeginLoc(), SM))
+                     .str())
+          << clang::FixItHint::CreateReplacement(Range, Reset);
+    }
+  }
+
+  if (!DefaultConstructed)
+    diag(Var->getLocation(),
+         "once hoisted, give it its initial value with assign() or "
+         "operator= so that the existing capacity is reused",
+         clang::DiagnosticIDs::Note);
+  else if (Uses.Escaped)
+    diag(Var->getLocation(),
+         "not hoisted automatically: a pointer or reference to '%0' is "
+         "taken inside the loop and could observe the reuse",
+         clang::DiagnosticIDs::Note)
+        << Var->getName();
+  else if (Formatted)
+    diag(Var->getLocation(),
+         "not hoisted automatically: the loop changes the formatting of "
+         "'%0', and str(\"\") and clear() would carry its flags, precision, "
+         "width, fill and locale into the next iteration",
+         clang::DiagnosticIDs::Note)
+        << Var->getName();
+  else if (IsStream && Fixable)
+    diag(Var->getLocation(),
+         "str(\"\") and clear() reset the contents and error state but keep "
+         "the flags, precision, width, fill and locale, which this loop does "
+         "not change",
+         clang::DiagnosticIDs::Note);
+
+  if (*Kind == StdSymbol::UnorderedMap)
+    diag(Var->getLocation(),
+         "clear() keeps the bucket array but still frees every node; an "
+         "open-addressing map (absl::flat_hash_map, "
+         "boost::unordered_flat_map) keeps all of its storage",
+         clang::DiagnosticIDs::Note);
+  else if (IsStream)
+    diag(Var->getLocation(),
+         "constructing a stream also copies the global locale, which takes "
+         "a process-wide lock",
+         clang::DiagnosticIDs::Note);
+
+  if (Executed)
+    noteLoopExecution(Var->getLocation(), *Executed);
+}
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
@@ -0,0 +1,58 @@
+//===--- ContainerInLoopBodyCheck.h -*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// Flags local std::vector, std::string, std::unordered_map, std::deque and
+// std::ostringstream variables declared inside a loop body and filled there.
+// Every iteration allocates fresh storage for them and frees it again at
+// the end of the iteration; declared once before the loop and cleared on
+// each iteration, they keep their capacity and stop allocating once warm.
+//
+// Variables that are moved from, swapped or returned are not flagged: their
+// storage leaves the iteration anyway.  The fix-it hoists the declaration
+// and replaces it with clear() when the variable is default-constructed and
+// no pointer or reference to it is taken in the loop.  Streams are reset
+// with str("") and clear(), which keep the flags, precision, width, fill
+// and locale, so they are only hoisted when the loop changes none of them.
+//
+// References:
+//   - Chromium base/containers guidelines ("reuse scratch buffers")
+//   - Abseil Tip #77: Temporaries, Moves, and Copies
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_CHECKS_CONTAINER_IN_LOOP_BODY_CHECK_H
+#define HL_TIDY_CHECKS_CONTAINER_IN_LOOP_BODY_CHECK_H
+
+#include "HlTidyCheck.h"
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+class ContainerInLoopBodyCheck : public HlTidyCheck {
+public:
+  ContainerInLoopBodyCheck(llvm::StringRef Name,
+                           clang::tidy::ClangTidyContext *Context);
+
+  bool isLanguageVersionSupported(const clang::LangOptions &LangOpts) const override {
+    return LangOpts.CPlusPlus;
+  }
+
+  void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
+  void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// push_back() on a dependent container resolves only when instantiated.
+  bool requiresInstantiations() const override { return true; }
+
+  /// Every iteration allocates the storage again.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::HeapAllocation;
+  }
+};
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_CHECKS_CONTAINER_IN_LOOP_BODY_CHECK_H
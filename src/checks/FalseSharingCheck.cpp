@@ -0,0 +1,503 @@
+//===--- FalseSharingCheck.cpp - hl-perf-false-sharing ---------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "FalseSharingCheck.h"
+#include "utils/CppStandardUtils.h"
+#include "utils/LoopContext.h"
+#include "utils/StdSymbols.h"
+#include "utils/TranslationUnitCache.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/DeclTemplate.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/RecordLayout.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+
+#include <algorithm>
+#include <optional>
+#include <string>
+
+using namespace clang::ast_matchers;
+using hl::tidy::utils::StdSymbol;
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+namespace {
+
+/// How a synchronisation type is named in diagnostics, or std::nullopt if
+/// \p T is not one.
+std::optional<llvm::StringRef> syncKind(clang::QualType T,
+                                        clang::ASTContext &Ctx) {
+  const clang::CXXRecordDecl *RD = T->getAsCXXRecordDecl();
+  if (!RD)
+    return std::nullopt;
+  std::optional<StdSymbol> S = utils::StdSymbols::get(Ctx).classify(RD);
+  if (!S)
+    return std::nullopt;
+  switch (*S) {
+  case StdSymbol::Atomic:
+    return llvm::StringRef("std::atomic");
+  case StdSymbol::AtomicFlag:
+    return llvm::StringRef("std::atomic_flag");
+  case StdSymbol::Barrier:
+    return llvm::StringRef("std::barrier");
+  case StdSymbol::ConditionVariable:
+    return llvm::StringRef("std::condition_variable");
+  case StdSymbol::ConditionVariableAny:
+    return llvm::StringRef("std::condition_variable_any");
+  case StdSymbol::CountingSemaphore:
+    return llvm::StringRef("std::counting_semaphore");
+  case StdSymbol::Latch:
+    return llvm::StringRef("std::latch");
+  case StdSymbol::Mutex:
+    return llvm::StringRef("std::mutex");
+  case StdSymbol::RecursiveMutex:
+    return llvm::StringRef("std::recursive_mutex");
+  case StdSymbol::RecursiveTimedMutex:
+    return llvm::StringRef("std::recursive_timed_mutex");
+  case StdSymbol::SharedMutex:
+    return llvm::StringRef("std::shared_mutex");
+  case StdSymbol::SharedTimedMutex:
+    return llvm::StringRef("std::shared_timed_mutex");
+  case StdSymbol::TimedMutex:
+    return llvm::StringRef("std::timed_mutex");
+  default:
+    return std::nullopt;
+  }
+}
+
+/// Template argument \p Index of a std::array or std::vector type.
+const clang::TemplateArgument *templateArg(clang::QualType T,
+                                           unsigned Index) {
+  const auto *Spec =
+      llvm::dyn_cast_or_null<clang::ClassTemplateSpecializationDecl>(
+          T->getAsCXXRecordDecl());
+  if (!Spec || Spec->getTemplateArgs().size() <= Index)
+    return nullptr;
+  return &Spec->getTemplateArgs()[Index];
+}
+
+/// The element type of C arrays and std::array, which are laid out inline,
+/// or \p T itself.
+clang::QualType inlineElement(clang::QualType T, clang::ASTContext &Ctx) {
+  for (;;) {
+    T = Ctx.getBaseElementType(T);
+    const clang::CXXRecordDecl *RD = T->getAsCXXRecordDecl();
+    const clang::TemplateArgument *Arg = templateArg(T, 0);
+    if (!RD || !Arg || Arg->getKind() != clang::TemplateArgument::Type ||
+        !utils::StdSymbols::get(Ctx).is(RD, StdSymbol::Array))
+      return T;
+    T = Arg->getAsType();
+  }
+}
+
+/// A synchronisation object inside a record, at a fixed offset.
+struct SyncMember {
+  /// Field of the checked record that contains it.
+  const clang::FieldDecl *Top;
+  /// Path from the checked record, e.g. "Stats.Hits".
+  std::string Name;
+  llvm::StringRef Kind;
+  uint64_t Offset;
+  uint64_t Size;
+};
+
+/// Appends the synchronisation objects of \p RD, at \p Base bytes into the
+/// checked record, to \p Members.  Records outside namespace std are
+/// searched recursively.
+void collectSync(const clang::RecordDecl *RD, uint64_t Base,
+                 const clang::FieldDecl *Top, llvm::StringRef Prefix,
+                 unsigned Depth, clang::ASTContext &Ctx,
+                 llvm::SmallVectorImpl<SyncMember> &Members) {
+  const clang::ASTRecordLayout &Layout = Ctx.getASTRecordLayout(RD);
+  for (const clang::FieldDecl *FD : RD->fields()) {
+    if (FD->isBitField() || FD->getType()->isIncompleteType() ||
+        FD->getType()->isDependentType())
+      continue;
+    uint64_t Offset = Base + Layout.getFieldOffset(FD->getFieldIndex()) / 8;
+    const clang::FieldDecl *Owner = Top ? Top : FD;
+    std::string Name = (Prefix + FD->getName()).str();
+    if (std::optional<llvm::StringRef> Kind =
+            syncKind(inlineElement(FD->getType(), Ctx), Ctx)) {
+      Members.push_back(
+          {Owner, Name, *Kind, Offset,
+           static_cast<uint64_t>(
+               Ctx.getTypeSizeInChars(FD->getType()).getQuantity())});
+      continue;
+    }
+    const clang::RecordDecl *Inner = FD->getType()->getAsRecordDecl();
+    if (Inner && Depth < 4 && !Inner->isInStdNamespace() &&
+        Inner->getDefinition() && !Inner->isInvalidDecl())
+      collectSync(Inner->getDefinition(), Offset, Owner, Name + ".",
+                  Depth + 1, Ctx, Members);
+  }
+}
+
+/// Whether some record of the element type holds a synchronisation object.
+bool holdsSync(clang::QualType T, unsigned Depth, clang::ASTContext &Ctx,
+               llvm::StringRef &Kind) {
+  T = inlineElement(T, Ctx);
+  if (std::optional<llvm::StringRef> K = syncKind(T, Ctx)) {
+    Kind = *K;
+    return true;
+  }
+  const clang::RecordDecl *RD = T->getAsRecordDecl();
+  if (!RD || Depth == 4 || RD->isInStdNamespace() || !RD->getDefinition())
+    return false;
+  for (const clang::FieldDecl *FD : RD->getDefinition()->fields())
+    if (!FD->getType()->isDependentType() &&
+        holdsSync(FD->getType(), Depth + 1, Ctx, Kind))
+      return true;
+  return false;
+}
+
+/// Where the TU writes each field outside constructors and destructors.
+class FieldWrites {
+public:
+  explicit FieldWrites(clang::ASTContext &Ctx);
+
+  /// How \p FD is written often enough to keep its cache line moving, or
+  /// an empty string.
+  std::string frequency(const clang::FieldDecl *FD) const {
+    auto It = Writes.find(FD);
+    if (It == Writes.end())
+      return {};
+    if (It->second.InLoop)
+      return "inside a loop";
+    if (It->second.Functions.size() > 1)
+      return "in " + std::to_string(It->second.Functions.size()) +
+             " functions";
+    return {};
+  }
+
+private:
+  friend class WriteCollector;
+
+  struct Info {
+    llvm::SmallPtrSet<const clang::FunctionDecl *, 2> Functions;
+    bool InLoop = false;
+  };
+
+  llvm::DenseMap<const clang::FieldDecl *, Info> Writes;
+};
+
+class WriteCollector : public clang::RecursiveASTVisitor<WriteCollector> {
+  using Base = clang::RecursiveASTVisitor<WriteCollector>;
+
+public:
+  WriteCollector(FieldWrites &Index, clang::ASTContext &Ctx)
+      : Index(Index), Loops(utils::LoopContext::get(Ctx)) {}
+
+  bool shouldVisitTemplateInstantiations() const { return true; }
+
+  bool TraverseDecl(clang::Decl *D) {
+    const auto *FD = llvm::dyn_cast_or_null<clang::FunctionDecl>(D);
+    if (!FD || !FD->doesThisDeclarationHaveABody())
+      return Base::TraverseDecl(D);
+    const clang::FunctionDecl *Outer = Current;
+    // Constructors and destructors run before and after the object is
+    // shared.
+    Current = llvm::isa<clang::CXXConstructorDecl, clang::CXXDestructorDecl>(FD)
+                  ? nullptr
+                  : FD;
+    bool Result = Base::TraverseDecl(D);
+    Current = Outer;
+    return Result;
+  }
+
+  bool VisitBinaryOperator(clang::BinaryOperator *BO) {
+    if (BO->isAssignmentOp())
+      write(BO->getLHS(), BO);
+    return true;
+  }
+
+  bool VisitUnaryOperator(clang::UnaryOperator *UO) {
+    if (UO->isIncrementDecrementOp())
+      write(UO->getSubExpr(), UO);
+    return true;
+  }
+
+  bool VisitCXXOperatorCallExpr(clang::CXXOperatorCallExpr *E) {
+    clang::OverloadedOperatorKind Op = E->getOperator();
+    if ((E->isAssignmentOp() || Op == clang::OO_PlusPlus ||
+         Op == clang::OO_MinusMinus) &&
+        E->getNumArgs() != 0)
+      write(E->getArg(0), E);
+    return true;
+  }
+
+private:
+  void write(const clang::Expr *Target, const clang::Stmt *At) {
+    const auto *ME =
+        llvm::dyn_cast<clang::MemberExpr>(Target->IgnoreParenImpCasts());
+    if (!Current || !ME)
+      return;
+    const auto *FD = llvm::dyn_cast<clang::FieldDecl>(ME->getMemberDecl());
+    if (!FD)
+      return;
+    FieldWrites::Info &Info = Index.Writes[FD];
+    Info.Functions.insert(Current);
+    if (Loops.innermostLoop(At))
+      Info.InLoop = true;
+  }
+
+  FieldWrites &Index;
+  const utils::LoopContext &Loops;
+  const clang::FunctionDecl *Current = nullptr;
+};
+
+FieldWrites::FieldWrites(clang::ASTContext &Ctx) {
+  WriteCollector Collector(*this, Ctx);
+  Collector.TraverseAST(Ctx);
+}
+
+} // namespace
+
+FalseSharingCheck::FalseSharingCheck(llvm::StringRef Name,
+                                     clang::tidy::ClangTidyContext *Context)
+    : HlTidyCheck(Name, Context),
+      DestructiveInterferenceBytes(
+          Options.get("DestructiveInterferenceBytes", 64u)) {}
+
+void FalseSharingCheck::registerMatchers(MatchFinder *Finder) {
+  // Only concrete records have a layout; see hl-perf-struct-layout.
+  Finder->addMatcher(
+      recordDecl(isDefinition(), unless(isUnion()), unless(isImplicit()),
+                 unless(cxxRecordDecl(isLambda())),
+                 unless(classTemplateSpecializationDecl()))
+          .bind("record"),
+      this);
+  Finder->addMatcher(
+      declaratorDecl(anyOf(fieldDecl(), varDecl(unless(parmVarDecl()))))
+          .bind("decl"),
+      this);
+}
+
+void FalseSharingCheck::check(const MatchFinder::MatchResult &Result) {
+  if (const auto *RD = Result.Nodes.getNodeAs<clang::RecordDecl>("record"))
+    checkRecord(RD, *Result.Context);
+  else if (const auto *D =
+               Result.Nodes.getNodeAs<clang::DeclaratorDecl>("decl"))
+    checkArray(D, *Result.Context);
+}
+
+void FalseSharingCheck::checkRecord(const clang::RecordDecl *RD,
+                                    clang::ASTContext &Ctx) {
+  if (RD->isInvalidDecl() || RD->isDependentType() ||
+      RD->isAnonymousStructOrUnion() || RD->field_empty())
+    return;
+  if (const auto *CXXRD = llvm::dyn_cast<clang::CXXRecordDecl>(RD))
+    if (CXXRD->getNumVBases() != 0)
+      return;
+
+  llvm::SmallVector<SyncMember, 4> Members;
+  collectSync(RD, 0, nullptr, "", 0, Ctx, Members);
+  if (Members.empty())
+    return;
+
+  const uint64_t Line = DestructiveInterferenceBytes;
+  const clang::ASTRecordLayout &Layout = Ctx.getASTRecordLayout(RD);
+  uint64_t RecordAlign = Layout.getAlignment().getQuantity();
+  // Whether the bytes [AOff, AOff + ASize) and [BOff, BOff + BSize), with
+  // A first, can fall on one cache line.  Once the record itself is
+  // aligned to the line size, the line boundaries are known.
+  auto MayShare = [&](uint64_t AOff, uint64_t ASize, uint64_t BOff,
+                      uint64_t BSize) {
+    uint64_t ALast = AOff + std::max<uint64_t>(ASize, 1) - 1;
+    if (RecordAlign >= Line)
+      return ALast / Line >= BOff / Line &&
+             AOff / Line <= (BOff + std::max<uint64_t>(BSize, 1) - 1) / Line;
+    return BOff <= ALast || BOff - ALast < Line;
+  };
+
+  // Plain fields the TU keeps writing, for the atomics next to them.
+  struct Plain {
+    const clang::FieldDecl *Field;
+    uint64_t Offset;
+    uint64_t Size;
+    std::string Frequency;
+  };
+  llvm::SmallVector<Plain, 4> Written;
+  bool HasAtomic = llvm::any_of(Members, [](const SyncMember &M) {
+    return M.Kind == "std::atomic" || M.Kind == "std::atomic_flag";
+  });
+  if (HasAtomic) {
+    const FieldWrites &Writes = utils::getPerTU<FieldWrites>(Ctx);
+    for (const clang::FieldDecl *FD : RD->fields()) {
+      if (FD->isBitField() || FD->getType()->isIncompleteType() ||
+          llvm::any_of(Members, [FD](const SyncMember &M) {
+            return M.Top == FD;
+          }))
+        continue;
+      std::string Frequency = Writes.frequency(FD);
+      if (Frequency.empty())
+        continue;
+      Written.push_back(
+          {FD, Layout.getFieldOffset(FD->getFieldIndex()) / 8,
+           static_cast<uint64_t>(
+               Ctx.getTypeSizeInChars(FD->getType()).getQuantity()),
+           std::move(Frequency)});
+    }
+  }
+
+  // std::hardware_destructive_interference_size is not used in the fix-it:
+  // it needs <new>, and its value depends on the target and the standard
+  // library (256 on aarch64 with libstdc++), so it may not match the size
+  // the warning was computed for.
+  bool MentionStdConstant = utils::hasAtLeast(utils::detectStandard(Ctx),
+                                              utils::CppStandard::Cpp17);
+  std::string Alignas = "alignas(" + std::to_string(Line) + ") ";
+  const clang::SourceManager &SM = Ctx.getSourceManager();
+
+  // Separating \p Later from everything before it takes one alignas.
+  llvm::SmallPtrSet<const clang::FieldDecl *, 4> Reported;
+  auto Report = [&](const clang::FieldDecl *Later, llvm::StringRef Message,
+                    llvm::ArrayRef<std::string> Args,
+                    const clang::FieldDecl *Other, llvm::StringRef OtherName) {
+    Reported.insert(Later);
+    {
+      auto D = diag(Later->getLocation(), Message);
+      for (const std::string &Arg : Args)
+        D << Arg;
+      clang::SourceLocation Begin = Later->getBeginLoc();
+      if (Begin.isValid() && !Begin.isMacroID() &&
+          SM.isWrittenInSameFile(Begin, RD->getLocation()))
+        D << clang::FixItHint::CreateInsertion(Begin, Alignas);
+    }
+    diag(Other->getLocation(), "'%0' is declared here",
+         clang::DiagnosticIDs::Note)
+        << OtherName;
+    if (MentionStdConstant)
+      diag(Later->getLocation(),
+           "alignas(%0) follows the DestructiveInterferenceBytes option; "
+           "std::hardware_destructive_interference_size in <new> varies "
+           "with the target and the standard library",
+           clang::DiagnosticIDs::Note)
+          << static_cast<unsigned>(Line);
+  };
+
+  // Two synchronisation objects in different fields.
+  for (unsigned J = 1; J < Members.size(); ++J) {
+    const SyncMember &B = Members[J];
+    if (Reported.count(B.Top) || B.Top->getMaxAlignment() / 8 >= Line)
+      continue;
+    for (unsigned I = J; I-- != 0;) {
+      const SyncMember &A = Members[I];
+      if (A.Top == B.Top || !MayShare(A.Offset, A.Size, B.Offset, B.Size))
+        continue;
+      Report(B.Top,
+             "'%0' (%1) can share a %2-byte cache line with '%3' (%4), which "
+             "starts %5 bytes before it: threads using one keep invalidating "
+             "the other's line",
+             {B.Name, B.Kind.str(), std::to_string(Line), A.Name,
+              A.Kind.str(), std::to_string(B.Offset - A.Offset)},
+             A.Top, A.Name);
+      break;
+    }
+  }
+
+  // An atomic next to a plain field that is written all the time.
+  for (const SyncMember &M : Members) {
+    if (M.Kind != "std::atomic" && M.Kind != "std::atomic_flag")
+      continue;
+    for (const Plain &P : Written) {
+      bool PlainFirst = P.Offset < M.Offset;
+      const clang::FieldDecl *Later = PlainFirst ? M.Top : P.Field;
+      if (Reported.count(M.Top) || Reported.count(P.Field) ||
+          Later->getMaxAlignment() / 8 >= Line ||
+          !(PlainFirst ? MayShare(P.Offset, P.Size, M.Offset, M.Size)
+                       : MayShare(M.Offset, M.Size, P.Offset, P.Size)))
+        continue;
+      std::string PlainName = P.Field->getNameAsString();
+      Report(Later,
+             "'%0' (%1) can share a %2-byte cache line with '%3', which is "
+             "written %4: every write invalidates the line for the threads "
+             "using '%0'",
+             {M.Name, M.Kind.str(), std::to_string(Line), PlainName,
+              P.Frequency},
+             PlainFirst ? P.Field : M.Top, PlainFirst ? PlainName : M.Name);
+      break;
+    }
+  }
+}
+
+void FalseSharingCheck::checkArray(const clang::DeclaratorDecl *D,
+                                   clang::ASTContext &Ctx) {
+  clang::QualType T = D->getType().getNonReferenceType();
+  if (D->isInvalidDecl() || T->isDependentType() ||
+      D->getLocation().isMacroID())
+    return;
+  if (const auto *VD = llvm::dyn_cast<clang::VarDecl>(D))
+    if (VD->isTemplated())
+      return;
+
+  const utils::StdSymbols &Symbols = utils::StdSymbols::get(Ctx);
+  clang::QualType Element;
+  uint64_t Count = 0;
+  if (const auto *CAT = Ctx.getAsConstantArrayType(T)) {
+    Element = Ctx.getBaseElementType(T);
+    Count = Ctx.getConstantArrayElementCount(CAT);
+  } else if (const clang::CXXRecordDecl *RD = T->getAsCXXRecordDecl()) {
+    const clang::TemplateArgument *Arg = templateArg(T, 0);
+    if (!Arg || Arg->getKind() != clang::TemplateArgument::Type)
+      return;
+    if (Symbols.is(RD, StdSymbol::Array)) {
+      const clang::TemplateArgument *Size = templateArg(T, 1);
+      if (!Size || Size->getKind() != clang::TemplateArgument::Integral)
+        return;
+      Element = Arg->getAsType();
+      Count = Size->getAsIntegral().getZExtValue();
+    } else if (Symbols.is(RD, StdSymbol::Vector)) {
+      Element = Arg->getAsType();
+    } else {
+      return;
+    }
+  } else {
+    return;
+  }
+  if (Element.isNull() || Element->isIncompleteType() ||
+      Element->isDependentType() || (Count != 0 && Count < 2))
+    return;
+
+  llvm::StringRef Kind;
+  if (!holdsSync(Element, 0, Ctx, Kind))
+    return;
+  uint64_t ElementSize = Ctx.getTypeSizeInChars(Element).getQuantity();
+  const uint64_t Line = DestructiveInterferenceBytes;
+  if (ElementSize == 0 || ElementSize >= Line)
+    return;
+
+  std::string ElementName =
+      Element.getLocalUnqualifiedType().getAsString(Ctx.getPrintingPolicy());
+  std::string Held = syncKind(Element, Ctx)
+                         ? std::string()
+                         : " (holding a " + Kind.str() + ")";
+  diag(D->getLocation(),
+       "'%0' stores %1 '%2'%3 elements of %4 bytes contiguously: up to %5 "
+       "of them share each %6-byte cache line, so threads working on "
+       "different elements keep invalidating each other's line")
+      << D->getName()
+      << (Count != 0 ? std::to_string(Count) : std::string("its"))
+      << ElementName << Held << static_cast<unsigned>(ElementSize)
+      << static_cast<unsigned>(
+             Count ? std::min(llvm::divideCeil(Line, ElementSize), Count)
+                   : llvm::divideCeil(Line, ElementSize))
+      << static_cast<unsigned>(Line);
+  diag(D->getLocation(),
+       "give each element its own line with a wrapper such as 'struct "
+       "alignas(%0) Padded { %1 Value; }'",
+       clang::DiagnosticIDs::Note)
+      << static_cast<unsigned>(Line) << ElementName;
+}
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
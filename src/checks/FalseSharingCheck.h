@@ -0,0 +1,68 @@
+//===--- FalseSharingCheck.h - hl-perf-false-sharing -----------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// Flags synchronisation objects -- std::atomic, std::atomic_flag, the std
+// mutexes, condition variables, semaphores, latches and barriers -- laid
+// out so that they can share a cache line with something another thread
+// writes:
+//
+//   - two of them in one record, less than `DestructiveInterferenceBytes`
+//     (default 64; 128 on CPUs that prefetch cache lines in pairs) apart,
+//     found from ASTRecordLayout, nested records included;
+//   - an atomic next to a plain field that the translation unit writes
+//     inside a loop or from several functions;
+//   - arrays, std::array and std::vector of them (or of structs holding
+//     them) whose elements are smaller than the destructive size, such as
+//     per-worker counters indexed by thread id.
+//
+// The fix-it aligns the later member of a pair with `alignas(N)`, N being
+// `DestructiveInterferenceBytes`.  std::hardware_destructive_interference_size
+// is only mentioned in a note: its value differs between targets and
+// standard libraries, and using it would need <new>.
+//
+// References:
+//   - P0154R1 hardware_destructive_interference_size
+//   - Intel 64 and IA-32 Optimization Reference Manual, false sharing
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_CHECKS_FALSE_SHARING_CHECK_H
+#define HL_TIDY_CHECKS_FALSE_SHARING_CHECK_H
+
+#include "HlTidyCheck.h"
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+class FalseSharingCheck : public HlTidyCheck {
+public:
+  FalseSharingCheck(llvm::StringRef Name,
+                    clang::tidy::ClangTidyContext *Context);
+
+  bool isLanguageVersionSupported(const clang::LangOptions &LangOpts) const override {
+    return LangOpts.CPlusPlus11;
+  }
+
+  void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
+  void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// Every contended write moves the line between cores.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::CacheMiss;
+  }
+
+private:
+  void checkRecord(const clang::RecordDecl *RD, clang::ASTContext &Ctx);
+  void checkArray(const clang::DeclaratorDecl *D, clang::ASTContext &Ctx);
+
+  /// Objects closer than this can end up on the same cache line.
+  unsigned DestructiveInterferenceBytes;
+};
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_CHECKS_FALSE_SHARING_CHECK_H
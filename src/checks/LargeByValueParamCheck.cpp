@@ -0,0 +1,404 @@
+//===--- LargeByValueParamCheck.cpp -*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "LargeByValueParamCheck.h"
+#include "utils/CopyCost.h"
+#include "utils/CppStandardUtils.h"
+#include "utils/StdSymbols.h"
+#include "utils/TranslationUnitCache.h"
+#include "utils/VariableUses.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/ParentMapContext.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/AST/StmtCXX.h"
+#include "clang/AST/TypeLoc.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/Lex/Lexer.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringSwitch.h"
+
+#include <optional>
+#include <vector>
+
+using namespace clang::ast_matchers;
+using hl::tidy::utils::StdSymbol;
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+namespace {
+
+/// The declaration calls to \p FD are recorded under: the template pattern
+/// for an instantiation, and always the first declaration.
+const clang::FunctionDecl *calleeKey(const clang::FunctionDecl *FD) {
+  if (const auto *Pattern = FD->getTemplateInstantiationPattern())
+    FD = Pattern;
+  return FD->getCanonicalDecl();
+}
+
+/// What the calls in the TU pass to one by-value parameter.
+struct ArgumentKinds {
+  /// Lvalues, copied into the parameter.
+  unsigned Copies = 0;
+  /// Temporaries and xvalues, moved or constructed in place.
+  unsigned Rvalues = 0;
+  /// A braced list, which a std::span parameter would not accept.
+  bool Braced = false;
+};
+
+/// Every call in the TU, indexed by callee and parameter, and the functions
+/// whose address is taken.  Built once per TU on first use.
+class CallSites {
+public:
+  explicit CallSites(clang::ASTContext &Ctx);
+
+  const ArgumentKinds *find(const clang::FunctionDecl *FD,
+                            unsigned Param) const {
+    auto It = Args.find({calleeKey(FD), Param});
+    return It == Args.end() ? nullptr : &It->second;
+  }
+
+  bool isAddressTaken(const clang::FunctionDecl *FD) const {
+    return AddressTaken.contains(calleeKey(FD));
+  }
+
+private:
+  friend class CallSiteCollector;
+
+  void record(const clang::FunctionDecl *Callee, unsigned Param,
+              const clang::Expr *Arg);
+
+  llvm::DenseMap<std::pair<const clang::FunctionDecl *, unsigned>,
+                 ArgumentKinds>
+      Args;
+  llvm::DenseSet<const clang::FunctionDecl *> AddressTaken;
+};
+
+class CallSiteCollector : public clang::RecursiveASTVisitor<CallSiteCollector> {
+public:
+  explicit CallSiteCollector(CallSites &Sites) : Sites(Sites) {}
+
+  bool shouldVisitTemplateInstantiations() const { return true; }
+
+  bool VisitCallExpr(clang::CallExpr *Call) {
+    const clang::FunctionDecl *Callee = Call->getDirectCallee();
+    if (!Callee)
+      return true;
+    Callees.insert(Call->getCallee()->IgnoreParenImpCasts());
+    // The object argument of a member operator is not a parameter.
+    unsigned Shift = 0;
+    if (const auto *Method = llvm::dyn_cast<clang::CXXMethodDecl>(Callee))
+      if (llvm::isa<clang::CXXOperatorCallExpr>(Call) && !Method->isStatic())
+        Shift = 1;
+    for (unsigned I = Shift, N = Call->getNumArgs(); I < N; ++I) {
+      if (I - Shift >= Callee->getNumParams())
+        break;
+      Sites.record(Callee, I - Shift, Call->getArg(I));
+    }
+    return true;
+  }
+
+  bool VisitCXXConstructExpr(clang::CXXConstructExpr *Construct) {
+    const clang::CXXConstructorDecl *Ctor = Construct->getConstructor();
+    for (unsigned I = 0, N = Construct->getNumArgs(); I < N; ++I) {
+      if (I >= Ctor->getNumParams())
+        break;
+      Sites.record(Ctor, I, Construct->getArg(I));
+    }
+    return true;
+  }
+
+  bool VisitDeclRefExpr(clang::DeclRefExpr *Ref) {
+    // Parents are visited first, so a callee is already known here.
+    const auto *FD = llvm::dyn_cast<clang::FunctionDecl>(Ref->getDecl());
+    if (FD && !Callees.contains(Ref))
+      Sites.AddressTaken.insert(calleeKey(FD));
+    return true;
+  }
+
+private:
+  CallSites &Sites;
+  llvm::DenseSet<const clang::Expr *> Callees;
+};
+
+CallSites::CallSites(clang::ASTContext &Ctx) {
+  CallSiteCollector Collector(*this);
+  Collector.TraverseAST(Ctx);
+}
+
+void CallSites::record(const clang::FunctionDecl *Callee, unsigned Param,
+                       const clang::Expr *Arg) {
+  clang::QualType T = Callee->getParamDecl(Param)->getType();
+  if (T->isReferenceType() || !T->getAsCXXRecordDecl())
+    return;
+  ArgumentKinds &Kinds = Args[{calleeKey(Callee), Param}];
+  // An lvalue argument is copied into the parameter by a copy constructor;
+  // anything else is moved or constructed in place.
+  const auto *Construct =
+      llvm::dyn_cast<clang::CXXConstructExpr>(Arg->IgnoreImplicit());
+  if (Construct && Construct->isListInitialization())
+    Kinds.Braced = true;
+  if (Construct && Construct->getConstructor()->isCopyConstructor())
+    ++Kinds.Copies;
+  else
+    ++Kinds.Rvalues;
+}
+
+/// The statements a parameter can be used in: the body and, for a
+/// constructor, the member initializers.
+std::vector<const clang::Stmt *>
+parameterScopes(const clang::FunctionDecl *FD) {
+  std::vector<const clang::Stmt *> Scopes{FD->getBody()};
+  if (const auto *Ctor = llvm::dyn_cast<clang::CXXConstructorDecl>(FD))
+    for (const clang::CXXCtorInitializer *Init : Ctor->inits())
+      if (Init->isWritten())
+        Scopes.push_back(Init->getInit());
+  return Scopes;
+}
+
+/// True if every use of \p Param is something std::span also offers:
+/// size(), empty(), data(), front(), back(), iteration and indexing.
+bool usedAsSpan(const clang::ParmVarDecl *Param,
+                const std::vector<const clang::Stmt *> &Scopes,
+                clang::ASTContext &Ctx) {
+  for (const clang::Stmt *Scope : Scopes) {
+    auto Refs = match(
+        findAll(declRefExpr(to(decl(equalsNode(Param)))).bind("ref")), *Scope,
+        Ctx);
+    for (const BoundNodes &Node : Refs) {
+      const clang::Expr *E = Node.getNodeAs<clang::DeclRefExpr>("ref");
+      clang::DynTypedNodeList Parents = Ctx.getParents(*E);
+      while (!Parents.empty() && (Parents[0].get<clang::ParenExpr>() ||
+                                  Parents[0].get<clang::ImplicitCastExpr>())) {
+        E = Parents[0].get<clang::Expr>();
+        Parents = Ctx.getParents(*E);
+      }
+      if (Parents.empty())
+        return false;
+      if (const auto *Range = Parents[0].get<clang::VarDecl>()) {
+        // The implicit range variable of a range-for.
+        if (!Range->isImplicit())
+          return false;
+        continue;
+      }
+      if (const auto *Op = Parents[0].get<clang::CXXOperatorCallExpr>()) {
+        if (Op->getOperator() != clang::OO_Subscript || Op->getArg(0) != E)
+          return false;
+        continue;
+      }
+      const auto *Member = Parents[0].get<clang::MemberExpr>();
+      if (!Member || !Member->getMemberDecl()->getIdentifier())
+        return false;
+      bool Viewed = llvm::StringSwitch<bool>(Member->getMemberDecl()->getName())
+                        .Cases("size", "empty", "data", "front", "back", true)
+                        .Cases("begin", "end", "rbegin", "rend", true)
+                        .Default(false);
+      if (!Viewed)
+        return false;
+    }
+  }
+  return true;
+}
+
+/// Source text of the element type of a parameter spelled
+/// `std::vector<E>`; empty if it is spelled any other way.
+std::string spelledElementType(const clang::ParmVarDecl *Param,
+                               clang::ASTContext &Ctx) {
+  auto Spec = Param->getTypeSourceInfo()
+                  ->getTypeLoc()
+                  .getAsAdjusted<clang::TemplateSpecializationTypeLoc>();
+  if (!Spec || Spec.getNumArgs() != 1)
+    return {};
+  clang::SourceRange R = Spec.getArgLoc(0).getSourceRange();
+  if (R.isInvalid() || R.getBegin().isMacroID() || R.getEnd().isMacroID())
+    return {};
+  return clang::Lexer::getSourceText(
+             clang::CharSourceRange::getTokenRange(R), Ctx.getSourceManager(),
+             Ctx.getLangOpts())
+      .str();
+}
+
+/// Functions whose parameter list is fixed by something other than their
+/// body.
+bool hasFixedSignature(const clang::FunctionDecl *FD) {
+  if (FD->isMain() || FD->isDeleted() || FD->isDefaulted() ||
+      FD->isTemplateInstantiation() ||
+      llvm::isa<clang::CoroutineBodyStmt>(FD->getBody()))
+    return true;
+  if (const auto *Method = llvm::dyn_cast<clang::CXXMethodDecl>(FD))
+    if (Method->isVirtual() || Method->isCopyAssignmentOperator() ||
+        Method->isMoveAssignmentOperator())
+      return true;
+  if (const auto *Ctor = llvm::dyn_cast<clang::CXXConstructorDecl>(FD))
+    return Ctor->isCopyOrMoveConstructor();
+  return false;
+}
+
+} // namespace
+
+LargeByValueParamCheck::LargeByValueParamCheck(
+    llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
+    : HlTidyCheck(Name, Context),
+      MaxByValueBytes(Options.get("MaxByValueBytes", 64u)),
+      Inserter(Options.getLocalOrGlobal(
+                   "IncludeStyle", clang::tidy::utils::IncludeSorter::IS_LLVM),
+               areDiagsSelfContained()) {}
+
+void LargeByValueParamCheck::registerPPCallbacks(
+    const clang::SourceManager &, clang::Preprocessor *PP,
+    clang::Preprocessor *) {
+  Inserter.registerPreprocessor(PP);
+}
+
+void LargeByValueParamCheck::registerMatchers(MatchFinder *Finder) {
+  // Which parameters are expensive to copy, and what the body does with
+  // them, is decided in check().
+  Finder->addMatcher(
+      functionDecl(isDefinition(), unless(isImplicit()),
+                   hasAnyParameter(hasType(
+                       hasUnqualifiedDesugaredType(recordType()))))
+          .bind("func"),
+      this);
+}
+
+void LargeByValueParamCheck::check(const MatchFinder::MatchResult &Result) {
+  const auto *FD = Result.Nodes.getNodeAs<clang::FunctionDecl>("func");
+  if (!FD || !FD->getBody() || hasFixedSignature(FD))
+    return;
+
+  clang::ASTContext &Ctx = *Result.Context;
+  std::vector<const clang::Stmt *> Scopes = parameterScopes(FD);
+  for (unsigned I = 0, N = FD->getNumParams(); I != N; ++I) {
+    const clang::ParmVarDecl *Param = FD->getParamDecl(I);
+    clang::QualType T = Param->getType();
+    if (T->isReferenceType() || T->isDependentType() ||
+        !T->getAsCXXRecordDecl() || Param->getName().empty())
+      continue;
+
+    utils::CopyCost Cost = utils::CopyCosts::get(Ctx).of(T);
+    if (Cost.Kind == utils::CopyCost::Unknown ||
+        (Cost.Kind == utils::CopyCost::Bytes && Cost.Bytes <= MaxByValueBytes))
+      continue;
+
+    utils::VariableUses Uses;
+    for (const clang::Stmt *Scope : Scopes)
+      Uses.merge(utils::analyzeUses(Param, Scope, Ctx));
+    if (Uses.References == 0 || Uses.Escaped)
+      continue;
+
+    std::string TypeName =
+        T.getUnqualifiedType().getAsString(Ctx.getPrintingPolicy());
+
+    if (Uses.Moved) {
+      // A working copy that is modified and then returned is not a sink.
+      if (Uses.isModified())
+        continue;
+      const ArgumentKinds *Calls =
+          utils::getPerTU<CallSites>(Ctx).find(FD, I);
+      if (!Calls || Calls->Rvalues != 0 || Calls->Copies == 0)
+        continue;
+      diag(Param->getLocation(),
+           "sink parameter '%0' is moved from, but no call in this "
+           "translation unit passes an rvalue: every call copies '%1', which "
+           "%2")
+          << Param->getName() << TypeName << Cost.describe();
+      diag(Param->getLocation(),
+           "std::move the argument at the call sites that no longer need it, "
+           "or pass a temporary",
+           clang::DiagnosticIDs::Note);
+      continue;
+    }
+
+    if (Uses.Copied) {
+      diag(Param->getLocation(),
+           "by-value parameter '%0' is copied again but never moved: copying "
+           "'%1' %2; std::move it into its destination at its last use")
+          << Param->getName() << TypeName << Cost.describe();
+      continue;
+    }
+
+    if (!Uses.isReadOnly())
+      continue;
+
+    // Rewriting the signature must be possible at every declaration, and
+    // must not break a function pointer somewhere.
+    const CallSites &Sites = utils::getPerTU<CallSites>(Ctx);
+    bool Rewritable = !Sites.isAddressTaken(FD);
+    for (const clang::FunctionDecl *Redecl : FD->redecls()) {
+      const clang::ParmVarDecl *P = Redecl->getParamDecl(I);
+      clang::SourceRange R =
+          P->getTypeSourceInfo()->getTypeLoc().getSourceRange();
+      if (R.isInvalid() || R.getBegin().isMacroID() || R.getEnd().isMacroID())
+        Rewritable = false;
+    }
+
+    std::string Element;
+    if (utils::hasAtLeast(utils::detectStandard(Ctx),
+                          utils::CppStandard::Cpp20) &&
+        utils::StdSymbols::get(Ctx).is(T->getAsCXXRecordDecl(),
+                                       StdSymbol::Vector) &&
+        usedAsSpan(Param, Scopes, Ctx)) {
+      const ArgumentKinds *Calls = Sites.find(FD, I);
+      if (!Calls || !Calls->Braced)
+        Element = spelledElementType(Param, Ctx);
+    }
+
+    {
+      // Scoped so the warning is emitted before the notes below.
+      auto D = diag(Param->getLocation(),
+                    "parameter '%0' is taken by value but only read: every "
+                    "call copies '%1', which %2; take it as '%3'")
+               << Param->getName() << TypeName << Cost.describe()
+               << (Element.empty() ? "const " + TypeName + " &"
+                                   : "std::span<const " + Element + ">");
+      if (Rewritable) {
+        for (const clang::FunctionDecl *Redecl : FD->redecls()) {
+          const clang::ParmVarDecl *P = Redecl->getParamDecl(I);
+          clang::TypeLoc TL = P->getTypeSourceInfo()->getTypeLoc();
+          if (!Element.empty()) {
+            D << clang::FixItHint::CreateReplacement(
+                TL.getSourceRange(), "std::span<const " + Element + ">");
+            clang::FileID File =
+                Ctx.getSourceManager().getFileID(TL.getBeginLoc());
+            if (std::optional<clang::FixItHint> Include =
+                    Inserter.createIncludeInsertion(File, "<span>"))
+              D << *Include;
+          } else {
+            if (!P->getType().isConstQualified())
+              D << clang::FixItHint::CreateInsertion(TL.getBeginLoc(),
+                                                      "const ");
+            if (P->getName().empty() || P->getLocation().isMacroID())
+              D << clang::FixItHint::CreateInsertion(
+                  clang::Lexer::getLocForEndOfToken(
+                      TL.getEndLoc(), 0, Ctx.getSourceManager(),
+                      Ctx.getLangOpts()),
+                  " &");
+            else
+              D << clang::FixItHint::CreateInsertion(P->getLocation(), "&");
+          }
+        }
+      }
+    }
+
+    if (!Rewritable)
+      diag(Param->getLocation(),
+           "the address of the function is taken or its signature comes "
+           "from a macro, so it is not rewritten automatically",
+           clang::DiagnosticIDs::Note);
+    else if (!Element.empty())
+      diag(Param->getLocation(),
+           "'%0' is only sized, indexed and iterated, which std::span "
+           "offers for a std::vector, a std::array or a C array alike",
+           clang::DiagnosticIDs::Note)
+          << Param->getName();
+  }
+}
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
@@ -0,0 +1,77 @@
+//===--- LargeByValueParamCheck.h -*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// Flags function parameters taken by value whose copy is expensive: a
+// std::vector, std::map or std::string, a struct holding one, a
+// std::shared_ptr, a type with a user-provided copy constructor, or a
+// trivially copyable struct larger than `MaxByValueBytes` (default 64, from
+// ASTRecordLayout).  What the function does with the parameter decides the
+// advice:
+//
+//   - only read: take it as 'const T &' (**FixIt**), or as
+//     'std::span<const E>' in C++20 when a std::vector is only indexed and
+//     iterated (**FixIt**);
+//   - copied again (into a member, a container, a by-value argument)
+//     without ever being moved: std::move it instead;
+//   - moved from (a sink parameter): by-value is right, but it only pays
+//     off when callers pass rvalues, so it is flagged when every call in
+//     the translation unit passes an lvalue.
+//
+// Parameters that are modified in place (a working copy) or whose address
+// escapes are left alone, as are virtual functions, copy and move
+// constructors and assignment operators, and coroutines, whose signature or
+// parameter lifetime cannot change.  Fix-its rewrite every declaration of
+// the function and are not offered when its address is taken.  The
+// std::span fix-it also includes <span> in each file it rewrites, placed
+// according to `IncludeStyle` (`llvm` or `google`).
+//
+// References:
+//   - CppCoreGuidelines F.15, F.16, F.18
+//   - clang-tidy performance-unnecessary-value-param
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_CHECKS_LARGE_BY_VALUE_PARAM_CHECK_H
+#define HL_TIDY_CHECKS_LARGE_BY_VALUE_PARAM_CHECK_H
+
+#include "HlTidyCheck.h"
+
+#include "clang-tidy/utils/IncludeInserter.h"
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+class LargeByValueParamCheck : public HlTidyCheck {
+public:
+  LargeByValueParamCheck(llvm::StringRef Name,
+                         clang::tidy::ClangTidyContext *Context);
+
+  bool isLanguageVersionSupported(const clang::LangOptions &LangOpts) const override {
+    return LangOpts.CPlusPlus11;
+  }
+
+  void registerPPCallbacks(const clang::SourceManager &SM,
+                           clang::Preprocessor *PP,
+                           clang::Preprocessor *ModuleExpanderPP) override;
+  void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
+  void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// The common case is a std::string or container parameter.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::HeapAllocation;
+  }
+
+private:
+  /// Trivially copyable parameters up to this size are not reported.
+  unsigned MaxByValueBytes;
+  /// Adds `#include <span>` with the std::span fix-it.
+  clang::tidy::utils::IncludeInserter Inserter;
+};
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_CHECKS_LARGE_BY_VALUE_PARAM_CHECK_H
@@ -0,0 +1,198 @@
+//===--- LockInLoopCheck.cpp - hl-perf-lock-in-loop ------------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "LockInLoopCheck.h"
+#include "utils/CriticalSections.h"
+#include "utils/LoopContext.h"
+#include "utils/StdSymbols.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+
+#include <string>
+
+using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+namespace {
+
+/// What a critical section runs while the lock is held.
+struct SectionSize {
+  unsigned Statements = 0;
+  unsigned OpaqueCalls = 0;
+  unsigned Loops = 0;
+  const clang::CallExpr *FirstOpaque = nullptr;
+};
+
+/// True if \p Call runs code this translation unit does not contain: an
+/// indirect call, or a function without a definition here.
+bool isOpaqueCall(const clang::CallExpr *Call) {
+  const clang::FunctionDecl *Callee = Call->getDirectCallee();
+  if (!Callee)
+    return true;
+  return Callee->getBuiltinID() == 0 && !Callee->hasBody();
+}
+
+/// Adds what \p S runs to \p Size.  Lambdas are not entered: they need not
+/// run under the lock.
+void measure(const clang::Stmt *S, SectionSize &Size) {
+  if (!S || llvm::isa<clang::LambdaExpr>(S))
+    return;
+  if (!llvm::isa<clang::Expr, clang::CompoundStmt, clang::NullStmt>(S))
+    ++Size.Statements;
+  if (llvm::isa<clang::ForStmt, clang::WhileStmt, clang::DoStmt,
+                clang::CXXForRangeStmt>(S))
+    ++Size.Loops;
+  if (const auto *Call = llvm::dyn_cast<clang::CallExpr>(S);
+      Call && isOpaqueCall(Call)) {
+    ++Size.OpaqueCalls;
+    if (!Size.FirstOpaque)
+      Size.FirstOpaque = Call;
+  }
+  // Only what the user wrote of a range-for: not its implicit range,
+  // begin and end variables.
+  if (const auto *RangeFor = llvm::dyn_cast<clang::CXXForRangeStmt>(S)) {
+    measure(RangeFor->getRangeInit(), Size);
+    measure(RangeFor->getBody(), Size);
+    return;
+  }
+  // Expression statements of a block count as statements too.
+  bool Block = llvm::isa<clang::CompoundStmt>(S);
+  for (const clang::Stmt *Child : S->children()) {
+    if (Block && llvm::isa_and_nonnull<clang::Expr>(Child))
+      ++Size.Statements;
+    measure(Child, Size);
+  }
+}
+
+/// True if \p S passes \p Guard to a function, such as a condition
+/// variable's wait().
+bool handsOff(const clang::Stmt *S, const clang::VarDecl *Guard) {
+  if (!S)
+    return false;
+  auto IsGuard = [Guard](const clang::Expr *Arg) {
+    const auto *Ref =
+        llvm::dyn_cast<clang::DeclRefExpr>(Arg->IgnoreParenImpCasts());
+    return Ref && Ref->getDecl() == Guard;
+  };
+  if (const auto *Call = llvm::dyn_cast<clang::CallExpr>(S))
+    if (llvm::any_of(Call->arguments(), IsGuard))
+      return true;
+  for (const clang::Stmt *Child : S->children())
+    if (handsOff(Child, Guard))
+      return true;
+  return false;
+}
+
+std::string plural(unsigned N, llvm::StringRef Word) {
+  return std::to_string(N) + " " + Word.str() + (N == 1 ? "" : "s");
+}
+
+} // namespace
+
+LockInLoopCheck::LockInLoopCheck(llvm::StringRef Name,
+                                 clang::tidy::ClangTidyContext *Context)
+    : HlTidyCheck(Name, Context),
+      MaxLockedStatements(Options.get("MaxLockedStatements", 20u)),
+      MaxLockedCalls(Options.get("MaxLockedCalls", 3u)),
+      MaxLockedLoops(Options.get("MaxLockedLoops", 1u)) {}
+
+void LockInLoopCheck::registerMatchers(MatchFinder *Finder) {
+  // Which of these start a critical section is decided in check() by
+  // utils::criticalSectionOf().
+  Finder->addMatcher(
+      varDecl(hasLocalStorage(),
+              hasType(hasUnqualifiedDesugaredType(recordType(hasDeclaration(
+                  namedDecl(isStdSymbol(
+                      {StdSymbol::LockGuard, StdSymbol::ScopedLock,
+                       StdSymbol::UniqueLock, StdSymbol::SharedLock})))))))
+          .bind("guard"),
+      this);
+  Finder->addMatcher(
+      cxxMemberCallExpr(
+          callee(cxxMethodDecl(hasAnyName("lock", "lock_shared"))))
+          .bind("lock"),
+      this);
+}
+
+void LockInLoopCheck::check(const MatchFinder::MatchResult &Result) {
+  clang::ASTContext &Ctx = *Result.Context;
+  std::optional<utils::CriticalSection> Section;
+  clang::SourceLocation Loc;
+  if (const auto *Guard = Result.Nodes.getNodeAs<clang::VarDecl>("guard")) {
+    Section = utils::criticalSectionOf(Guard, Ctx);
+    Loc = Guard->getLocation();
+  } else if (const auto *Lock =
+                 Result.Nodes.getNodeAs<clang::CXXMemberCallExpr>("lock")) {
+    Section = utils::criticalSectionOf(Lock, Ctx);
+    Loc = Lock->getExprLoc();
+  }
+  if (!Section || Loc.isMacroID())
+    return;
+
+  std::string Mutex = utils::mutexSpelling(*Section, Ctx);
+
+  // Once per iteration.  A guard handed to a condition variable, or a
+  // lock released before the rest of the iteration, is per item by
+  // design.
+  const clang::Stmt *Loop =
+      utils::LoopContext::get(Ctx).innermostLoop(Section->Acquire);
+  bool PerItem =
+      (Section->Guard &&
+       llvm::any_of(Section->Statements,
+                    [&](const clang::Stmt *S) {
+                      return handsOff(S, Section->Guard);
+                    })) ||
+      (Section->Release && Section->Release != Section->Block->body_back());
+  if (Loop && !PerItem) {
+    std::optional<utils::LoopExecution> Executed = loopExecution(Loop);
+    if (!isRarelyRun(Executed)) {
+      diag(Loc, "'%0' locks '%1' on every iteration of the loop: each "
+                "acquisition is an atomic read-modify-write, and a "
+                "contended one puts the thread to sleep; take the lock once "
+                "around the loop, or collect the items and lock once per "
+                "batch")
+          << Section->Kind << Mutex;
+      if (Executed)
+        noteLoopExecution(Loc, *Executed);
+    }
+  }
+
+  SectionSize Size;
+  for (const clang::Stmt *S : Section->Statements) {
+    if (llvm::isa<clang::Expr>(S))
+      ++Size.Statements;
+    measure(S, Size);
+  }
+  if (Size.Statements <= MaxLockedStatements &&
+      Size.OpaqueCalls <= MaxLockedCalls && Size.Loops <= MaxLockedLoops)
+    return;
+  diag(Loc, "'%0' holds '%1' across %2, %3 into code outside this "
+            "translation unit and %4: every thread that needs '%1' waits "
+            "for all of it; move the work that does not touch the shared "
+            "state out of the critical section")
+      << Section->Kind << Mutex << plural(Size.Statements, "statement")
+      << plural(Size.OpaqueCalls, "call") << plural(Size.Loops, "loop");
+  if (const clang::CallExpr *Call = Size.FirstOpaque) {
+    if (const clang::FunctionDecl *Callee = Call->getDirectCallee())
+      diag(Call->getExprLoc(),
+           "'%0' is not defined in this translation unit and runs with "
+           "'%1' held",
+           clang::DiagnosticIDs::Note)
+          << Callee->getNameAsString() << Mutex;
+    else
+      diag(Call->getExprLoc(), "this indirect call runs with '%0' held",
+           clang::DiagnosticIDs::Note)
+          << Mutex;
+  }
+}
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
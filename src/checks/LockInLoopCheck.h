@@ -0,0 +1,65 @@
+//===--- LockInLoopCheck.h - hl-perf-lock-in-loop --------------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// Flags mutex acquisitions that cost more than they need to, the user-mutex
+// counterpart of the stream lock hl-perf-avoid-cout-cerr reports:
+//
+//   - a std::lock_guard, std::scoped_lock, std::unique_lock,
+//     std::shared_lock or `m.lock()` inside a loop body, which takes the
+//     lock once per element where one acquisition around the batch would
+//     do.  Guards handed to a condition variable and sections that unlock
+//     before the rest of the iteration are left alone: they are per-item
+//     by design;
+//   - critical sections that run more than `MaxLockedStatements` (default
+//     20) statements, more than `MaxLockedCalls` (default 3) calls into
+//     functions this translation unit cannot see, or more than
+//     `MaxLockedLoops` (default 1) loops while the lock is held.
+//
+// What runs under a lock is computed by utils/CriticalSections.h.
+//
+// References:
+//   - Herb Sutter, "Effective Concurrency: Use Critical Sections
+//     (Preferably Locks) to Eliminate Races" and "Avoid Calling Unknown
+//     Code While Inside a Critical Section"
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_CHECKS_LOCK_IN_LOOP_CHECK_H
+#define HL_TIDY_CHECKS_LOCK_IN_LOOP_CHECK_H
+
+#include "HlTidyCheck.h"
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+class LockInLoopCheck : public HlTidyCheck {
+public:
+  LockInLoopCheck(llvm::StringRef Name,
+                  clang::tidy::ClangTidyContext *Context);
+
+  bool isLanguageVersionSupported(const clang::LangOptions &LangOpts) const override {
+    return LangOpts.CPlusPlus11;
+  }
+
+  void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
+  void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// An uncontended acquisition is an atomic read-modify-write; a contended
+  /// one is a context switch.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::AtomicRMW;
+  }
+
+private:
+  unsigned MaxLockedStatements;
+  unsigned MaxLockedCalls;
+  unsigned MaxLockedLoops;
+};
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_CHECKS_LOCK_IN_LOOP_CHECK_H
@@ -2,13 +2,14 @@
 // Author: Aleksandr Loshkarev
 
 #include "PreferContainsCheck.h"
+#include "utils/StdSymbols.h"
 
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/ExprCXX.h"
-#include "clang/AST/ParentMapContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::declaresMethodNamed;
 
 namespace hl {
 namespace tidy {
@@ -16,71 +17,12 @@ namespace checks {
 
 PreferContainsCheck::PreferContainsCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
-
-/// Walk parents to check if the given find() call is compared with end().
-static bool isComparedWithEnd(clang::ASTContext &Ctx,
-                              const clang::CXXMemberCallExpr *FindCall) {
-  auto Parents = Ctx.getParents(*FindCall);
-  // Walk up through implicit casts, materialize, etc.
-  while (!Parents.empty()) {
-    const auto &P = Parents[0];
-    // Check for CXXOperatorCallExpr with == or !=.
-    if (const auto *Op = P.get<clang::CXXOperatorCallExpr>()) {
-      auto OpKind = Op->getOperator();
-      if (OpKind == clang::OO_ExclaimEqual ||
-          OpKind == clang::OO_EqualEqual) {
-        // Check if any other argument is an end() call.
-        for (unsigned i = 0; i < Op->getNumArgs(); ++i) {
-          const auto *Arg = Op->getArg(i)->IgnoreImplicit();
-          if (const auto *MC = llvm::dyn_cast<clang::CXXMemberCallExpr>(Arg)) {
-            if (const auto *Method = MC->getMethodDecl()) {
-              if (Method->getName() == "end")
-                return true;
-            }
-          }
-        }
-      }
-      return false;
-    }
-    // Check for CXXRewrittenBinaryOperator.
-    if (P.get<clang::CXXRewrittenBinaryOperator>())
-      return true; // contains() pattern detected at rewritten level
-    // Check for BinaryOperator (built-in != on iterators in some cases).
-    if (const auto *BO = P.get<clang::BinaryOperator>()) {
-      if (BO->getOpcode() == clang::BO_NE ||
-          BO->getOpcode() == clang::BO_EQ) {
-        // Check if one side is end().
-        for (const auto *Side : {BO->getLHS(), BO->getRHS()}) {
-          if (const auto *MC =
-                  llvm::dyn_cast<clang::CXXMemberCallExpr>(
-                      Side->IgnoreImplicit())) {
-            if (const auto *M = MC->getMethodDecl()) {
-              if (M->getName() == "end")
-                return true;
-            }
-          }
-        }
-      }
-      return false;
-    }
-    // Keep walking up through implicit nodes.
-    if (P.get<clang::ImplicitCastExpr>() ||
-        P.get<clang::MaterializeTemporaryExpr>() ||
-        P.get<clang::CXXConstructExpr>() ||
-        P.get<clang::UnaryOperator>() ||
-        P.get<clang::ExprWithCleanups>()) {
-      Parents = Ctx.getParents(P);
-      continue;
-    }
-    break;
-  }
-  return false;
-}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferContainsCheck::registerMatchers(MatchFinder *Finder) {
-  auto HasContainsMethod =
-      cxxRecordDecl(hasMethod(hasName("contains")));
+  // declaresMethodNamed() memoizes the per-class answer, so the method list
+  // of std::map<K, V> is scanned once per TU rather than once per find().
+  auto HasContainsMethod = cxxRecordDecl(declaresMethodNamed("contains"));
 
   // Pattern 1: container.count(key) > 0 or != 0
   Finder->addMatcher(
@@ -98,14 +40,28 @@ void PreferContainsCheck::registerMatchers(MatchFinder *Finder) {
       this);
 
   // Pattern 2: container.find(key) compared with container.end()
-  // Instead of trying to match the comparison operator (which may be
-  // rewritten in C++20), we match the find() call and walk up in check().
+  // Rooted at the comparison rather than at find(), so that no parent walk
+  // (and therefore no ParentMap for the whole TU) is needed.
+  // binaryOperation() covers built-in comparisons, overloaded operator==/!=
+  // and C++20 rewritten comparisons such as `it != end` implemented as
+  // !(it == end).  The operand may be wrapped in an iterator conversion
+  // (iterator -> const_iterator).
+  StatementMatcher FindCall =
+      cxxMemberCallExpr(callee(cxxMethodDecl(hasName("find"),
+                                             ofClass(HasContainsMethod))))
+          .bind("map_find_call");
+  StatementMatcher EndCall =
+      cxxMemberCallExpr(callee(cxxMethodDecl(hasAnyName("end", "cend"))));
+  auto Operand = [](const StatementMatcher &Inner) {
+    auto Bare = ignoringImplicit(ignoringParens(Inner));
+    return ignoringImplicit(ignoringParens(
+        expr(anyOf(Inner, cxxConstructExpr(hasArgument(0, Bare))))));
+  };
   Finder->addMatcher(
-      cxxMemberCallExpr(
-          callee(cxxMethodDecl(
-              hasName("find"),
-              ofClass(HasContainsMethod))))
-          .bind("map_find_call"),
+      binaryOperation(
+          hasAnyOperatorName("==", "!="),
+          hasOperands(Operand(FindCall), Operand(EndCall)))
+          .bind("find_end_check"),
       this);
 
   // Pattern 3: string.find(x) != std::string::npos
@@ -117,7 +73,7 @@ void PreferContainsCheck::registerMatchers(MatchFinder *Finder) {
                   callee(cxxMethodDecl(
                       hasName("find"),
                       ofClass(cxxRecordDecl(
-                          hasMethod(hasName("starts_with")))))))
+                          declaresMethodNamed("starts_with"))))))
                   .bind("str_find_call")),
           hasEitherOperand(ignoringImplicit(
               declRefExpr(to(namedDecl(hasName("npos")))))))
@@ -146,16 +102,19 @@ void PreferContainsCheck::check(
 
   if (const auto *FindCall =
           Result.Nodes.getNodeAs<clang::CXXMemberCallExpr>("map_find_call")) {
-    if (isComparedWithEnd(*Result.Context, FindCall)) {
-      diag(FindCall->getExprLoc(),
-           "find(k) != end() for existence check is verbose; "
-           "use .contains(k) (C++20) for clearer intent");
-
-      diag(FindCall->getExprLoc(),
-           "contains() returns bool directly, avoiding the unused "
-           "iterator and potential dangling-iterator bugs",
-           clang::DiagnosticIDs::Note);
-    }
+    // A rewritten `a != b` matches both as itself and as the `a == b` in its
+    // semantic form; report each find() once.
+    if (!ReportedFindCalls.insert(FindCall).second)
+      return;
+
+    diag(FindCall->getExprLoc(),
+         "find(k) != end() for existence check is verbose; "
+         "use .contains(k) (C++20) for clearer intent");
+
+    diag(FindCall->getExprLoc(),
+         "contains() returns bool directly, avoiding the unused "
+         "iterator and potential dangling-iterator bugs",
+         clang::DiagnosticIDs::Note);
     return;
   }
 
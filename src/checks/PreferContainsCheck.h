@@ -23,13 +23,14 @@
 #ifndef HL_TIDY_CHECKS_PREFER_CONTAINS_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_CONTAINS_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
+#include "llvm/ADT/DenseSet.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferContainsCheck : public clang::tidy::ClangTidyCheck {
+class PreferContainsCheck : public HlTidyCheck {
 public:
   PreferContainsCheck(llvm::StringRef Name,
                       clang::tidy::ClangTidyContext *Context);
@@ -40,6 +41,14 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// find()/end() on a dependent container resolve only in instantiations.
+  bool requiresInstantiations() const override { return true; }
+
+private:
+  /// find() calls already diagnosed in this TU.
+  llvm::DenseSet<const clang::Expr *> ReportedFindCalls;
 };
 
 } // namespace checks
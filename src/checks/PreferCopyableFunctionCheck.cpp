@@ -5,8 +5,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -14,24 +17,24 @@ namespace checks {
 
 PreferCopyableFunctionCheck::PreferCopyableFunctionCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferCopyableFunctionCheck::registerMatchers(MatchFinder *Finder) {
   // Match std::function variable declarations.
   Finder->addMatcher(
-      varDecl(hasType(namedDecl(hasName("::std::function"))))
+      varDecl(hasType(namedDecl(isStdSymbol(StdSymbol::Function))))
           .bind("func_var"),
       this);
 
   // Match std::function field declarations.
   Finder->addMatcher(
-      fieldDecl(hasType(namedDecl(hasName("::std::function"))))
+      fieldDecl(hasType(namedDecl(isStdSymbol(StdSymbol::Function))))
           .bind("func_field"),
       this);
 
   // Match std::function parameter declarations.
   Finder->addMatcher(
-      parmVarDecl(hasType(namedDecl(hasName("::std::function"))))
+      parmVarDecl(hasType(namedDecl(isStdSymbol(StdSymbol::Function))))
           .bind("func_param"),
       this);
 }
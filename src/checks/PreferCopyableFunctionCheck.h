@@ -24,13 +24,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_COPYABLE_FUNCTION_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_COPYABLE_FUNCTION_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferCopyableFunctionCheck : public clang::tidy::ClangTidyCheck {
+class PreferCopyableFunctionCheck : public HlTidyCheck {
 public:
   PreferCopyableFunctionCheck(llvm::StringRef Name,
                               clang::tidy::ClangTidyContext *Context);
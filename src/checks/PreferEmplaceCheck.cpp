@@ -14,7 +14,7 @@ namespace checks {
 
 PreferEmplaceCheck::PreferEmplaceCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferEmplaceCheck::registerMatchers(MatchFinder *Finder) {
   // Match push_back called with a CXXConstructExpr (explicit temporary).
@@ -21,13 +21,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_EMPLACE_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_EMPLACE_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferEmplaceCheck : public clang::tidy::ClangTidyCheck {
+class PreferEmplaceCheck : public HlTidyCheck {
 public:
   PreferEmplaceCheck(llvm::StringRef Name,
                      clang::tidy::ClangTidyContext *Context);
@@ -38,6 +38,15 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// Relies on the implicit construct expressions of the instantiated call.
+  bool requiresInstantiations() const override { return true; }
+
+  /// push_back(T(...)) constructs and moves a temporary.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::TemporaryCopy;
+  }
 };
 
 } // namespace checks
@@ -14,7 +14,7 @@ namespace checks {
 
 PreferEraseIfCheck::PreferEraseIfCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferEraseIfCheck::registerMatchers(MatchFinder *Finder) {
   // Match the erase-remove idiom:
@@ -24,13 +24,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_ERASE_IF_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_ERASE_IF_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferEraseIfCheck : public clang::tidy::ClangTidyCheck {
+class PreferEraseIfCheck : public HlTidyCheck {
 public:
   PreferEraseIfCheck(llvm::StringRef Name,
                      clang::tidy::ClangTidyContext *Context);
@@ -41,6 +41,10 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// erase() on a dependent container resolves only in instantiations.
+  bool requiresInstantiations() const override { return true; }
 };
 
 } // namespace checks
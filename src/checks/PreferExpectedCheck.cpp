@@ -5,8 +5,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -14,7 +17,7 @@ namespace checks {
 
 PreferExpectedCheck::PreferExpectedCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferExpectedCheck::registerMatchers(MatchFinder *Finder) {
   // Match functions that return std::optional — potential candidates
@@ -22,7 +25,7 @@ void PreferExpectedCheck::registerMatchers(MatchFinder *Finder) {
   Finder->addMatcher(
       functionDecl(
           returns(qualType(hasDeclaration(
-              namedDecl(hasName("::std::optional"))))))
+              namedDecl(isStdSymbol(StdSymbol::Optional))))))
           .bind("optional_return"),
       this);
 
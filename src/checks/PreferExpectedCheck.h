@@ -22,13 +22,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_EXPECTED_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_EXPECTED_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferExpectedCheck : public clang::tidy::ClangTidyCheck {
+class PreferExpectedCheck : public HlTidyCheck {
 public:
   PreferExpectedCheck(llvm::StringRef Name,
                       clang::tidy::ClangTidyContext *Context);
@@ -6,8 +6,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -15,37 +18,20 @@ namespace checks {
 
 PreferFlatContainersCheck::PreferFlatContainersCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferFlatContainersCheck::registerMatchers(MatchFinder *Finder) {
+  // One matcher per declaration kind; the container is identified in check()
+  // from the bound type declaration instead of one matcher per container.
+  auto TreeContainer =
+      namedDecl(isStdSymbol({StdSymbol::Map, StdSymbol::Set,
+                             StdSymbol::Multimap, StdSymbol::Multiset}))
+          .bind("container");
+
   Finder->addMatcher(
-      varDecl(hasType(namedDecl(hasName("::std::map")))).bind("map_var"),
-      this);
-  Finder->addMatcher(
-      fieldDecl(hasType(namedDecl(hasName("::std::map")))).bind("map_field"),
-      this);
-  Finder->addMatcher(
-      varDecl(hasType(namedDecl(hasName("::std::set")))).bind("set_var"),
-      this);
-  Finder->addMatcher(
-      fieldDecl(hasType(namedDecl(hasName("::std::set")))).bind("set_field"),
-      this);
-  Finder->addMatcher(
-      varDecl(hasType(namedDecl(hasName("::std::multimap"))))
-          .bind("mmap_var"),
-      this);
-  Finder->addMatcher(
-      fieldDecl(hasType(namedDecl(hasName("::std::multimap"))))
-          .bind("mmap_field"),
-      this);
-  Finder->addMatcher(
-      varDecl(hasType(namedDecl(hasName("::std::multiset"))))
-          .bind("mset_var"),
-      this);
+      varDecl(hasType(TreeContainer)).bind("container_var"), this);
   Finder->addMatcher(
-      fieldDecl(hasType(namedDecl(hasName("::std::multiset"))))
-          .bind("mset_field"),
-      this);
+      fieldDecl(hasType(TreeContainer)).bind("container_field"), this);
 }
 
 void PreferFlatContainersCheck::check(
@@ -53,49 +39,43 @@ void PreferFlatContainersCheck::check(
   auto Std = utils::detectStandard(*Result.Context);
 
   clang::SourceLocation Loc;
-  llvm::StringRef Container;
-  llvm::StringRef FlatAlt;
-
-  if (const auto *V = Result.Nodes.getNodeAs<clang::VarDecl>("map_var")) {
+  if (const auto *V =
+          Result.Nodes.getNodeAs<clang::VarDecl>("container_var")) {
     Loc = V->getLocation();
-    Container = "std::map";
-    FlatAlt = "std::flat_map";
   } else if (const auto *F =
-                 Result.Nodes.getNodeAs<clang::FieldDecl>("map_field")) {
+                 Result.Nodes.getNodeAs<clang::FieldDecl>("container_field")) {
     Loc = F->getLocation();
+  } else {
+    return;
+  }
+
+  const auto *ContainerDecl =
+      Result.Nodes.getNodeAs<clang::NamedDecl>("container");
+  auto Symbol =
+      utils::StdSymbols::get(*Result.Context).classify(ContainerDecl);
+  if (!Symbol)
+    return;
+
+  llvm::StringRef Container;
+  llvm::StringRef FlatAlt;
+  switch (*Symbol) {
+  case StdSymbol::Map:
     Container = "std::map";
     FlatAlt = "std::flat_map";
-  } else if (const auto *V =
-                 Result.Nodes.getNodeAs<clang::VarDecl>("set_var")) {
-    Loc = V->getLocation();
+    break;
+  case StdSymbol::Set:
     Container = "std::set";
     FlatAlt = "std::flat_set";
-  } else if (const auto *F =
-                 Result.Nodes.getNodeAs<clang::FieldDecl>("set_field")) {
-    Loc = F->getLocation();
-    Container = "std::set";
-    FlatAlt = "std::flat_set";
-  } else if (const auto *V =
-                 Result.Nodes.getNodeAs<clang::VarDecl>("mmap_var")) {
-    Loc = V->getLocation();
-    Container = "std::multimap";
-    FlatAlt = "std::flat_multimap";
-  } else if (const auto *F =
-                 Result.Nodes.getNodeAs<clang::FieldDecl>("mmap_field")) {
-    Loc = F->getLocation();
+    break;
+  case StdSymbol::Multimap:
     Container = "std::multimap";
     FlatAlt = "std::flat_multimap";
-  } else if (const auto *V =
-                 Result.Nodes.getNodeAs<clang::VarDecl>("mset_var")) {
-    Loc = V->getLocation();
+    break;
+  case StdSymbol::Multiset:
     Container = "std::multiset";
     FlatAlt = "std::flat_multiset";
-  } else if (const auto *F =
-                 Result.Nodes.getNodeAs<clang::FieldDecl>("mset_field")) {
-    Loc = F->getLocation();
-    Container = "std::multiset";
-    FlatAlt = "std::flat_multiset";
-  } else {
+    break;
+  default:
     return;
   }
 
@@ -109,7 +89,7 @@ void PreferFlatContainersCheck::check(
          "use %0 (C++23): contiguous storage with cache-friendly "
          "lookup and iteration",
          clang::DiagnosticIDs::Note)
-        << FlatAlt;
+        << FlatAlt << utils::Suggestion{FlatAlt.str(), "C++23"};
   } else {
     diag(Loc,
          "use a sorted std::vector with std::lower_bound, or "
@@ -124,7 +104,8 @@ void PreferFlatContainersCheck::check(
   diag(Loc,
        "if O(1) average lookup is needed, consider "
        "std::unordered_map/unordered_set or absl::flat_hash_map",
-       clang::DiagnosticIDs::Note);
+       clang::DiagnosticIDs::Note)
+      << utils::Suggestion{"std::unordered_map/unordered_set", ""};
 }
 
 } // namespace checks
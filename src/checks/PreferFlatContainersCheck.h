@@ -26,13 +26,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_FLAT_CONTAINERS_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_FLAT_CONTAINERS_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferFlatContainersCheck : public clang::tidy::ClangTidyCheck {
+class PreferFlatContainersCheck : public HlTidyCheck {
 public:
   PreferFlatContainersCheck(llvm::StringRef Name,
                             clang::tidy::ClangTidyContext *Context);
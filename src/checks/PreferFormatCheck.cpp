@@ -6,8 +6,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -15,13 +18,15 @@ namespace checks {
 
 PreferFormatCheck::PreferFormatCheck(llvm::StringRef Name,
                                      clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferFormatCheck::registerMatchers(MatchFinder *Finder) {
   // Match construction of std::stringstream / std::ostringstream.
   Finder->addMatcher(
-      varDecl(hasType(namedDecl(
-                  matchesName("::std::(basic_)?(o|i)?stringstream"))))
+      varDecl(hasType(namedDecl(isStdSymbol(
+                  {StdSymbol::BasicStringstream, StdSymbol::BasicOstringstream,
+                   StdSymbol::BasicIstringstream, StdSymbol::Stringstream,
+                   StdSymbol::Ostringstream, StdSymbol::Istringstream}))))
           .bind("sstream_var"),
       this);
 
@@ -20,13 +20,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_FORMAT_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_FORMAT_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferFormatCheck : public clang::tidy::ClangTidyCheck {
+class PreferFormatCheck : public HlTidyCheck {
 public:
   PreferFormatCheck(llvm::StringRef Name,
                     clang::tidy::ClangTidyContext *Context);
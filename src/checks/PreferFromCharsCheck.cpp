@@ -6,8 +6,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -15,26 +18,29 @@ namespace checks {
 
 PreferFromCharsCheck::PreferFromCharsCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferFromCharsCheck::registerMatchers(MatchFinder *Finder) {
   // Match calls to std::stoi, std::stol, std::stoll, std::stoul,
   // std::stoull, std::stof, std::stod, std::stold.
   Finder->addMatcher(
-      callExpr(callee(functionDecl(matchesName(
-                   "::std::sto(i|l|ll|ul|ull|f|d|ld)"))))
+      callExpr(callee(functionDecl(isStdSymbol(
+                   {StdSymbol::Stoi, StdSymbol::Stol, StdSymbol::Stoll,
+                    StdSymbol::Stoul, StdSymbol::Stoull, StdSymbol::Stof,
+                    StdSymbol::Stod, StdSymbol::Stold}))))
           .bind("sto_call"),
       this);
 
   // Match calls to std::to_string.
   Finder->addMatcher(
-      callExpr(callee(functionDecl(hasName("::std::to_string"))))
+      callExpr(callee(functionDecl(isStdSymbol(StdSymbol::ToString))))
           .bind("to_string_call"),
       this);
 
   // Match atoi, atol, atof from C.
   Finder->addMatcher(
-      callExpr(callee(functionDecl(matchesName("^::ato(i|l|f|ll)$"))))
+      callExpr(callee(functionDecl(
+                   hasAnyName("::atoi", "::atol", "::atof", "::atoll"))))
           .bind("ato_call"),
       this);
 }
@@ -19,13 +19,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_FROM_CHARS_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_FROM_CHARS_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferFromCharsCheck : public clang::tidy::ClangTidyCheck {
+class PreferFromCharsCheck : public HlTidyCheck {
 public:
   PreferFromCharsCheck(llvm::StringRef Name,
                        clang::tidy::ClangTidyContext *Context);
@@ -36,6 +36,16 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// std::stoi(S) and std::to_string(V) with dependent arguments are
+  /// unresolved calls until instantiated.
+  bool requiresInstantiations() const override { return true; }
+
+  /// The sto* and to_string family consult the global locale.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::LocaleLock;
+  }
 };
 
 } // namespace checks
@@ -5,8 +5,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -14,14 +17,14 @@ namespace checks {
 
 PreferFunctionRefCheck::PreferFunctionRefCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferFunctionRefCheck::registerMatchers(MatchFinder *Finder) {
   // Match function parameters of type std::function (by value or const ref).
   // These are prime candidates for std::function_ref when the callable
   // does not outlive the function call.
   Finder->addMatcher(
-      parmVarDecl(hasType(namedDecl(hasName("::std::function"))))
+      parmVarDecl(hasType(namedDecl(isStdSymbol(StdSymbol::Function))))
           .bind("func_param"),
       this);
 
@@ -29,7 +32,7 @@ void PreferFunctionRefCheck::registerMatchers(MatchFinder *Finder) {
   Finder->addMatcher(
       parmVarDecl(hasType(references(qualType(
           isConstQualified(),
-          hasDeclaration(namedDecl(hasName("::std::function")))))))
+          hasDeclaration(namedDecl(isStdSymbol(StdSymbol::Function)))))))
           .bind("func_cref_param"),
       this);
 }
@@ -19,13 +19,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_FUNCTION_REF_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_FUNCTION_REF_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferFunctionRefCheck : public clang::tidy::ClangTidyCheck {
+class PreferFunctionRefCheck : public HlTidyCheck {
 public:
   PreferFunctionRefCheck(llvm::StringRef Name,
                          clang::tidy::ClangTidyContext *Context);
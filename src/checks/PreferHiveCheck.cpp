@@ -5,8 +5,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -14,26 +17,26 @@ namespace checks {
 
 PreferHiveCheck::PreferHiveCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferHiveCheck::registerMatchers(MatchFinder *Finder) {
   // Match std::list variable and field declarations.
   Finder->addMatcher(
-      varDecl(hasType(namedDecl(hasName("::std::list"))))
+      varDecl(hasType(namedDecl(isStdSymbol(StdSymbol::List))))
           .bind("list_var"),
       this);
   Finder->addMatcher(
-      fieldDecl(hasType(namedDecl(hasName("::std::list"))))
+      fieldDecl(hasType(namedDecl(isStdSymbol(StdSymbol::List))))
           .bind("list_field"),
       this);
 
   // Match std::forward_list variable and field declarations.
   Finder->addMatcher(
-      varDecl(hasType(namedDecl(hasName("::std::forward_list"))))
+      varDecl(hasType(namedDecl(isStdSymbol(StdSymbol::ForwardList))))
           .bind("fwd_list_var"),
       this);
   Finder->addMatcher(
-      fieldDecl(hasType(namedDecl(hasName("::std::forward_list"))))
+      fieldDecl(hasType(namedDecl(isStdSymbol(StdSymbol::ForwardList))))
           .bind("fwd_list_field"),
       this);
 }
@@ -78,7 +81,8 @@ void PreferHiveCheck::check(
        "if pointer/iterator stability is not needed, prefer "
        "std::vector which has the best cache locality; "
        "for pre-C++26, consider plf::colony",
-       clang::DiagnosticIDs::Note);
+       clang::DiagnosticIDs::Note)
+      << utils::Suggestion{"plf::colony", ""};
 }
 
 } // namespace checks
@@ -26,13 +26,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_HIVE_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_HIVE_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferHiveCheck : public clang::tidy::ClangTidyCheck {
+class PreferHiveCheck : public HlTidyCheck {
 public:
   PreferHiveCheck(llvm::StringRef Name,
                   clang::tidy::ClangTidyContext *Context);
@@ -5,8 +5,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -14,7 +17,7 @@ namespace checks {
 
 PreferInplaceVectorCheck::PreferInplaceVectorCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context),
+    : HlTidyCheck(Name, Context),
       MaxInplaceSize(
           Options.get("MaxInplaceSize", 64u)) {}
 
@@ -26,7 +29,7 @@ void PreferInplaceVectorCheck::registerMatchers(MatchFinder *Finder) {
   Finder->addMatcher(
       cxxMemberCallExpr(
           on(declRefExpr(to(
-              varDecl(hasType(namedDecl(hasName("::std::vector"))),
+              varDecl(hasType(namedDecl(isStdSymbol(StdSymbol::Vector))),
                       hasLocalStorage())
                   .bind("vec_var")))),
           callee(cxxMethodDecl(hasName("reserve"))),
@@ -37,7 +40,7 @@ void PreferInplaceVectorCheck::registerMatchers(MatchFinder *Finder) {
   // Match local std::vector with constructor taking a size argument.
   Finder->addMatcher(
       varDecl(
-          hasType(namedDecl(hasName("::std::vector"))),
+          hasType(namedDecl(isStdSymbol(StdSymbol::Vector))),
           hasLocalStorage(),
           hasInitializer(
               cxxConstructExpr(
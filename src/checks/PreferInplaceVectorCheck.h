@@ -22,13 +22,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_INPLACE_VECTOR_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_INPLACE_VECTOR_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferInplaceVectorCheck : public clang::tidy::ClangTidyCheck {
+class PreferInplaceVectorCheck : public HlTidyCheck {
 public:
   PreferInplaceVectorCheck(llvm::StringRef Name,
                            clang::tidy::ClangTidyContext *Context);
@@ -40,6 +40,10 @@ public:
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
 
+protected:
+  /// reserve() on a dependent std::vector resolves only when instantiated.
+  bool requiresInstantiations() const override { return true; }
+
 private:
   /// Maximum vector size to consider for inplace_vector suggestion.
   unsigned MaxInplaceSize;
@@ -5,8 +5,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -14,17 +17,18 @@ namespace checks {
 
 PreferJthreadCheck::PreferJthreadCheck(llvm::StringRef Name,
                                        clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferJthreadCheck::registerMatchers(MatchFinder *Finder) {
   // Match variable declarations of std::thread.
   Finder->addMatcher(
-      varDecl(hasType(namedDecl(hasName("::std::thread")))).bind("thread_var"),
+      varDecl(hasType(namedDecl(isStdSymbol(StdSymbol::Thread))))
+          .bind("thread_var"),
       this);
 
   // Match field declarations of std::thread.
   Finder->addMatcher(
-      fieldDecl(hasType(namedDecl(hasName("::std::thread"))))
+      fieldDecl(hasType(namedDecl(isStdSymbol(StdSymbol::Thread))))
           .bind("thread_field"),
       this);
 }
@@ -13,13 +13,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_JTHREAD_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_JTHREAD_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferJthreadCheck : public clang::tidy::ClangTidyCheck {
+class PreferJthreadCheck : public HlTidyCheck {
 public:
   PreferJthreadCheck(llvm::StringRef Name,
                      clang::tidy::ClangTidyContext *Context);
@@ -5,8 +5,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -14,19 +17,19 @@ namespace checks {
 
 PreferMoveOnlyFunctionCheck::PreferMoveOnlyFunctionCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferMoveOnlyFunctionCheck::registerMatchers(MatchFinder *Finder) {
   // Match std::function fields (often used for storing callbacks).
   Finder->addMatcher(
-      fieldDecl(hasType(namedDecl(hasName("::std::function"))))
+      fieldDecl(hasType(namedDecl(isStdSymbol(StdSymbol::Function))))
           .bind("func_field"),
       this);
 
   // Match std::function parameters taken by value (ownership transfer).
   Finder->addMatcher(
       parmVarDecl(
-          hasType(namedDecl(hasName("::std::function"))),
+          hasType(namedDecl(isStdSymbol(StdSymbol::Function))),
           unless(hasType(references(qualType()))))
           .bind("func_param_val"),
       this);
@@ -36,7 +39,7 @@ void PreferMoveOnlyFunctionCheck::registerMatchers(MatchFinder *Finder) {
       parmVarDecl(
           hasType(rValueReferenceType(
               pointee(hasDeclaration(
-                  namedDecl(hasName("::std::function")))))))
+                  namedDecl(isStdSymbol(StdSymbol::Function)))))))
           .bind("func_param_rval"),
       this);
 }
@@ -15,13 +15,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_MOVE_ONLY_FUNCTION_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_MOVE_ONLY_FUNCTION_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferMoveOnlyFunctionCheck : public clang::tidy::ClangTidyCheck {
+class PreferMoveOnlyFunctionCheck : public HlTidyCheck {
 public:
   PreferMoveOnlyFunctionCheck(llvm::StringRef Name,
                               clang::tidy::ClangTidyContext *Context);
@@ -14,7 +14,7 @@ namespace checks {
 
 PreferNoexceptMoveCheck::PreferNoexceptMoveCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferNoexceptMoveCheck::registerMatchers(MatchFinder *Finder) {
   // Match move constructors without noexcept.
@@ -22,13 +22,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_NOEXCEPT_MOVE_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_NOEXCEPT_MOVE_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferNoexceptMoveCheck : public clang::tidy::ClangTidyCheck {
+class PreferNoexceptMoveCheck : public HlTidyCheck {
 public:
   PreferNoexceptMoveCheck(llvm::StringRef Name,
                           clang::tidy::ClangTidyContext *Context);
@@ -39,6 +39,12 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// Without noexcept, vector growth copies instead of moving.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::CopyOnReallocation;
+  }
 };
 
 } // namespace checks
@@ -5,8 +5,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -14,7 +17,7 @@ namespace checks {
 
 PreferPrintCheck::PreferPrintCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferPrintCheck::registerMatchers(MatchFinder *Finder) {
   // Match printf / fprintf / puts / fputs calls.
@@ -38,7 +41,7 @@ void PreferPrintCheck::registerMatchers(MatchFinder *Finder) {
           hasOverloadedOperatorName("<<"),
           hasArgument(0,
               declRefExpr(to(namedDecl(
-                  hasAnyName("::std::cout", "::std::cerr"))))))
+                  isStdSymbol({StdSymbol::Cout, StdSymbol::Cerr}))))))
           .bind("cout_shift"),
       this);
 }
@@ -30,13 +30,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_PRINT_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_PRINT_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferPrintCheck : public clang::tidy::ClangTidyCheck {
+class PreferPrintCheck : public HlTidyCheck {
 public:
   PreferPrintCheck(llvm::StringRef Name,
                    clang::tidy::ClangTidyContext *Context);
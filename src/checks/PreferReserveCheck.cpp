@@ -2,11 +2,15 @@
 // Author: Aleksandr Loshkarev
 
 #include "PreferReserveCheck.h"
+#include "utils/LoopContext.h"
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -14,28 +18,16 @@ namespace checks {
 
 PreferReserveCheck::PreferReserveCheck(llvm::StringRef Name,
                                        clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferReserveCheck::registerMatchers(MatchFinder *Finder) {
-  // Match push_back/emplace_back calls on vectors inside any loop construct.
-  // forStmt, whileStmt, doStmt, cxxForRangeStmt
-  auto PushBackMatcher =
+  // Match push_back/emplace_back calls on vectors; check() keeps only those
+  // that run once per iteration of a for/while/do/range-for loop.
+  Finder->addMatcher(
       cxxMemberCallExpr(
-          on(hasType(namedDecl(hasName("::std::vector")))),
+          on(hasType(namedDecl(isStdSymbol(StdSymbol::Vector)))),
           callee(cxxMethodDecl(hasAnyName("push_back", "emplace_back"))))
-          .bind("push_in_loop");
-
-  Finder->addMatcher(
-      forStmt(hasDescendant(PushBackMatcher)).bind("for_loop"), this);
-
-  Finder->addMatcher(
-      whileStmt(hasDescendant(PushBackMatcher)).bind("while_loop"), this);
-
-  Finder->addMatcher(
-      doStmt(hasDescendant(PushBackMatcher)).bind("do_loop"), this);
-
-  Finder->addMatcher(
-      cxxForRangeStmt(hasDescendant(PushBackMatcher)).bind("range_loop"),
+          .bind("push_in_loop"),
       this);
 }
 
@@ -45,6 +37,14 @@ void PreferReserveCheck::check(const MatchFinder::MatchResult &Result) {
   if (!Push)
     return;
 
+  const clang::Stmt *Loop =
+      utils::LoopContext::get(*Result.Context).innermostLoop(Push);
+  if (!Loop)
+    return;
+  std::optional<utils::LoopExecution> Executed = loopExecution(Loop);
+  if (isRarelyRun(Executed))
+    return;
+
   diag(Push->getExprLoc(),
        "push_back/emplace_back inside a loop without reserve() causes "
        "repeated heap reallocations; call reserve() before the loop "
@@ -59,6 +59,23 @@ void PreferReserveCheck::check(const MatchFinder::MatchResult &Result) {
        "if the final size is unknown, consider reserving an estimated "
        "upper bound, or use std::vector::resize() + index assignment",
        clang::DiagnosticIDs::Note);
+
+  if (!Executed)
+    return;
+  noteLoopExecution(Push->getExprLoc(), *Executed);
+  // Appends per entry of the loop, which is what one reserve() before it
+  // has to cover.
+  std::optional<uint64_t> Appends = executionsAt(Push->getExprLoc());
+  if (Appends && Executed->Entries && *Executed->Entries > 0) {
+    uint64_t PerEntry = (*Appends + *Executed->Entries - 1) /
+                        *Executed->Entries;
+    if (PerEntry > 1)
+      diag(Push->getExprLoc(),
+           "the coverage run appended %0 elements per loop entry on "
+           "average; consider reserve(%0) before the loop",
+           clang::DiagnosticIDs::Note)
+          << std::to_string(PerEntry);
+  }
 }
 
 } // namespace checks
@@ -14,13 +14,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_RESERVE_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_RESERVE_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferReserveCheck : public clang::tidy::ClangTidyCheck {
+class PreferReserveCheck : public HlTidyCheck {
 public:
   PreferReserveCheck(llvm::StringRef Name,
                      clang::tidy::ClangTidyContext *Context);
@@ -31,6 +31,15 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// push_back() on a std::vector<T> is an unresolved call until instantiated.
+  bool requiresInstantiations() const override { return true; }
+
+  /// Growth without reserve() reallocates and moves the elements.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::Reallocation;
+  }
 };
 
 } // namespace checks
@@ -5,8 +5,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -14,7 +17,7 @@ namespace checks {
 
 PreferSpanCheck::PreferSpanCheck(llvm::StringRef Name,
                                  clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferSpanCheck::registerMatchers(MatchFinder *Finder) {
   // Match function parameters that are 'const std::vector<T>&' —
@@ -23,7 +26,7 @@ void PreferSpanCheck::registerMatchers(MatchFinder *Finder) {
       parmVarDecl(
           hasType(references(qualType(
               isConstQualified(),
-              hasDeclaration(namedDecl(hasName("::std::vector")))))))
+              hasDeclaration(namedDecl(isStdSymbol(StdSymbol::Vector)))))))
           .bind("vec_ref_param"),
       this);
 
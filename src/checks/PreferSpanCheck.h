@@ -17,13 +17,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_SPAN_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_SPAN_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferSpanCheck : public clang::tidy::ClangTidyCheck {
+class PreferSpanCheck : public HlTidyCheck {
 public:
   PreferSpanCheck(llvm::StringRef Name,
                   clang::tidy::ClangTidyContext *Context);
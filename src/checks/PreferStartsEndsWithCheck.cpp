@@ -14,7 +14,7 @@ namespace checks {
 
 PreferStartsEndsWithCheck::PreferStartsEndsWithCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferStartsEndsWithCheck::registerMatchers(MatchFinder *Finder) {
   // Pattern 1: s.find(x) == 0
@@ -23,13 +23,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_STARTS_ENDS_WITH_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_STARTS_ENDS_WITH_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferStartsEndsWithCheck : public clang::tidy::ClangTidyCheck {
+class PreferStartsEndsWithCheck : public HlTidyCheck {
 public:
   PreferStartsEndsWithCheck(llvm::StringRef Name,
                             clang::tidy::ClangTidyContext *Context);
@@ -40,6 +40,10 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// String member calls in templates may be dependent.
+  bool requiresInstantiations() const override { return true; }
 };
 
 } // namespace checks
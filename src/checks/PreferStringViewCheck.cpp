@@ -5,8 +5,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -14,7 +17,7 @@ namespace checks {
 
 PreferStringViewCheck::PreferStringViewCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferStringViewCheck::registerMatchers(MatchFinder *Finder) {
   // Match function parameters of type 'const std::string &'.
@@ -24,7 +27,7 @@ void PreferStringViewCheck::registerMatchers(MatchFinder *Finder) {
       parmVarDecl(
           hasType(references(qualType(
               isConstQualified(),
-              hasDeclaration(namedDecl(hasName("::std::basic_string")))))))
+              hasDeclaration(namedDecl(isStdSymbol(StdSymbol::BasicString)))))))
           .bind("param"),
       this);
 }
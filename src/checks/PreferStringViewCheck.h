@@ -14,13 +14,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_STRING_VIEW_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_STRING_VIEW_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferStringViewCheck : public clang::tidy::ClangTidyCheck {
+class PreferStringViewCheck : public HlTidyCheck {
 public:
   PreferStringViewCheck(llvm::StringRef Name,
                         clang::tidy::ClangTidyContext *Context);
@@ -31,6 +31,12 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// Passing a literal or substring materializes a std::string.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::HeapAllocation;
+  }
 };
 
 } // namespace checks
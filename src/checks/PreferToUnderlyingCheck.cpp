@@ -14,7 +14,7 @@ namespace checks {
 
 PreferToUnderlyingCheck::PreferToUnderlyingCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferToUnderlyingCheck::registerMatchers(MatchFinder *Finder) {
   // Match static_cast<IntegerType>(expr) where expr has scoped enum type.
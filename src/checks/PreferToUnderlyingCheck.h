@@ -22,13 +22,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_TO_UNDERLYING_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_TO_UNDERLYING_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferToUnderlyingCheck : public clang::tidy::ClangTidyCheck {
+class PreferToUnderlyingCheck : public HlTidyCheck {
 public:
   PreferToUnderlyingCheck(llvm::StringRef Name,
                           clang::tidy::ClangTidyContext *Context);
@@ -5,8 +5,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -14,25 +17,25 @@ namespace checks {
 
 PreferUniquePtrCheck::PreferUniquePtrCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferUniquePtrCheck::registerMatchers(MatchFinder *Finder) {
   // Flag std::make_shared calls — these are clear construction sites.
   Finder->addMatcher(
-      callExpr(callee(functionDecl(hasName("::std::make_shared"))))
+      callExpr(callee(functionDecl(isStdSymbol(StdSymbol::MakeShared))))
           .bind("make_shared"),
       this);
 
   // Flag field declarations with shared_ptr type.
   Finder->addMatcher(
-      fieldDecl(hasType(namedDecl(hasName("::std::shared_ptr"))))
+      fieldDecl(hasType(namedDecl(isStdSymbol(StdSymbol::SharedPtr))))
           .bind("shared_field"),
       this);
 
   // Flag shared_ptr parameters passed by value (copy = atomic inc/dec).
   Finder->addMatcher(
       parmVarDecl(
-          hasType(namedDecl(hasName("::std::shared_ptr"))),
+          hasType(namedDecl(isStdSymbol(StdSymbol::SharedPtr))),
           unless(hasType(references(qualType()))))
           .bind("shared_param_by_value"),
       this);
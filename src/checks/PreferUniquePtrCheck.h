@@ -18,13 +18,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_UNIQUE_PTR_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_UNIQUE_PTR_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferUniquePtrCheck : public clang::tidy::ClangTidyCheck {
+class PreferUniquePtrCheck : public HlTidyCheck {
 public:
   PreferUniquePtrCheck(llvm::StringRef Name,
                        clang::tidy::ClangTidyContext *Context);
@@ -35,6 +35,19 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// std::make_shared<T>(Args...) with dependent arguments is an unresolved
+  /// call until instantiated.
+  bool requiresInstantiations() const override { return true; }
+
+  /// Refcount traffic only matters where shared_ptr copies run per request.
+  bool isHotPathScoped() const override { return true; }
+
+  /// Each shared_ptr copy is an atomic reference count update.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::AtomicRMW;
+  }
 };
 
 } // namespace checks
@@ -14,7 +14,7 @@ namespace checks {
 
 PreferUnreachableCheck::PreferUnreachableCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferUnreachableCheck::registerMatchers(MatchFinder *Finder) {
   // Match __builtin_unreachable() calls.
@@ -22,13 +22,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_UNREACHABLE_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_UNREACHABLE_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferUnreachableCheck : public clang::tidy::ClangTidyCheck {
+class PreferUnreachableCheck : public HlTidyCheck {
 public:
   PreferUnreachableCheck(llvm::StringRef Name,
                          clang::tidy::ClangTidyContext *Context);
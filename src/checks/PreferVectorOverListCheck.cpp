@@ -6,8 +6,11 @@
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "utils/StdSymbols.h"
 
 using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
 
 namespace hl {
 namespace tidy {
@@ -15,24 +18,26 @@ namespace checks {
 
 PreferVectorOverListCheck::PreferVectorOverListCheck(
     llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
-    : ClangTidyCheck(Name, Context) {}
+    : HlTidyCheck(Name, Context) {}
 
 void PreferVectorOverListCheck::registerMatchers(MatchFinder *Finder) {
   // std::list
   Finder->addMatcher(
-      varDecl(hasType(namedDecl(hasName("::std::list")))).bind("list_var"),
+      varDecl(hasType(namedDecl(isStdSymbol(StdSymbol::List))))
+          .bind("list_var"),
       this);
   Finder->addMatcher(
-      fieldDecl(hasType(namedDecl(hasName("::std::list")))).bind("list_field"),
+      fieldDecl(hasType(namedDecl(isStdSymbol(StdSymbol::List))))
+          .bind("list_field"),
       this);
 
   // std::forward_list
   Finder->addMatcher(
-      varDecl(hasType(namedDecl(hasName("::std::forward_list"))))
+      varDecl(hasType(namedDecl(isStdSymbol(StdSymbol::ForwardList))))
           .bind("fwd_list_var"),
       this);
   Finder->addMatcher(
-      fieldDecl(hasType(namedDecl(hasName("::std::forward_list"))))
+      fieldDecl(hasType(namedDecl(isStdSymbol(StdSymbol::ForwardList))))
           .bind("fwd_list_field"),
       this);
 }
@@ -76,14 +81,16 @@ void PreferVectorOverListCheck::check(
     diag(Loc,
          "if you need stable iterators/pointers, consider "
          "boost::stable_vector or a pool allocator with std::vector",
-         clang::DiagnosticIDs::Note);
+         clang::DiagnosticIDs::Note)
+        << utils::Suggestion{"boost::stable_vector", ""};
   }
 
   if (utils::hasAtLeast(Std, utils::CppStandard::Cpp26)) {
     diag(Loc,
          "std::hive (C++26) provides stable pointers with better "
          "cache locality than linked lists",
-         clang::DiagnosticIDs::Note);
+         clang::DiagnosticIDs::Note)
+        << utils::Suggestion{"std::hive", "C++26"};
   }
 }
 
@@ -18,13 +18,13 @@
 #ifndef HL_TIDY_CHECKS_PREFER_VECTOR_OVER_LIST_CHECK_H
 #define HL_TIDY_CHECKS_PREFER_VECTOR_OVER_LIST_CHECK_H
 
-#include "clang-tidy/ClangTidyCheck.h"
+#include "HlTidyCheck.h"
 
 namespace hl {
 namespace tidy {
 namespace checks {
 
-class PreferVectorOverListCheck : public clang::tidy::ClangTidyCheck {
+class PreferVectorOverListCheck : public HlTidyCheck {
 public:
   PreferVectorOverListCheck(llvm::StringRef Name,
                             clang::tidy::ClangTidyContext *Context);
@@ -35,6 +35,12 @@ public:
 
   void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
   void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// Each node visited is a likely cache miss.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::CacheMiss;
+  }
 };
 
 } // namespace checks
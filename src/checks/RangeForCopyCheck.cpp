@@ -0,0 +1,162 @@
+//===--- RangeForCopyCheck.cpp - hl-perf-range-for-copy --------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "RangeForCopyCheck.h"
+#include "utils/CopyCost.h"
+#include "utils/VariableUses.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+
+using namespace clang::ast_matchers;
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+namespace {
+
+/// How the loop variable can be declared instead of by value.
+enum class Binding { None, ConstReference, ForwardingReference };
+
+/// Name of the loop variable for diagnostics; "[k, v]" for a structured
+/// binding.
+std::string variableName(const clang::VarDecl *Var) {
+  const auto *Decomposition = llvm::dyn_cast<clang::DecompositionDecl>(Var);
+  if (!Decomposition)
+    return Var->getName().str();
+  std::string Name = "[";
+  for (const clang::BindingDecl *B : Decomposition->bindings()) {
+    if (Name.size() > 1)
+      Name += ", ";
+    Name += B->getName().str();
+  }
+  return Name + "]";
+}
+
+} // namespace
+
+RangeForCopyCheck::RangeForCopyCheck(llvm::StringRef Name,
+                                     clang::tidy::ClangTidyContext *Context)
+    : HlTidyCheck(Name, Context),
+      MaxCopyBytes(Options.get("MaxCopyBytes", 64u)) {}
+
+void RangeForCopyCheck::registerMatchers(MatchFinder *Finder) {
+  // Whether the loop variable copies the element, and what one copy costs,
+  // is decided in check().
+  Finder->addMatcher(
+      cxxForRangeStmt(hasLoopVariable(varDecl().bind("var"))).bind("loop"),
+      this);
+}
+
+void RangeForCopyCheck::check(const MatchFinder::MatchResult &Result) {
+  const auto *For = Result.Nodes.getNodeAs<clang::CXXForRangeStmt>("loop");
+  const auto *Var = Result.Nodes.getNodeAs<clang::VarDecl>("var");
+  if (!For || !Var)
+    return;
+
+  clang::QualType T = Var->getType();
+  if (T->isReferenceType() || T->isDependentType())
+    return;
+  // Only a copy of the element itself can be replaced by a reference; a
+  // conversion or a proxy returned by value cannot.
+  const clang::Expr *Init = Var->getInit();
+  const auto *Construct =
+      Init ? llvm::dyn_cast<clang::CXXConstructExpr>(Init->IgnoreImplicit())
+           : nullptr;
+  if (!Construct || !Construct->getConstructor()->isCopyConstructor())
+    return;
+
+  clang::ASTContext &Ctx = *Result.Context;
+  utils::CopyCost Cost = utils::CopyCosts::get(Ctx).of(T);
+  if (Cost.Kind == utils::CopyCost::Unknown ||
+      (Cost.Kind == utils::CopyCost::Bytes && Cost.Bytes <= MaxCopyBytes))
+    return;
+
+  std::optional<utils::LoopExecution> Executed = loopExecution(For);
+  if (isRarelyRun(Executed))
+    return;
+
+  utils::VariableUses Uses;
+  if (const auto *Decomposition = llvm::dyn_cast<clang::DecompositionDecl>(Var))
+    for (const clang::BindingDecl *B : Decomposition->bindings())
+      Uses.merge(utils::analyzeUses(B, For->getBody(), Ctx));
+  else
+    Uses = utils::analyzeUses(Var, For->getBody(), Ctx);
+
+  // Moving out of the elements through a reference is only unobservable
+  // when the range is a temporary.
+  bool FromTemporary = !For->getRangeInit()->isLValue();
+  Binding Suggested = Binding::None;
+  if (Uses.Moved) {
+    // 'const auto &&' cannot be moved from, so it would copy where the
+    // body moves instead.
+    if (T->getContainedAutoType() && FromTemporary && !Uses.Escaped &&
+        !T.isConstQualified())
+      Suggested = Binding::ForwardingReference;
+  } else if (Uses.isReadOnly()) {
+    Suggested = Binding::ConstReference;
+  }
+
+  std::string Name = variableName(Var);
+  clang::SourceLocation TypeLoc =
+      Var->getTypeSourceInfo()->getTypeLoc().getBeginLoc();
+  {
+    // Scoped so the warning is emitted before the notes below.
+    auto D = diag(Var->getLocation(),
+                  "range-for variable '%0' copies every element: copying "
+                  "'%1' %2")
+             << Name
+             << T.getUnqualifiedType().getAsString(Ctx.getPrintingPolicy())
+             << Cost.describe();
+
+    if (Suggested != Binding::None && !TypeLoc.isMacroID() &&
+        !Var->getLocation().isMacroID()) {
+      if (Suggested == Binding::ForwardingReference) {
+        D << clang::FixItHint::CreateInsertion(Var->getLocation(), "&&");
+      } else {
+        if (!T.isConstQualified())
+          D << clang::FixItHint::CreateInsertion(TypeLoc, "const ");
+        D << clang::FixItHint::CreateInsertion(Var->getLocation(), "&");
+      }
+    }
+  }
+
+  if (Suggested == Binding::None) {
+    if (Uses.Moved && T.isConstQualified())
+      diag(Var->getLocation(),
+           "'%0' is const, so moving from it copies; iterate by "
+           "'const auto &' if it is not modified, or drop the 'const' to "
+           "move from the copy",
+           clang::DiagnosticIDs::Note)
+          << Name;
+    else if (Uses.Moved && !FromTemporary)
+      diag(Var->getLocation(),
+           "'%0' is moved from; iterating by 'auto &&' would move out of the "
+           "container's elements, so do it only if the container is not used "
+           "after the loop",
+           clang::DiagnosticIDs::Note)
+          << Name;
+    else if (Uses.Escaped && !Uses.Moved)
+      diag(Var->getLocation(),
+           "a pointer or reference to '%0' is taken in the loop body; iterate "
+           "by 'const auto &' once it cannot outlive the iteration",
+           clang::DiagnosticIDs::Note)
+          << Name;
+    else if (!Uses.Moved)
+      diag(Var->getLocation(),
+           "'%0' is modified in the loop body; iterate by 'auto &' if the "
+           "elements may change in place, otherwise keep the copy",
+           clang::DiagnosticIDs::Note)
+          << Name;
+  }
+
+  if (Executed)
+    noteLoopExecution(Var->getLocation(), *Executed);
+}
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
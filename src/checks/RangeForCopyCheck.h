@@ -0,0 +1,60 @@
+//===--- RangeForCopyCheck.h - hl-perf-range-for-copy ----------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// Flags range-for loops whose loop variable is a by-value copy of an
+// element that is expensive to copy: a std::string, a container, a struct
+// holding one (a heap allocation per iteration), a std::shared_ptr (an
+// atomic increment and decrement per iteration), a type with a
+// user-provided copy constructor, or a trivially copyable type larger than
+// `MaxCopyBytes` (default 64, one cache line).
+//
+// The fix-it iterates by 'const auto &' when the body only reads the copy,
+// and by 'auto &&' when the body moves from it and the range is a
+// temporary, so that the moved-from elements are not observable.
+//
+// References:
+//   - CppCoreGuidelines ES.71, F.16
+//   - clang-tidy performance-for-range-copy
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_CHECKS_RANGE_FOR_COPY_CHECK_H
+#define HL_TIDY_CHECKS_RANGE_FOR_COPY_CHECK_H
+
+#include "HlTidyCheck.h"
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+class RangeForCopyCheck : public HlTidyCheck {
+public:
+  RangeForCopyCheck(llvm::StringRef Name,
+                    clang::tidy::ClangTidyContext *Context);
+
+  bool isLanguageVersionSupported(const clang::LangOptions &LangOpts) const override {
+    return LangOpts.CPlusPlus11;
+  }
+
+  void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
+  void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// `auto` over a dependent range is deduced only when instantiated.
+  bool requiresInstantiations() const override { return true; }
+
+  /// The common case is a std::string or container element.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::HeapAllocation;
+  }
+
+private:
+  /// Trivially copyable elements up to this size are not reported.
+  unsigned MaxCopyBytes;
+};
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_CHECKS_RANGE_FOR_COPY_CHECK_H
@@ -0,0 +1,470 @@
+//===--- StringConcatInLoopCheck.cpp - hl-perf-string-concat-in-loop -----===//
+// Author: Aleksandr Loshkarev
+
+#include "StringConcatInLoopCheck.h"
+#include "utils/CppStandardUtils.h"
+#include "utils/LoopContext.h"
+#include "utils/StdSymbols.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclTemplate.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/ParentMapContext.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/Lex/Lexer.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include <algorithm>
+#include <string>
+
+using namespace clang::ast_matchers;
+using hl::tidy::utils::isStdSymbol;
+using hl::tidy::utils::StdSymbol;
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+namespace {
+
+auto stringType() {
+  return hasUnqualifiedDesugaredType(recordType(
+      hasDeclaration(namedDecl(isStdSymbol(StdSymbol::BasicString)))));
+}
+
+bool isString(clang::QualType T, clang::ASTContext &Ctx) {
+  const clang::CXXRecordDecl *RD =
+      T.getNonReferenceType()->getAsCXXRecordDecl();
+  return RD && utils::StdSymbols::get(Ctx).is(RD, StdSymbol::BasicString);
+}
+
+/// True for std::string, whose pieces std::format_to can append.
+bool isCharString(clang::QualType T) {
+  const auto *Spec =
+      llvm::dyn_cast_or_null<clang::ClassTemplateSpecializationDecl>(
+          T.getNonReferenceType()->getAsCXXRecordDecl());
+  return Spec && Spec->getTemplateArgs().size() > 0 &&
+         Spec->getTemplateArgs()[0].getKind() ==
+             clang::TemplateArgument::Type &&
+         Spec->getTemplateArgs()[0].getAsType()->isCharType();
+}
+
+/// True for the nodes the AST wraps around an operand: conversions,
+/// temporaries, parentheses and (before C++17) elidable moves.
+bool isImplicitWrapper(const clang::Expr *E) {
+  if (const auto *Construct = llvm::dyn_cast<clang::CXXConstructExpr>(E))
+    return Construct->isElidable() && Construct->getNumArgs() == 1;
+  return llvm::isa<clang::ImplicitCastExpr, clang::MaterializeTemporaryExpr,
+                   clang::CXXBindTemporaryExpr, clang::ParenExpr,
+                   clang::ExprWithCleanups>(E);
+}
+
+/// \p E without the implicit nodes around it.
+const clang::Expr *skipImplicit(const clang::Expr *E) {
+  for (;;) {
+    const clang::Expr *Next = E->IgnoreImplicit()->IgnoreParens();
+    if (const auto *Construct = llvm::dyn_cast<clang::CXXConstructExpr>(Next);
+        Construct && isImplicitWrapper(Construct))
+      Next = Construct->getArg(0);
+    if (Next == E)
+      return E;
+    E = Next;
+  }
+}
+
+/// The node \p E is an operand of, looking through the implicit nodes
+/// around it.
+clang::DynTypedNode parentOf(const clang::Expr *E, clang::ASTContext &Ctx) {
+  clang::DynTypedNode Node = clang::DynTypedNode::create(*E);
+  for (;;) {
+    clang::DynTypedNodeList Parents = Ctx.getParents(Node);
+    if (Parents.empty())
+      return {};
+    const auto *Parent = Parents[0].get<clang::Expr>();
+    if (!Parent || !isImplicitWrapper(Parent))
+      return Parents[0];
+    Node = Parents[0];
+  }
+}
+
+/// \p E as a std::string operator+, or null.
+const clang::CXXOperatorCallExpr *asConcat(const clang::Expr *E,
+                                           clang::ASTContext &Ctx) {
+  const auto *Call =
+      llvm::dyn_cast<clang::CXXOperatorCallExpr>(skipImplicit(E));
+  if (!Call || Call->getOperator() != clang::OO_Plus ||
+      Call->getNumArgs() != 2 || !isString(Call->getType(), Ctx))
+    return nullptr;
+  return Call;
+}
+
+/// The operands of the operator+ chain ending in \p Top, left to right.
+llvm::SmallVector<const clang::Expr *, 8>
+chainOperands(const clang::CXXOperatorCallExpr *Top, clang::ASTContext &Ctx) {
+  llvm::SmallVector<const clang::Expr *, 8> Operands;
+  const clang::Expr *E = Top;
+  while (const clang::CXXOperatorCallExpr *Call = asConcat(E, Ctx)) {
+    Operands.push_back(Call->getArg(1));
+    E = Call->getArg(0);
+  }
+  Operands.push_back(E);
+  std::reverse(Operands.begin(), Operands.end());
+  return Operands;
+}
+
+/// True if the value of \p E is not used: it is a statement of its own.
+bool isDiscarded(const clang::Expr *E, clang::ASTContext &Ctx) {
+  const auto *Parent = parentOf(E, Ctx).get<clang::Stmt>();
+  return Parent && !llvm::isa<clang::Expr, clang::ReturnStmt>(Parent);
+}
+
+/// True if \p S names \p D: a reference to the variable, or an access to
+/// the field.
+bool refersTo(const clang::Stmt *S, const clang::ValueDecl *D) {
+  if (!S)
+    return false;
+  if (const auto *Ref = llvm::dyn_cast<clang::DeclRefExpr>(S);
+      Ref && Ref->getDecl()->getCanonicalDecl() == D->getCanonicalDecl())
+    return true;
+  if (const auto *Member = llvm::dyn_cast<clang::MemberExpr>(S);
+      Member &&
+      Member->getMemberDecl()->getCanonicalDecl() == D->getCanonicalDecl())
+    return true;
+  return llvm::any_of(S->children(), [D](const clang::Stmt *Child) {
+    return refersTo(Child, D);
+  });
+}
+
+/// True if \p Piece may read \p Target: it names a variable or field that
+/// \p Target is reached through, as `Line.substr(0, 3)` does for `Line`.
+bool readsTarget(const clang::Stmt *Piece, const clang::Expr *Target) {
+  if (!Piece)
+    return false;
+  const clang::ValueDecl *D = nullptr;
+  if (const auto *Ref = llvm::dyn_cast<clang::DeclRefExpr>(Piece))
+    D = Ref->getDecl();
+  else if (const auto *Member = llvm::dyn_cast<clang::MemberExpr>(Piece))
+    D = Member->getMemberDecl();
+  if (D && refersTo(Target, D))
+    return true;
+  return llvm::any_of(Piece->children(), [Target](const clang::Stmt *Child) {
+    return readsTarget(Child, Target);
+  });
+}
+
+/// Source text of \p E, or an empty string inside macros.
+std::string sourceText(const clang::Expr *E, clang::ASTContext &Ctx) {
+  clang::CharSourceRange Range =
+      clang::CharSourceRange::getTokenRange(E->getSourceRange());
+  if (Range.getBegin().isMacroID() || Range.getEnd().isMacroID())
+    return {};
+  return clang::Lexer::getSourceText(Range, Ctx.getSourceManager(),
+                                     Ctx.getLangOpts())
+      .str();
+}
+
+/// `Object.append(a).append(b)...` for \p Pieces.
+std::optional<std::string>
+appendText(llvm::StringRef Object, llvm::ArrayRef<const clang::Expr *> Pieces,
+           clang::ASTContext &Ctx) {
+  std::string Text = Object.str();
+  for (const clang::Expr *Piece : Pieces) {
+    std::string Spelling = sourceText(Piece, Ctx);
+    if (Spelling.empty())
+      return std::nullopt;
+    if (skipImplicit(Piece)->getType()->isIntegralOrEnumerationType())
+      Text += ".append(1, " + Spelling + ")";
+    else
+      Text += ".append(" + Spelling + ")";
+  }
+  return Text;
+}
+
+/// The characters of an ordinary string or character literal as spelled
+/// between its quotes, ready to go between the quotes of a string literal.
+std::optional<std::string> literalSpelling(const clang::Expr *E,
+                                           llvm::StringRef Text) {
+  if (const auto *String = llvm::dyn_cast<clang::StringLiteral>(E)) {
+    if (!String->isOrdinary() || String->getNumConcatenated() != 1 ||
+        Text.size() < 2 || !Text.starts_with("\"") || !Text.ends_with("\""))
+      return std::nullopt;
+    return Text.drop_front().drop_back().str();
+  }
+  if (const auto *Char = llvm::dyn_cast<clang::CharacterLiteral>(E)) {
+    if (Char->getKind() != clang::CharacterLiteralKind::Ascii ||
+        Text.size() < 3 || !Text.starts_with("'") || !Text.ends_with("'"))
+      return std::nullopt;
+    llvm::StringRef Inner = Text.drop_front().drop_back();
+    return Inner == "\"" ? std::string("\\\"") : Inner.str();
+  }
+  return std::nullopt;
+}
+
+/// `std::format_to(std::back_inserter(Object), "...", ...)` appending
+/// \p Pieces, with the literal ones folded into the format string.
+std::optional<std::string>
+formatText(llvm::StringRef Object, llvm::ArrayRef<const clang::Expr *> Pieces,
+           clang::ASTContext &Ctx) {
+  std::string Format;
+  std::string Args;
+  for (const clang::Expr *Piece : Pieces) {
+    const clang::Expr *E = skipImplicit(Piece);
+    std::string Spelling = sourceText(E, Ctx);
+    if (Spelling.empty())
+      return std::nullopt;
+    if (std::optional<std::string> Literal = literalSpelling(E, Spelling)) {
+      for (char C : *Literal) {
+        if (C == '{' || C == '}')
+          Format += C;
+        Format += C;
+      }
+      continue;
+    }
+    // "{}" prints only a plain char as a character: integers, signed and
+    // unsigned char (uint8_t) print as numbers, and the wide character
+    // types do not format into a char string.  operator+ appends them all
+    // as one character.
+    if (E->getType()->isIntegralOrEnumerationType() &&
+        !E->getType()->isCharType())
+      return std::nullopt;
+    Format += "{}";
+    Args += ", " + Spelling;
+  }
+  return "std::format_to(std::back_inserter(" + Object.str() + "), \"" +
+         Format + "\"" + Args + ")";
+}
+
+/// Rewrites `std::string Var = a + b + ...;` to a reserve() of the final
+/// length followed by the appends.  Every operand has to be cheap to name
+/// twice: a literal, a character, or a string variable or member.  Falls
+/// back to append() and clears \p UseFormat when the pieces do not format
+/// the way they append.
+std::optional<clang::FixItHint>
+declarationFix(const clang::VarDecl *Var,
+               llvm::ArrayRef<const clang::Expr *> Operands, bool &UseFormat,
+               clang::ASTContext &Ctx) {
+  clang::DynTypedNodeList Parents = Ctx.getParents(*Var);
+  const auto *DS =
+      Parents.empty() ? nullptr : Parents[0].get<clang::DeclStmt>();
+  if (!DS || !DS->isSingleDecl() || !Var->hasLocalStorage() ||
+      Var->getType().isConstQualified() ||
+      !isString(Var->getType(), Ctx) || Var->getType()->isReferenceType() ||
+      Var->getType()->getContainedAutoType())
+    return std::nullopt;
+  Parents = Ctx.getParents(*DS);
+  if (Parents.empty() || !Parents[0].get<clang::CompoundStmt>())
+    return std::nullopt;
+  clang::SourceLocation Begin = DS->getBeginLoc();
+  if (Begin.isMacroID() || DS->getEndLoc().isMacroID())
+    return std::nullopt;
+
+  std::string Size;
+  for (const clang::Expr *Operand : Operands) {
+    const clang::Expr *E = skipImplicit(Operand);
+    std::string Term;
+    if (const auto *String = llvm::dyn_cast<clang::StringLiteral>(E)) {
+      Term = std::to_string(String->getLength());
+    } else if (E->getType()->isIntegralOrEnumerationType()) {
+      Term = "1";
+    } else if (llvm::isa<clang::DeclRefExpr, clang::MemberExpr>(E) &&
+               isString(E->getType(), Ctx)) {
+      Term = sourceText(E, Ctx);
+      if (Term.empty())
+        return std::nullopt;
+      Term += ".size()";
+    } else {
+      return std::nullopt;
+    }
+    Size += (Size.empty() ? "" : " + ") + Term;
+  }
+
+  std::string Name = Var->getNameAsString();
+  std::optional<std::string> Append;
+  if (UseFormat)
+    Append = formatText(Name, Operands, Ctx);
+  UseFormat = Append.has_value();
+  if (!Append)
+    Append = appendText(Name, Operands, Ctx);
+  if (!Append)
+    return std::nullopt;
+  const clang::SourceManager &SM = Ctx.getSourceManager();
+  llvm::StringRef Declarator = clang::Lexer::getSourceText(
+      clang::CharSourceRange::getCharRange(Begin, Var->getLocation()), SM,
+      Ctx.getLangOpts());
+  std::string Indent(SM.getSpellingColumnNumber(Begin) - 1, ' ');
+  return clang::FixItHint::CreateReplacement(
+      DS->getSourceRange(), Declarator.str() + Name + ";\n" + Indent + Name +
+                                ".reserve(" + Size + ");\n" + Indent +
+                                *Append + ";");
+}
+
+bool isStdPlus(const clang::Expr *E) {
+  const clang::CXXRecordDecl *RD = E->getType()->getAsCXXRecordDecl();
+  return RD && RD->isInStdNamespace() && RD->getIdentifier() &&
+         RD->getName() == "plus";
+}
+
+} // namespace
+
+StringConcatInLoopCheck::StringConcatInLoopCheck(
+    llvm::StringRef Name, clang::tidy::ClangTidyContext *Context)
+    : HlTidyCheck(Name, Context),
+      MinChainOperands(Options.get("MinChainOperands", 4u)) {}
+
+void StringConcatInLoopCheck::registerMatchers(MatchFinder *Finder) {
+  // Every operator+ on std::string; check() keeps the last one of each
+  // chain and looks at what its result is used for.
+  Finder->addMatcher(cxxOperatorCallExpr(hasOverloadedOperatorName("+"),
+                                         argumentCountIs(2),
+                                         hasType(stringType()))
+                         .bind("concat"),
+                     this);
+
+  Finder->addMatcher(
+      callExpr(callee(functionDecl(hasName("::std::accumulate"))),
+               hasArgument(2, expr(hasType(stringType()))))
+          .bind("accumulate"),
+      this);
+}
+
+void StringConcatInLoopCheck::check(const MatchFinder::MatchResult &Result) {
+  clang::ASTContext &Ctx = *Result.Context;
+  utils::CppStandard Std = utils::detectStandard(Ctx);
+
+  if (const auto *Call =
+          Result.Nodes.getNodeAs<clang::CallExpr>("accumulate")) {
+    // C++20 moves the accumulator into each operator+, which appends in
+    // place.
+    if (utils::hasAtLeast(Std, utils::CppStandard::Cpp20) ||
+        Call->getBeginLoc().isMacroID() ||
+        (Call->getNumArgs() == 4 && !isStdPlus(Call->getArg(3))))
+      return;
+    diag(Call->getBeginLoc(),
+         "std::accumulate over std::string computes 'init = init + *it' "
+         "before C++20, copying the whole result into a new string for "
+         "every element; append the elements in a range-for loop instead");
+    return;
+  }
+
+  const auto *Top =
+      Result.Nodes.getNodeAs<clang::CXXOperatorCallExpr>("concat");
+  if (!Top || Top->getBeginLoc().isMacroID())
+    return;
+  clang::DynTypedNode Parent = parentOf(Top, Ctx);
+  const auto *ParentCall = Parent.get<clang::CXXOperatorCallExpr>();
+  // Not the last operator+ of its chain.
+  if (ParentCall && asConcat(ParentCall, Ctx) &&
+      skipImplicit(ParentCall->getArg(0)) == Top)
+    return;
+  llvm::SmallVector<const clang::Expr *, 8> Operands = chainOperands(Top, Ctx);
+
+  // `s = s + ...` and `s += a + b` in a loop.
+  if (ParentCall && ParentCall->getNumArgs() == 2 &&
+      skipImplicit(ParentCall->getArg(1)) == Top &&
+      (ParentCall->getOperator() == clang::OO_Equal ||
+       ParentCall->getOperator() == clang::OO_PlusEqual)) {
+    const clang::Expr *Target = skipImplicit(ParentCall->getArg(0));
+    bool Self = ParentCall->getOperator() == clang::OO_Equal;
+    std::string Object = sourceText(Target, Ctx);
+    const clang::Stmt *Loop =
+        utils::LoopContext::get(Ctx).innermostLoop(ParentCall);
+    if (Loop && !Object.empty() &&
+        (!Self ||
+         (llvm::isa<clang::DeclRefExpr, clang::MemberExpr>(Target) &&
+          Object == sourceText(skipImplicit(Operands.front()), Ctx)))) {
+      std::optional<utils::LoopExecution> Executed = loopExecution(Loop);
+      if (isRarelyRun(Executed))
+        return;
+      llvm::ArrayRef<const clang::Expr *> Pieces = Operands;
+      if (Self)
+        Pieces = Pieces.drop_front();
+      if (!llvm::isa<clang::DeclRefExpr, clang::MemberExpr>(Target))
+        Object = "(" + Object + ")";
+
+      // Every piece after the first is evaluated once the string has
+      // already grown, and std::format_to appends while it still holds
+      // all of them, so none may read the target.
+      auto ReadsTarget = [Target](const clang::Expr *Piece) {
+        return readsTarget(Piece, Target);
+      };
+      bool Aliased = llvm::any_of(Pieces.drop_front(), ReadsTarget);
+
+      std::optional<std::string> Replacement;
+      bool UseFormat = false;
+      if (!Aliased) {
+        if (Pieces.size() == 1) {
+          std::string Piece = sourceText(Pieces.front(), Ctx);
+          if (!Piece.empty())
+            Replacement = Object + " += " + Piece;
+        } else if (utils::hasAtLeast(Std, utils::CppStandard::Cpp20) &&
+                   isCharString(Target->getType()) &&
+                   isDiscarded(ParentCall, Ctx) &&
+                   !ReadsTarget(Pieces.front())) {
+          Replacement = formatText(Object, Pieces, Ctx);
+          UseFormat = Replacement.has_value();
+        }
+        if (!Replacement)
+          Replacement = appendText(Object, Pieces, Ctx);
+      }
+
+      clang::SourceLocation Loc = ParentCall->getOperatorLoc();
+      llvm::StringRef Message =
+          Self ? "'%0 = %0 + ...' copies '%0' into a new string on every "
+                 "iteration, which is quadratic in its final length; append "
+                 "to '%0' in place"
+               : "'%0 += ...' builds its right-hand side in a temporary "
+                 "string on every iteration and then copies it into '%0'; "
+                 "append the pieces to '%0' directly";
+      {
+        auto D = diag(Loc, Message);
+        D << sourceText(Target, Ctx);
+        if (Replacement)
+          D << clang::FixItHint::CreateReplacement(
+              ParentCall->getSourceRange(), *Replacement);
+      }
+      if (UseFormat)
+        diag(Loc,
+             "std::format_to is declared in <format> and "
+             "std::back_inserter in <iterator>",
+             clang::DiagnosticIDs::Note);
+      if (Aliased)
+        diag(Loc,
+             "not rewritten automatically: a later piece reads '%0', which "
+             "appending in place would already have changed",
+             clang::DiagnosticIDs::Note)
+            << sourceText(Target, Ctx);
+      if (Executed)
+        noteLoopExecution(Loc, *Executed);
+      return;
+    }
+  }
+
+  // A long chain anywhere.
+  if (Operands.size() < MinChainOperands)
+    return;
+  bool UseFormat = utils::hasAtLeast(Std, utils::CppStandard::Cpp20) &&
+                   isCharString(Top->getType());
+  std::optional<clang::FixItHint> Fix;
+  if (const auto *Var = Parent.get<clang::VarDecl>();
+      Var && Var->getInit() && skipImplicit(Var->getInit()) == Top)
+    Fix = declarationFix(Var, Operands, UseFormat, Ctx);
+  clang::SourceLocation Loc = Top->getBeginLoc();
+  {
+    auto D = diag(Loc, "operator+ chain of %0 std::string operands grows a "
+                       "temporary piece by piece, reallocating as it goes; "
+                       "reserve the final length and append the pieces");
+    D << static_cast<unsigned>(Operands.size());
+    if (Fix)
+      D << *Fix;
+  }
+  if (Fix && UseFormat)
+    diag(Loc,
+         "std::format_to is declared in <format> and std::back_inserter in "
+         "<iterator>",
+         clang::DiagnosticIDs::Note);
+}
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
@@ -0,0 +1,68 @@
+//===--- StringConcatInLoopCheck.h - hl-perf-string-concat-in-loop -------===//
+// Author: Aleksandr Loshkarev
+//
+// Flags std::string concatenation that allocates more than the result
+// needs:
+//
+//   - `s = s + piece` in a loop body, which copies all of `s` into a new
+//     buffer on every iteration and is quadratic in the final length;
+//   - `s += a + b + ...` in a loop body, which builds the right-hand side
+//     in a temporary string before copying it into `s`;
+//   - std::accumulate with a std::string initial value before C++20, which
+//     computes `init = init + *it` and so copies the result per element;
+//   - operator+ chains of `MinChainOperands` (default 4) or more operands,
+//     which grow one temporary piece by piece.
+//
+// The loop cases are rewritten to append in place: `s.append(a).append(b)`,
+// or `std::format_to(std::back_inserter(s), ...)` from C++20 when the
+// result is discarded and every character piece is a plain char (other
+// character types print as numbers through "{}").  They are not rewritten when a later piece reads
+// the string being appended to, as in `s = s + sep + s.substr(0, 3)`: in
+// place, it would see the string already grown.  No reserve() is added
+// inside a loop: reserving the exact size on every iteration defeats the
+// geometric growth of the buffer.
+// A long chain initialising a local is rewritten to a reserve() of the
+// final length followed by the appends (or the std::format_to call).
+//
+// References:
+//   - Scott Meyers, "Effective STL", Item 14: Use reserve to avoid
+//     unnecessary reallocations
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_CHECKS_STRING_CONCAT_IN_LOOP_CHECK_H
+#define HL_TIDY_CHECKS_STRING_CONCAT_IN_LOOP_CHECK_H
+
+#include "HlTidyCheck.h"
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+class StringConcatInLoopCheck : public HlTidyCheck {
+public:
+  StringConcatInLoopCheck(llvm::StringRef Name,
+                          clang::tidy::ClangTidyContext *Context);
+
+  bool isLanguageVersionSupported(const clang::LangOptions &LangOpts) const override {
+    return LangOpts.CPlusPlus11;
+  }
+
+  void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
+  void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// Every temporary is a new heap buffer the pieces are copied into.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::Reallocation;
+  }
+
+private:
+  unsigned MinChainOperands;
+};
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_CHECKS_STRING_CONCAT_IN_LOOP_CHECK_H
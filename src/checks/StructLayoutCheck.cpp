@@ -0,0 +1,534 @@
+//===--- StructLayoutCheck.cpp - hl-perf-struct-layout ---------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "StructLayoutCheck.h"
+#include "utils/TranslationUnitCache.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Attr.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/DeclFriend.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/RecordLayout.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/Lex/Lexer.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+using namespace clang::ast_matchers;
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+namespace {
+
+/// What in the TU depends on the declaration order of a record's fields.
+class LayoutDependents {
+public:
+  explicit LayoutDependents(clang::ASTContext &Ctx);
+
+  /// Why \p RD must keep its field order, or an empty string.
+  llvm::StringRef reason(const clang::RecordDecl *RD) const {
+    auto It = Reasons.find(RD->getCanonicalDecl());
+    return It == Reasons.end() ? llvm::StringRef() : It->second;
+  }
+
+private:
+  friend class DependentCollector;
+
+  void note(clang::QualType T, llvm::StringRef Why) {
+    if (const clang::RecordDecl *RD = T->getAsRecordDecl())
+      Reasons.try_emplace(RD->getCanonicalDecl(), Why);
+  }
+
+  llvm::DenseMap<const clang::RecordDecl *, llvm::StringRef> Reasons;
+};
+
+class DependentCollector
+    : public clang::RecursiveASTVisitor<DependentCollector> {
+public:
+  explicit DependentCollector(LayoutDependents &Dependents)
+      : Dependents(Dependents) {}
+
+  bool shouldVisitTemplateInstantiations() const { return true; }
+
+  bool VisitInitListExpr(clang::InitListExpr *E) {
+    if (E->getNumInits() != 0)
+      Dependents.note(E->getType(), "is aggregate-initialized");
+    return true;
+  }
+
+  bool VisitCXXParenListInitExpr(clang::CXXParenListInitExpr *E) {
+    Dependents.note(E->getType(), "is aggregate-initialized");
+    return true;
+  }
+
+  bool VisitOffsetOfExpr(clang::OffsetOfExpr *E) {
+    Dependents.note(E->getTypeSourceInfo()->getType(), "is used in offsetof");
+    return true;
+  }
+
+  bool VisitDecompositionDecl(clang::DecompositionDecl *D) {
+    Dependents.note(D->getType().getNonReferenceType(),
+                    "is decomposed by a structured binding");
+    return true;
+  }
+
+private:
+  LayoutDependents &Dependents;
+};
+
+LayoutDependents::LayoutDependents(clang::ASTContext &Ctx) {
+  DependentCollector Collector(*this);
+  Collector.TraverseAST(Ctx);
+}
+
+/// A field, or a run of adjacent bit-fields, which moves as one unit.
+struct Block {
+  llvm::SmallVector<const clang::FieldDecl *, 2> Fields;
+  /// Offset in the current layout, in bits.
+  uint64_t OffsetBits = 0;
+  uint64_t SizeBits = 0;
+  /// Alignment the record's packing gives the block, in bytes.
+  uint64_t Align = 1;
+  /// Alignment of the block's type, in bytes.
+  uint64_t NaturalAlign = 1;
+
+  uint64_t sizeInBytes() const { return llvm::divideCeil(SizeBits, 8); }
+};
+
+/// Padding before \p Next, or at the end of the record if it is null.
+struct Hole {
+  uint64_t Bytes;
+  const clang::FieldDecl *Prev;
+  const clang::FieldDecl *Next;
+};
+
+/// Alignment of \p FD inside \p RD, in bytes, with alignas, `packed` and
+/// `#pragma pack` applied.
+uint64_t fieldAlign(const clang::FieldDecl *FD, const clang::RecordDecl *RD,
+                    clang::ASTContext &Ctx) {
+  uint64_t Natural = Ctx.getTypeAlignInChars(FD->getType()).getQuantity();
+  uint64_t Explicit = FD->getMaxAlignment() / 8;
+  uint64_t Align = Natural;
+  if (RD->hasAttr<clang::PackedAttr>() || FD->hasAttr<clang::PackedAttr>())
+    Align = 1;
+  if (const auto *Pack = RD->getAttr<clang::MaxFieldAlignmentAttr>())
+    Align = std::min<uint64_t>(Align, std::max(Pack->getAlignment() / 8, 1u));
+  return std::max(Align, Explicit);
+}
+
+/// Size of a record whose fields start at \p Start bytes and are laid out
+/// in \p Order.  Bit-field runs start at their type's alignment, which is
+/// never denser than what the ABI does.
+uint64_t layOut(llvm::ArrayRef<const Block *> Order, uint64_t Start,
+                uint64_t RecordAlign,
+                llvm::SmallVectorImpl<uint64_t> *Offsets = nullptr) {
+  uint64_t Offset = Start;
+  for (const Block *B : Order) {
+    Offset = llvm::alignTo(Offset, B->Align);
+    if (Offsets)
+      Offsets->push_back(Offset);
+    Offset += B->sizeInBytes();
+  }
+  return llvm::alignTo(std::max<uint64_t>(Offset, 1), RecordAlign);
+}
+
+/// End of the bases and the vtable pointer, where the fields start, in
+/// bits.
+uint64_t fieldsStart(const clang::RecordDecl *RD,
+                     const clang::ASTRecordLayout &Layout,
+                     clang::ASTContext &Ctx) {
+  const auto *CXXRD = llvm::dyn_cast<clang::CXXRecordDecl>(RD);
+  if (!CXXRD)
+    return 0;
+  uint64_t End = 0;
+  if (Layout.hasOwnVFPtr())
+    End = Ctx.getTargetInfo().getPointerWidth(clang::LangAS::Default);
+  for (const clang::CXXBaseSpecifier &Base : CXXRD->bases()) {
+    const clang::CXXRecordDecl *BaseRD = Base.getType()->getAsCXXRecordDecl();
+    if (!BaseRD || BaseRD->isEmpty())
+      continue;
+    const clang::ASTRecordLayout &BaseLayout = Ctx.getASTRecordLayout(BaseRD);
+    // The tail padding of a non-POD base is reused for fields.
+    clang::CharUnits Used = BaseRD->isPOD() ? BaseLayout.getNonVirtualSize()
+                                            : BaseLayout.getDataSize();
+    End = std::max<uint64_t>(
+        End, Ctx.toBits(Layout.getBaseClassOffset(BaseRD) + Used));
+  }
+  return End;
+}
+
+std::string cacheLineEffect(uint64_t Before, uint64_t After, unsigned Line) {
+  if (Before <= Line)
+    return std::to_string(Line / After) + " per " + std::to_string(Line) +
+           "-byte cache line instead of " + std::to_string(Line / Before);
+  uint64_t LinesBefore = llvm::divideCeil(Before, Line);
+  uint64_t LinesAfter = llvm::divideCeil(After, Line);
+  if (LinesAfter < LinesBefore)
+    return "spanning " + std::to_string(LinesAfter) + " " +
+           std::to_string(Line) + "-byte cache lines instead of " +
+           std::to_string(LinesBefore);
+  return "still spanning " + std::to_string(LinesAfter) + " " +
+         std::to_string(Line) + "-byte cache lines";
+}
+
+/// Source range of the declaration of \p FD, attributes, its doc comment
+/// and a trailing `//` comment on the same line included, or an invalid
+/// range if it cannot be moved on its own.
+clang::CharSourceRange fieldText(const clang::FieldDecl *FD,
+                                 clang::ASTContext &Ctx) {
+  const clang::SourceManager &SM = Ctx.getSourceManager();
+  const clang::LangOptions &LO = Ctx.getLangOpts();
+  clang::SourceLocation Begin = FD->getBeginLoc();
+  for (const clang::Attr *A : FD->attrs())
+    if (!A->isImplicit() && A->getLocation().isValid() &&
+        SM.isBeforeInTranslationUnit(A->getRange().getBegin(), Begin))
+      Begin = A->getRange().getBegin();
+  if (const clang::RawComment *Doc = Ctx.getRawCommentForDeclNoCache(FD);
+      Doc && !Doc->isTrailingComment() &&
+      SM.isBeforeInTranslationUnit(Doc->getBeginLoc(), Begin))
+    Begin = Doc->getBeginLoc();
+  if (Begin.isMacroID() || FD->getEndLoc().isMacroID())
+    return {};
+  // Fails for `int a, b;`: the next token is a comma.
+  clang::SourceLocation End =
+      clang::Lexer::findLocationAfterToken(FD->getEndLoc(), clang::tok::semi,
+                                           SM, LO, false);
+  if (End.isInvalid())
+    return {};
+  bool Invalid = false;
+  const char *P = SM.getCharacterData(End, &Invalid);
+  if (Invalid)
+    return {};
+  const char *Q = P;
+  while (*Q == ' ' || *Q == '\t')
+    ++Q;
+  if (Q[0] == '/' && Q[1] == '/') {
+    while (*Q && *Q != '\n' && *Q != '\r')
+      ++Q;
+    End = End.getLocWithOffset(Q - P);
+  }
+  return clang::CharSourceRange::getCharRange(Begin, End);
+}
+
+} // namespace
+
+StructLayoutCheck::StructLayoutCheck(llvm::StringRef Name,
+                                     clang::tidy::ClangTidyContext *Context)
+    : HlTidyCheck(Name, Context),
+      MinRecordBytes(Options.get("MinRecordBytes", 16u)),
+      CacheLineBytes(Options.get("CacheLineBytes", 64u)) {}
+
+void StructLayoutCheck::registerMatchers(MatchFinder *Finder) {
+  // Template patterns have no layout, and a specialization's layout depends
+  // on its arguments, so only concrete records are checked.
+  Finder->addMatcher(
+      recordDecl(isDefinition(), unless(isUnion()), unless(isImplicit()),
+                 unless(cxxRecordDecl(isLambda())),
+                 unless(classTemplateSpecializationDecl()))
+          .bind("record"),
+      this);
+}
+
+void StructLayoutCheck::check(const MatchFinder::MatchResult &Result) {
+  const auto *RD = Result.Nodes.getNodeAs<clang::RecordDecl>("record");
+  if (!RD || RD->isInvalidDecl() || RD->isDependentType() ||
+      RD->isAnonymousStructOrUnion() || RD->field_empty())
+    return;
+  if (const auto *CXXRD = llvm::dyn_cast<clang::CXXRecordDecl>(RD))
+    if (CXXRD->getNumVBases() != 0)
+      return;
+
+  clang::ASTContext &Ctx = *Result.Context;
+  const clang::ASTRecordLayout &Layout = Ctx.getASTRecordLayout(RD);
+  uint64_t Size = Layout.getSize().getQuantity();
+  uint64_t RecordAlign = Layout.getAlignment().getQuantity();
+  bool Packed = RD->hasAttr<clang::PackedAttr>() ||
+                RD->hasAttr<clang::MaxFieldAlignmentAttr>() ||
+                llvm::any_of(RD->fields(), [](const clang::FieldDecl *FD) {
+                  return FD->hasAttr<clang::PackedAttr>();
+                });
+
+  // Group the fields into blocks; zero-size and flexible array members
+  // cannot be modelled.
+  llvm::SmallVector<Block, 8> Blocks;
+  bool Modelled = true;
+  for (const clang::FieldDecl *FD : RD->fields()) {
+    if (FD->isZeroSize(Ctx) || FD->getType()->isIncompleteArrayType() ||
+        FD->getType()->isDependentType()) {
+      Modelled = false;
+      break;
+    }
+    uint64_t Offset = Layout.getFieldOffset(FD->getFieldIndex());
+    uint64_t Bits = FD->isBitField()
+                        ? FD->getBitWidthValue()
+                        : Ctx.toBits(Ctx.getTypeSizeInChars(FD->getType()));
+    uint64_t Natural = Ctx.getTypeAlignInChars(FD->getType()).getQuantity();
+    if (FD->isBitField() && !Blocks.empty() &&
+        Blocks.back().Fields.back()->isBitField()) {
+      Block &Run = Blocks.back();
+      Run.Fields.push_back(FD);
+      Run.SizeBits = std::max(Run.SizeBits, Offset + Bits - Run.OffsetBits);
+      Run.Align = std::max(Run.Align, fieldAlign(FD, RD, Ctx));
+      Run.NaturalAlign = std::max(Run.NaturalAlign, Natural);
+      continue;
+    }
+    Block B;
+    B.Fields.push_back(FD);
+    B.OffsetBits = Offset;
+    B.SizeBits = Bits;
+    B.Align = fieldAlign(FD, RD, Ctx);
+    B.NaturalAlign = Natural;
+    Blocks.push_back(std::move(B));
+  }
+  if (!Modelled || Blocks.empty())
+    return;
+
+  uint64_t StartBits = fieldsStart(RD, Layout, Ctx);
+  uint64_t Start = llvm::divideCeil(StartBits, 8);
+  llvm::SmallVector<const Block *, 8> Declared;
+  for (const Block &B : Blocks)
+    Declared.push_back(&B);
+  // The model must not underestimate the current layout, or the size it
+  // predicts for another order means nothing.
+  if (layOut(Declared, Start, RecordAlign) < Size)
+    return;
+
+  // Packed records are ordered by natural alignment, so that the fields
+  // end up aligned without padding; others by their alignment in the
+  // record.
+  llvm::SmallVector<const Block *, 8> Proposed(Declared);
+  llvm::stable_sort(Proposed, [Packed](const Block *A, const Block *B) {
+    return Packed ? A->NaturalAlign > B->NaturalAlign : A->Align > B->Align;
+  });
+  llvm::SmallVector<uint64_t, 8> ProposedOffsets;
+  uint64_t ProposedSize = layOut(Proposed, Start, RecordAlign,
+                                 &ProposedOffsets);
+  bool Reordered = !llvm::equal(Proposed, Declared);
+
+  const clang::FieldDecl *Misaligned = nullptr;
+  unsigned MisalignedCount = 0;
+  bool Reorder = false;
+  if (Packed) {
+    for (const Block &B : Blocks) {
+      const clang::FieldDecl *FD = B.Fields.front();
+      if (FD->isBitField() || B.OffsetBits % (B.NaturalAlign * 8) == 0)
+        continue;
+      if (!Misaligned)
+        Misaligned = FD;
+      ++MisalignedCount;
+    }
+    if (!Misaligned)
+      return;
+    Reorder = Reordered && ProposedSize <= Size;
+    for (unsigned I = 0; Reorder && I != Proposed.size(); ++I)
+      if (ProposedOffsets[I] % Proposed[I]->NaturalAlign != 0)
+        Reorder = false;
+  } else {
+    if (Size < MinRecordBytes || ProposedSize >= Size)
+      return;
+    Reorder = true;
+  }
+
+  // Padding in the current layout, from the actual field offsets.
+  llvm::SmallVector<Hole, 8> Holes;
+  uint64_t PaddingBits = 0;
+  uint64_t Cursor = StartBits;
+  const clang::FieldDecl *Prev = nullptr;
+  for (const Block &B : Blocks) {
+    if (B.OffsetBits > Cursor) {
+      PaddingBits += B.OffsetBits - Cursor;
+      if ((B.OffsetBits - Cursor) / 8 != 0)
+        Holes.push_back({(B.OffsetBits - Cursor) / 8, Prev, B.Fields.front()});
+    }
+    Cursor = std::max(Cursor, B.OffsetBits + B.SizeBits);
+    Prev = B.Fields.back();
+  }
+  if (Ctx.toBits(Layout.getSize()) > Cursor) {
+    uint64_t Tail = Ctx.toBits(Layout.getSize()) - Cursor;
+    PaddingBits += Tail;
+    if (Tail / 8 != 0)
+      Holes.push_back({Tail / 8, Prev, nullptr});
+  }
+
+  // Fix-its need every field declaration on its own, in one file, with
+  // nothing but whitespace between them, and nothing depending on the
+  // order.
+  const clang::SourceManager &SM = Ctx.getSourceManager();
+  const clang::LangOptions &LO = Ctx.getLangOpts();
+  std::string Blocker;
+  llvm::SmallVector<const clang::FieldDecl *, 8> Fields(RD->fields());
+  llvm::SmallVector<const clang::FieldDecl *, 8> NewOrder;
+  for (const Block *B : Proposed)
+    NewOrder.append(B->Fields.begin(), B->Fields.end());
+  llvm::SmallVector<clang::CharSourceRange, 8> Texts;
+  if (Reorder) {
+    if (llvm::StringRef Why = utils::getPerTU<LayoutDependents>(Ctx).reason(RD);
+        !Why.empty())
+      Blocker = Why.str() + " in this translation unit";
+    if (const auto *CXXRD = llvm::dyn_cast<clang::CXXRecordDecl>(RD))
+      for (const clang::CXXConstructorDecl *Ctor : CXXRD->ctors())
+        for (const clang::CXXCtorInitializer *Init : Ctor->inits())
+          if (Blocker.empty() && Init->isWritten() &&
+              Init->isAnyMemberInitializer())
+            Blocker = "initializes its fields in constructor member-"
+                      "initializer lists, which follow declaration order";
+    // Default member initializers also run in declaration order, so one
+    // that reads another field could read it before it is initialized.
+    auto SiblingField = memberExpr(
+        hasObjectExpression(cxxThisExpr()),
+        member(fieldDecl(hasDeclContext(recordDecl(equalsNode(RD))))));
+    for (const clang::FieldDecl *FD : RD->fields()) {
+      const clang::Expr *Init = FD->getInClassInitializer();
+      if (Blocker.empty() && Init &&
+          !match(findAll(SiblingField), *Init, Ctx).empty())
+        Blocker = "initializes a field from another field in a default "
+                  "member initializer, which runs in declaration order";
+    }
+    // Defaulted comparisons compare the fields in declaration order.
+    if (const auto *CXXRD = llvm::dyn_cast<clang::CXXRecordDecl>(RD)) {
+      llvm::SmallVector<const clang::FunctionDecl *, 4> Functions(
+          CXXRD->methods());
+      for (const clang::FriendDecl *Friend : CXXRD->friends())
+        if (const auto *FD = llvm::dyn_cast_or_null<clang::FunctionDecl>(
+                Friend->getFriendDecl()))
+          Functions.push_back(FD);
+      for (const clang::FunctionDecl *FD : Functions)
+        if (Blocker.empty() && FD->isDefaulted() &&
+            llvm::is_contained({clang::OO_Spaceship, clang::OO_EqualEqual,
+                                clang::OO_ExclaimEqual, clang::OO_Less,
+                                clang::OO_LessEqual, clang::OO_Greater,
+                                clang::OO_GreaterEqual},
+                               FD->getOverloadedOperator()))
+          Blocker = "has a defaulted comparison, which compares its fields "
+                    "in declaration order";
+    }
+    // Fields are constructed in declaration order and destroyed in
+    // reverse, which matters when more than one of them does something
+    // there.
+    auto NonTrivial = [&Ctx](const clang::FieldDecl *FD) {
+      const clang::CXXRecordDecl *FieldRD =
+          Ctx.getBaseElementType(FD->getType())->getAsCXXRecordDecl();
+      return FieldRD && FieldRD->hasDefinition() &&
+             (!FieldRD->hasTrivialDestructor() ||
+              !FieldRD->hasTrivialDefaultConstructor());
+    };
+    llvm::SmallVector<const clang::FieldDecl *, 8> BuiltBefore, BuiltAfter;
+    llvm::copy_if(Fields, std::back_inserter(BuiltBefore), NonTrivial);
+    llvm::copy_if(NewOrder, std::back_inserter(BuiltAfter), NonTrivial);
+    if (Blocker.empty() && BuiltBefore != BuiltAfter)
+      Blocker = "has fields with non-trivial constructors or destructors, "
+                "which run in declaration order";
+    // The layout of a packed record is usually a wire or file format that
+    // something outside this translation unit depends on.
+    if (Blocker.empty() && Packed)
+      Blocker = "is packed, so its layout is likely an external format";
+    for (const clang::FieldDecl *FD : Fields) {
+      clang::CharSourceRange Text = fieldText(FD, Ctx);
+      if (Text.isInvalid() || (!Texts.empty() &&
+                               !SM.isWrittenInSameFile(Texts.front().getBegin(),
+                                                       Text.getBegin()))) {
+        if (Blocker.empty())
+          Blocker = "declares a field in a macro or several fields in one "
+                    "declaration";
+        break;
+      }
+      if (!Texts.empty()) {
+        llvm::StringRef Between = clang::Lexer::getSourceText(
+            clang::CharSourceRange::getCharRange(Texts.back().getEnd(),
+                                                 Text.getBegin()),
+            SM, LO);
+        if (!Between.trim().empty() && Blocker.empty())
+          Blocker = "has comments or other declarations between its fields";
+      }
+      Texts.push_back(Text);
+    }
+  }
+
+  std::string Name = RD->getNameAsString();
+  if (Name.empty())
+    if (const clang::TypedefNameDecl *Typedef =
+            RD->getTypedefNameForAnonDecl())
+      Name = Typedef->getNameAsString();
+  {
+    // Scoped so the warning is emitted before the notes below.
+    auto D = diag(Packed ? Misaligned->getLocation() : RD->getLocation(),
+                  Packed ? "packed record '%0' places '%1' at offset %2, which "
+                           "is not a multiple of its %3-byte alignment: every "
+                           "access is an unaligned load or store and cannot "
+                           "be atomic%4"
+                         : "'%0' is %1 bytes, %2 of them padding; ordering "
+                           "its fields by decreasing alignment makes it %3 "
+                           "bytes, %4");
+    if (Packed)
+      D << Name << Misaligned->getName()
+        << static_cast<unsigned>(
+               Layout.getFieldOffset(Misaligned->getFieldIndex()) / 8)
+        << static_cast<unsigned>(
+               Ctx.getTypeAlignInChars(Misaligned->getType()).getQuantity())
+        << (MisalignedCount > 1 ? " (" + std::to_string(MisalignedCount) +
+                                      " misaligned fields)"
+                                : std::string());
+    else
+      D << Name << static_cast<unsigned>(Size)
+        << static_cast<unsigned>(PaddingBits / 8)
+        << static_cast<unsigned>(ProposedSize)
+        << cacheLineEffect(Size, ProposedSize, CacheLineBytes);
+    if (Reorder && Blocker.empty() && Texts.size() == Fields.size()) {
+      for (unsigned I = 0; I != Fields.size(); ++I) {
+        if (NewOrder[I] == Fields[I])
+          continue;
+        unsigned From = llvm::find(Fields, NewOrder[I]) - Fields.begin();
+        D << clang::FixItHint::CreateReplacement(
+            Texts[I], clang::Lexer::getSourceText(Texts[From], SM, LO));
+      }
+    }
+  }
+
+  if (!Packed) {
+    llvm::stable_sort(Holes, [](const Hole &A, const Hole &B) {
+      return A.Bytes > B.Bytes;
+    });
+    for (const Hole &H : llvm::ArrayRef(Holes).take_front(3)) {
+      if (H.Next)
+        diag(H.Next->getLocation(), "%0-byte hole before '%1'",
+             clang::DiagnosticIDs::Note)
+            << static_cast<unsigned>(H.Bytes) << H.Next->getName();
+      else
+        diag(H.Prev->getLocation(), "%0 bytes of tail padding after '%1'",
+             clang::DiagnosticIDs::Note)
+            << static_cast<unsigned>(H.Bytes) << H.Prev->getName();
+    }
+  }
+
+  if (!Reorder)
+    return;
+  std::string Order;
+  for (const clang::FieldDecl *FD : NewOrder) {
+    if (!FD->getIdentifier())
+      continue;
+    if (!Order.empty())
+      Order += ", ";
+    Order += FD->getName();
+  }
+  diag(RD->getLocation(), "suggested field order: %0",
+       clang::DiagnosticIDs::Note)
+      << Order;
+  if (!Blocker.empty())
+    diag(RD->getLocation(), "not reordered automatically: '%0' %1",
+         clang::DiagnosticIDs::Note)
+        << Name << Blocker;
+}
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
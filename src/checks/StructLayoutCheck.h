@@ -0,0 +1,70 @@
+//===--- StructLayoutCheck.h - hl-perf-struct-layout -----------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// Flags records of at least `MinRecordBytes` (default 16) whose fields are
+// declared in an order that wastes space on padding, read from clang's
+// ASTRecordLayout.  The warning gives the total padding, the size the
+// record would have with its fields ordered by decreasing alignment, and
+// what that means per `CacheLineBytes` (default 64) cache line; notes
+// point at the largest holes and list the suggested order.  Adjacent
+// bit-fields move together, and `#pragma pack` / `packed` alignment is
+// taken into account.
+//
+// Packed records of any size are flagged separately when they put a field
+// at an offset that is not a multiple of its natural alignment: every
+// access to it is an unaligned load or store, and it cannot be accessed
+// atomically.  A field order that aligns every field is suggested when one
+// exists.
+//
+// The reorder fix-it is only offered when nothing in the translation unit
+// depends on the declaration order: no aggregate initialization, offsetof
+// or structured binding of the record, no constructor member-initializer
+// lists, no default member initializer reading another field, no
+// defaulted comparison, no change in the order of fields with non-trivial
+// constructors or destructors, and nothing but whitespace between the field
+// declarations.  A doc comment above a field moves with it.  Packed records
+// only get the suggested order, as their layout is usually an external
+// format.
+//
+// References:
+//   - The Lost Art of Structure Packing (E. S. Raymond)
+//   - pahole(1)
+//   - clang-tidy altera-struct-pack-align
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_CHECKS_STRUCT_LAYOUT_CHECK_H
+#define HL_TIDY_CHECKS_STRUCT_LAYOUT_CHECK_H
+
+#include "HlTidyCheck.h"
+
+namespace hl {
+namespace tidy {
+namespace checks {
+
+class StructLayoutCheck : public HlTidyCheck {
+public:
+  StructLayoutCheck(llvm::StringRef Name,
+                    clang::tidy::ClangTidyContext *Context);
+
+  void registerMatchers(clang::ast_matchers::MatchFinder *Finder) override;
+  void check(const clang::ast_matchers::MatchFinder::MatchResult &Result) override;
+
+protected:
+  /// Padding costs cache lines on every array or hash-map traversal.
+  utils::Cost occurrenceCost() const override {
+    return utils::Cost::CacheMiss;
+  }
+
+private:
+  /// Records smaller than this are not checked for padding.
+  unsigned MinRecordBytes;
+  /// Cache line size the record size is compared against.
+  unsigned CacheLineBytes;
+};
+
+} // namespace checks
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_CHECKS_STRUCT_LAYOUT_CHECK_H
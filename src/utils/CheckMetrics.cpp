@@ -0,0 +1,115 @@
+//===--- CheckMetrics.cpp - Per-check instrumentation counters --*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "CheckMetrics.h"
+#include "ModuleOptions.h"
+#include "TUSession.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+std::shared_ptr<MetricsSink>
+MetricsSink::acquire(clang::tidy::ClangTidyContext &Context) {
+  return acquireTUSession<MetricsSink>(
+      Context, [&]() -> std::shared_ptr<MetricsSink> {
+        std::string Dir = getModuleOption(Context, "MetricsDir", "");
+        if (Dir.empty())
+          return nullptr;
+        return std::make_shared<MetricsSink>(std::move(Dir),
+                                             Context.getCurrentFile().str());
+      });
+}
+
+void MetricsSink::add(llvm::StringRef CheckName, const CheckMetrics &Metrics) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  CheckMetrics &Total = Checks[CheckName];
+  Total.Callbacks += Metrics.Callbacks;
+  Total.EarlyReturns += Metrics.EarlyReturns;
+  Total.Deduplicated += Metrics.Deduplicated;
+  Total.Warnings += Metrics.Warnings;
+  Total.Notes += Metrics.Notes;
+  Total.CallbackTime += Metrics.CallbackTime;
+  for (const auto &Entry : Metrics.BoundIds)
+    Total.BoundIds[Entry.getKey()] += Entry.getValue();
+}
+
+MetricsSink::~MetricsSink() { write(); }
+
+/// Sorted keys, so that the output is stable across runs.
+template <typename T>
+static std::vector<llvm::StringRef> sortedKeys(const llvm::StringMap<T> &Map) {
+  std::vector<llvm::StringRef> Keys;
+  Keys.reserve(Map.size());
+  for (const auto &Entry : Map)
+    Keys.push_back(Entry.getKey());
+  std::sort(Keys.begin(), Keys.end());
+  return Keys;
+}
+
+void MetricsSink::write() const {
+  if (Checks.empty() || MainFile.empty())
+    return;
+
+  // <dir>/<basename>.<hash of full path>.json keeps same-named files from
+  // different directories apart.
+  llvm::SmallString<256> Path(Dir);
+  llvm::sys::fs::create_directories(Path);
+  std::string Name;
+  llvm::raw_string_ostream(Name)
+      << llvm::sys::path::filename(MainFile) << '.'
+      << llvm::format_hex_no_prefix(llvm::xxHash64(MainFile), 16) << ".json";
+  llvm::sys::path::append(Path, Name);
+
+  // Write to a temporary and rename, so that a concurrent merge never reads
+  // a half-written file.
+  llvm::SmallString<256> TmpPath(Path);
+  TmpPath += ".tmp";
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(TmpPath, EC, llvm::sys::fs::OF_Text);
+  if (EC)
+    return;
+
+  llvm::json::OStream J(OS, 2);
+  J.object([&] {
+    J.attribute("file", MainFile);
+    J.attributeObject("checks", [&] {
+      for (llvm::StringRef CheckName : sortedKeys(Checks)) {
+        const CheckMetrics &M = Checks.find(CheckName)->getValue();
+        J.attributeObject(CheckName, [&] {
+          J.attribute("callbacks", static_cast<int64_t>(M.Callbacks));
+          J.attribute("early_returns", static_cast<int64_t>(M.EarlyReturns));
+          J.attribute("deduplicated", static_cast<int64_t>(M.Deduplicated));
+          J.attribute("warnings", static_cast<int64_t>(M.Warnings));
+          J.attribute("notes", static_cast<int64_t>(M.Notes));
+          J.attribute("callback_ns",
+                      static_cast<int64_t>(M.CallbackTime.count()));
+          J.attributeObject("bound_ids", [&] {
+            for (llvm::StringRef Id : sortedKeys(M.BoundIds))
+              J.attribute(Id,
+                          static_cast<int64_t>(M.BoundIds.lookup(Id)));
+          });
+        });
+      }
+    });
+  });
+  OS << '\n';
+  OS.close();
+  if (!OS.has_error())
+    llvm::sys::fs::rename(TmpPath, Path);
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
@@ -0,0 +1,91 @@
+//===--- CheckMetrics.h - Per-check instrumentation counters ----*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// Opt-in instrumentation for the hl-* checks.  clang-tidy's own check
+// profile reports one aggregate time per check; these counters break it down
+// so we can see *why* a check is expensive:
+//
+//   - how often each bound node ID fires,
+//   - how long the check() callbacks take,
+//   - how many callbacks return without diagnosing anything,
+//   - how many matches hl-module.Deduplicate dropped,
+//   - how many warnings and notes are emitted (before NOLINT filtering).
+//
+// Enabled by setting `hl-module.MetricsDir`.  One JSON file is written per
+// translation unit into that directory once all checks for the TU are done;
+// tools/hl_tidy_metrics_merge.py aggregates them across a compile database.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_CHECK_METRICS_H
+#define HL_TIDY_UTILS_CHECK_METRICS_H
+
+#include "clang-tidy/ClangTidyDiagnosticConsumer.h"
+#include "clang/Basic/DiagnosticIDs.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+/// Counters collected for one check over one translation unit.
+struct CheckMetrics {
+  uint64_t Callbacks = 0;
+  /// Callbacks that returned without emitting any diagnostic.
+  uint64_t EarlyReturns = 0;
+  /// Matches dropped by hl-module.Deduplicate before reaching check().
+  uint64_t Deduplicated = 0;
+  uint64_t Warnings = 0;
+  uint64_t Notes = 0;
+  std::chrono::nanoseconds CallbackTime{0};
+  /// Number of callbacks in which each node ID was bound.
+  llvm::StringMap<uint64_t> BoundIds;
+
+  void countDiagnostic(clang::DiagnosticIDs::Level Level) {
+    if (Level == clang::DiagnosticIDs::Note)
+      ++Notes;
+    else
+      ++Warnings;
+  }
+};
+
+/// Collects CheckMetrics from every check of one translation unit and writes
+/// them as JSON when the last check releases it.
+class MetricsSink {
+public:
+  MetricsSink(std::string Dir, std::string MainFile)
+      : Dir(std::move(Dir)), MainFile(std::move(MainFile)) {}
+  ~MetricsSink();
+
+  /// Return the sink for the TU \p Context is currently processing, or null
+  /// when `hl-module.MetricsDir` is not set.  All checks created for the
+  /// same TU share one sink.
+  static std::shared_ptr<MetricsSink>
+  acquire(clang::tidy::ClangTidyContext &Context);
+
+  /// Merge \p Metrics for \p CheckName into the TU totals.
+  void add(llvm::StringRef CheckName, const CheckMetrics &Metrics);
+
+private:
+  void write() const;
+
+  std::string Dir;
+  std::string MainFile;
+  std::mutex Mutex;
+  llvm::StringMap<CheckMetrics> Checks;
+};
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_CHECK_METRICS_H
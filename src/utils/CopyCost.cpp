@@ -0,0 +1,155 @@
+//===--- CopyCost.cpp - What copying a value of a type costs ----*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "CopyCost.h"
+#include "StdSymbols.h"
+#include "TranslationUnitCache.h"
+
+#include "clang/AST/RecordLayout.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+namespace {
+
+/// Cost of copying a standard type that is not classified by its members.
+CopyCost::CopyKind stdCopyKind(StdSymbol Symbol) {
+  switch (Symbol) {
+  case StdSymbol::Any:
+  case StdSymbol::BasicRegex:
+  case StdSymbol::BasicString:
+  case StdSymbol::Deque:
+  case StdSymbol::ForwardList:
+  case StdSymbol::Function:
+  case StdSymbol::List:
+  case StdSymbol::Map:
+  case StdSymbol::Multimap:
+  case StdSymbol::Multiset:
+  case StdSymbol::Set:
+  case StdSymbol::UnorderedMap:
+  case StdSymbol::UnorderedSet:
+  case StdSymbol::Vector:
+    return CopyCost::Allocation;
+  case StdSymbol::SharedPtr:
+    return CopyCost::RefCount;
+  default:
+    return CopyCost::Unknown;
+  }
+}
+
+bool hasUserProvidedCopy(const clang::CXXRecordDecl *RD) {
+  for (const clang::CXXConstructorDecl *Ctor : RD->ctors())
+    if (Ctor->isCopyConstructor() && Ctor->isUserProvided())
+      return true;
+  return false;
+}
+
+} // namespace
+
+std::string CopyCost::describe() const {
+  std::string Text;
+  llvm::raw_string_ostream OS(Text);
+  switch (Kind) {
+  case Unknown:
+    OS << "copies the value";
+    break;
+  case Bytes:
+    OS << "copies " << this->Bytes << " bytes";
+    break;
+  case Constructor:
+    OS << "runs a user-provided copy constructor";
+    if (!Member.empty())
+      OS << " for member '" << Member << "'";
+    break;
+  case RefCount:
+  case Allocation:
+    OS << (Kind == RefCount ? "increments an atomic reference count"
+                            : "allocates heap memory");
+    if (!Member.empty())
+      OS << " for member '" << Member << "' (" << Owner << ")";
+    break;
+  }
+  return Text;
+}
+
+CopyCosts &CopyCosts::get(clang::ASTContext &Ctx) {
+  return getPerTU<CopyCosts>(Ctx);
+}
+
+CopyCost CopyCosts::of(clang::QualType T) {
+  CopyCost Cost;
+  if (T.isNull())
+    return Cost;
+  T = T.getCanonicalType().getUnqualifiedType();
+  if (T->isDependentType() || T->isIncompleteType())
+    return Cost;
+  if (T->isReferenceType()) {
+    // A reference member copies as a pointer.
+    Cost.Kind = CopyCost::Bytes;
+    Cost.Bytes = Ctx.getTypeSizeInChars(Ctx.VoidPtrTy).getQuantity();
+    return Cost;
+  }
+  if (const clang::ConstantArrayType *Array = Ctx.getAsConstantArrayType(T)) {
+    Cost = of(Array->getElementType());
+    Cost.Bytes = Ctx.getTypeSizeInChars(T).getQuantity();
+    return Cost;
+  }
+  if (const clang::CXXRecordDecl *RD = T->getAsCXXRecordDecl())
+    return ofRecord(RD);
+  Cost.Kind = CopyCost::Bytes;
+  Cost.Bytes = Ctx.getTypeSizeInChars(T).getQuantity();
+  return Cost;
+}
+
+CopyCost CopyCosts::ofRecord(const clang::CXXRecordDecl *RD) {
+  RD = RD->getDefinition();
+  if (!RD || RD->isInvalidDecl() || RD->isDependentType())
+    return CopyCost();
+  auto It = Records.find(RD);
+  if (It != Records.end())
+    return It->second;
+
+  CopyCost Cost;
+  Cost.Bytes = Ctx.getASTRecordLayout(RD).getSize().getQuantity();
+  if (std::optional<StdSymbol> Symbol = StdSymbols::get(Ctx).classify(RD);
+      Symbol && stdCopyKind(*Symbol) != CopyCost::Unknown) {
+    Cost.Kind = stdCopyKind(*Symbol);
+    Cost.Owner =
+        Symbol == StdSymbol::BasicString ? "std::string"
+                                         : ("std::" + RD->getName()).str();
+  } else {
+    Cost.Kind = CopyCost::Bytes;
+    // The most expensive base or member decides, and is reported.
+    for (const clang::CXXBaseSpecifier &Base : RD->bases()) {
+      CopyCost Inner = of(Base.getType());
+      if (Inner.Kind > Cost.Kind) {
+        Cost.Kind = Inner.Kind;
+        Cost.Member = std::move(Inner.Member);
+        Cost.Owner = std::move(Inner.Owner);
+      }
+    }
+    for (const clang::FieldDecl *Field : RD->fields()) {
+      CopyCost Inner = of(Field->getType());
+      if (Inner.Kind > Cost.Kind) {
+        Cost.Kind = Inner.Kind;
+        Cost.Member = Field->getName().str();
+        if (!Inner.Member.empty())
+          Cost.Member += "." + Inner.Member;
+        Cost.Owner = std::move(Inner.Owner);
+      }
+    }
+    if (Cost.Kind < CopyCost::Constructor && hasUserProvidedCopy(RD)) {
+      Cost.Kind = CopyCost::Constructor;
+      Cost.Member.clear();
+      Cost.Owner.clear();
+    }
+  }
+  Records.try_emplace(RD, Cost);
+  return Cost;
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
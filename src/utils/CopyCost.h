@@ -0,0 +1,78 @@
+//===--- CopyCost.h - What copying a value of a type costs ------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// Checks about values passed or iterated by copy need one answer: how much
+// does one copy cost?  CopyCosts classifies a type once per TU, from the
+// cheapest to the most expensive kind of copy:
+//
+//   - Bytes: trivially copyable; a memcpy of the size from ASTRecordLayout;
+//   - Constructor: a user-provided copy constructor somewhere in the type;
+//   - RefCount: a std::shared_ptr somewhere in the type (atomic increment);
+//   - Allocation: a std::string, a standard container, std::function or
+//     std::any somewhere in the type (heap allocation, unless empty).
+//
+// Records are classified from their bases and fields, so a struct holding a
+// std::string allocates on copy too, and the field that makes it so is
+// reported.  Results are memoized per canonical record.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_COPY_COST_H
+#define HL_TIDY_UTILS_COPY_COST_H
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/Type.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <string>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+struct CopyCost {
+  /// Ordered from cheapest to most expensive.
+  enum CopyKind { Unknown, Bytes, Constructor, RefCount, Allocation };
+
+  CopyKind Kind = Unknown;
+  /// Size of the type; 0 if it is incomplete or dependent.
+  uint64_t Bytes = 0;
+  /// Path of the member responsible for Kind (e.g. "meta.tags"); empty if
+  /// it is the type itself.
+  std::string Member;
+  /// The standard type responsible for Kind (e.g. "std::vector"); empty for
+  /// Bytes and Constructor.
+  std::string Owner;
+
+  /// Describe what one copy does, e.g. "allocates heap memory for member
+  /// 'tags' (std::vector)".
+  std::string describe() const;
+};
+
+class CopyCosts {
+public:
+  explicit CopyCosts(clang::ASTContext &Ctx) : Ctx(Ctx) {}
+
+  /// Shared per-TU instance.
+  static CopyCosts &get(clang::ASTContext &Ctx);
+
+  /// Cost of copying a \p T.  Unknown for dependent and incomplete types.
+  CopyCost of(clang::QualType T);
+
+private:
+  CopyCost ofRecord(const clang::CXXRecordDecl *RD);
+
+  clang::ASTContext &Ctx;
+  llvm::DenseMap<const clang::CXXRecordDecl *, CopyCost> Records;
+};
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_COPY_COST_H
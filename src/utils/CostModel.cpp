@@ -0,0 +1,195 @@
+//===--- CostModel.cpp - Estimated runtime cost of findings -----*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "CostModel.h"
+#include "DiagnosticHelper.h"
+#include "ModuleOptions.h"
+#include "TUSession.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <mutex>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+namespace {
+
+struct CostEntry {
+  llvm::StringLiteral Name;
+  double Nanoseconds;
+};
+
+/// Indexed by Cost.  Uncontended figures; contention only widens the gaps.
+constexpr CostEntry Costs[] = {
+    {"none", 0},
+    {"indirect call", 5},
+    {"temporary copy", 10},
+    {"atomic read-modify-write", 20},
+    {"RTTI lookup", 30},
+    {"cache miss", 80},
+    {"heap allocation", 50},
+    {"copy on reallocation", 100},
+    {"reallocation", 200},
+    {"locale lock", 100},
+    {"stream lock", 200},
+    {"stream flush", 2000},
+    {"blocking call", 5000},
+    {"regex construction", 10000},
+};
+static_assert(std::size(Costs) == size_t(Cost::RegexConstruction) + 1,
+              "one entry per Cost");
+
+bool byScore(const RankedFinding &A, const RankedFinding &B) {
+  if (A.Score != B.Score)
+    return A.Score > B.Score;
+  return A.Location < B.Location;
+}
+
+/// Keep the \p Size highest-scored of \p Findings, best first.
+void keepTop(std::vector<RankedFinding> &Findings, size_t Size) {
+  if (Findings.size() > Size) {
+    std::partial_sort(Findings.begin(), Findings.begin() + Size,
+                      Findings.end(), byScore);
+    Findings.resize(Size);
+  } else {
+    llvm::sort(Findings, byScore);
+  }
+}
+
+void print(llvm::raw_ostream &OS, const llvm::Twine &Title, size_t Total,
+           const std::vector<RankedFinding> &Top) {
+  OS << "hl-tidy: most expensive findings " << Title << " (" << Top.size()
+     << " of " << Total << "):\n";
+  for (const RankedFinding &F : Top)
+    OS << llvm::format("  %12.0f  ", F.Score) << F.Location << ": "
+       << formatDescription(F.Description, F.Args) << " [" << F.Check
+       << "]\n";
+}
+
+/// The best findings of every TU analysed by this process, printed at exit
+/// if there was more than one TU.
+class ProjectRanking {
+public:
+  static ProjectRanking &get() {
+    static ProjectRanking Instance;
+    return Instance;
+  }
+
+  void add(const std::vector<RankedFinding> &Top, size_t TUTotal,
+           size_t Size) {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    ++Units;
+    Total += TUTotal;
+    this->Size = std::max(this->Size, Size);
+    Findings.insert(Findings.end(), Top.begin(), Top.end());
+    // A TU's top N contains every finding of it that can make the project's.
+    if (Findings.size() > 2 * this->Size)
+      keepTop(Findings, this->Size);
+  }
+
+  ~ProjectRanking() {
+    if (Units < 2 || Findings.empty())
+      return;
+    keepTop(Findings, Size);
+    // llvm::errs() may already be gone during static destruction.
+    llvm::raw_fd_ostream OS(2, /*shouldClose=*/false);
+    print(OS, "in " + llvm::Twine(Units) + " translation units", Total,
+          Findings);
+  }
+
+private:
+  std::mutex Mutex;
+  std::vector<RankedFinding> Findings;
+  size_t Units = 0;
+  size_t Total = 0;
+  size_t Size = 0;
+};
+
+} // namespace
+
+llvm::StringRef costName(Cost C) { return Costs[size_t(C)].Name; }
+
+double costNanoseconds(Cost C) { return Costs[size_t(C)].Nanoseconds; }
+
+CostModel::CostModel(const clang::tidy::ClangTidyContext &Context) {
+  unsigned ReportSize = 0;
+  llvm::StringRef(getModuleOption(Context, "CostReport", ""))
+      .trim()
+      .getAsInteger(10, ReportSize);
+  Enabled = ReportSize > 0 || getModuleFlag(Context, "CostModel", false);
+  std::string Iterations = getModuleOption(Context, "CostLoopIterations", "");
+  if (!Iterations.empty() &&
+      llvm::StringRef(Iterations).trim().getAsDouble(LoopIterations))
+    LoopIterations = 10;
+}
+
+double CostModel::score(Cost C, unsigned LoopDepth,
+                        std::optional<double> Hotness,
+                        std::optional<uint64_t> Executions) const {
+  double Score =
+      costNanoseconds(C) *
+      (Executions ? double(*Executions)
+                  : std::pow(LoopIterations, double(LoopDepth)));
+  if (Hotness)
+    Score *= *Hotness / 100.0;
+  return Score;
+}
+
+std::shared_ptr<CostReport>
+CostReport::acquire(clang::tidy::ClangTidyContext &Context) {
+  return acquireTUSession<CostReport>(
+      Context, [&]() -> std::shared_ptr<CostReport> {
+        unsigned Size = 0;
+        llvm::StringRef(getModuleOption(Context, "CostReport", ""))
+            .trim()
+            .getAsInteger(10, Size);
+        if (Size == 0)
+          return nullptr;
+        return std::make_shared<CostReport>(Context.getCurrentFile().str(),
+                                            Size);
+      });
+}
+
+std::unique_ptr<RankedFinding>
+CostReport::record(llvm::StringRef CheckName, clang::SourceLocation Loc,
+                   llvm::StringRef Description, double Score) {
+  auto Finding = std::make_unique<RankedFinding>();
+  Finding->Score = Score;
+  Finding->Check = CheckName.str();
+  Finding->Description = Description.str();
+  if (SM && Loc.isValid()) {
+    clang::PresumedLoc P = SM->getPresumedLoc(SM->getFileLoc(Loc));
+    if (P.isValid())
+      llvm::raw_string_ostream(Finding->Location)
+          << P.getFilename() << ':' << P.getLine() << ':' << P.getColumn();
+  }
+  if (Finding->Location.empty())
+    Finding->Location = MainFile;
+  return Finding;
+}
+
+void CostReport::commit(std::unique_ptr<RankedFinding> Finding) {
+  Findings.push_back(std::move(*Finding));
+}
+
+CostReport::~CostReport() {
+  if (Findings.empty())
+    return;
+  size_t Total = Findings.size();
+  keepTop(Findings, Size);
+  print(llvm::errs(), "in " + llvm::sys::path::filename(MainFile), Total,
+        Findings);
+  ProjectRanking::get().add(Findings, Total, Size);
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
@@ -0,0 +1,146 @@
+//===--- CostModel.h - Estimated runtime cost of hl-* findings --*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// Every hl-perf-* warning looks the same whether the code runs once at
+// startup or a billion times a day.  The cost model gives each finding a
+// score so that the biggest wins are fixed first:
+//
+//   score = base cost of one occurrence
+//         x LoopIterations ^ loop depth, or the line's execution count
+//           with hl-module.CoverageFile (see Coverage.h)
+//         x share of the profile samples (with hl-module.ProfileFile)
+//
+// The base cost is what the check flags, declared by the check through
+// HlTidyCheck::occurrenceCost(): an atomic read-modify-write for a
+// shared_ptr copy, a heap allocation for std::function, a locale lock for
+// std::stoi, an indirect branch for a virtual call.  The figures are rough
+// nanoseconds on an uncontended current server core; only their ratios
+// matter for the ranking.
+//
+// `hl-module.CostModel` appends the score to every warning of a check that
+// declares a cost, and the export writes it as `cost`.  `hl-module.CostReport`
+// also prints the N most expensive findings of each TU and, when a process
+// analyses several TUs (hl-tidy-run), of the whole run.  Runs with one
+// process per TU merge the exported `cost` fields with
+// tools/hl_tidy_cost_report.py instead.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_COST_MODEL_H
+#define HL_TIDY_UTILS_COST_MODEL_H
+
+#include "clang-tidy/ClangTidyDiagnosticConsumer.h"
+#include "clang/Basic/SourceLocation.h"
+#include "clang/Basic/SourceManager.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+/// What one occurrence of a finding costs at runtime.
+enum class Cost : uint8_t {
+  /// Not a runtime cost (style, API modernisation); not scored.
+  None,
+  IndirectCall,
+  TemporaryCopy,
+  AtomicRMW,
+  RttiLookup,
+  CacheMiss,
+  HeapAllocation,
+  CopyOnReallocation,
+  Reallocation,
+  LocaleLock,
+  StreamLock,
+  StreamFlush,
+  BlockingCall,
+  RegexConstruction,
+};
+
+/// Human-readable name of \p C, e.g. "heap allocation".
+llvm::StringRef costName(Cost C);
+
+/// Approximate nanoseconds of one occurrence of \p C.
+double costNanoseconds(Cost C);
+
+/// The hl-module options of the cost model, read by every check.
+class CostModel {
+public:
+  explicit CostModel(const clang::tidy::ClangTidyContext &Context);
+
+  /// True if `hl-module.CostModel` or `hl-module.CostReport` is set.
+  bool isEnabled() const { return Enabled; }
+
+  /// Score of one occurrence of \p C at \p LoopDepth in a function with
+  /// \p Hotness percent of the profile samples, if known.  A known
+  /// \p Executions count of the line replaces the assumed trip counts.
+  double score(Cost C, unsigned LoopDepth, std::optional<double> Hotness,
+               std::optional<uint64_t> Executions = std::nullopt) const;
+
+private:
+  bool Enabled = false;
+  /// hl-module.CostLoopIterations: assumed trip count of every loop.
+  double LoopIterations = 10;
+};
+
+/// A scored warning, waiting for its arguments.
+struct RankedFinding {
+  double Score = 0;
+  std::string Check;
+  /// file:line:column of the warning.
+  std::string Location;
+  std::string Description;
+  std::vector<std::string> Args;
+};
+
+/// The N most expensive findings of one TU, shared by all its hl-* checks
+/// (see TUSession.h) and printed when the last check releases it.
+class CostReport {
+public:
+  CostReport(std::string MainFile, unsigned Size)
+      : MainFile(std::move(MainFile)), Size(Size) {}
+  ~CostReport();
+
+  /// Return the report for the TU \p Context is currently processing, or
+  /// null when `hl-module.CostReport` is not set.
+  static std::shared_ptr<CostReport>
+  acquire(clang::tidy::ClangTidyContext &Context);
+
+  /// Use \p SM to resolve locations.  Only the first call has an effect.
+  void attach(const clang::SourceManager &SM) {
+    if (!this->SM)
+      this->SM = &SM;
+  }
+
+  /// Start a finding.  The caller streams its arguments and hands it back
+  /// to commit() when the diagnostic is emitted.
+  std::unique_ptr<RankedFinding> record(llvm::StringRef CheckName,
+                                        clang::SourceLocation Loc,
+                                        llvm::StringRef Description,
+                                        double Score);
+  void addArgument(RankedFinding &Finding, std::string Text) {
+    Finding.Args.push_back(std::move(Text));
+  }
+  void commit(std::unique_ptr<RankedFinding> Finding);
+
+private:
+  std::string MainFile;
+  unsigned Size;
+  const clang::SourceManager *SM = nullptr;
+  /// Every finding of the TU; sorted and cut to Size when printed.
+  std::vector<RankedFinding> Findings;
+};
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_COST_MODEL_H
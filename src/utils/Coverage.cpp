@@ -0,0 +1,373 @@
+//===--- Coverage.cpp - Line execution counts from coverage -----*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "Coverage.h"
+#include "ModuleOptions.h"
+#include "TranslationUnitCache.h"
+
+#include "clang/AST/Decl.h"
+#include "clang/AST/ParentMapContext.h"
+#include "clang/AST/StmtCXX.h"
+#include "clang/Basic/SourceManager.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+namespace {
+
+Coverage::CoverageFormat parseFormat(llvm::StringRef Name) {
+  Name = Name.trim();
+  if (Name.equals_insensitive("gcov"))
+    return Coverage::Gcov;
+  if (Name.equals_insensitive("llvm-cov") || Name.equals_insensitive("json"))
+    return Coverage::LLVMCov;
+  return Coverage::Auto;
+}
+
+std::string normalizePath(llvm::StringRef Path) {
+  llvm::SmallString<256> Out(Path);
+  llvm::sys::path::native(Out);
+  llvm::sys::path::remove_dots(Out, /*remove_dot_dot=*/true);
+  return std::string(Out);
+}
+
+/// True if \p Long ends with \p Short at a path component boundary.
+bool endsWithPath(llvm::StringRef Long, llvm::StringRef Short) {
+  if (!Long.ends_with(Short))
+    return false;
+  if (Long.size() == Short.size())
+    return true;
+  return llvm::sys::path::is_separator(Long[Long.size() - Short.size() - 1]);
+}
+
+/// A gcov count field: "-" for no code, "#####" or "=====" for never run,
+/// a number with an optional '*' for partly run lines, or with `-H`, a
+/// number with a k/M/G suffix.
+std::optional<uint64_t> parseGcovCount(llvm::StringRef Field) {
+  Field = Field.trim().rtrim('*');
+  if (Field.starts_with("#####") || Field.starts_with("====="))
+    return 0;
+  uint64_t Scale = 1;
+  if (Field.consume_back("k"))
+    Scale = 1000;
+  else if (Field.consume_back("M"))
+    Scale = 1000000;
+  else if (Field.consume_back("G"))
+    Scale = 1000000000;
+  if (Scale == 1) {
+    uint64_t Count = 0;
+    if (Field.getAsInteger(10, Count))
+      return std::nullopt;
+    return Count;
+  }
+  double Count = 0;
+  if (Field.getAsDouble(Count))
+    return std::nullopt;
+  return static_cast<uint64_t>(Count * Scale);
+}
+
+} // namespace
+
+Coverage::LineCounts &Coverage::file(llvm::StringRef Path) {
+  std::string Key = normalizePath(Path);
+  auto Inserted = Files.try_emplace(Key);
+  if (Inserted.second)
+    ByName[llvm::sys::path::filename(Key)].push_back(Key);
+  return Inserted.first->second;
+}
+
+bool Coverage::parseGcov(llvm::StringRef Text) {
+  LineCounts *Current = nullptr;
+  bool Found = false;
+  // A "----" separator opens a per-instantiation section when a "name:"
+  // label follows it, and closes the sections when a count line does.
+  bool AfterSeparator = false, InInstantiation = false;
+  while (!Text.empty()) {
+    auto [Line, Rest] = Text.split('\n');
+    Text = Rest;
+    Line = Line.rtrim("\r");
+    if (Line.trim().starts_with("------")) {
+      AfterSeparator = true;
+      continue;
+    }
+    llvm::SmallVector<llvm::StringRef, 3> Fields;
+    Line.split(Fields, ':', 2);
+    unsigned LineNo = 0;
+    bool IsCountLine =
+        Fields.size() == 3 && !Fields[1].trim().getAsInteger(10, LineNo);
+    if (AfterSeparator) {
+      InInstantiation = !IsCountLine;
+      AfterSeparator = false;
+    }
+    if (InInstantiation || !IsCountLine)
+      continue;
+    if (LineNo == 0) {
+      llvm::StringRef Tag = Fields[2];
+      if (Tag.consume_front("Source:"))
+        Current = &file(Tag.trim());
+      continue;
+    }
+    if (!Current)
+      continue;
+    std::optional<uint64_t> Count = parseGcovCount(Fields[0]);
+    if (!Count)
+      continue;
+    (*Current)[LineNo] += *Count;
+    Found = true;
+  }
+  return Found;
+}
+
+bool Coverage::parseLLVMCov(llvm::StringRef Text) {
+  llvm::Expected<llvm::json::Value> Root = llvm::json::parse(Text);
+  if (!Root) {
+    llvm::consumeError(Root.takeError());
+    return false;
+  }
+  const llvm::json::Object *Top = Root->getAsObject();
+  const llvm::json::Array *Data = Top ? Top->getArray("data") : nullptr;
+  if (!Data)
+    return false;
+  bool Found = false;
+  for (const llvm::json::Value &Export : *Data) {
+    const llvm::json::Object *E = Export.getAsObject();
+    const llvm::json::Array *FileList = E ? E->getArray("files") : nullptr;
+    if (!FileList)
+      continue;
+    for (const llvm::json::Value &FileValue : *FileList) {
+      const llvm::json::Object *F = FileValue.getAsObject();
+      if (!F)
+        continue;
+      std::optional<llvm::StringRef> Name = F->getString("filename");
+      const llvm::json::Array *Segments = F->getArray("segments");
+      if (!Name || !Segments)
+        continue;
+      // Counts of this export, merged into the others by sum.
+      LineCounts Lines;
+      // [line, column, count, hasCount, isRegionEntry, isGapRegion]
+      for (const llvm::json::Value &SegmentValue : *Segments) {
+        const llvm::json::Array *S = SegmentValue.getAsArray();
+        if (!S || S->size() < 5)
+          continue;
+        std::optional<int64_t> LineNo = (*S)[0].getAsInteger();
+        std::optional<int64_t> Count = (*S)[2].getAsInteger();
+        std::optional<bool> HasCount = (*S)[3].getAsBoolean();
+        std::optional<bool> IsGap =
+            S->size() > 5 ? (*S)[5].getAsBoolean() : std::optional<bool>();
+        if (!LineNo || !Count || *LineNo <= 0 || *Count < 0 ||
+            !HasCount.value_or(false) || IsGap.value_or(false))
+          continue;
+        uint64_t &Slot = Lines[static_cast<unsigned>(*LineNo)];
+        Slot = std::max(Slot, static_cast<uint64_t>(*Count));
+      }
+      if (Lines.empty())
+        continue;
+      LineCounts &Target = file(*Name);
+      for (const auto &Entry : Lines)
+        Target[Entry.first] += Entry.second;
+      Found = true;
+    }
+  }
+  return Found;
+}
+
+bool Coverage::parse(llvm::StringRef Text, CoverageFormat Format) {
+  if (Format == Auto)
+    Format = Text.ltrim().starts_with("{") ? LLVMCov : Gcov;
+  if (!(Format == LLVMCov ? parseLLVMCov(Text) : parseGcov(Text)))
+    return false;
+  llvm::raw_string_ostream(Digest)
+      << (Digest.empty() ? "" : "-")
+      << llvm::format_hex_no_prefix(llvm::xxHash64(Text), 16);
+  return true;
+}
+
+const Coverage::LineCounts *Coverage::lines(llvm::StringRef File) const {
+  std::string Path = normalizePath(File);
+  auto It = Files.find(Path);
+  if (It != Files.end())
+    return &It->second;
+  // Relative paths in the data: the longest matching suffix wins.
+  auto Candidates = ByName.find(llvm::sys::path::filename(Path));
+  if (Candidates == ByName.end())
+    return nullptr;
+  const LineCounts *Best = nullptr;
+  size_t BestLength = 0;
+  for (const std::string &Candidate : Candidates->second) {
+    size_t Length = 0;
+    if (endsWithPath(Path, Candidate))
+      Length = Candidate.size();
+    else if (endsWithPath(Candidate, Path))
+      Length = Path.size();
+    if (Length > BestLength) {
+      BestLength = Length;
+      Best = &Files.find(Candidate)->second;
+    }
+  }
+  return Best;
+}
+
+std::shared_ptr<const Coverage>
+Coverage::acquire(const clang::tidy::ClangTidyContext &Context) {
+  std::string Path = getModuleOption(Context, "CoverageFile", "");
+  if (Path.empty())
+    return nullptr;
+  CoverageFormat Format =
+      parseFormat(getModuleOption(Context, "CoverageFormat", "auto"));
+
+  struct Entry {
+    llvm::sys::TimePoint<> ModTime;
+    uint64_t Size = 0;
+    std::shared_ptr<const Coverage> Loaded;
+  };
+  static std::mutex Mutex;
+  static llvm::StringMap<Entry> Loaded;
+
+  llvm::sys::fs::file_status Status;
+  bool Exists = !llvm::sys::fs::status(Path, Status);
+  std::string Key = Path + '\0' + std::to_string(Format);
+
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto It = Loaded.find(Key);
+  if (It != Loaded.end() &&
+      (!Exists || (It->second.ModTime == Status.getLastModificationTime() &&
+                   It->second.Size == Status.getSize())))
+    return It->second.Loaded;
+
+  Entry &Slot = Loaded[Key];
+  Slot.Loaded = nullptr;
+  if (Exists) {
+    Slot.ModTime = Status.getLastModificationTime();
+    Slot.Size = Status.getSize();
+  }
+
+  std::vector<std::string> Inputs;
+  if (llvm::sys::fs::is_directory(Status)) {
+    std::error_code EC;
+    for (llvm::sys::fs::directory_iterator I(Path, EC), End; I != End && !EC;
+         I.increment(EC)) {
+      llvm::StringRef Ext = llvm::sys::path::extension(I->path());
+      if (Ext == ".gcov" || Ext == ".json")
+        Inputs.push_back(I->path());
+    }
+    // Directory order is unspecified; the digest must not be.
+    llvm::sort(Inputs);
+  } else {
+    Inputs.push_back(Path);
+  }
+
+  auto Data = std::make_shared<Coverage>();
+  bool Found = false;
+  for (const std::string &Input : Inputs) {
+    auto Buffer = llvm::MemoryBuffer::getFile(Input, /*IsText=*/true);
+    if (!Buffer) {
+      llvm::errs() << "hl-module.CoverageFile: cannot read '" << Input
+                   << "': " << Buffer.getError().message() << "\n";
+      continue;
+    }
+    Found |= Data->parse((*Buffer)->getBuffer(), Format);
+  }
+  if (!Found) {
+    llvm::errs() << "hl-module.CoverageFile: no line counts in '" << Path
+                 << "'\n";
+    return nullptr;
+  }
+  Slot.Loaded = std::move(Data);
+  return Slot.Loaded;
+}
+
+CoverageIndex::CoverageIndex(clang::ASTContext &Ctx, const Coverage &Data)
+    : Ctx(Ctx), Data(Data) {}
+
+const CoverageIndex &CoverageIndex::get(clang::ASTContext &Ctx,
+                                        const Coverage &Data) {
+  return getPerTU<CoverageIndex>(Ctx, Data);
+}
+
+std::optional<uint64_t>
+CoverageIndex::countAt(clang::SourceLocation Loc) const {
+  if (Loc.isInvalid())
+    return std::nullopt;
+  const clang::SourceManager &SM = Ctx.getSourceManager();
+  Loc = SM.getExpansionLoc(Loc);
+  clang::FileID FID = SM.getFileID(Loc);
+  auto [It, Inserted] = Files.try_emplace(FID, nullptr);
+  if (Inserted) {
+    if (clang::OptionalFileEntryRef Entry = SM.getFileEntryRefForID(FID)) {
+      llvm::StringRef RealPath = Entry->getFileEntry().tryGetRealPathName();
+      It->second = Data.lines(RealPath.empty() ? Entry->getName() : RealPath);
+    }
+  }
+  if (!It->second)
+    return std::nullopt;
+  auto Count = It->second->find(SM.getSpellingLineNumber(Loc));
+  if (Count == It->second->end())
+    return std::nullopt;
+  return Count->second;
+}
+
+std::optional<LoopExecution>
+CoverageIndex::loop(const clang::Stmt *Loop) const {
+  const clang::Stmt *Body = nullptr;
+  if (const auto *For = llvm::dyn_cast_or_null<clang::ForStmt>(Loop))
+    Body = For->getBody();
+  else if (const auto *While = llvm::dyn_cast_or_null<clang::WhileStmt>(Loop))
+    Body = While->getBody();
+  else if (const auto *Do = llvm::dyn_cast_or_null<clang::DoStmt>(Loop))
+    Body = Do->getBody();
+  else if (const auto *Range =
+               llvm::dyn_cast_or_null<clang::CXXForRangeStmt>(Loop))
+    Body = Range->getBody();
+  if (const auto *Block = llvm::dyn_cast_or_null<clang::CompoundStmt>(Body))
+    Body = Block->body_empty() ? nullptr : Block->body_front();
+  if (!Body)
+    return std::nullopt;
+  std::optional<uint64_t> Iterations = countAt(Body->getBeginLoc());
+  if (!Iterations)
+    return std::nullopt;
+
+  LoopExecution Result;
+  Result.Iterations = *Iterations;
+  clang::DynTypedNodeList Parents = Ctx.getParents(*Loop);
+  const auto *Block =
+      Parents.empty() ? nullptr : Parents[0].get<clang::CompoundStmt>();
+  if (!Block)
+    return Result;
+  const clang::Stmt *Previous = nullptr;
+  for (const clang::Stmt *S : Block->body()) {
+    if (S == Loop)
+      break;
+    Previous = S;
+  }
+  if (Previous) {
+    // Only a straight-line statement runs exactly once per entry.
+    if (llvm::isa<clang::Expr, clang::DeclStmt>(Previous))
+      Result.Entries = countAt(Previous->getBeginLoc());
+    return Result;
+  }
+  clang::DynTypedNodeList Owners = Ctx.getParents(*Block);
+  if (!Owners.empty())
+    if (const auto *FD = Owners[0].get<clang::FunctionDecl>()) {
+      Result.Entries = countAt(Block->getLBracLoc());
+      if (!Result.Entries)
+        Result.Entries = countAt(FD->getBeginLoc());
+    }
+  return Result;
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
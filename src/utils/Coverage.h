@@ -0,0 +1,127 @@
+//===--- Coverage.h - Line execution counts from coverage data --*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// The loop-scoped checks assume every loop is hot.  Coverage data from an
+// integration-test run records how often each loop body actually ran.  With
+// `hl-module.CoverageFile` set, line execution counts are loaded once per
+// process from
+//
+//   - `gcov` text files (`*.gcov`, `gcov -t` output).  Per-instantiation
+//     sections are skipped; they repeat lines already counted;
+//   - `llvm-cov export` JSON.  A line's count is the largest count of a
+//     region that starts on it.
+//
+// The option names a file, or a directory whose `*.gcov` and `*.json` files
+// are all read.  Counts of a file that several inputs cover (a header seen
+// by many TUs) are summed.  Files are matched by path, or by the longest
+// path suffix when the coverage data used relative paths.
+//
+// CoverageIndex turns line counts into per-loop facts for one TU:
+//
+//   - Iterations: the count of the first line of the loop body;
+//   - Entries: the count of the statement right before the loop, or of the
+//     function's opening line for a loop at the start of a function body.
+//     Unknown elsewhere (e.g. a loop at the start of an if branch, where the
+//     line before it counts the condition, not the branch).
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_COVERAGE_H
+#define HL_TIDY_UTILS_COVERAGE_H
+
+#include "clang-tidy/ClangTidyDiagnosticConsumer.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Stmt.h"
+#include "clang/Basic/SourceLocation.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+class Coverage {
+public:
+  enum CoverageFormat { Auto, Gcov, LLVMCov };
+
+  using LineCounts = llvm::DenseMap<unsigned, uint64_t>;
+
+  /// Add the counts of \p Text, in \p Format, to this data.  Returns false
+  /// if \p Text holds no counts.
+  bool parse(llvm::StringRef Text, CoverageFormat Format);
+
+  /// Return the coverage data named by `hl-module.CoverageFile`, loading it
+  /// on first use in the process, or null when the option is unset or
+  /// nothing could be read.  The result is shared by all TUs and threads.
+  static std::shared_ptr<const Coverage>
+  acquire(const clang::tidy::ClangTidyContext &Context);
+
+  /// Counts of the lines of \p File, or null if the data has none.
+  const LineCounts *lines(llvm::StringRef File) const;
+
+  /// Hash of the inputs, for keys of caches whose results depend on them.
+  llvm::StringRef digest() const { return Digest; }
+
+private:
+  bool parseGcov(llvm::StringRef Text);
+  bool parseLLVMCov(llvm::StringRef Text);
+  LineCounts &file(llvm::StringRef Path);
+
+  llvm::StringMap<LineCounts> Files;
+  /// File name -> the paths in Files with that name.
+  llvm::StringMap<llvm::SmallVector<std::string, 1>> ByName;
+  std::string Digest;
+};
+
+/// What the coverage run saw of one loop.
+struct LoopExecution {
+  /// Times the loop body ran, over all entries of the loop.
+  uint64_t Iterations = 0;
+  /// Times the loop was entered, if it can be told.
+  std::optional<uint64_t> Entries;
+
+  /// Iterations per entry, rounded up; nullopt if Entries is unknown or 0.
+  std::optional<uint64_t> averageTripCount() const {
+    if (!Entries || *Entries == 0)
+      return std::nullopt;
+    return (Iterations + *Entries - 1) / *Entries;
+  }
+};
+
+/// Coverage counts for the statements of one TU.
+class CoverageIndex {
+public:
+  CoverageIndex(clang::ASTContext &Ctx, const Coverage &Data);
+
+  /// Shared per-TU instance; built on first use.
+  static const CoverageIndex &get(clang::ASTContext &Ctx,
+                                  const Coverage &Data);
+
+  /// Execution count of the line \p Loc is on (after macro expansion), or
+  /// nullopt if the line has no count.
+  std::optional<uint64_t> countAt(clang::SourceLocation Loc) const;
+
+  /// Execution counts of the for, while, do or range-for \p Loop.
+  std::optional<LoopExecution> loop(const clang::Stmt *Loop) const;
+
+private:
+  clang::ASTContext &Ctx;
+  const Coverage &Data;
+  /// Counts of each file the TU has looked up; null if there are none.
+  mutable llvm::DenseMap<clang::FileID, const Coverage::LineCounts *> Files;
+};
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_COVERAGE_H
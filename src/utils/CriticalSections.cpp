@@ -0,0 +1,310 @@
+//===--- CriticalSections.cpp - Statements run under a mutex ----*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "CriticalSections.h"
+#include "StdSymbols.h"
+
+#include "clang/AST/ParentMapContext.h"
+#include "clang/Lex/Lexer.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/STLFunctionExtras.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+namespace {
+
+/// How diagnostics name a guard type, or an empty string if \p T is not
+/// one.
+llvm::StringRef guardKind(clang::QualType T, clang::ASTContext &Ctx) {
+  const clang::CXXRecordDecl *RD =
+      T.getNonReferenceType()->getAsCXXRecordDecl();
+  if (!RD)
+    return {};
+  std::optional<StdSymbol> S = StdSymbols::get(Ctx).classify(RD);
+  if (!S)
+    return {};
+  switch (*S) {
+  case StdSymbol::LockGuard:
+    return "std::lock_guard";
+  case StdSymbol::ScopedLock:
+    return "std::scoped_lock";
+  case StdSymbol::UniqueLock:
+    return "std::unique_lock";
+  case StdSymbol::SharedLock:
+    return "std::shared_lock";
+  default:
+    return {};
+  }
+}
+
+bool isMutexType(clang::QualType T, clang::ASTContext &Ctx) {
+  const clang::CXXRecordDecl *RD =
+      T.getNonReferenceType()->getAsCXXRecordDecl();
+  return RD && StdSymbols::get(Ctx).is(
+                   RD, {StdSymbol::Mutex, StdSymbol::RecursiveMutex,
+                        StdSymbol::TimedMutex, StdSymbol::RecursiveTimedMutex,
+                        StdSymbol::SharedMutex, StdSymbol::SharedTimedMutex});
+}
+
+/// std::defer_lock_t, std::try_to_lock_t or std::adopt_lock_t.
+bool isLockTag(clang::QualType T, llvm::StringRef Name = {}) {
+  const clang::CXXRecordDecl *RD =
+      T.getNonReferenceType()->getAsCXXRecordDecl();
+  if (!RD || !RD->isInStdNamespace() || !RD->getIdentifier())
+    return false;
+  if (!Name.empty())
+    return RD->getName() == Name;
+  return RD->getName() == "defer_lock_t" ||
+         RD->getName() == "try_to_lock_t" || RD->getName() == "adopt_lock_t";
+}
+
+/// True if \p A and \p B name the same object: the same variable, or the
+/// same field of the same object.
+bool sameObject(const clang::Expr *A, const clang::Expr *B) {
+  A = A->IgnoreParenImpCasts();
+  B = B->IgnoreParenImpCasts();
+  if (const auto *RefA = llvm::dyn_cast<clang::DeclRefExpr>(A)) {
+    const auto *RefB = llvm::dyn_cast<clang::DeclRefExpr>(B);
+    return RefB && RefA->getDecl()->getCanonicalDecl() ==
+                       RefB->getDecl()->getCanonicalDecl();
+  }
+  if (const auto *MemberA = llvm::dyn_cast<clang::MemberExpr>(A)) {
+    const auto *MemberB = llvm::dyn_cast<clang::MemberExpr>(B);
+    return MemberB && MemberA->isArrow() == MemberB->isArrow() &&
+           MemberA->getMemberDecl()->getCanonicalDecl() ==
+               MemberB->getMemberDecl()->getCanonicalDecl() &&
+           sameObject(MemberA->getBase(), MemberB->getBase());
+  }
+  if (const auto *DerefA = llvm::dyn_cast<clang::UnaryOperator>(A)) {
+    const auto *DerefB = llvm::dyn_cast<clang::UnaryOperator>(B);
+    return DerefA->getOpcode() == clang::UO_Deref && DerefB &&
+           DerefB->getOpcode() == clang::UO_Deref &&
+           sameObject(DerefA->getSubExpr(), DerefB->getSubExpr());
+  }
+  return llvm::isa<clang::CXXThisExpr>(A) && llvm::isa<clang::CXXThisExpr>(B);
+}
+
+/// The member call \p S is, if it calls \p Name or \p SharedName.
+const clang::CXXMemberCallExpr *memberCall(const clang::Stmt *S,
+                                           llvm::StringRef Name,
+                                           llvm::StringRef SharedName) {
+  const auto *E = llvm::dyn_cast_or_null<clang::Expr>(S);
+  if (!E)
+    return nullptr;
+  const auto *Call =
+      llvm::dyn_cast<clang::CXXMemberCallExpr>(E->IgnoreImplicit());
+  if (!Call || !Call->getMethodDecl() ||
+      !Call->getMethodDecl()->getIdentifier() ||
+      !Call->getImplicitObjectArgument())
+    return nullptr;
+  llvm::StringRef Called = Call->getMethodDecl()->getName();
+  return Called == Name || Called == SharedName ? Call : nullptr;
+}
+
+/// True if \p S never completes normally: a return or a throw, a break or
+/// continue that is not inside a loop or switch of its own (\p InLoop), or
+/// a block ending in one of those.
+bool leavesBlock(const clang::Stmt *S, bool InLoop) {
+  if (const auto *Block = llvm::dyn_cast<clang::CompoundStmt>(S))
+    return !Block->body_empty() && leavesBlock(Block->body_back(), InLoop);
+  if (llvm::isa<clang::BreakStmt, clang::ContinueStmt>(S))
+    return !InLoop;
+  if (const auto *E = llvm::dyn_cast<clang::Expr>(S))
+    S = E->IgnoreImplicit();
+  return llvm::isa<clang::ReturnStmt, clang::CXXThrowExpr>(S);
+}
+
+/// True if \p S calls unlock() or unlock_shared() on an object \p IsTarget
+/// accepts and can then go on to the next statement.  A branch that
+/// unlocks and then returns, throws, breaks or continues does not release
+/// the lock for what follows.  Lambdas are not entered: they need not run
+/// here.
+bool unlocks(const clang::Stmt *S,
+             llvm::function_ref<bool(const clang::Expr *)> IsTarget,
+             bool InLoop = false) {
+  if (!S || llvm::isa<clang::LambdaExpr>(S) || leavesBlock(S, InLoop))
+    return false;
+  if (const auto *Call = memberCall(S, "unlock", "unlock_shared"))
+    if (IsTarget(Call->getImplicitObjectArgument()))
+      return true;
+  InLoop = InLoop || llvm::isa<clang::ForStmt, clang::WhileStmt, clang::DoStmt,
+                               clang::CXXForRangeStmt, clang::SwitchStmt>(S);
+  for (const clang::Stmt *Child : S->children())
+    if (unlocks(Child, IsTarget, InLoop))
+      return true;
+  return false;
+}
+
+/// True if \p Object is what \p Section is released through: its guard,
+/// or the mutex lock() was called on.
+bool releases(const CriticalSection &Section, const clang::Expr *Object) {
+  if (!Section.Guard)
+    return sameObject(Object, Section.Mutex);
+  const auto *Ref =
+      llvm::dyn_cast<clang::DeclRefExpr>(Object->IgnoreParenImpCasts());
+  return Ref && Ref->getDecl() == Section.Guard;
+}
+
+} // namespace
+
+std::string mutexSpelling(const CriticalSection &Section,
+                          const clang::ASTContext &Ctx) {
+  llvm::StringRef Text = clang::Lexer::getSourceText(
+      clang::CharSourceRange::getTokenRange(Section.Mutex->getSourceRange()),
+      Ctx.getSourceManager(), Ctx.getLangOpts());
+  return Text.empty() ? "the mutex" : Text.str();
+}
+
+std::optional<CriticalSection>
+criticalSectionStartedBy(const clang::Stmt *S, const clang::CompoundStmt *Block,
+                         clang::ASTContext &Ctx) {
+  CriticalSection Section;
+  if (const auto *DS = llvm::dyn_cast<clang::DeclStmt>(S)) {
+    if (!DS->isSingleDecl())
+      return std::nullopt;
+    const auto *Var = llvm::dyn_cast<clang::VarDecl>(DS->getSingleDecl());
+    if (!Var || !Var->getInit())
+      return std::nullopt;
+    Section.Kind = guardKind(Var->getType(), Ctx);
+    const auto *Construct = llvm::dyn_cast<clang::CXXConstructExpr>(
+        Var->getInit()->IgnoreImplicit());
+    if (Section.Kind.empty() || !Construct)
+      return std::nullopt;
+    for (const clang::Expr *Arg : Construct->arguments()) {
+      if (isLockTag(Arg->getType(), "defer_lock_t") ||
+          !guardKind(Arg->getType(), Ctx).empty())
+        return std::nullopt;
+      if (!Section.Mutex && !isLockTag(Arg->getType()))
+        Section.Mutex = Arg;
+    }
+    if (!Section.Mutex)
+      return std::nullopt;
+    Section.Guard = Var;
+  } else if (const auto *Call = memberCall(S, "lock", "lock_shared")) {
+    const clang::Expr *Object = Call->getImplicitObjectArgument();
+    clang::QualType T = Object->getType();
+    if (T->isPointerType())
+      T = T->getPointeeType();
+    if (!isMutexType(T, Ctx) && guardKind(T, Ctx).empty())
+      return std::nullopt;
+    Section.Mutex = Object;
+    Section.Kind = Call->getMethodDecl()->getName() == "lock"
+                       ? "lock()"
+                       : "lock_shared()";
+  } else {
+    return std::nullopt;
+  }
+
+  auto Body = Block->body();
+  auto It = llvm::find(Body, S);
+  if (It == Body.end())
+    return std::nullopt;
+  Section.Acquire = S;
+  Section.Block = Block;
+  auto IsTarget = [&Section](const clang::Expr *Object) {
+    return releases(Section, Object);
+  };
+  auto End = std::find_if(std::next(It), Body.end(),
+                          [&](const clang::Stmt *Later) {
+                            return unlocks(Later, IsTarget);
+                          });
+  if (End != Body.end())
+    Section.Release = *End;
+  Section.Statements = llvm::ArrayRef<clang::Stmt *>(
+      Block->body_begin() + (It - Body.begin()) + 1,
+      Block->body_begin() + (End - Body.begin()));
+  return Section;
+}
+
+std::optional<CriticalSection> criticalSectionOf(const clang::VarDecl *Guard,
+                                                 clang::ASTContext &Ctx) {
+  clang::DynTypedNodeList Parents = Ctx.getParents(*Guard);
+  const auto *DS =
+      Parents.empty() ? nullptr : Parents[0].get<clang::DeclStmt>();
+  if (!DS)
+    return std::nullopt;
+  Parents = Ctx.getParents(*DS);
+  const auto *Block =
+      Parents.empty() ? nullptr : Parents[0].get<clang::CompoundStmt>();
+  if (!Block)
+    return std::nullopt;
+  return criticalSectionStartedBy(DS, Block, Ctx);
+}
+
+std::optional<CriticalSection>
+criticalSectionOf(const clang::CXXMemberCallExpr *Lock,
+                  clang::ASTContext &Ctx) {
+  // The call may be wrapped in an ExprWithCleanups statement.
+  const clang::Stmt *S = Lock;
+  clang::DynTypedNodeList Parents = Ctx.getParents(*S);
+  while (!Parents.empty() && Parents[0].get<clang::ExprWithCleanups>()) {
+    S = Parents[0].get<clang::Stmt>();
+    Parents = Ctx.getParents(*S);
+  }
+  const auto *Block =
+      Parents.empty() ? nullptr : Parents[0].get<clang::CompoundStmt>();
+  if (!Block)
+    return std::nullopt;
+  return criticalSectionStartedBy(S, Block, Ctx);
+}
+
+std::optional<CriticalSection>
+enclosingCriticalSection(const clang::Stmt *S, clang::ASTContext &Ctx) {
+  // The blocks between S and the section's block, each with the statement
+  // that leads to S: an unlock before it in the same block releases the
+  // lock for S too.
+  using Step = std::pair<const clang::CompoundStmt *, const clang::Stmt *>;
+  llvm::SmallVector<Step, 4> Path;
+  auto ReleasedOnPath = [&Path](const CriticalSection &Section) {
+    auto IsTarget = [&Section](const clang::Expr *Object) {
+      return releases(Section, Object);
+    };
+    for (const auto &[Block, Inner] : Path)
+      for (const clang::Stmt *Earlier : Block->body()) {
+        if (Earlier == Inner)
+          break;
+        if (unlocks(Earlier, IsTarget))
+          return true;
+      }
+    return false;
+  };
+  clang::DynTypedNode Child = clang::DynTypedNode::create(*S);
+  for (;;) {
+    clang::DynTypedNodeList Parents = Ctx.getParents(Child);
+    if (Parents.empty() || Parents[0].get<clang::FunctionDecl>() ||
+        Parents[0].get<clang::LambdaExpr>() ||
+        Parents[0].get<clang::BlockDecl>())
+      return std::nullopt;
+    const clang::DynTypedNode Parent = Parents[0];
+    const auto *Block = Parent.get<clang::CompoundStmt>();
+    const clang::Stmt *Inner = Child.get<clang::Stmt>();
+    if (Block && Inner) {
+      auto Body = Block->body();
+      auto It = llvm::find(Body, Inner);
+      if (It == Body.end())
+        It = Body.begin();
+      // The latest acquisition before Inner that still holds its lock.
+      while (It != Body.begin()) {
+        --It;
+        std::optional<CriticalSection> Section =
+            criticalSectionStartedBy(*It, Block, Ctx);
+        if (Section && llvm::is_contained(Section->Statements, Inner) &&
+            !ReleasedOnPath(*Section))
+          return Section;
+      }
+      Path.emplace_back(Block, Inner);
+    }
+    Child = Parent;
+  }
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
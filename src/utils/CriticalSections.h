@@ -0,0 +1,91 @@
+//===--- CriticalSections.h - Statements run under a mutex ------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// Finds where a mutex is acquired and which statements run while it is
+// held, for the checks about lock contention.  A critical section starts
+// with a statement of a block that
+//
+//   - declares a std::lock_guard, std::scoped_lock, std::unique_lock or
+//     std::shared_lock that locks on construction (not with
+//     std::defer_lock, not moved from another guard);
+//   - calls lock() or lock_shared() on a std mutex or on a guard.
+//
+// It lasts until the end of the block, or until the first later statement
+// of the block that unlocks it -- `guard.unlock()`, `m.unlock()` -- even
+// when the unlock is nested in an if or a block of its own; that statement
+// is not part of the section.  A branch that unlocks and then leaves the
+// block -- `if (Err) { m.unlock(); return; }` -- does not end the section,
+// as nothing after it runs on that path; statements after the unlock
+// inside such a branch are not held.  Sections are tracked per block
+// rather than over the CFG: guards are scoped to blocks, and ending a
+// section at an unlock on any path that carries on means that what is
+// reported as held is held on every path through the block.  A lock()
+// without a matching unlock() in its block is assumed held until the end
+// of the block.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_CRITICAL_SECTIONS_H
+#define HL_TIDY_UTILS_CRITICAL_SECTIONS_H
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/Stmt.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <optional>
+#include <string>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+struct CriticalSection {
+  /// The guard variable, or null for a lock() call on a mutex.
+  const clang::VarDecl *Guard = nullptr;
+  /// The mutex as written: the first mutex a guard is constructed with, or
+  /// the object lock() is called on.
+  const clang::Expr *Mutex = nullptr;
+  /// The statement that acquires the lock, directly inside Block.
+  const clang::Stmt *Acquire = nullptr;
+  const clang::CompoundStmt *Block = nullptr;
+  /// The statements after Acquire that run with the lock held.
+  llvm::ArrayRef<clang::Stmt *> Statements;
+  /// The statement that releases the lock early, or null if it is held to
+  /// the end of Block.
+  const clang::Stmt *Release = nullptr;
+  /// How diagnostics name the acquisition: "std::lock_guard", "lock()".
+  llvm::StringRef Kind;
+};
+
+/// The mutex of \p Section as written in the source, or "the mutex" if it
+/// has no spelling of its own (a macro argument, say).
+std::string mutexSpelling(const CriticalSection &Section,
+                          const clang::ASTContext &Ctx);
+
+/// The critical section that \p S, a statement directly inside \p Block,
+/// starts, or std::nullopt if it does not acquire a lock.
+std::optional<CriticalSection>
+criticalSectionStartedBy(const clang::Stmt *S, const clang::CompoundStmt *Block,
+                         clang::ASTContext &Ctx);
+
+/// The critical section started by the declaration of \p Guard, or by the
+/// lock() call \p Lock, if it is a statement of its own.
+std::optional<CriticalSection> criticalSectionOf(const clang::VarDecl *Guard,
+                                                 clang::ASTContext &Ctx);
+std::optional<CriticalSection>
+criticalSectionOf(const clang::CXXMemberCallExpr *Lock, clang::ASTContext &Ctx);
+
+/// The innermost critical section of the same function that holds a lock
+/// while \p S runs, or std::nullopt.
+std::optional<CriticalSection>
+enclosingCriticalSection(const clang::Stmt *S, clang::ASTContext &Ctx);
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_CRITICAL_SECTIONS_H
@@ -0,0 +1,409 @@
+//===--- DiagnosticExport.cpp - Streaming SARIF / NDJSON export --*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "DiagnosticExport.h"
+#include "CppStandardUtils.h"
+#include "LoopContext.h"
+#include "ModuleOptions.h"
+#include "TUSession.h"
+
+#include "clang/Lex/Lexer.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/xxhash.h"
+
+#include <algorithm>
+
+#ifndef HL_TIDY_VERSION
+#define HL_TIDY_VERSION "unknown"
+#endif
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+namespace {
+
+llvm::StringRef levelName(clang::DiagnosticIDs::Level Level) {
+  switch (Level) {
+  case clang::DiagnosticIDs::Error:
+  case clang::DiagnosticIDs::Fatal:
+    return "error";
+  case clang::DiagnosticIDs::Note:
+    return "note";
+  case clang::DiagnosticIDs::Remark:
+    return "remark";
+  default:
+    return "warning";
+  }
+}
+
+/// SARIF has no remarks; a demoted finding is a note.
+llvm::StringRef sarifLevel(clang::DiagnosticIDs::Level Level) {
+  switch (Level) {
+  case clang::DiagnosticIDs::Warning:
+    return "warning";
+  case clang::DiagnosticIDs::Remark:
+  case clang::DiagnosticIDs::Note:
+    return "note";
+  default:
+    return "error";
+  }
+}
+
+void writeRegion(llvm::json::OStream &J, const ExportedLoc &Begin,
+                 const ExportedLoc *End) {
+  J.attribute("startLine", Begin.Line);
+  J.attribute("startColumn", Begin.Column);
+  if (End) {
+    J.attribute("endLine", End->Line);
+    J.attribute("endColumn", End->Column);
+  }
+}
+
+void writeSarifLocation(llvm::json::OStream &J, const ExportedLoc &Loc) {
+  J.attributeObject("physicalLocation", [&] {
+    J.attributeObject("artifactLocation",
+                      [&] { J.attribute("uri", Loc.File); });
+    J.attributeObject("region", [&] { writeRegion(J, Loc, nullptr); });
+  });
+}
+
+/// The alternatives recommended by \p Notes, as an array body.
+void writeSuggestions(llvm::json::OStream &J,
+                      const std::vector<ExportedNote> &Notes) {
+  for (const ExportedNote &Note : Notes)
+    if (Note.Suggested)
+      J.object([&] {
+        J.attribute("alternative", Note.Suggested->Alternative);
+        J.attribute("since", Note.Suggested->Since);
+      });
+}
+
+} // namespace
+
+std::shared_ptr<ExportSession>
+ExportSession::acquire(clang::tidy::ClangTidyContext &Context) {
+  return acquireTUSession<ExportSession>(
+      Context, [&]() -> std::shared_ptr<ExportSession> {
+        std::string Dir = getModuleOption(Context, "ExportDir", "");
+        std::string MainFile = Context.getCurrentFile().str();
+        if (Dir.empty() || MainFile.empty())
+          return nullptr;
+        ExportFormat Format =
+            llvm::StringRef(getModuleOption(Context, "ExportFormat", "ndjson"))
+                    .trim()
+                    .equals_insensitive("sarif")
+                ? SARIF
+                : NDJSON;
+
+        // <dir>/<basename>.<hash of full path>.<ext>, as for MetricsDir.
+        llvm::SmallString<256> Path(Dir);
+        llvm::sys::fs::create_directories(Path);
+        std::string Name;
+        llvm::raw_string_ostream(Name)
+            << llvm::sys::path::filename(MainFile) << '.'
+            << llvm::format_hex_no_prefix(llvm::xxHash64(MainFile), 16)
+            << (Format == SARIF ? ".sarif" : ".ndjson");
+        llvm::sys::path::append(Path, Name);
+        return std::make_shared<ExportSession>(
+            Path.str().str(), Format,
+            getModuleOption(Context, "ExportRoot", ""));
+      });
+}
+
+ExportSession::ExportSession(std::string Path, ExportFormat Format,
+                             std::string Root)
+    : Path(std::move(Path)), Format(Format), Root(std::move(Root)) {
+  // Written under a temporary name and renamed when complete, so readers
+  // never see half a file.
+  TmpPath = this->Path + ".tmp";
+  std::error_code EC;
+  OS = std::make_unique<llvm::raw_fd_ostream>(TmpPath, EC,
+                                              llvm::sys::fs::OF_Text);
+  if (EC) {
+    OS.reset();
+    return;
+  }
+  if (Format != SARIF)
+    return;
+
+  Sarif = std::make_unique<llvm::json::OStream>(*OS);
+  llvm::json::OStream &J = *Sarif;
+  J.objectBegin();
+  J.attribute("version", "2.1.0");
+  J.attribute("$schema", "https://json.schemastore.org/sarif-2.1.0.json");
+  J.attributeBegin("runs");
+  J.arrayBegin();
+  J.objectBegin();
+  J.attributeObject("tool", [&] {
+    J.attributeObject("driver", [&] {
+      J.attribute("name", "hl-tidy");
+      J.attribute("version", HL_TIDY_VERSION);
+    });
+  });
+  J.attributeBegin("results");
+  J.arrayBegin();
+}
+
+ExportSession::~ExportSession() {
+  for (const std::unique_ptr<ExportedDiagnostic> &Diag : Open)
+    write(*Diag);
+  Open.clear();
+  if (!OS)
+    return;
+  if (Sarif) {
+    llvm::json::OStream &J = *Sarif;
+    J.arrayEnd();
+    J.attributeEnd();
+    J.objectEnd();
+    J.arrayEnd();
+    J.attributeEnd();
+    J.objectEnd();
+    Sarif.reset();
+    *OS << "\n";
+  }
+  OS->close();
+  if (OS->has_error()) {
+    OS->clear_error();
+    llvm::sys::fs::remove(TmpPath);
+    return;
+  }
+  if (llvm::sys::fs::rename(TmpPath, Path))
+    llvm::sys::fs::remove(TmpPath);
+}
+
+void ExportSession::attach(const clang::SourceManager &SourceMgr,
+                           const clang::LangOptions &Opts) {
+  if (SM)
+    return;
+  SM = &SourceMgr;
+  LangOpts = &Opts;
+}
+
+std::unique_ptr<ExportedDiagnostic>
+ExportSession::record(llvm::StringRef CheckName, clang::SourceLocation Loc,
+                      llvm::StringRef Description,
+                      clang::DiagnosticIDs::Level Level) {
+  if (!OS || !SM)
+    return nullptr;
+  auto Diag = std::make_unique<ExportedDiagnostic>();
+  Diag->Check = CheckName.str();
+  Diag->Level = Level;
+  Diag->Description = Description.str();
+  Diag->Loc = Loc;
+  return Diag;
+}
+
+void ExportSession::addFixIt(ExportedDiagnostic &Diag,
+                             const clang::FixItHint &Hint) {
+  clang::CharSourceRange Range =
+      clang::Lexer::makeFileCharRange(Hint.RemoveRange, *SM, *LangOpts);
+  if (Range.isInvalid())
+    return;
+  std::optional<ExportedLoc> Begin = resolve(Range.getBegin());
+  std::optional<ExportedLoc> End = resolve(Range.getEnd());
+  if (Begin && End)
+    Diag.Fixes.push_back({*Begin, *End, Hint.CodeToInsert});
+}
+
+std::optional<ExportedLoc>
+ExportSession::resolve(clang::SourceLocation Loc) const {
+  if (Loc.isInvalid())
+    return std::nullopt;
+  clang::PresumedLoc P = SM->getPresumedLoc(SM->getFileLoc(Loc));
+  if (P.isInvalid())
+    return std::nullopt;
+  ExportedLoc Out;
+  llvm::StringRef File = P.getFilename();
+  if (!Root.empty() && File.consume_front(Root))
+    File = File.ltrim("/\\");
+  Out.File = File.str();
+  Out.Line = P.getLine();
+  Out.Column = P.getColumn();
+  return Out;
+}
+
+std::string ExportSession::fingerprint(const ExportedDiagnostic &Diag) const {
+  std::string Key = Diag.Check;
+  Key += '\0';
+  if (Diag.Resolved)
+    Key += Diag.Resolved->File;
+  Key += '\0';
+  Key += Diag.Message;
+  Key += '\0';
+  if (Diag.Loc.isValid()) {
+    // The text of the flagged line rather than its number, so that edits
+    // above it keep the fingerprint.
+    std::pair<clang::FileID, unsigned> Decomposed =
+        SM->getDecomposedLoc(SM->getFileLoc(Diag.Loc));
+    bool Invalid = false;
+    llvm::StringRef Buffer = SM->getBufferData(Decomposed.first, &Invalid);
+    if (!Invalid && Decomposed.second <= Buffer.size()) {
+      size_t Begin = Buffer.rfind('\n', Decomposed.second);
+      Begin = Begin == llvm::StringRef::npos ? 0 : Begin + 1;
+      size_t End = Buffer.find('\n', Decomposed.second);
+      Key += Buffer.slice(Begin, End).trim();
+    }
+  }
+  std::string Out;
+  llvm::raw_string_ostream(Out)
+      << llvm::format_hex_no_prefix(llvm::xxHash64(Key), 16);
+  return Out;
+}
+
+void ExportSession::commit(std::unique_ptr<ExportedDiagnostic> Diag) {
+  Diag->Message = formatDescription(Diag->Description, Diag->Args);
+  auto Same = [&](const std::unique_ptr<ExportedDiagnostic> &Other) {
+    return Other->Check == Diag->Check;
+  };
+  auto It = std::find_if(Open.begin(), Open.end(), Same);
+
+  if (Diag->Level == clang::DiagnosticIDs::Note) {
+    // Notes belong to the last warning of the same check.
+    if (It == Open.end())
+      return;
+    ExportedDiagnostic &Warning = **It;
+    Warning.Notes.push_back(
+        {Diag->Message, resolve(Diag->Loc), std::move(Diag->Suggested)});
+    for (ExportedFix &Fix : Diag->Fixes)
+      Warning.Fixes.push_back(std::move(Fix));
+    return;
+  }
+
+  Diag->Resolved = resolve(Diag->Loc);
+  Diag->Fingerprint = fingerprint(*Diag);
+  if (Ctx) {
+    Diag->Standard = standardLabel(detectStandard(*Ctx)).str();
+    if (Diag->Loc.isValid())
+      Diag->LoopDepth = LoopContext::get(*Ctx).depthAt(Diag->Loc);
+  }
+  if (It != Open.end()) {
+    write(**It);
+    *It = std::move(Diag);
+  } else {
+    Open.push_back(std::move(Diag));
+  }
+}
+
+void ExportSession::write(const ExportedDiagnostic &Diag) {
+  if (!OS)
+    return;
+  if (Sarif) {
+    writeSarifResult(*Sarif, Diag);
+    return;
+  }
+  llvm::json::OStream J(*OS);
+  writeRecord(J, Diag);
+  *OS << "\n";
+}
+
+void ExportSession::writeRecord(llvm::json::OStream &J,
+                                const ExportedDiagnostic &D) {
+  J.object([&] {
+    J.attribute("fingerprint", D.Fingerprint);
+    J.attribute("check", D.Check);
+    J.attribute("level", levelName(D.Level));
+    J.attribute("message", D.Message);
+    if (D.Resolved) {
+      J.attribute("file", D.Resolved->File);
+      J.attribute("line", D.Resolved->Line);
+      J.attribute("column", D.Resolved->Column);
+    }
+    J.attribute("standard", D.Standard);
+    J.attribute("loopDepth", D.LoopDepth);
+    if (D.Hotness)
+      J.attribute("hotness", *D.Hotness);
+    if (D.Cost)
+      J.attribute("cost", *D.Cost);
+    if (D.HotRoot)
+      J.attribute("hotRoot", *D.HotRoot);
+    J.attributeArray("notes", [&] {
+      for (const ExportedNote &Note : D.Notes)
+        J.object([&] {
+          J.attribute("message", Note.Message);
+          if (Note.Loc) {
+            J.attribute("file", Note.Loc->File);
+            J.attribute("line", Note.Loc->Line);
+            J.attribute("column", Note.Loc->Column);
+          }
+        });
+    });
+    J.attributeArray("suggestions", [&] { writeSuggestions(J, D.Notes); });
+    J.attributeArray("fixes", [&] {
+      for (const ExportedFix &Fix : D.Fixes)
+        J.object([&] {
+          J.attribute("file", Fix.Begin.File);
+          J.attribute("line", Fix.Begin.Line);
+          J.attribute("column", Fix.Begin.Column);
+          J.attribute("endLine", Fix.End.Line);
+          J.attribute("endColumn", Fix.End.Column);
+          J.attribute("replacement", Fix.Replacement);
+        });
+    });
+  });
+}
+
+void ExportSession::writeSarifResult(llvm::json::OStream &J,
+                                     const ExportedDiagnostic &D) {
+  J.object([&] {
+    J.attribute("ruleId", D.Check);
+    J.attribute("level", sarifLevel(D.Level));
+    J.attributeObject("message", [&] { J.attribute("text", D.Message); });
+    J.attributeArray("locations", [&] {
+      if (D.Resolved)
+        J.object([&] { writeSarifLocation(J, *D.Resolved); });
+    });
+    J.attributeObject("partialFingerprints",
+                      [&] { J.attribute("hlTidy/v1", D.Fingerprint); });
+    J.attributeArray("relatedLocations", [&] {
+      for (size_t I = 0; I < D.Notes.size(); ++I)
+        J.object([&] {
+          J.attribute("id", static_cast<int64_t>(I));
+          J.attributeObject("message",
+                            [&] { J.attribute("text", D.Notes[I].Message); });
+          if (D.Notes[I].Loc)
+            writeSarifLocation(J, *D.Notes[I].Loc);
+        });
+    });
+    if (!D.Fixes.empty())
+      J.attributeArray("fixes", [&] {
+        J.object([&] {
+          J.attributeArray("artifactChanges", [&] {
+            for (const ExportedFix &Fix : D.Fixes)
+              J.object([&] {
+                J.attributeObject("artifactLocation",
+                                  [&] { J.attribute("uri", Fix.Begin.File); });
+                J.attributeArray("replacements", [&] {
+                  J.object([&] {
+                    J.attributeObject("deletedRegion", [&] {
+                      writeRegion(J, Fix.Begin, &Fix.End);
+                    });
+                    J.attributeObject("insertedContent", [&] {
+                      J.attribute("text", Fix.Replacement);
+                    });
+                  });
+                });
+              });
+          });
+        });
+      });
+    J.attributeObject("properties", [&] {
+      J.attribute("standard", D.Standard);
+      J.attribute("loopDepth", D.LoopDepth);
+      if (D.Hotness)
+        J.attribute("hotness", *D.Hotness);
+      if (D.Cost)
+        J.attribute("cost", *D.Cost);
+      if (D.HotRoot)
+        J.attribute("hotRoot", *D.HotRoot);
+      J.attributeArray("suggestions", [&] { writeSuggestions(J, D.Notes); });
+    });
+  });
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
@@ -0,0 +1,168 @@
+//===--- DiagnosticExport.h - Streaming SARIF / NDJSON export ---*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// clang-tidy keeps every diagnostic of a run in memory and can only dump
+// them as YAML at the end, with the suggestions of each finding spread over
+// free-text notes.  With `hl-module.ExportDir` set, the hl-* checks also
+// write their findings themselves, one file per translation unit, while the
+// TU is analysed:
+//
+//   - `hl-module.ExportFormat=ndjson` (default): one JSON object per line;
+//   - `hl-module.ExportFormat=sarif`: a SARIF 2.1.0 log with one run.
+//
+// Each record is one warning with its notes folded in, and carries as
+// structured fields: a fingerprint, the check, the location, the detected
+// C++ standard, the loop nesting depth of the flagged code, its profile
+// hotness, cost score and hot-path root when those are enabled (the message
+// does not repeat them as the terminal does), the notes, the alternatives
+// they recommend (the utils::Suggestion streamed into each note) and the
+// fix-its.
+//
+// A warning is written as soon as the next warning of the same check, or
+// the end of the TU, shows that no more notes can follow, so memory stays
+// at one open warning per check however many findings a TU has.
+//
+// The fingerprint hashes the check, the file path (relative to
+// `hl-module.ExportRoot` when set), the message and the text of the flagged
+// line, so it survives edits elsewhere in the file and different checkout
+// locations.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_DIAGNOSTIC_EXPORT_H
+#define HL_TIDY_UTILS_DIAGNOSTIC_EXPORT_H
+
+#include "DiagnosticHelper.h"
+
+#include "clang-tidy/ClangTidyDiagnosticConsumer.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/LangOptions.h"
+#include "clang/Basic/SourceManager.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+/// A resolved file position.
+struct ExportedLoc {
+  std::string File;
+  unsigned Line = 0;
+  unsigned Column = 0;
+};
+
+struct ExportedFix {
+  ExportedLoc Begin;
+  ExportedLoc End;
+  std::string Replacement;
+};
+
+struct ExportedNote {
+  std::string Message;
+  std::optional<ExportedLoc> Loc;
+  std::optional<Suggestion> Suggested;
+};
+
+/// One diagnostic while it is being streamed, and then one warning with its
+/// notes once committed.
+struct ExportedDiagnostic {
+  std::string Check;
+  clang::DiagnosticIDs::Level Level = clang::DiagnosticIDs::Warning;
+  std::string Description;
+  clang::SourceLocation Loc;
+  std::vector<std::string> Args;
+  std::vector<ExportedFix> Fixes;
+  /// Profile hotness in percent (see Profile.h), set by the check.
+  std::optional<double> Hotness;
+  /// Cost-model score (see CostModel.h), set by the check.
+  std::optional<double> Cost;
+  /// Hot entry point the flagged code is reached from (see HotPath.h), set
+  /// by the check.
+  std::optional<std::string> HotRoot;
+  /// The alternative a note recommends, streamed by the check.
+  std::optional<Suggestion> Suggested;
+
+  // Filled in by ExportSession::commit().
+  std::string Message;
+  std::optional<ExportedLoc> Resolved;
+  std::string Fingerprint;
+  std::string Standard;
+  unsigned LoopDepth = 0;
+  std::vector<ExportedNote> Notes;
+};
+
+/// The export file of one translation unit, shared by all hl-* checks
+/// created for it (see TUSession.h).  The file is complete when the last
+/// check releases the session.
+class ExportSession {
+public:
+  enum ExportFormat { NDJSON, SARIF };
+
+  ExportSession(std::string Path, ExportFormat Format, std::string Root);
+  ~ExportSession();
+
+  /// Return the session for the TU \p Context is currently processing, or
+  /// null when `hl-module.ExportDir` is not set.
+  static std::shared_ptr<ExportSession>
+  acquire(clang::tidy::ClangTidyContext &Context);
+
+  /// Use \p SM and \p LangOpts to resolve locations.  Only the first call
+  /// has an effect.
+  void attach(const clang::SourceManager &SM,
+              const clang::LangOptions &LangOpts);
+
+  /// Use \p Ctx for the standard and loop depth of later diagnostics.
+  void setASTContext(clang::ASTContext &Ctx) { this->Ctx = &Ctx; }
+
+  /// Start a diagnostic.  The caller streams arguments and fix-its into it
+  /// and hands it back to commit() when the diagnostic is emitted.
+  std::unique_ptr<ExportedDiagnostic>
+  record(llvm::StringRef CheckName, clang::SourceLocation Loc,
+         llvm::StringRef Description, clang::DiagnosticIDs::Level Level);
+  void addArgument(ExportedDiagnostic &Diag, std::string Text) {
+    Diag.Args.push_back(std::move(Text));
+  }
+  void addFixIt(ExportedDiagnostic &Diag, const clang::FixItHint &Hint);
+  void addSuggestion(ExportedDiagnostic &Diag, Suggestion S) {
+    Diag.Suggested = std::move(S);
+  }
+  void commit(std::unique_ptr<ExportedDiagnostic> Diag);
+
+private:
+  std::optional<ExportedLoc> resolve(clang::SourceLocation Loc) const;
+  std::string fingerprint(const ExportedDiagnostic &Diag) const;
+  void write(const ExportedDiagnostic &Diag);
+  void writeSarifResult(llvm::json::OStream &J, const ExportedDiagnostic &D);
+  void writeRecord(llvm::json::OStream &J, const ExportedDiagnostic &D);
+
+  std::string Path;
+  std::string TmpPath;
+  ExportFormat Format;
+  std::string Root;
+
+  const clang::SourceManager *SM = nullptr;
+  const clang::LangOptions *LangOpts = nullptr;
+  clang::ASTContext *Ctx = nullptr;
+
+  std::unique_ptr<llvm::raw_fd_ostream> OS;
+  /// The document stream for SARIF; NDJSON uses one stream per line.
+  std::unique_ptr<llvm::json::OStream> Sarif;
+  /// The last warning of each check, waiting for its notes.
+  std::vector<std::unique_ptr<ExportedDiagnostic>> Open;
+};
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_DIAGNOSTIC_EXPORT_H
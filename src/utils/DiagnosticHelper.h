@@ -18,18 +18,36 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Twine.h"
 
+#include <string>
+#include <vector>
+
 namespace hl {
 namespace tidy {
 namespace utils {
 
-/// Build a note string of the form:
+/// A replacement recommended by a note, carried through HlDiag into the
+/// structured export and the result cache.
+struct Suggestion {
+  std::string Alternative;
+  /// Standard the alternative needs, e.g. "C++23"; empty if none is named.
+  std::string Since;
+};
+
+/// The text of a note together with the replacement it recommends.  Emit it
+/// as `diag(Loc, N.Message, clang::DiagnosticIDs::Note) << N.Suggested`.
+struct SuggestionNote {
+  std::string Message;
+  Suggestion Suggested;
+};
+
+/// Build a note of the form:
 ///   "consider using <Alternative> (available since <Standard>)"
 /// when the translation unit is compiled with at least that standard.
-inline std::string
+inline SuggestionNote
 buildReplacementNote(llvm::StringRef Alternative, CppStandard Since,
                      CppStandard Current) {
-  std::string Msg;
-  llvm::raw_string_ostream OS(Msg);
+  SuggestionNote Note;
+  llvm::raw_string_ostream OS(Note.Message);
   if (hasAtLeast(Current, Since)) {
     OS << "consider using " << Alternative
        << " (available since " << standardLabel(Since) << ")";
@@ -38,19 +56,52 @@ buildReplacementNote(llvm::StringRef Alternative, CppStandard Since,
        << standardLabel(Since) << "; current standard is "
        << standardLabel(Current);
   }
-  return Msg;
+  OS.flush();
+  Note.Suggested = {Alternative.str(), standardLabel(Since).str()};
+  return Note;
 }
 
 /// Build a note that simply recommends a replacement without standard
 /// constraints.
-inline std::string buildSimpleNote(llvm::StringRef Alternative,
-                                   llvm::StringRef Reason = "") {
-  std::string Msg;
-  llvm::raw_string_ostream OS(Msg);
+inline SuggestionNote buildSimpleNote(llvm::StringRef Alternative,
+                                      llvm::StringRef Reason = "") {
+  SuggestionNote Note;
+  llvm::raw_string_ostream OS(Note.Message);
   OS << "consider using " << Alternative;
   if (!Reason.empty())
     OS << " (" << Reason << ")";
-  return Msg;
+  OS.flush();
+  Note.Suggested = {Alternative.str(), ""};
+  return Note;
+}
+
+/// Expand the %N placeholders of \p Description with \p Args, as the
+/// diagnostic engine does for the plain string and integer arguments the
+/// hl-* checks stream.
+inline std::string formatDescription(llvm::StringRef Description,
+                                     const std::vector<std::string> &Args) {
+  std::string Out;
+  while (!Description.empty()) {
+    size_t Pos = Description.find('%');
+    Out += Description.take_front(Pos);
+    if (Pos == llvm::StringRef::npos)
+      break;
+    Description = Description.drop_front(Pos + 1);
+    if (Description.consume_front("%")) {
+      Out += '%';
+      continue;
+    }
+    unsigned Index = 0;
+    llvm::StringRef Digits =
+        Description.take_while([](char C) { return C >= '0' && C <= '9'; });
+    if (!Digits.empty() && !Digits.getAsInteger(10, Index) &&
+        Index < Args.size())
+      Out += Args[Index];
+    else
+      Out += ("%" + Digits).str();
+    Description = Description.drop_front(Digits.size());
+  }
+  return Out;
 }
 
 } // namespace utils
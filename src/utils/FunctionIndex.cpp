@@ -0,0 +1,112 @@
+//===--- FunctionIndex.cpp - Enclosing function of a location ---*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "FunctionIndex.h"
+#include "Profile.h"
+#include "TranslationUnitCache.h"
+
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+
+#include <algorithm>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+namespace {
+
+class FunctionCollector : public clang::RecursiveASTVisitor<FunctionCollector> {
+public:
+  explicit FunctionCollector(
+      std::vector<const clang::FunctionDecl *> &Functions)
+      : Functions(Functions) {}
+
+  bool VisitFunctionDecl(clang::FunctionDecl *FD) {
+    if (FD->isImplicit() || !FD->doesThisDeclarationHaveABody())
+      return true;
+    if (const auto *MD = llvm::dyn_cast<clang::CXXMethodDecl>(FD))
+      if (MD->getParent()->isLambda())
+        return true;
+    Functions.push_back(FD);
+    return true;
+  }
+
+private:
+  std::vector<const clang::FunctionDecl *> &Functions;
+};
+
+} // namespace
+
+FunctionIndex::FunctionIndex(clang::ASTContext &Ctx)
+    : SM(Ctx.getSourceManager()),
+      Mangler(std::make_unique<clang::ASTNameGenerator>(Ctx)) {
+  // The whole TU rather than the traversal scope: a result-cache hit empties
+  // the scope before the replayed diagnostics are weighted.
+  std::vector<const clang::FunctionDecl *> Functions;
+  FunctionCollector Collector(Functions);
+  for (clang::Decl *D : Ctx.getTranslationUnitDecl()->decls())
+    Collector.TraverseDecl(D);
+
+  for (const clang::FunctionDecl *FD : Functions) {
+    clang::SourceRange R = FD->getSourceRange();
+    auto Begin = SM.getDecomposedLoc(SM.getExpansionLoc(R.getBegin()));
+    auto End = SM.getDecomposedLoc(SM.getExpansionLoc(R.getEnd()));
+    if (Begin.first.isInvalid() || Begin.first != End.first)
+      continue;
+    Ranges[Begin.first].push_back({Begin.second, End.second, FD});
+  }
+  for (auto &Entry : Ranges)
+    std::stable_sort(Entry.second.begin(), Entry.second.end(),
+                     [](const Range &A, const Range &B) {
+                       return A.Begin < B.Begin;
+                     });
+}
+
+FunctionIndex::~FunctionIndex() = default;
+
+const FunctionIndex &FunctionIndex::get(clang::ASTContext &Ctx) {
+  return getPerTU<FunctionIndex>(Ctx);
+}
+
+const clang::FunctionDecl *
+FunctionIndex::enclosing(clang::SourceLocation Loc) const {
+  if (Loc.isInvalid())
+    return nullptr;
+  auto [FID, Offset] = SM.getDecomposedLoc(SM.getExpansionLoc(Loc));
+  auto It = Ranges.find(FID);
+  if (It == Ranges.end())
+    return nullptr;
+  const std::vector<Range> &InFile = It->second;
+  auto After = std::upper_bound(
+      InFile.begin(), InFile.end(), Offset,
+      [](unsigned Off, const Range &R) { return Off < R.Begin; });
+  // Nested definitions start later, so the first range that still contains
+  // the offset, walking backwards, is the innermost one.
+  while (After != InFile.begin()) {
+    --After;
+    if (After->End >= Offset)
+      return After->FD;
+  }
+  return nullptr;
+}
+
+std::vector<std::string>
+FunctionIndex::profileNames(const clang::FunctionDecl *FD) const {
+  std::vector<std::string> Names;
+  if (!FD->isDependentContext()) {
+    if (llvm::isa<clang::CXXConstructorDecl>(FD) ||
+        llvm::isa<clang::CXXDestructorDecl>(FD)) {
+      for (const std::string &Name : Mangler->getAllManglings(FD))
+        Names.push_back(Profile::normalizeName(Name));
+    } else {
+      Names.push_back(Profile::normalizeName(Mangler->getName(FD)));
+    }
+  }
+  Names.push_back(Profile::normalizeName(FD->getQualifiedNameAsString()));
+  return Names;
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
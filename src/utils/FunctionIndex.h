@@ -0,0 +1,69 @@
+//===--- FunctionIndex.h - Enclosing function of a location -----*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// Module-wide features that weigh a finding by the function it is in (see
+// Profile.h) only have the diagnostic location to go on.  FunctionIndex
+// records the source range of every function definition in the TU once, by
+// file and offset, and answers "which function contains this location?" with
+// a binary search.
+//
+// Lambdas are not indexed: their bodies are attributed to the enclosing
+// function, as profilers do once the lambda is inlined.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_FUNCTION_INDEX_H
+#define HL_TIDY_UTILS_FUNCTION_INDEX_H
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Decl.h"
+#include "clang/AST/Mangle.h"
+#include "clang/Basic/SourceLocation.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+class FunctionIndex {
+public:
+  /// Index every function definition in the TU owning \p Ctx.
+  explicit FunctionIndex(clang::ASTContext &Ctx);
+  ~FunctionIndex();
+
+  /// Shared per-TU instance; built on first use.
+  static const FunctionIndex &get(clang::ASTContext &Ctx);
+
+  /// Innermost function definition whose source range, signature included,
+  /// contains the expansion location of \p Loc.
+  const clang::FunctionDecl *enclosing(clang::SourceLocation Loc) const;
+
+  /// The names a profile may use for \p FD, normalized with
+  /// Profile::normalizeName(): its mangled names, when it is not a
+  /// template, and its qualified name.
+  std::vector<std::string> profileNames(const clang::FunctionDecl *FD) const;
+
+private:
+  struct Range {
+    unsigned Begin;
+    unsigned End;
+    const clang::FunctionDecl *FD;
+  };
+
+  const clang::SourceManager &SM;
+  /// Sorted by Begin.
+  llvm::DenseMap<clang::FileID, std::vector<Range>> Ranges;
+  std::unique_ptr<clang::ASTNameGenerator> Mangler;
+};
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_FUNCTION_INDEX_H
@@ -0,0 +1,329 @@
+//===--- HotPath.cpp - Annotated hot paths and their callees ----*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "HotPath.h"
+#include "FunctionIndex.h"
+#include "ModuleOptions.h"
+#include "TranslationUnitCache.h"
+
+#include "clang/AST/Attr.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Index/USRGeneration.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+#include <vector>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+namespace {
+
+bool isLambdaCallOperator(const clang::FunctionDecl *FD) {
+  const auto *MD = llvm::dyn_cast<clang::CXXMethodDecl>(FD);
+  return MD && MD->getParent()->isLambda();
+}
+
+template <typename AttrT> bool anyRedeclHas(const clang::FunctionDecl *FD) {
+  for (const clang::FunctionDecl *R : FD->redecls())
+    if (R->hasAttr<AttrT>())
+      return true;
+  return false;
+}
+
+bool isAnnotatedHot(const clang::FunctionDecl *FD) {
+  if (anyRedeclHas<clang::HotAttr>(FD))
+    return true;
+  for (const clang::FunctionDecl *R : FD->redecls())
+    for (const auto *A : R->specific_attrs<clang::AnnotateAttr>())
+      if (A->getAnnotation() == "hl::hot")
+        return true;
+  return false;
+}
+
+/// Records, for every function definition, the functions its body refers
+/// to.  Lambda bodies belong to the enclosing function.
+class CallGraphBuilder : public clang::RecursiveASTVisitor<CallGraphBuilder> {
+  using Base = clang::RecursiveASTVisitor<CallGraphBuilder>;
+
+public:
+  using Graph = llvm::DenseMap<const clang::FunctionDecl *,
+                               llvm::SmallVector<const clang::FunctionDecl *, 8>>;
+
+  explicit CallGraphBuilder(const llvm::Regex *Names) : Names(Names) {}
+
+  /// Walk every declaration of the TU owning \p Ctx.  As for FunctionIndex,
+  /// the traversal scope is not used: callees may live outside it.
+  void build(clang::ASTContext &Ctx) {
+    for (clang::Decl *D : Ctx.getTranslationUnitDecl()->decls())
+      TraverseDecl(D);
+  }
+
+  // Calls in templates are only resolved in their instantiations.
+  bool shouldVisitTemplateInstantiations() const { return true; }
+
+  bool TraverseDecl(clang::Decl *D) {
+    auto *FD = llvm::dyn_cast_or_null<clang::FunctionDecl>(D);
+    if (!FD || isLambdaCallOperator(FD) ||
+        !FD->doesThisDeclarationHaveABody())
+      return Base::TraverseDecl(D);
+    const clang::FunctionDecl *Key = HotPathSet::key(FD);
+    // Every instantiation of a template maps to the same key.
+    if (Callees.try_emplace(Key).second) {
+      Definitions.push_back(Key);
+      if (isRoot(FD))
+        Roots.push_back(Key);
+    }
+    const clang::FunctionDecl *Saved = Current;
+    Current = Key;
+    bool Result = Base::TraverseDecl(D);
+    Current = Saved;
+    return Result;
+  }
+
+  bool VisitDeclRefExpr(clang::DeclRefExpr *E) {
+    if (const auto *FD = llvm::dyn_cast<clang::FunctionDecl>(E->getDecl()))
+      addCallee(FD);
+    return true;
+  }
+
+  bool VisitMemberExpr(clang::MemberExpr *E) {
+    if (const auto *FD =
+            llvm::dyn_cast<clang::FunctionDecl>(E->getMemberDecl()))
+      addCallee(FD);
+    return true;
+  }
+
+  bool VisitCXXConstructExpr(clang::CXXConstructExpr *E) {
+    addCallee(E->getConstructor());
+    return true;
+  }
+
+  /// Callees of every definition, keyed by HotPathSet::key().
+  Graph Callees;
+  /// Keys of the definitions, in TU order.
+  std::vector<const clang::FunctionDecl *> Definitions;
+  /// Keys of the definitions that are roots.
+  std::vector<const clang::FunctionDecl *> Roots;
+
+private:
+  bool isRoot(const clang::FunctionDecl *FD) const {
+    if (isAnnotatedHot(FD))
+      return true;
+    return Names && !FD->isImplicit() &&
+           Names->match(FD->getQualifiedNameAsString());
+  }
+
+  void addCallee(const clang::FunctionDecl *FD) {
+    if (Current && FD)
+      Callees[Current].push_back(HotPathSet::key(FD));
+  }
+
+  const llvm::Regex *Names;
+  const clang::FunctionDecl *Current = nullptr;
+};
+
+/// USR of \p FD, the name the cross-TU index knows it by; empty if clang
+/// cannot name it.
+std::string usrOf(const clang::FunctionDecl *FD) {
+  llvm::SmallString<128> USR;
+  if (clang::index::generateUSRForDecl(FD, USR))
+    return {};
+  return std::string(USR);
+}
+
+/// Writes the phase-one summary of a TU when constructed, so that the first
+/// check to see the TU does it and the others find it done.
+struct SummaryWriter {
+  SummaryWriter(clang::ASTContext &Ctx, llvm::StringRef Dir,
+                const llvm::Regex *Names, const Profile *Samples,
+                double HotProfileThreshold) {
+    const clang::SourceManager &SM = Ctx.getSourceManager();
+    clang::OptionalFileEntryRef Main =
+        SM.getFileEntryRefForID(SM.getMainFileID());
+    if (!Main)
+      return;
+    llvm::SmallString<256> MainPath(Main->getName());
+    llvm::sys::fs::make_absolute(MainPath);
+    // The hash keeps equally named files in different directories apart.
+    llvm::SmallString<256> Path(Dir);
+    llvm::sys::path::append(
+        Path, llvm::sys::path::filename(MainPath) + "." +
+                  llvm::utohexstr(llvm::xxHash64(MainPath)) + ".hlsum");
+    if (llvm::sys::fs::create_directories(Dir) ||
+        !utils::writeSummary(Path, HotPathSet::summarize(
+                                       Ctx, Names, Samples,
+                                       HotProfileThreshold)))
+      llvm::errs() << "hl-module.SummaryDir: cannot write '" << Path << "'\n";
+  }
+};
+
+clang::DiagnosticIDs::Level parseLevel(llvm::StringRef Name,
+                                       clang::DiagnosticIDs::Level Default) {
+  Name = Name.trim();
+  if (Name.equals_insensitive("error"))
+    return clang::DiagnosticIDs::Error;
+  if (Name.equals_insensitive("warning"))
+    return clang::DiagnosticIDs::Warning;
+  if (Name.equals_insensitive("remark"))
+    return clang::DiagnosticIDs::Remark;
+  if (Name.equals_insensitive("ignore") || Name.equals_insensitive("none"))
+    return clang::DiagnosticIDs::Ignored;
+  return Default;
+}
+
+} // namespace
+
+const clang::FunctionDecl *HotPathSet::key(const clang::FunctionDecl *FD) {
+  if (const clang::FunctionDecl *Pattern =
+          FD->getTemplateInstantiationPattern())
+    FD = Pattern;
+  return FD->getCanonicalDecl();
+}
+
+HotPathSet::HotPathSet(clang::ASTContext &Ctx, const llvm::Regex *Names,
+                       const HotIndex *Index) {
+  CallGraphBuilder Builder(Names);
+  Builder.build(Ctx);
+
+  std::vector<const clang::FunctionDecl *> Worklist;
+  for (const clang::FunctionDecl *Root : Builder.Roots) {
+    Roots.try_emplace(Root, Strings.save(Root->getQualifiedNameAsString()));
+    Worklist.push_back(Root);
+  }
+  // Functions the index marks as hot continue the path of their root in
+  // another TU.
+  if (Index)
+    for (const clang::FunctionDecl *FD : Builder.Definitions) {
+      if (Roots.count(FD))
+        continue;
+      std::string USR = usrOf(FD);
+      if (USR.empty())
+        continue;
+      if (std::optional<llvm::StringRef> Root = Index->rootOf(USR)) {
+        Roots.try_emplace(FD, Strings.save(*Root));
+        Worklist.push_back(FD);
+      }
+    }
+
+  while (!Worklist.empty()) {
+    const clang::FunctionDecl *Caller = Worklist.back();
+    Worklist.pop_back();
+    auto It = Builder.Callees.find(Caller);
+    if (It == Builder.Callees.end())
+      continue;
+    llvm::StringRef Root = Roots.lookup(Caller);
+    for (const clang::FunctionDecl *Callee : It->second) {
+      if (anyRedeclHas<clang::ColdAttr>(Callee))
+        continue;
+      if (Roots.try_emplace(Callee, Root).second)
+        Worklist.push_back(Callee);
+    }
+  }
+}
+
+const HotPathSet &HotPathSet::get(clang::ASTContext &Ctx,
+                                  const llvm::Regex *Names,
+                                  const HotIndex *Index) {
+  return getPerTU<HotPathSet>(Ctx, Names, Index);
+}
+
+std::optional<llvm::StringRef>
+HotPathSet::rootOf(const clang::FunctionDecl *FD) const {
+  auto It = Roots.find(key(FD));
+  if (It == Roots.end())
+    return std::nullopt;
+  return It->second;
+}
+
+std::vector<FunctionSummary>
+HotPathSet::summarize(clang::ASTContext &Ctx, const llvm::Regex *Names,
+                      const Profile *Samples, double HotProfileThreshold) {
+  CallGraphBuilder Builder(Names);
+  Builder.build(Ctx);
+  llvm::DenseSet<const clang::FunctionDecl *> Roots(Builder.Roots.begin(),
+                                                    Builder.Roots.end());
+  const FunctionIndex *Functions = Samples ? &FunctionIndex::get(Ctx) : nullptr;
+
+  std::vector<FunctionSummary> Summary;
+  Summary.reserve(Builder.Definitions.size());
+  for (const clang::FunctionDecl *FD : Builder.Definitions) {
+    std::string USR = usrOf(FD);
+    if (USR.empty())
+      continue;
+    FunctionSummary &F = Summary.emplace_back();
+    F.USR = std::move(USR);
+    F.Name = FD->getQualifiedNameAsString();
+    if (Roots.count(FD))
+      F.Flags |= FunctionSummary::Root;
+    if (anyRedeclHas<clang::ColdAttr>(FD))
+      F.Flags |= FunctionSummary::Cold;
+    if (Samples &&
+        Samples->hotness(Functions->profileNames(FD)).value_or(0.0) >=
+            HotProfileThreshold)
+      F.Flags |= FunctionSummary::Profiled;
+    llvm::DenseSet<const clang::FunctionDecl *> Seen;
+    for (const clang::FunctionDecl *Callee : Builder.Callees.lookup(FD)) {
+      if (!Seen.insert(Callee).second)
+        continue;
+      std::string CalleeUSR = usrOf(Callee);
+      if (!CalleeUSR.empty())
+        F.Callees.push_back(std::move(CalleeUSR));
+    }
+  }
+  return Summary;
+}
+
+HotPathScope::HotPathScope(const clang::tidy::ClangTidyContext &Context)
+    : Names(getModuleRegex(Context, "HotFunctions")),
+      SummaryDir(getModuleOption(Context, "SummaryDir", "")) {
+  std::string IndexPath = getModuleOption(Context, "HotIndex", "");
+  if (!IndexPath.empty())
+    Index = HotIndex::acquire(IndexPath);
+  Enabled = Names || Index || getModuleFlag(Context, "HotPathScoping", false);
+  HotLevel = parseLevel(getModuleOption(Context, "HotPathLevel", ""),
+                        clang::DiagnosticIDs::Warning);
+  ColdLevel = parseLevel(getModuleOption(Context, "ColdPathLevel", ""),
+                         clang::DiagnosticIDs::Remark);
+  std::string Threshold = getModuleOption(Context, "HotProfileThreshold", "");
+  if (!Threshold.empty() &&
+      llvm::StringRef(Threshold).trim().getAsDouble(HotProfileThreshold))
+    HotProfileThreshold = 1.0;
+}
+
+void HotPathScope::writeSummary(clang::ASTContext &Ctx,
+                                const Profile *Samples) const {
+  if (!writesSummary())
+    return;
+  getPerTU<SummaryWriter>(Ctx, llvm::StringRef(SummaryDir),
+                          Names ? &*Names : nullptr, Samples,
+                          HotProfileThreshold);
+}
+
+clang::DiagnosticIDs::Level
+HotPathScope::classify(clang::ASTContext &Ctx, clang::SourceLocation Loc,
+                       clang::DiagnosticIDs::Level Level,
+                       std::optional<std::string> &Root) const {
+  const clang::FunctionDecl *FD = FunctionIndex::get(Ctx).enclosing(Loc);
+  if (!FD)
+    return Level;
+  std::optional<llvm::StringRef> HotRoot =
+      HotPathSet::get(Ctx, Names ? &*Names : nullptr, Index.get()).rootOf(FD);
+  if (!HotRoot)
+    return ColdLevel;
+  Root = HotRoot->str();
+  return HotLevel;
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
@@ -0,0 +1,138 @@
+//===--- HotPath.h - Annotated hot paths and their callees ------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// A std::regex built once at startup costs nothing; the same regex built per
+// request is the outage.  Hot-path scoping lets a project mark its entry
+// points and have the checks that care about it (see
+// HlTidyCheck::isHotPathScoped()) report differently inside and outside the
+// code those entry points reach.
+//
+// Roots of the hot set are functions
+//   - declared `[[gnu::hot]]`,
+//   - declared `[[clang::annotate("hl::hot")]]`, or
+//   - whose qualified name matches `hl-module.HotFunctions`, e.g.
+//     `(^|::)handle[A-Z]`.  The name has no leading `::`, so a free
+//     function is matched from `^`.
+//
+// HotPathSet builds the call graph of the TU once: every function, method and
+// constructor a definition calls or takes the address of, with lambda bodies
+// counting as part of the function around them and template instantiations
+// as part of their pattern.  Hotness is propagated from the roots to all
+// transitive callees defined in the TU, except through `[[gnu::cold]]`
+// functions.  Calls through virtual functions and function pointers are not
+// followed past the declaration that is named.
+//
+// With `hl-module.HotIndex` set, functions the cross-TU index (see
+// SummaryIndex.h) marks as hot are roots too, so hotness that entered
+// through a handler in another TU continues here.  With `hl-module.SummaryDir`
+// set, each TU writes its phase-one summary for that index.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_HOT_PATH_H
+#define HL_TIDY_UTILS_HOT_PATH_H
+
+#include "Profile.h"
+#include "SummaryIndex.h"
+
+#include "clang-tidy/ClangTidyDiagnosticConsumer.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Decl.h"
+#include "clang/Basic/DiagnosticIDs.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Regex.h"
+#include "llvm/Support/StringSaver.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+/// The functions of one TU that are reachable from a hot root.
+class HotPathSet {
+public:
+  /// Build the call graph of the TU owning \p Ctx and propagate hotness
+  /// from the annotated roots, functions matching \p Names and functions
+  /// \p Index marks as hot; the last two may be null.
+  HotPathSet(clang::ASTContext &Ctx, const llvm::Regex *Names,
+             const HotIndex *Index);
+
+  /// Shared per-TU instance; built on first use.
+  static const HotPathSet &get(clang::ASTContext &Ctx,
+                               const llvm::Regex *Names,
+                               const HotIndex *Index);
+
+  /// Name of the root \p FD is reached from (its own for a root), or
+  /// nullopt if \p FD is not on a hot path.
+  std::optional<llvm::StringRef>
+  rootOf(const clang::FunctionDecl *FD) const;
+
+  /// The declaration calls are keyed by: the template pattern of an
+  /// instantiation, canonicalized.
+  static const clang::FunctionDecl *key(const clang::FunctionDecl *FD);
+
+  /// The phase-one summary of the functions defined in the TU owning
+  /// \p Ctx.  Functions with at least \p HotProfileThreshold percent of
+  /// \p Samples, when given, are marked as profiled.
+  static std::vector<FunctionSummary>
+  summarize(clang::ASTContext &Ctx, const llvm::Regex *Names,
+            const Profile *Samples, double HotProfileThreshold);
+
+private:
+  /// Hot function -> name of the root it was first reached from.
+  llvm::DenseMap<const clang::FunctionDecl *, llvm::StringRef> Roots;
+  llvm::BumpPtrAllocator Alloc;
+  llvm::StringSaver Strings{Alloc};
+};
+
+/// The hl-module options of hot-path scoping, read by every check.
+class HotPathScope {
+public:
+  explicit HotPathScope(const clang::tidy::ClangTidyContext &Context);
+
+  /// True if `hl-module.HotPathScoping` is set, or `hl-module.HotFunctions`
+  /// or `hl-module.HotIndex` name roots.
+  bool isEnabled() const { return Enabled; }
+
+  /// Level at which a warning at \p Loc is reported: `HotPathLevel` inside
+  /// the hot set, with the root it is reached from stored in \p Root, and
+  /// `ColdPathLevel` outside it.  Ignored means the warning is dropped.
+  /// Code outside any function keeps \p Level.
+  clang::DiagnosticIDs::Level classify(clang::ASTContext &Ctx,
+                                       clang::SourceLocation Loc,
+                                       clang::DiagnosticIDs::Level Level,
+                                       std::optional<std::string> &Root) const;
+
+  /// True if `hl-module.SummaryDir` is set.
+  bool writesSummary() const { return !SummaryDir.empty(); }
+
+  /// Write the phase-one summary of the TU owning \p Ctx into SummaryDir.
+  /// Only the first call for a TU does work.
+  void writeSummary(clang::ASTContext &Ctx, const Profile *Samples) const;
+
+  /// The cross-TU index, or null without `hl-module.HotIndex`.
+  const HotIndex *index() const { return Index.get(); }
+
+private:
+  bool Enabled = false;
+  std::optional<llvm::Regex> Names;
+  std::shared_ptr<const HotIndex> Index;
+  clang::DiagnosticIDs::Level HotLevel = clang::DiagnosticIDs::Warning;
+  clang::DiagnosticIDs::Level ColdLevel = clang::DiagnosticIDs::Remark;
+
+  std::string SummaryDir;
+  double HotProfileThreshold = 1.0;
+};
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_HOT_PATH_H
@@ -0,0 +1,146 @@
+//===--- LoopContext.cpp - Shared loop nesting index -------------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "LoopContext.h"
+#include "TranslationUnitCache.h"
+
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include <algorithm>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+namespace {
+
+/// Single pass over the TU that maintains a stack of the loops enclosing the
+/// current node and records it for every statement below a loop.
+class LoopIndexer : public clang::RecursiveASTVisitor<LoopIndexer> {
+  using Base = clang::RecursiveASTVisitor<LoopIndexer>;
+
+public:
+  explicit LoopIndexer(llvm::DenseMap<const clang::Stmt *, LoopInfo> &Info)
+      : Info(Info) {}
+
+  // Mirror what the AST matchers see, so that any node a check matches has
+  // an entry here.
+  bool shouldVisitTemplateInstantiations() const { return true; }
+  bool shouldVisitImplicitCode() const { return true; }
+
+  bool VisitStmt(clang::Stmt *S) {
+    record(S);
+    return true;
+  }
+
+  bool TraverseDecl(clang::Decl *D) {
+    if (!D || !(llvm::isa<clang::FunctionDecl>(D) ||
+                llvm::isa<clang::BlockDecl>(D)))
+      return Base::TraverseDecl(D);
+    FreshScope Scope(*this);
+    return Base::TraverseDecl(D);
+  }
+
+  bool TraverseLambdaExpr(clang::LambdaExpr *E) {
+    record(E);
+    FreshScope Scope(*this);
+    return Base::TraverseLambdaExpr(E);
+  }
+
+  bool TraverseForStmt(clang::ForStmt *S) {
+    record(S);
+    if (!TraverseStmt(S->getInit()))
+      return false;
+    LoopScope Scope(*this, S);
+    return TraverseStmt(S->getConditionVariableDeclStmt()) &&
+           TraverseStmt(S->getCond()) && TraverseStmt(S->getInc()) &&
+           TraverseStmt(S->getBody());
+  }
+
+  bool TraverseWhileStmt(clang::WhileStmt *S) {
+    record(S);
+    LoopScope Scope(*this, S);
+    return TraverseStmt(S->getConditionVariableDeclStmt()) &&
+           TraverseStmt(S->getCond()) && TraverseStmt(S->getBody());
+  }
+
+  bool TraverseDoStmt(clang::DoStmt *S) {
+    record(S);
+    LoopScope Scope(*this, S);
+    return TraverseStmt(S->getBody()) && TraverseStmt(S->getCond());
+  }
+
+  bool TraverseCXXForRangeStmt(clang::CXXForRangeStmt *S) {
+    record(S);
+    if (!TraverseStmt(S->getInit()) || !TraverseStmt(S->getRangeStmt()) ||
+        !TraverseStmt(S->getBeginStmt()) || !TraverseStmt(S->getEndStmt()))
+      return false;
+    LoopScope Scope(*this, S);
+    return TraverseStmt(S->getCond()) && TraverseStmt(S->getInc()) &&
+           TraverseStmt(S->getLoopVarStmt()) && TraverseStmt(S->getBody());
+  }
+
+private:
+  struct LoopScope {
+    LoopScope(LoopIndexer &V, const clang::Stmt *Loop) : V(V) {
+      V.Stack.push_back(Loop);
+    }
+    ~LoopScope() { V.Stack.pop_back(); }
+    LoopIndexer &V;
+  };
+
+  struct FreshScope {
+    explicit FreshScope(LoopIndexer &V) : V(V), Saved(std::move(V.Stack)) {
+      V.Stack.clear();
+    }
+    ~FreshScope() { V.Stack = std::move(Saved); }
+    LoopIndexer &V;
+    llvm::SmallVector<const clang::Stmt *, 4> Saved;
+  };
+
+  void record(const clang::Stmt *S) {
+    if (!S || Stack.empty())
+      return;
+    Info[S] = LoopInfo{Stack.back(), static_cast<unsigned>(Stack.size())};
+  }
+
+  llvm::DenseMap<const clang::Stmt *, LoopInfo> &Info;
+  llvm::SmallVector<const clang::Stmt *, 4> Stack;
+};
+
+} // namespace
+
+LoopContext::LoopContext(clang::ASTContext &Ctx) {
+  LoopIndexer(Info).TraverseAST(Ctx);
+}
+
+unsigned LoopContext::depthAt(clang::SourceLocation Loc) const {
+  if (!LocDepth) {
+    LocDepth.emplace();
+    auto Note = [&](clang::SourceLocation L, unsigned Depth) {
+      if (L.isInvalid())
+        return;
+      unsigned &Slot = (*LocDepth)[L];
+      Slot = std::max(Slot, Depth);
+    };
+    for (const auto &Entry : Info) {
+      const clang::Stmt *S = Entry.first;
+      Note(S->getBeginLoc(), Entry.second.Depth);
+      if (const auto *E = llvm::dyn_cast<clang::Expr>(S))
+        Note(E->getExprLoc(), Entry.second.Depth);
+      if (const auto *DS = llvm::dyn_cast<clang::DeclStmt>(S))
+        for (const clang::Decl *D : DS->decls())
+          Note(D->getLocation(), Entry.second.Depth);
+    }
+  }
+  return LocDepth->lookup(Loc);
+}
+
+const LoopContext &LoopContext::get(clang::ASTContext &Ctx) {
+  return getPerTU<LoopContext>(Ctx);
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
@@ -0,0 +1,82 @@
+//===--- LoopContext.h - Shared loop nesting index ---------------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// Answers "is this statement executed once per loop iteration, and how deeply
+// nested is it?" in O(1).
+//
+// Checks used to express this as `forStmt(hasDescendant(X))` and friends,
+// one matcher per loop kind.  That re-walks every loop body once per matcher
+// and once per enclosing loop, which is quadratic in nesting depth and
+// reports the same call once for each loop around it.  LoopContext instead
+// walks every function body exactly once per translation unit and records,
+// for each statement inside a loop, the innermost enclosing loop and the
+// nesting depth.  Checks match the interesting node directly and query the
+// index from check().
+//
+// Only the per-iteration parts of a loop count as "inside": the condition,
+// increment, range-for loop variable and body.  For-init statements and the
+// range expression of a range-for run once and are not considered in-loop.
+// Lambda, block and nested function bodies start a fresh context, since they
+// do not necessarily run on every iteration of the loop around them.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_LOOP_CONTEXT_H
+#define HL_TIDY_UTILS_LOOP_CONTEXT_H
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Stmt.h"
+#include "clang/Basic/SourceLocation.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include <optional>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+/// Loop nesting facts for a single statement.
+struct LoopInfo {
+  /// Innermost loop whose per-iteration part contains the statement.
+  const clang::Stmt *Loop = nullptr;
+  /// Number of enclosing loops within the same function; 0 = not in a loop.
+  unsigned Depth = 0;
+};
+
+class LoopContext {
+public:
+  /// Index every loop in the translation unit owning \p Ctx.
+  explicit LoopContext(clang::ASTContext &Ctx);
+
+  /// Shared per-TU instance; built on first use.
+  static const LoopContext &get(clang::ASTContext &Ctx);
+
+  LoopInfo lookup(const clang::Stmt *S) const {
+    auto It = Info.find(S);
+    return It == Info.end() ? LoopInfo() : It->second;
+  }
+
+  bool isInLoop(const clang::Stmt *S) const { return lookup(S).Depth != 0; }
+  unsigned depth(const clang::Stmt *S) const { return lookup(S).Depth; }
+  const clang::Stmt *innermostLoop(const clang::Stmt *S) const {
+    return lookup(S).Loop;
+  }
+
+  /// Loop depth of the statement, expression or local declaration that
+  /// starts at \p Loc, for code that only has a diagnostic location.  Built
+  /// on first use.
+  unsigned depthAt(clang::SourceLocation Loc) const;
+
+private:
+  llvm::DenseMap<const clang::Stmt *, LoopInfo> Info;
+  mutable std::optional<llvm::DenseMap<clang::SourceLocation, unsigned>>
+      LocDepth;
+};
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_LOOP_CONTEXT_H
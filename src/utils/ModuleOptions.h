@@ -0,0 +1,96 @@
+//===--- ModuleOptions.h - hl-module.* configuration options ----*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// Options that apply to the plugin as a whole rather than to one check live
+// under the "hl-module." prefix in CheckOptions:
+//
+//   CheckOptions:
+//     - key: hl-module.MetricsDir
+//       value: /tmp/hl-metrics
+//
+// They are read from the configuration in effect for the current file.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_MODULE_OPTIONS_H
+#define HL_TIDY_UTILS_MODULE_OPTIONS_H
+
+#include "clang-tidy/ClangTidyDiagnosticConsumer.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Regex.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <atomic>
+#include <optional>
+#include <string>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+/// Return the value of "hl-module.<Name>", if configured.
+inline std::optional<std::string>
+getModuleOption(const clang::tidy::ClangTidyContext &Context,
+                llvm::StringRef Name) {
+  llvm::SmallString<64> Key("hl-module.");
+  Key += Name;
+  const auto &Opts = Context.getOptions().CheckOptions;
+  auto It = Opts.find(Key);
+  if (It == Opts.end())
+    return std::nullopt;
+  return It->second.Value;
+}
+
+/// Return "hl-module.<Name>" as a string, or \p Default when unset.
+inline std::string getModuleOption(const clang::tidy::ClangTidyContext &Context,
+                                   llvm::StringRef Name,
+                                   llvm::StringRef Default) {
+  if (auto Value = getModuleOption(Context, Name))
+    return *Value;
+  return Default.str();
+}
+
+/// Return "hl-module.<Name>" parsed as a boolean ("true"/"false", "1"/"0"),
+/// or \p Default when unset or unparseable.
+inline bool getModuleFlag(const clang::tidy::ClangTidyContext &Context,
+                          llvm::StringRef Name, bool Default) {
+  auto Value = getModuleOption(Context, Name);
+  if (!Value)
+    return Default;
+  llvm::StringRef V = llvm::StringRef(*Value).trim();
+  if (V.equals_insensitive("true") || V == "1")
+    return true;
+  if (V.equals_insensitive("false") || V == "0")
+    return false;
+  return Default;
+}
+
+/// Compile "hl-module.<Name>" as a regex; empty or invalid patterns disable
+/// the option rather than matching everything or nothing.
+inline std::optional<llvm::Regex>
+getModuleRegex(const clang::tidy::ClangTidyContext &Context,
+               llvm::StringRef Name) {
+  std::string Pattern = getModuleOption(Context, Name, "");
+  if (Pattern.empty())
+    return std::nullopt;
+  llvm::Regex Re(Pattern);
+  std::string Error;
+  if (!Re.isValid(Error)) {
+    // Every check reads the options; complain once per process.
+    static std::atomic<bool> Reported{false};
+    if (!Reported.exchange(true))
+      llvm::errs() << "hl-module." << Name << ": invalid regex '" << Pattern
+                   << "': " << Error << "\n";
+    return std::nullopt;
+  }
+  return std::optional<llvm::Regex>(std::move(Re));
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_MODULE_OPTIONS_H
@@ -0,0 +1,315 @@
+//===--- Profile.cpp - Sample weight per function from a profile -*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "Profile.h"
+#include "ModuleOptions.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+namespace {
+
+constexpr llvm::StringLiteral AnonymousNamespace = "(anonymous namespace)";
+
+bool isInteger(llvm::StringRef Text) {
+  uint64_t Ignored;
+  return !Text.empty() && !Text.getAsInteger(10, Ignored);
+}
+
+/// Split "name:total:head" into name and total.
+std::optional<std::pair<llvm::StringRef, uint64_t>>
+splitNameAndTotal(llvm::StringRef Line, bool WithHead) {
+  llvm::StringRef Name = Line.trim();
+  if (WithHead) {
+    auto [Rest, Head] = Name.rsplit(':');
+    if (Rest == Name || !isInteger(Head))
+      return std::nullopt;
+    Name = Rest;
+  }
+  auto [Rest, TotalText] = Name.rsplit(':');
+  uint64_t Total = 0;
+  if (Rest == Name || Rest.empty() || TotalText.getAsInteger(10, Total))
+    return std::nullopt;
+  return std::make_pair(Rest, Total);
+}
+
+Profile::ProfileFormat detectFormat(llvm::StringRef Text) {
+  while (!Text.empty()) {
+    auto [Line, Rest] = Text.split('\n');
+    Text = Rest;
+    Line = Line.rtrim();
+    if (Line.empty())
+      continue;
+    if (Line.starts_with("#") || Line.starts_with(":"))
+      return Profile::LLVMProfdata;
+    if (!Line.starts_with(" ") && splitNameAndTotal(Line, true))
+      return Profile::AutoFDO;
+    return Profile::Folded;
+  }
+  return Profile::Folded;
+}
+
+Profile::ProfileFormat parseFormat(llvm::StringRef Name) {
+  Name = Name.trim();
+  if (Name.equals_insensitive("folded") || Name.equals_insensitive("perf"))
+    return Profile::Folded;
+  if (Name.equals_insensitive("llvm-profdata") ||
+      Name.equals_insensitive("instr"))
+    return Profile::LLVMProfdata;
+  if (Name.equals_insensitive("autofdo") || Name.equals_insensitive("sample"))
+    return Profile::AutoFDO;
+  return Profile::Auto;
+}
+
+} // namespace
+
+std::string Profile::normalizeName(llvm::StringRef Name) {
+  Name = Name.trim();
+  // stackcollapse-perf annotates kernel, JIT and inlined frames.
+  for (llvm::StringRef Suffix : {"_[k]", "_[j]", "_[i]", "_[w]"})
+    Name.consume_back(Suffix);
+  if (Name.starts_with("_Z"))
+    return Name.take_until([](char C) { return C == '.'; }).str();
+  Name = Name.take_front(Name.find(" [clone "));
+
+  std::string Out;
+  unsigned Angle = 0;
+  for (size_t I = 0; I < Name.size(); ++I) {
+    if (Name.substr(I).starts_with(AnonymousNamespace)) {
+      if (!Angle)
+        Out += AnonymousNamespace;
+      I += AnonymousNamespace.size() - 1;
+      continue;
+    }
+    char C = Name[I];
+    // operator<, operator<<, operator<=> are names, not argument lists.
+    if (C == '<' && llvm::StringRef(Out).ends_with("operator")) {
+      while (I < Name.size() && (Name[I] == '<' || Name[I] == '=' ||
+                                 Name[I] == '>'))
+        Out += Name[I++];
+      --I;
+      continue;
+    }
+    if (C == '<') {
+      ++Angle;
+      continue;
+    }
+    if (C == '>' && Angle) {
+      --Angle;
+      continue;
+    }
+    if (Angle)
+      continue;
+    // The parameter list ends the name; lambdas nested in a function are
+    // attributed to the function.
+    if (C == '(')
+      break;
+    if (C != ' ')
+      Out += C;
+  }
+  return Out;
+}
+
+void Profile::add(llvm::StringRef Name, uint64_t Weight) {
+  std::string Key = normalizeName(Name);
+  if (!Key.empty())
+    Weights[Key] += Weight;
+}
+
+std::unique_ptr<Profile> Profile::parse(llvm::StringRef Text,
+                                        ProfileFormat Format) {
+  if (Format == Auto)
+    Format = detectFormat(Text);
+  llvm::StringRef Contents = Text;
+  auto P = std::make_unique<Profile>();
+
+  switch (Format) {
+  case Auto:
+  case Folded: {
+    llvm::StringSet<> Seen;
+    while (!Text.empty()) {
+      auto [Line, Rest] = Text.split('\n');
+      Text = Rest;
+      auto [Stack, CountText] = Line.rtrim().rsplit(' ');
+      uint64_t Count = 0;
+      if (Stack.empty() || CountText.getAsInteger(10, Count))
+        continue;
+      P->Total += Count;
+      // Inclusive weight: a recursive function counts once per stack.
+      Seen.clear();
+      llvm::SmallVector<llvm::StringRef, 32> Frames;
+      Stack.split(Frames, ';', -1, false);
+      for (llvm::StringRef Frame : Frames) {
+        std::string Key = normalizeName(Frame);
+        if (!Key.empty() && Seen.insert(Key).second)
+          P->Weights[Key] += Count;
+      }
+    }
+    break;
+  }
+
+  case LLVMProfdata: {
+    // Records are separated by blank lines: the name, then "# Func Hash:",
+    // "# Num Counters:" and "# Counter Values:" each followed by their
+    // values, then optional value-profile data.
+    std::string Name;
+    uint64_t NumCounters = 0, Sum = 0;
+    llvm::StringRef Expect;
+    auto Flush = [&] {
+      if (!Name.empty()) {
+        P->add(Name, Sum);
+        P->Total += Sum;
+      }
+      Name.clear();
+      NumCounters = Sum = 0;
+      Expect = "";
+    };
+    while (!Text.empty()) {
+      auto [Line, Rest] = Text.split('\n');
+      Text = Rest;
+      Line = Line.trim();
+      if (Line.empty()) {
+        Flush();
+        continue;
+      }
+      if (Line.starts_with(":"))
+        continue;
+      if (Line.consume_front("#")) {
+        Expect = Line.trim();
+        continue;
+      }
+      if (Name.empty()) {
+        // Local functions are prefixed with their file: "a.cpp;_ZL3foov"
+        // or, before LLVM 17, "a.cpp:_ZL3foov".
+        llvm::StringRef N = Line.rsplit(';').second;
+        if (N.empty())
+          N = Line;
+        if (!N.contains("::") && N.contains(':'))
+          N = N.rsplit(':').second;
+        Name = N.str();
+      } else if (Expect == "Num Counters:") {
+        Line.getAsInteger(10, NumCounters);
+        Expect = "";
+      } else if (Expect == "Counter Values:" && NumCounters) {
+        uint64_t Value = 0;
+        if (!Line.getAsInteger(10, Value))
+          Sum += Value;
+        --NumCounters;
+      }
+    }
+    Flush();
+    break;
+  }
+
+  case AutoFDO: {
+    while (!Text.empty()) {
+      auto [Line, Rest] = Text.split('\n');
+      Text = Rest;
+      if (Line.trim().empty() || Line.trim().starts_with("!"))
+        continue;
+      if (!Line.starts_with(" ") && !Line.starts_with("\t")) {
+        // A top-level function: "name:total:head".
+        if (auto F = splitNameAndTotal(Line, true)) {
+          P->add(F->first, F->second);
+          P->Total += F->second;
+        }
+        continue;
+      }
+      // An inlined call site: "offset: name:total".  Sample lines have a
+      // count right after the offset instead.
+      llvm::StringRef Body = Line.trim().split(": ").second;
+      if (Body.empty() || isInteger(Body.split(' ').first))
+        continue;
+      if (auto F = splitNameAndTotal(Body, false))
+        P->add(F->first, F->second);
+    }
+    break;
+  }
+  }
+
+  if (!P->Total)
+    return nullptr;
+  llvm::raw_string_ostream(P->Digest)
+      << static_cast<unsigned>(Format) << '-'
+      << llvm::format_hex_no_prefix(llvm::xxHash64(Contents), 16);
+  return P;
+}
+
+std::optional<double>
+Profile::hotness(llvm::ArrayRef<std::string> Names) const {
+  uint64_t Weight = 0;
+  for (const std::string &Name : Names) {
+    auto It = Weights.find(Name);
+    if (It != Weights.end())
+      Weight = std::max(Weight, It->second);
+  }
+  if (!Weight || !Total)
+    return std::nullopt;
+  return 100.0 * static_cast<double>(Weight) / static_cast<double>(Total);
+}
+
+std::shared_ptr<const Profile>
+Profile::acquire(const clang::tidy::ClangTidyContext &Context) {
+  std::string Path = getModuleOption(Context, "ProfileFile", "");
+  if (Path.empty())
+    return nullptr;
+  ProfileFormat Format =
+      parseFormat(getModuleOption(Context, "ProfileFormat", "auto"));
+
+  struct Entry {
+    llvm::sys::TimePoint<> ModTime;
+    uint64_t Size = 0;
+    std::shared_ptr<const Profile> Loaded;
+  };
+  static std::mutex Mutex;
+  static llvm::StringMap<Entry> Loaded;
+
+  llvm::sys::fs::file_status Status;
+  bool Exists = !llvm::sys::fs::status(Path, Status);
+  std::string Key = Path + '\0' + std::to_string(Format);
+
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto It = Loaded.find(Key);
+  if (It != Loaded.end() &&
+      (!Exists || (It->second.ModTime == Status.getLastModificationTime() &&
+                   It->second.Size == Status.getSize())))
+    return It->second.Loaded;
+
+  Entry &Slot = Loaded[Key];
+  Slot.Loaded = nullptr;
+  if (Exists) {
+    Slot.ModTime = Status.getLastModificationTime();
+    Slot.Size = Status.getSize();
+  }
+  auto Buffer = llvm::MemoryBuffer::getFile(Path, /*IsText=*/true);
+  if (!Buffer) {
+    llvm::errs() << "hl-module.ProfileFile: cannot read '" << Path
+                 << "': " << Buffer.getError().message() << "\n";
+    return nullptr;
+  }
+  std::unique_ptr<Profile> Parsed =
+      parse((*Buffer)->getBuffer(), Format);
+  if (!Parsed) {
+    llvm::errs() << "hl-module.ProfileFile: no samples in '" << Path
+                 << "'\n";
+    return nullptr;
+  }
+  Slot.Loaded = std::move(Parsed);
+  return Slot.Loaded;
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
@@ -0,0 +1,86 @@
+//===--- Profile.h - Sample weight per function from a profile --*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// Most hl-perf-* findings sit in code that never runs hot, and a flat list of
+// them buries the few that do.  With `hl-module.ProfileFile` set, a local
+// profile is loaded once per process and every function is given a hotness:
+// its share of the profile's total weight, in percent.
+//
+// Three text formats are understood (`hl-module.ProfileFormat`, default
+// `auto`, which guesses from the first lines):
+//
+//   - `folded`: `perf script | stackcollapse-perf.pl` output, one
+//     `frame;frame;...;leaf <count>` line per stack.  A function's weight is
+//     the number of samples whose stack contains it (inclusive time);
+//   - `llvm-profdata`: `llvm-profdata merge --text` of an instrumentation
+//     profile.  A function's weight is the sum of its counters;
+//   - `autofdo`: `llvm-profdata merge --sample --text` or create_llvm_prof
+//     text output.  A function's weight is its total sample count, plus the
+//     samples of the call sites where it was inlined into others.
+//
+// Frames are matched by mangled name when the profile has one, and by
+// qualified name without parameter or template argument lists otherwise, so
+// overloads and instantiations of one function share its weight.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_PROFILE_H
+#define HL_TIDY_UTILS_PROFILE_H
+
+#include "clang-tidy/ClangTidyDiagnosticConsumer.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+class Profile {
+public:
+  enum ProfileFormat { Auto, Folded, LLVMProfdata, AutoFDO };
+
+  /// Parse \p Text in \p Format.  Returns null if nothing could be read.
+  static std::unique_ptr<Profile> parse(llvm::StringRef Text,
+                                        ProfileFormat Format);
+
+  /// Return the profile named by `hl-module.ProfileFile`, loading it on
+  /// first use in the process, or null when the option is unset or the file
+  /// cannot be read.  The result is shared by all TUs and threads.
+  static std::shared_ptr<const Profile>
+  acquire(const clang::tidy::ClangTidyContext &Context);
+
+  /// Hotness in percent of the function known by any of \p Names (see
+  /// FunctionIndex::profileNames()), or nullopt if the profile has no
+  /// samples for it.
+  std::optional<double> hotness(llvm::ArrayRef<std::string> Names) const;
+
+  /// Hash of the weights, for keys of caches whose results depend on them.
+  llvm::StringRef digest() const { return Digest; }
+
+  /// Reduce a profile frame or a declaration name to the form it is matched
+  /// by: mangled names lose compiler-added suffixes such as `.cold` or
+  /// `.llvm.1234`; demangled names lose parameter lists, template argument
+  /// lists and `[clone ...]` markers.
+  static std::string normalizeName(llvm::StringRef Name);
+
+private:
+  void add(llvm::StringRef Name, uint64_t Weight);
+
+  llvm::StringMap<uint64_t> Weights;
+  uint64_t Total = 0;
+  std::string Digest;
+};
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_PROFILE_H
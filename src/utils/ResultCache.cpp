@@ -0,0 +1,815 @@
+//===--- ResultCache.cpp - On-disk cache of hl-* diagnostics ----*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "ResultCache.h"
+#include "Coverage.h"
+#include "CppStandardUtils.h"
+#include "ModuleOptions.h"
+#include "Profile.h"
+#include "SummaryIndex.h"
+#include "TUSession.h"
+
+#include "clang-tidy/ClangTidyModule.h"
+#include "clang-tidy/ClangTidyModuleRegistry.h"
+#include "clang/Basic/TargetInfo.h"
+#include "clang/Basic/Version.h"
+#include "clang/Lex/PPCallbacks.h"
+#include "clang/Lex/PreprocessorOptions.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/ScopeExit.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+
+#ifndef HL_TIDY_VERSION
+#define HL_TIDY_VERSION "unknown"
+#endif
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+namespace {
+
+namespace endian = llvm::support::endian;
+namespace fs = llvm::sys::fs;
+
+// File layout:
+//
+//   "HLTCACHE" u32 FormatVersion u32 reserved
+//   record*
+//
+// Record layout; the checksum covers the key and the payload, so the
+// last-use time can be rewritten in place:
+//
+//   u32 RecordMagic, u32 payload size, u64 last use (seconds since epoch),
+//   u64 xxHash64 checksum, 16-byte key, payload
+//
+// The file never shrinks in place: readers map it without a lock, and
+// truncating pages under a mapping raises SIGBUS.  A torn tail is covered by
+// a record with a zero checksum that every reader skips, and a file with a
+// bad header is replaced by renaming a new one over it.
+constexpr llvm::StringLiteral FileMagic = "HLTCACHE";
+constexpr uint32_t FormatVersion = 3;
+constexpr size_t FileHeaderSize = 16;
+constexpr uint32_t RecordMagic = 0x52434c48; // "HLCR"
+constexpr size_t LastUsedOffset = 8;
+constexpr size_t ChecksumOffset = 16;
+constexpr size_t KeyOffset = 24;
+constexpr size_t RecordHeaderSize = KeyOffset + sizeof(CacheKey);
+
+constexpr uint64_t DefaultMaxSizeMB = 256;
+
+uint64_t now() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+std::string fileHeader() {
+  std::string Header = FileMagic.str();
+  char Buf[8];
+  endian::write32le(Buf, FormatVersion);
+  endian::write32le(Buf + 4, 0);
+  Header.append(Buf, sizeof(Buf));
+  return Header;
+}
+
+llvm::StringRef recordKey(llvm::StringRef Record) {
+  return Record.substr(KeyOffset, sizeof(CacheKey));
+}
+
+uint64_t recordLastUsed(llvm::StringRef Record) {
+  return endian::read64le(Record.data() + LastUsedOffset);
+}
+
+bool checksumMatches(llvm::StringRef Record) {
+  return endian::read64le(Record.data() + ChecksumOffset) ==
+         llvm::xxHash64(Record.drop_front(KeyOffset));
+}
+
+std::string makeRecord(const CacheKey &Key, llvm::StringRef Payload) {
+  std::string Record(RecordHeaderSize, '\0');
+  Record.append(Payload.begin(), Payload.end());
+  std::memcpy(&Record[KeyOffset], Key.data(), Key.size());
+  endian::write32le(&Record[0], RecordMagic);
+  endian::write32le(&Record[4], static_cast<uint32_t>(Payload.size()));
+  endian::write64le(&Record[LastUsedOffset], now());
+  endian::write64le(&Record[ChecksumOffset],
+                    llvm::xxHash64(llvm::StringRef(Record).drop_front(
+                        KeyOffset)));
+  return Record;
+}
+
+/// Call \p Callback(Offset, Record) for every record with a well-formed
+/// header and return the end of the well-formed prefix; 0 if even the file
+/// header is bad.  Records are not checksummed here.
+template <typename CallbackT>
+uint64_t scanRecords(llvm::StringRef Data, CallbackT Callback) {
+  if (Data.size() < FileHeaderSize || !Data.starts_with(FileMagic) ||
+      endian::read32le(Data.data() + FileMagic.size()) != FormatVersion)
+    return 0;
+  uint64_t Offset = FileHeaderSize;
+  while (Data.size() - Offset >= RecordHeaderSize) {
+    const char *Header = Data.data() + Offset;
+    if (endian::read32le(Header) != RecordMagic)
+      break;
+    uint64_t Size = RecordHeaderSize + endian::read32le(Header + 4);
+    if (Data.size() - Offset < Size)
+      break;
+    Callback(Offset, Data.substr(Offset, Size));
+    Offset += Size;
+  }
+  return Offset;
+}
+
+struct CacheHit {
+  std::string Payload;
+  fs::UniqueID File;
+  uint64_t Offset;
+};
+
+/// Find the newest intact record for \p Key.  Runs without a lock: records
+/// are only ever appended, and a half-written one fails its checksum.
+std::optional<CacheHit> readEntry(llvm::StringRef Path, const CacheKey &Key) {
+  llvm::Expected<fs::file_t> File = fs::openNativeFileForRead(Path);
+  if (!File) {
+    llvm::consumeError(File.takeError());
+    return std::nullopt;
+  }
+  auto Close = llvm::make_scope_exit([&] { fs::closeFile(*File); });
+
+  fs::file_status Status;
+  if (fs::status(*File, Status) || Status.getSize() < FileHeaderSize)
+    return std::nullopt;
+  std::error_code EC;
+  fs::mapped_file_region Map(*File, fs::mapped_file_region::readonly,
+                             Status.getSize(), 0, EC);
+  if (EC)
+    return std::nullopt;
+
+  llvm::StringRef WantedKey(reinterpret_cast<const char *>(Key.data()),
+                            Key.size());
+  std::optional<CacheHit> Hit;
+  scanRecords(llvm::StringRef(Map.const_data(), Map.size()),
+              [&](uint64_t Offset, llvm::StringRef Record) {
+                if (recordKey(Record) != WantedKey || !checksumMatches(Record))
+                  return;
+                Hit = CacheHit{Record.drop_front(RecordHeaderSize).str(),
+                               Status.getUniqueID(), Offset};
+              });
+  return Hit;
+}
+
+/// Open the cache file, take the exclusive lock and run \p Callback.  A
+/// compaction may rename a new file over the path between open and lock; in
+/// that case the lock is on a dead file and the open is retried.
+bool withLockedFile(llvm::StringRef Path, fs::OpenFlags Flags,
+                    llvm::function_ref<void(int FD, const fs::file_status &)>
+                        Callback) {
+  for (unsigned Attempt = 0; Attempt < 8; ++Attempt) {
+    int FD;
+    if (fs::openFileForReadWrite(Path, FD, fs::CD_OpenAlways, Flags))
+      return false;
+    auto Close = llvm::make_scope_exit(
+        [&] { llvm::sys::Process::SafelyCloseFileDescriptor(FD); });
+    if (fs::lockFile(FD))
+      return false;
+
+    fs::file_status Opened, Current;
+    if (!fs::status(FD, Opened) && !fs::status(Path, Current) &&
+        fs::equivalent(Opened, Current)) {
+      Callback(FD, Opened);
+      fs::unlockFile(FD);
+      return true;
+    }
+    fs::unlockFile(FD);
+  }
+  return false;
+}
+
+/// Write \p Contents to a new file and rename it over \p Path, so that
+/// readers that have the old file mapped keep it intact.
+void replaceFile(llvm::StringRef Path, llvm::StringRef Contents) {
+  llvm::SmallString<256> TmpPath;
+  int TmpFD;
+  if (fs::createUniqueFile(Path + ".tmp-%%%%%%%%", TmpFD, TmpPath))
+    return;
+  llvm::raw_fd_ostream OS(TmpFD, /*shouldClose=*/true);
+  OS << Contents;
+  OS.close();
+  if (OS.has_error()) {
+    OS.clear_error();
+    fs::remove(TmpPath);
+    return;
+  }
+  if (fs::rename(TmpPath, Path))
+    fs::remove(TmpPath);
+}
+
+/// Rewrite the cache with the most recently used records that fit in half
+/// of \p MaxBytes.  Called with the lock on \p FD held.
+void compact(llvm::StringRef Path, int FD, uint64_t Size, uint64_t MaxBytes) {
+  std::error_code EC;
+  fs::mapped_file_region Map(fs::convertFDToNativeFile(FD),
+                             fs::mapped_file_region::readonly, Size, 0, EC);
+  if (EC)
+    return;
+
+  std::vector<llvm::StringRef> Records;
+  llvm::StringMap<size_t> Latest;
+  scanRecords(llvm::StringRef(Map.const_data(), Map.size()),
+              [&](uint64_t, llvm::StringRef Record) {
+                if (!checksumMatches(Record))
+                  return;
+                auto Inserted =
+                    Latest.try_emplace(recordKey(Record), Records.size());
+                if (Inserted.second)
+                  Records.push_back(Record);
+                else
+                  Records[Inserted.first->second] = Record;
+              });
+  std::stable_sort(Records.begin(), Records.end(),
+                   [](llvm::StringRef A, llvm::StringRef B) {
+                     return recordLastUsed(A) > recordLastUsed(B);
+                   });
+
+  std::string Out = fileHeader();
+  for (llvm::StringRef Record : Records) {
+    if (Out.size() + Record.size() > MaxBytes / 2)
+      break;
+    Out += Record;
+  }
+  replaceFile(Path, Out);
+}
+
+/// Append one record and compact the file if it outgrew \p MaxBytes.  A
+/// torn tail left by a writer that died mid-write is covered by a record
+/// that fails its checksum rather than truncated.
+void appendEntry(llvm::StringRef Path, uint64_t MaxBytes, const CacheKey &Key,
+                 llvm::StringRef Payload) {
+  std::string Record = makeRecord(Key, Payload);
+  withLockedFile(Path, fs::OF_None, [&](int FD,
+                                        const fs::file_status &Status) {
+    uint64_t Size = Status.getSize();
+    uint64_t End = 0;
+    if (Size) {
+      std::error_code EC;
+      fs::mapped_file_region Map(fs::convertFDToNativeFile(FD),
+                                 fs::mapped_file_region::readonly, Size, 0,
+                                 EC);
+      if (EC)
+        return;
+      End = scanRecords(llvm::StringRef(Map.const_data(), Map.size()),
+                        [](uint64_t, llvm::StringRef) {});
+    }
+    // Another format version, or garbage: start over in a new file.
+    if (Size && !End) {
+      replaceFile(Path, fileHeader() + Record);
+      return;
+    }
+
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/false, /*unbuffered=*/true);
+    uint64_t At = Size;
+    if (End != Size) {
+      uint64_t Torn = std::max<uint64_t>(Size - End, RecordHeaderSize);
+      std::string Skip(RecordHeaderSize, '\0');
+      endian::write32le(&Skip[0], RecordMagic);
+      endian::write32le(&Skip[4],
+                        static_cast<uint32_t>(Torn - RecordHeaderSize));
+      OS.seek(End);
+      OS << Skip;
+      At = End + Torn;
+    }
+    std::string Out = Size ? std::string() : fileHeader();
+    Out += Record;
+    OS.seek(At);
+    OS << Out;
+    OS.flush();
+    if (OS.has_error()) {
+      OS.clear_error();
+      return;
+    }
+    if (At + Out.size() > MaxBytes)
+      compact(Path, FD, At + Out.size(), MaxBytes);
+  });
+}
+
+/// Refresh the last-use time of the record a hit was served from.
+void touchEntry(llvm::StringRef Path, const CacheHit &Hit) {
+  withLockedFile(Path, fs::OF_None, [&](int FD,
+                                        const fs::file_status &Status) {
+    // Compacted since we read it; the offset means nothing in the new file.
+    if (Status.getUniqueID() != Hit.File)
+      return;
+    char Buf[8];
+    endian::write64le(Buf, now());
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/false, /*unbuffered=*/true);
+    OS.seek(Hit.Offset + LastUsedOffset);
+    OS.write(Buf, sizeof(Buf));
+    OS.flush();
+    if (OS.has_error())
+      OS.clear_error();
+  });
+}
+
+/// Length-prefix each field so that adjacent fields cannot alias.
+void hashField(llvm::BLAKE3 &Hasher, llvm::StringRef Field) {
+  uint8_t Size[8];
+  endian::write64le(Size, Field.size());
+  Hasher.update(Size);
+  Hasher.update(Field);
+}
+
+//===----------------------------------------------------------------------===//
+// Payload encoding
+//===----------------------------------------------------------------------===//
+
+class PayloadWriter {
+public:
+  void u8(uint8_t V) { Out.push_back(static_cast<char>(V)); }
+  void u32(uint32_t V) {
+    char Buf[4];
+    endian::write32le(Buf, V);
+    Out.append(Buf, sizeof(Buf));
+  }
+  void u64(uint64_t V) {
+    char Buf[8];
+    endian::write64le(Buf, V);
+    Out.append(Buf, sizeof(Buf));
+  }
+  void str(llvm::StringRef S) {
+    u32(S.size());
+    Out.append(S.begin(), S.end());
+  }
+  void loc(const CachedLoc &L) {
+    u32(L.File);
+    u32(L.Offset);
+  }
+  void range(const CachedRange &R) {
+    loc(R.Begin);
+    loc(R.End);
+    u8(R.IsTokenRange);
+  }
+
+  std::string Out;
+};
+
+class PayloadReader {
+public:
+  explicit PayloadReader(llvm::StringRef Data) : Data(Data) {}
+
+  uint8_t u8() {
+    const char *P = take(1);
+    return P ? static_cast<uint8_t>(*P) : 0;
+  }
+  uint32_t u32() {
+    const char *P = take(4);
+    return P ? endian::read32le(P) : 0;
+  }
+  uint64_t u64() {
+    const char *P = take(8);
+    return P ? endian::read64le(P) : 0;
+  }
+  std::string str() {
+    uint32_t Size = u32();
+    const char *P = take(Size);
+    return P ? std::string(P, Size) : std::string();
+  }
+  CachedLoc loc() {
+    CachedLoc L;
+    L.File = u32();
+    L.Offset = u32();
+    return L;
+  }
+  CachedRange range() {
+    CachedRange R;
+    R.Begin = loc();
+    R.End = loc();
+    R.IsTokenRange = u8();
+    return R;
+  }
+
+  bool failed() const { return Failed; }
+  bool done() const { return !Failed && Data.empty(); }
+
+private:
+  const char *take(size_t Size) {
+    if (Failed || Data.size() < Size) {
+      Failed = true;
+      return nullptr;
+    }
+    const char *P = Data.data();
+    Data = Data.drop_front(Size);
+    return P;
+  }
+
+  llvm::StringRef Data;
+  bool Failed = false;
+};
+
+std::string serialize(llvm::ArrayRef<CachedDiagnostic> Diags) {
+  PayloadWriter W;
+  W.u32(Diags.size());
+  for (const CachedDiagnostic &D : Diags) {
+    W.str(D.Check);
+    W.u8(D.Level);
+    W.str(D.Description);
+    W.u8(D.Loc.has_value());
+    if (D.Loc)
+      W.loc(*D.Loc);
+    W.u32(D.Args.size());
+    for (const CachedArg &A : D.Args) {
+      W.u8(A.Kind);
+      if (A.Kind == CachedArg::String)
+        W.str(A.Text);
+      else
+        W.u64(A.Value);
+    }
+    W.u32(D.Ranges.size());
+    for (const CachedRange &R : D.Ranges)
+      W.range(R);
+    W.u32(D.FixIts.size());
+    for (const CachedFixIt &F : D.FixIts) {
+      W.range(F.Remove);
+      W.str(F.Code);
+      W.u8(F.BeforePreviousInsertions);
+    }
+    W.u8(D.Suggested.has_value());
+    if (D.Suggested) {
+      W.str(D.Suggested->Alternative);
+      W.str(D.Suggested->Since);
+    }
+  }
+  return std::move(W.Out);
+}
+
+bool deserialize(llvm::StringRef Payload, std::vector<CachedDiagnostic> &Out) {
+  PayloadReader R(Payload);
+  uint32_t Count = R.u32();
+  for (uint32_t I = 0; I < Count && !R.failed(); ++I) {
+    CachedDiagnostic D;
+    D.Check = R.str();
+    uint8_t Level = R.u8();
+    if (Level > clang::DiagnosticIDs::Fatal)
+      return false;
+    D.Level = static_cast<clang::DiagnosticIDs::Level>(Level);
+    D.Description = R.str();
+    if (R.u8())
+      D.Loc = R.loc();
+    uint32_t Args = R.u32();
+    for (uint32_t J = 0; J < Args && !R.failed(); ++J) {
+      CachedArg A;
+      uint8_t Kind = R.u8();
+      if (Kind > CachedArg::Unsigned)
+        return false;
+      A.Kind = static_cast<CachedArg::ArgKind>(Kind);
+      if (A.Kind == CachedArg::String)
+        A.Text = R.str();
+      else
+        A.Value = R.u64();
+      D.Args.push_back(std::move(A));
+    }
+    uint32_t Ranges = R.u32();
+    for (uint32_t J = 0; J < Ranges && !R.failed(); ++J)
+      D.Ranges.push_back(R.range());
+    uint32_t FixIts = R.u32();
+    for (uint32_t J = 0; J < FixIts && !R.failed(); ++J) {
+      CachedFixIt F;
+      F.Remove = R.range();
+      F.Code = R.str();
+      F.BeforePreviousInsertions = R.u8();
+      D.FixIts.push_back(std::move(F));
+    }
+    if (R.u8()) {
+      D.Suggested.emplace();
+      D.Suggested->Alternative = R.str();
+      D.Suggested->Since = R.str();
+    }
+    Out.push_back(std::move(D));
+  }
+  return R.done();
+}
+
+/// Whether every check clang-tidy runs with the current Checks option is an
+/// hl-* check, so that nothing needs the AST once their results come from
+/// the cache.  Answered by enumerating the registered modules, once per
+/// distinct Checks value.
+bool onlyHlChecksEnabled(clang::tidy::ClangTidyContext &Context) {
+  std::string Globs = Context.getOptions().Checks.value_or("");
+  static std::mutex Mutex;
+  static llvm::StringMap<bool> Known;
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto It = Known.find(Globs);
+  if (It != Known.end())
+    return It->second;
+
+  // Static analyzer checks are not registered through modules.
+  bool Only = !llvm::StringRef(Globs).contains("clang-analyzer");
+  for (const auto &Entry : clang::tidy::ClangTidyModuleRegistry::entries()) {
+    if (!Only)
+      break;
+    std::unique_ptr<clang::tidy::ClangTidyModule> Module =
+        Entry.instantiate();
+    clang::tidy::ClangTidyCheckFactories Factories;
+    Module->addCheckFactories(Factories);
+    for (const auto &Factory : Factories) {
+      llvm::StringRef Name = Factory.getKey();
+      if (!Name.starts_with("hl-") && Context.isCheckEnabled(Name)) {
+        Only = false;
+        break;
+      }
+    }
+  }
+  Known[Globs] = Only;
+  return Only;
+}
+
+} // namespace
+
+//===----------------------------------------------------------------------===//
+// CacheSession
+//===----------------------------------------------------------------------===//
+
+/// Feeds every file the preprocessor enters into the session's key.
+class CacheSession::FileHasher : public clang::PPCallbacks {
+public:
+  explicit FileHasher(CacheSession &Session) : Session(Session) {}
+
+  void FileChanged(clang::SourceLocation Loc, FileChangeReason Reason,
+                   clang::SrcMgr::CharacteristicKind,
+                   clang::FileID) override {
+    if (Reason == EnterFile)
+      Session.enterFile(Session.SM->getFileID(Loc));
+  }
+
+private:
+  CacheSession &Session;
+};
+
+std::shared_ptr<CacheSession>
+CacheSession::acquire(clang::tidy::ClangTidyContext &Context) {
+  return acquireTUSession<CacheSession>(
+      Context, [&]() -> std::shared_ptr<CacheSession> {
+        std::string Path = getModuleOption(Context, "CacheFile", "");
+        if (Path.empty())
+          return nullptr;
+        uint64_t MaxSizeMB = DefaultMaxSizeMB;
+        std::string MaxSize = getModuleOption(Context, "CacheMaxSizeMB", "");
+        if (llvm::StringRef(MaxSize).getAsInteger(10, MaxSizeMB) ||
+            MaxSizeMB == 0)
+          MaxSizeMB = DefaultMaxSizeMB;
+        return std::make_shared<CacheSession>(std::move(Path),
+                                              MaxSizeMB << 20);
+      });
+}
+
+CacheSession::~CacheSession() {
+  if (State == Recording)
+    appendEntry(Path, MaxBytes, Key, serialize(Recorded));
+}
+
+void CacheSession::addCheck(llvm::StringRef CheckName) {
+  Checks.push_back(CheckName.str());
+}
+
+void CacheSession::attach(const clang::SourceManager &SourceMgr,
+                          clang::Preprocessor &PP) {
+  if (SM)
+    return;
+  SM = &SourceMgr;
+  // Headers coming from a PCH or module are never entered, so the key
+  // would not see them change.
+  if (!PP.getPreprocessorOpts().ImplicitPCHInclude.empty() ||
+      PP.getLangOpts().Modules) {
+    markUncacheable();
+    return;
+  }
+  PP.addPPCallbacks(std::make_unique<FileHasher>(*this));
+}
+
+void CacheSession::enterFile(clang::FileID FID) {
+  if (State != Pending || FID.isInvalid())
+    return;
+  bool Invalid = false;
+  llvm::StringRef Data = SM->getBufferData(FID, &Invalid);
+  if (Invalid) {
+    markUncacheable();
+    return;
+  }
+  FileIndex.try_emplace(FID, Files.size());
+  Files.push_back(FID);
+  hashField(Hasher, SM->getBufferName(SM->getLocForStartOfFile(FID)));
+  hashField(Hasher, Data);
+}
+
+bool CacheSession::lookup(clang::ASTContext &Ctx,
+                          clang::tidy::ClangTidyContext &Context) {
+  if (State != Pending)
+    return State == Hit;
+  if (!SM || Files.empty()) {
+    markUncacheable();
+    return false;
+  }
+
+  std::vector<std::pair<llvm::StringRef, llvm::StringRef>> Options;
+  for (const auto &Option : Context.getOptions().CheckOptions) {
+    llvm::StringRef Name = Option.getKey();
+    // Where results and metrics go does not change the results.
+    if (!Name.starts_with("hl-") || Name.starts_with("hl-module.Cache") ||
+        Name == "hl-module.MetricsDir")
+      continue;
+    Options.emplace_back(Name, Option.getValue().Value);
+  }
+  llvm::sort(Options);
+  llvm::sort(Checks);
+
+  hashField(Hasher, "options");
+  for (const auto &Option : Options) {
+    hashField(Hasher, Option.first);
+    hashField(Hasher, Option.second);
+  }
+  hashField(Hasher, "checks");
+  for (const std::string &Check : Checks)
+    hashField(Hasher, Check);
+  // The option names the profile; warnings depend on what is in it.
+  if (std::shared_ptr<const Profile> Samples = Profile::acquire(Context)) {
+    hashField(Hasher, "profile");
+    hashField(Hasher, Samples->digest());
+  }
+  // Likewise for the coverage counts and the cross-TU hot-path index.
+  if (std::shared_ptr<const Coverage> Counts = Coverage::acquire(Context)) {
+    hashField(Hasher, "coverage");
+    hashField(Hasher, Counts->digest());
+  }
+  std::string IndexPath = getModuleOption(Context, "HotIndex", "");
+  if (!IndexPath.empty())
+    if (std::shared_ptr<const HotIndex> Index = HotIndex::acquire(IndexPath)) {
+      hashField(Hasher, "hot-index");
+      hashField(Hasher, llvm::utohexstr(Index->digest()));
+    }
+  hashField(Hasher, standardLabel(detectStandard(Ctx)));
+  hashField(Hasher, Ctx.getTargetInfo().getTriple().str());
+  hashField(Hasher, HL_TIDY_VERSION);
+  hashField(Hasher, clang::getClangFullVersion());
+  hashField(Hasher, llvm::StringRef(fileHeader()));
+  Key = Hasher.final<sizeof(CacheKey)>();
+
+  std::optional<CacheHit> Found = readEntry(Path, Key);
+  if (Found && deserialize(Found->Payload, Hits) &&
+      llvm::all_of(Hits, [&](const CachedDiagnostic &D) {
+        auto ValidRange = [&](const CachedRange &R) {
+          return isValid(R.Begin) && isValid(R.End);
+        };
+        return (!D.Loc || isValid(*D.Loc)) &&
+               llvm::all_of(D.Ranges, ValidRange) &&
+               llvm::all_of(D.FixIts, [&](const CachedFixIt &F) {
+                 return ValidRange(F.Remove);
+               });
+      })) {
+    State = Hit;
+    touchEntry(Path, *Found);
+    if (onlyHlChecksEnabled(Context)) {
+      Ctx.setTraversalScope({});
+      SkippedTraversal = true;
+    }
+    return true;
+  }
+
+  Hits.clear();
+  State = Recording;
+  return false;
+}
+
+std::unique_ptr<CachedDiagnostic>
+CacheSession::record(llvm::StringRef CheckName, clang::SourceLocation Loc,
+                     llvm::StringRef Description,
+                     clang::DiagnosticIDs::Level Level) {
+  // Emitted before the lookup (e.g. from a PP callback): a hit could not
+  // suppress it, so replaying it would report it twice.
+  if (State == Pending)
+    markUncacheable();
+  if (State != Recording)
+    return nullptr;
+
+  auto Diag = std::make_unique<CachedDiagnostic>();
+  Diag->Check = CheckName.str();
+  Diag->Level = Level;
+  Diag->Description = Description.str();
+  if (Loc.isValid()) {
+    // Replaying at the file location would lose the macro expansion notes.
+    Diag->Loc = Loc.isMacroID() ? std::nullopt : encode(Loc);
+    if (!Diag->Loc) {
+      markUncacheable();
+      return nullptr;
+    }
+  }
+  return Diag;
+}
+
+void CacheSession::commit(std::unique_ptr<CachedDiagnostic> Diag) {
+  if (State == Recording)
+    Recorded.push_back(std::move(*Diag));
+}
+
+void CacheSession::addString(CachedDiagnostic &Diag, llvm::StringRef Text) {
+  CachedArg Arg;
+  Arg.Kind = CachedArg::String;
+  Arg.Text = Text.str();
+  Diag.Args.push_back(std::move(Arg));
+}
+
+void CacheSession::addInteger(CachedDiagnostic &Diag, bool IsSigned,
+                              int64_t Value) {
+  CachedArg Arg;
+  Arg.Kind = IsSigned ? CachedArg::Signed : CachedArg::Unsigned;
+  Arg.Value = static_cast<uint64_t>(Value);
+  Diag.Args.push_back(std::move(Arg));
+}
+
+void CacheSession::addRange(CachedDiagnostic &Diag,
+                            const clang::CharSourceRange &Range) {
+  if (std::optional<CachedRange> Encoded = encode(Range))
+    Diag.Ranges.push_back(*Encoded);
+  else
+    markUncacheable();
+}
+
+void CacheSession::addFixIt(CachedDiagnostic &Diag,
+                            const clang::FixItHint &Hint) {
+  // DiagnosticBuilder drops null hints as well.
+  if (Hint.isNull())
+    return;
+  std::optional<CachedRange> Remove = encode(Hint.RemoveRange);
+  if (!Remove || Hint.InsertFromRange.isValid()) {
+    markUncacheable();
+    return;
+  }
+  CachedFixIt Fix;
+  Fix.Remove = *Remove;
+  Fix.Code = Hint.CodeToInsert;
+  Fix.BeforePreviousInsertions = Hint.BeforePreviousInsertions;
+  Diag.FixIts.push_back(std::move(Fix));
+}
+
+void CacheSession::markUncacheable() { State = Uncacheable; }
+
+std::optional<CachedLoc>
+CacheSession::encode(clang::SourceLocation Loc) const {
+  if (!SM || Loc.isInvalid() || !Loc.isFileID())
+    return std::nullopt;
+  std::pair<clang::FileID, unsigned> Decomposed = SM->getDecomposedLoc(Loc);
+  auto It = FileIndex.find(Decomposed.first);
+  if (It == FileIndex.end())
+    return std::nullopt;
+  CachedLoc Encoded;
+  Encoded.File = It->second;
+  Encoded.Offset = Decomposed.second;
+  return Encoded;
+}
+
+std::optional<CachedRange>
+CacheSession::encode(const clang::CharSourceRange &Range) const {
+  std::optional<CachedLoc> Begin = encode(Range.getBegin());
+  std::optional<CachedLoc> End = encode(Range.getEnd());
+  if (!Begin || !End)
+    return std::nullopt;
+  CachedRange Encoded;
+  Encoded.Begin = *Begin;
+  Encoded.End = *End;
+  Encoded.IsTokenRange = Range.isTokenRange();
+  return Encoded;
+}
+
+bool CacheSession::isValid(const CachedLoc &Loc) const {
+  if (Loc.File >= Files.size())
+    return false;
+  bool Invalid = false;
+  llvm::StringRef Data = SM->getBufferData(Files[Loc.File], &Invalid);
+  return !Invalid && Loc.Offset <= Data.size();
+}
+
+clang::SourceLocation CacheSession::decode(const CachedLoc &Loc) const {
+  return SM->getLocForStartOfFile(Files[Loc.File]).getLocWithOffset(
+      Loc.Offset);
+}
+
+clang::CharSourceRange CacheSession::decode(const CachedRange &Range) const {
+  return clang::CharSourceRange(
+      clang::SourceRange(decode(Range.Begin), decode(Range.End)),
+      Range.IsTokenRange);
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
@@ -0,0 +1,192 @@
+//===--- ResultCache.h - On-disk cache of hl-* diagnostics ------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// Re-running clang-tidy over an unchanged translation unit repeats all of the
+// matching work only to produce the same diagnostics.  With
+// `hl-module.CacheFile` set, the hl-* diagnostics of every TU are stored in a
+// content-addressed cache and replayed on the next run instead of matching:
+//
+//   key   = BLAKE3 of every file entered by the preprocessor (name and
+//           contents, in inclusion order, including the <built-in> buffer
+//           that carries -D flags), the effective hl-* CheckOptions, the
+//           enabled hl-* checks, the contents of `hl-module.ProfileFile`,
+//           the detected C++ standard, the target triple, and the plugin
+//           and clang versions
+//   value = the diagnostics and fix-its the checks emitted, with locations
+//           stored as (file index, offset) into that same inclusion order
+//
+// The cache is a single append-only file shared by parallel clang-tidy
+// processes.  Readers map it without locking and skip records that fail
+// their checksum; writers append one record per TU under an exclusive file
+// lock.  A hit refreshes the record's last-use time in place, and when the
+// file grows past `hl-module.CacheMaxSizeMB` the writer rewrites it with the
+// most recently used half and renames it over the original.
+//
+// Translation units whose diagnostics cannot be reproduced exactly are not
+// cached: TUs built with a PCH or modules (their headers are never entered),
+// and TUs where a diagnostic is emitted inside a macro expansion or streams
+// an argument the cache does not understand.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_RESULT_CACHE_H
+#define HL_TIDY_UTILS_RESULT_CACHE_H
+
+#include "DiagnosticHelper.h"
+
+#include "clang-tidy/ClangTidyDiagnosticConsumer.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/BLAKE3.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+/// A file location independent of the SourceManager that produced it.
+struct CachedLoc {
+  /// Position of the file in the preprocessor's inclusion order.
+  uint32_t File = 0;
+  uint32_t Offset = 0;
+};
+
+struct CachedRange {
+  CachedLoc Begin;
+  CachedLoc End;
+  bool IsTokenRange = false;
+};
+
+struct CachedFixIt {
+  CachedRange Remove;
+  std::string Code;
+  bool BeforePreviousInsertions = false;
+};
+
+/// One streamed diagnostic argument.
+struct CachedArg {
+  enum ArgKind : uint8_t { String, Signed, Unsigned };
+  ArgKind Kind = String;
+  std::string Text;
+  uint64_t Value = 0;
+};
+
+/// Everything needed to emit a diagnostic again through ClangTidyCheck.
+struct CachedDiagnostic {
+  std::string Check;
+  clang::DiagnosticIDs::Level Level = clang::DiagnosticIDs::Warning;
+  std::string Description;
+  std::optional<CachedLoc> Loc;
+  std::vector<CachedArg> Args;
+  std::vector<CachedRange> Ranges;
+  std::vector<CachedFixIt> FixIts;
+  /// The alternative a note recommends, for the export of a replayed run.
+  std::optional<Suggestion> Suggested;
+};
+
+using CacheKey = std::array<uint8_t, 16>;
+
+/// The cache state of one translation unit, shared by all hl-* checks
+/// created for it (see TUSession.h).  The entry is written when the last
+/// check releases the session.
+class CacheSession {
+public:
+  CacheSession(std::string Path, uint64_t MaxBytes)
+      : Path(std::move(Path)), MaxBytes(MaxBytes) {}
+  ~CacheSession();
+
+  /// Return the session for the TU \p Context is currently processing, or
+  /// null when `hl-module.CacheFile` is not set.
+  static std::shared_ptr<CacheSession>
+  acquire(clang::tidy::ClangTidyContext &Context);
+
+  /// Note that \p CheckName is enabled for this TU; part of the key.
+  void addCheck(llvm::StringRef CheckName);
+
+  /// Start hashing the files \p PP enters.  Only the first call has an
+  /// effect.
+  void attach(const clang::SourceManager &SM, clang::Preprocessor &PP);
+
+  /// Look the TU up once parsing is done.  On a hit the stored diagnostics
+  /// become available through hits(); otherwise the session starts
+  /// recording.  Only the first call does work; all return whether the TU
+  /// was a hit.
+  bool lookup(clang::ASTContext &Ctx, clang::tidy::ClangTidyContext &Context);
+
+  bool isHit() const { return State == Hit; }
+  bool isRecording() const { return State == Recording; }
+
+  /// True if, on a hit, the traversal scope was emptied because no
+  /// non-hl-* check needs the AST.
+  bool skipsTraversal() const { return SkippedTraversal; }
+
+  /// Diagnostics stored for this TU, in emission order.
+  llvm::ArrayRef<CachedDiagnostic> hits() const { return Hits; }
+
+  /// Start recording a diagnostic emitted by \p CheckName.  Returns null
+  /// when the session is not recording.  The caller streams arguments into
+  /// it with the add*() functions and hands it back to commit() when the
+  /// diagnostic is emitted, so the cache keeps emission order.
+  std::unique_ptr<CachedDiagnostic>
+  record(llvm::StringRef CheckName, clang::SourceLocation Loc,
+         llvm::StringRef Description, clang::DiagnosticIDs::Level Level);
+  void commit(std::unique_ptr<CachedDiagnostic> Diag);
+  void addString(CachedDiagnostic &Diag, llvm::StringRef Text);
+  void addInteger(CachedDiagnostic &Diag, bool IsSigned, int64_t Value);
+  void addRange(CachedDiagnostic &Diag, const clang::CharSourceRange &Range);
+  void addFixIt(CachedDiagnostic &Diag, const clang::FixItHint &Hint);
+  void addSuggestion(CachedDiagnostic &Diag, Suggestion S) {
+    Diag.Suggested = std::move(S);
+  }
+
+  /// Give up on caching this TU.
+  void markUncacheable();
+
+  /// Map a cached location back into the current TU.
+  clang::SourceLocation decode(const CachedLoc &Loc) const;
+  clang::CharSourceRange decode(const CachedRange &Range) const;
+
+private:
+  class FileHasher;
+  enum SessionState { Pending, Hit, Recording, Uncacheable };
+
+  std::optional<CachedLoc> encode(clang::SourceLocation Loc) const;
+  std::optional<CachedRange> encode(const clang::CharSourceRange &Range) const;
+  bool isValid(const CachedLoc &Loc) const;
+  void enterFile(clang::FileID FID);
+
+  std::string Path;
+  uint64_t MaxBytes;
+  SessionState State = Pending;
+  bool SkippedTraversal = false;
+
+  const clang::SourceManager *SM = nullptr;
+  llvm::BLAKE3 Hasher;
+  llvm::DenseMap<clang::FileID, uint32_t> FileIndex;
+  std::vector<clang::FileID> Files;
+  llvm::SmallVector<std::string, 32> Checks;
+
+  CacheKey Key{};
+  std::vector<CachedDiagnostic> Recorded;
+  std::vector<CachedDiagnostic> Hits;
+};
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_RESULT_CACHE_H
@@ -0,0 +1,170 @@
+//===--- StdSymbols.cpp - Per-TU resolved std:: symbols ---------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "StdSymbols.h"
+#include "TranslationUnitCache.h"
+
+#include "clang/AST/DeclTemplate.h"
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+namespace {
+
+struct SymbolName {
+  llvm::StringLiteral Name;
+  StdSymbol Symbol;
+};
+
+// Unqualified names looked up in namespace std (including its inline
+// namespaces such as libc++'s std::__1 and libstdc++'s std::__cxx11).
+constexpr SymbolName KnownSymbols[] = {
+    {llvm::StringLiteral("any"), StdSymbol::Any},
+    {llvm::StringLiteral("array"), StdSymbol::Array},
+    {llvm::StringLiteral("atomic"), StdSymbol::Atomic},
+    {llvm::StringLiteral("atomic_flag"), StdSymbol::AtomicFlag},
+    {llvm::StringLiteral("barrier"), StdSymbol::Barrier},
+    {llvm::StringLiteral("basic_fstream"), StdSymbol::BasicFstream},
+    {llvm::StringLiteral("basic_ifstream"), StdSymbol::BasicIfstream},
+    {llvm::StringLiteral("basic_istringstream"),
+     StdSymbol::BasicIstringstream},
+    {llvm::StringLiteral("basic_ofstream"), StdSymbol::BasicOfstream},
+    {llvm::StringLiteral("basic_ostringstream"),
+     StdSymbol::BasicOstringstream},
+    {llvm::StringLiteral("basic_regex"), StdSymbol::BasicRegex},
+    {llvm::StringLiteral("basic_string"), StdSymbol::BasicString},
+    {llvm::StringLiteral("basic_stringstream"), StdSymbol::BasicStringstream},
+    {llvm::StringLiteral("condition_variable"), StdSymbol::ConditionVariable},
+    {llvm::StringLiteral("condition_variable_any"),
+     StdSymbol::ConditionVariableAny},
+    {llvm::StringLiteral("counting_semaphore"), StdSymbol::CountingSemaphore},
+    {llvm::StringLiteral("deque"), StdSymbol::Deque},
+    {llvm::StringLiteral("forward_list"), StdSymbol::ForwardList},
+    {llvm::StringLiteral("function"), StdSymbol::Function},
+    {llvm::StringLiteral("istringstream"), StdSymbol::Istringstream},
+    {llvm::StringLiteral("latch"), StdSymbol::Latch},
+    {llvm::StringLiteral("list"), StdSymbol::List},
+    {llvm::StringLiteral("lock_guard"), StdSymbol::LockGuard},
+    {llvm::StringLiteral("map"), StdSymbol::Map},
+    {llvm::StringLiteral("multimap"), StdSymbol::Multimap},
+    {llvm::StringLiteral("multiset"), StdSymbol::Multiset},
+    {llvm::StringLiteral("mutex"), StdSymbol::Mutex},
+    {llvm::StringLiteral("optional"), StdSymbol::Optional},
+    {llvm::StringLiteral("ostringstream"), StdSymbol::Ostringstream},
+    {llvm::StringLiteral("recursive_mutex"), StdSymbol::RecursiveMutex},
+    {llvm::StringLiteral("recursive_timed_mutex"),
+     StdSymbol::RecursiveTimedMutex},
+    {llvm::StringLiteral("regex"), StdSymbol::Regex},
+    {llvm::StringLiteral("scoped_lock"), StdSymbol::ScopedLock},
+    {llvm::StringLiteral("set"), StdSymbol::Set},
+    {llvm::StringLiteral("shared_lock"), StdSymbol::SharedLock},
+    {llvm::StringLiteral("shared_mutex"), StdSymbol::SharedMutex},
+    {llvm::StringLiteral("shared_ptr"), StdSymbol::SharedPtr},
+    {llvm::StringLiteral("shared_timed_mutex"), StdSymbol::SharedTimedMutex},
+    {llvm::StringLiteral("stringstream"), StdSymbol::Stringstream},
+    {llvm::StringLiteral("thread"), StdSymbol::Thread},
+    {llvm::StringLiteral("timed_mutex"), StdSymbol::TimedMutex},
+    {llvm::StringLiteral("unique_lock"), StdSymbol::UniqueLock},
+    {llvm::StringLiteral("unordered_map"), StdSymbol::UnorderedMap},
+    {llvm::StringLiteral("unordered_set"), StdSymbol::UnorderedSet},
+    {llvm::StringLiteral("vector"), StdSymbol::Vector},
+    {llvm::StringLiteral("wregex"), StdSymbol::WRegex},
+
+    {llvm::StringLiteral("any_cast"), StdSymbol::AnyCast},
+    {llvm::StringLiteral("bind"), StdSymbol::Bind},
+    {llvm::StringLiteral("bind_back"), StdSymbol::BindBack},
+    {llvm::StringLiteral("bind_front"), StdSymbol::BindFront},
+    {llvm::StringLiteral("make_shared"), StdSymbol::MakeShared},
+    {llvm::StringLiteral("regex_match"), StdSymbol::RegexMatch},
+    {llvm::StringLiteral("regex_replace"), StdSymbol::RegexReplace},
+    {llvm::StringLiteral("regex_search"), StdSymbol::RegexSearch},
+    {llvm::StringLiteral("stod"), StdSymbol::Stod},
+    {llvm::StringLiteral("stof"), StdSymbol::Stof},
+    {llvm::StringLiteral("stoi"), StdSymbol::Stoi},
+    {llvm::StringLiteral("stol"), StdSymbol::Stol},
+    {llvm::StringLiteral("stold"), StdSymbol::Stold},
+    {llvm::StringLiteral("stoll"), StdSymbol::Stoll},
+    {llvm::StringLiteral("stoul"), StdSymbol::Stoul},
+    {llvm::StringLiteral("stoull"), StdSymbol::Stoull},
+    {llvm::StringLiteral("to_string"), StdSymbol::ToString},
+
+    {llvm::StringLiteral("cerr"), StdSymbol::Cerr},
+    {llvm::StringLiteral("clog"), StdSymbol::Clog},
+    {llvm::StringLiteral("cout"), StdSymbol::Cout},
+    {llvm::StringLiteral("endl"), StdSymbol::Endl},
+};
+
+/// Map a declaration to the key stored in the table: the canonical template
+/// for specializations and templated patterns, the canonical decl otherwise.
+const clang::Decl *symbolKey(const clang::NamedDecl *D) {
+  if (const auto *Spec =
+          llvm::dyn_cast<clang::ClassTemplateSpecializationDecl>(D))
+    return Spec->getSpecializedTemplate()->getCanonicalDecl();
+  if (const auto *RD = llvm::dyn_cast<clang::CXXRecordDecl>(D)) {
+    if (const auto *Tmpl = RD->getDescribedClassTemplate())
+      return Tmpl->getCanonicalDecl();
+  }
+  if (const auto *FD = llvm::dyn_cast<clang::FunctionDecl>(D)) {
+    if (const auto *Tmpl = FD->getPrimaryTemplate())
+      return Tmpl->getCanonicalDecl();
+    if (const auto *Tmpl = FD->getDescribedFunctionTemplate())
+      return Tmpl->getCanonicalDecl();
+  }
+  return D->getCanonicalDecl();
+}
+
+} // namespace
+
+StdSymbols::StdSymbols(clang::ASTContext &Ctx) : Ctx(Ctx) {
+  auto &Idents = Ctx.Idents;
+  auto StdLookup =
+      Ctx.getTranslationUnitDecl()->lookup(&Idents.get("std"));
+  for (const clang::NamedDecl *StdND : StdLookup) {
+    const auto *Std = llvm::dyn_cast<clang::NamespaceDecl>(StdND);
+    if (!Std)
+      continue;
+    for (const SymbolName &Known : KnownSymbols) {
+      for (const clang::NamedDecl *D : Std->lookup(&Idents.get(Known.Name))) {
+        D = D->getUnderlyingDecl();
+        Symbols.try_emplace(symbolKey(D), Known.Symbol);
+      }
+    }
+  }
+}
+
+const StdSymbols &StdSymbols::get(clang::ASTContext &Ctx) {
+  return getPerTU<StdSymbols>(Ctx);
+}
+
+std::optional<StdSymbol>
+StdSymbols::classify(const clang::NamedDecl *D) const {
+  if (!D || Symbols.empty())
+    return std::nullopt;
+  auto It = Symbols.find(symbolKey(D));
+  if (It == Symbols.end())
+    return std::nullopt;
+  return It->second;
+}
+
+bool StdSymbols::declaresMethod(const clang::CXXRecordDecl *RD,
+                                llvm::StringRef Name) const {
+  if (!RD)
+    return false;
+  const clang::IdentifierInfo *II = &Ctx.Idents.get(Name);
+  auto [It, Inserted] = MethodCache.try_emplace({RD, II}, false);
+  if (!Inserted)
+    return It->second;
+
+  for (const clang::CXXMethodDecl *M : RD->methods()) {
+    if (M->getIdentifier() == II) {
+      It->second = true;
+      break;
+    }
+  }
+  return It->second;
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
@@ -0,0 +1,183 @@
+//===--- StdSymbols.h - Per-TU resolved std:: symbol table ------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// Nearly every check asks "is this the std::function template?" or "is this
+// call to std::stoi?".  Spelling that as `hasName("::std::function")` builds
+// and compares a qualified-name string for every candidate declaration, in
+// every check.  StdSymbols resolves the std templates, functions and objects
+// the checks care about once per translation unit by looking them up in
+// namespace std, and records their canonical declarations.  The isStdSymbol()
+// matcher then answers with a pointer lookup.
+//
+// The table also memoizes per-record facts (e.g. "does this class declare
+// a contains() method?") that would otherwise be recomputed per match.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_STD_SYMBOLS_H
+#define HL_TIDY_UTILS_STD_SYMBOLS_H
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/ASTMatchers/ASTMatchers.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <bitset>
+#include <initializer_list>
+#include <optional>
+#include <utility>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+/// std:: declarations known to the checks.  Class templates are identified
+/// by their template, so every specialization (std::map<K, V>) classifies as
+/// the template itself.
+enum class StdSymbol : unsigned {
+  // Class templates, classes and typedefs.
+  Any,
+  Array,
+  Atomic,
+  AtomicFlag,
+  Barrier,
+  BasicFstream,
+  BasicIfstream,
+  BasicIstringstream,
+  BasicOfstream,
+  BasicOstringstream,
+  BasicRegex,
+  BasicString,
+  BasicStringstream,
+  ConditionVariable,
+  ConditionVariableAny,
+  CountingSemaphore,
+  Deque,
+  ForwardList,
+  Function,
+  Istringstream,
+  Latch,
+  List,
+  LockGuard,
+  Map,
+  Multimap,
+  Multiset,
+  Mutex,
+  Optional,
+  Ostringstream,
+  RecursiveMutex,
+  RecursiveTimedMutex,
+  Regex,
+  ScopedLock,
+  Set,
+  SharedLock,
+  SharedMutex,
+  SharedPtr,
+  SharedTimedMutex,
+  Stringstream,
+  Thread,
+  TimedMutex,
+  UniqueLock,
+  UnorderedMap,
+  UnorderedSet,
+  Vector,
+  WRegex,
+
+  // Functions and function templates.
+  AnyCast,
+  Bind,
+  BindBack,
+  BindFront,
+  MakeShared,
+  RegexMatch,
+  RegexReplace,
+  RegexSearch,
+  Stod,
+  Stof,
+  Stoi,
+  Stol,
+  Stold,
+  Stoll,
+  Stoul,
+  Stoull,
+  ToString,
+
+  // Objects and manipulators.
+  Cerr,
+  Clog,
+  Cout,
+  Endl,
+
+  NumSymbols
+};
+
+/// A small set of StdSymbol values, used as the matcher parameter.
+class StdSymbolSet {
+public:
+  StdSymbolSet(StdSymbol S) { Bits.set(static_cast<unsigned>(S)); }
+  StdSymbolSet(std::initializer_list<StdSymbol> Symbols) {
+    for (StdSymbol S : Symbols)
+      Bits.set(static_cast<unsigned>(S));
+  }
+
+  bool contains(StdSymbol S) const {
+    return Bits.test(static_cast<unsigned>(S));
+  }
+
+private:
+  std::bitset<128> Bits;
+};
+
+class StdSymbols {
+public:
+  /// Resolve all known symbols in the translation unit owning \p Ctx.
+  explicit StdSymbols(clang::ASTContext &Ctx);
+
+  /// Shared per-TU instance; built on first use.
+  static const StdSymbols &get(clang::ASTContext &Ctx);
+
+  /// Classify \p D, looking through template specializations to the
+  /// template they were instantiated from.
+  std::optional<StdSymbol> classify(const clang::NamedDecl *D) const;
+
+  bool is(const clang::NamedDecl *D, StdSymbolSet Symbols) const {
+    auto S = classify(D);
+    return S && Symbols.contains(*S);
+  }
+
+  /// Memoized "does \p RD itself declare a method called \p Name?".
+  /// Matches what `cxxRecordDecl(hasMethod(hasName(Name)))` computes.
+  bool declaresMethod(const clang::CXXRecordDecl *RD,
+                      llvm::StringRef Name) const;
+
+private:
+  clang::ASTContext &Ctx;
+  llvm::DenseMap<const clang::Decl *, StdSymbol> Symbols;
+  mutable llvm::DenseMap<
+      std::pair<const clang::CXXRecordDecl *, const clang::IdentifierInfo *>,
+      bool>
+      MethodCache;
+};
+
+/// Matches a declaration that is (a specialization of) one of \p Symbols.
+///
+/// Usage:
+///   hasType(namedDecl(isStdSymbol(StdSymbol::Function)))
+///   callee(functionDecl(isStdSymbol({StdSymbol::Stoi, StdSymbol::Stol})))
+AST_MATCHER_P(clang::NamedDecl, isStdSymbol, StdSymbolSet, Symbols) {
+  return StdSymbols::get(Finder->getASTContext()).is(&Node, Symbols);
+}
+
+/// Memoized replacement for `hasMethod(hasName(Name))`.
+AST_MATCHER_P(clang::CXXRecordDecl, declaresMethodNamed, std::string, Name) {
+  return StdSymbols::get(Finder->getASTContext()).declaresMethod(&Node, Name);
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_STD_SYMBOLS_H
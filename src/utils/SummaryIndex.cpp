@@ -0,0 +1,288 @@
+//===--- SummaryIndex.cpp - Cross-TU hot-path summaries ---------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "SummaryIndex.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+namespace {
+
+constexpr llvm::StringLiteral SummaryHeader = "hl-tidy-summary 1";
+constexpr llvm::StringLiteral IndexMagic = "HLHOTIX1";
+constexpr size_t IndexHeaderSize = 32;
+constexpr size_t IndexRecordSize = 16;
+
+/// Write \p Data to \p Path under a temporary name and rename it, so that
+/// readers never see half a file.
+bool writeAtomically(llvm::StringRef Path, llvm::StringRef Data) {
+  std::string TmpPath = (Path + ".tmp").str();
+  {
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(TmpPath, EC, llvm::sys::fs::OF_None);
+    if (EC)
+      return false;
+    OS << Data;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      llvm::sys::fs::remove(TmpPath);
+      return false;
+    }
+  }
+  if (llvm::sys::fs::rename(TmpPath, Path)) {
+    llvm::sys::fs::remove(TmpPath);
+    return false;
+  }
+  return true;
+}
+
+void appendLE32(std::string &Out, uint32_t Value) {
+  char Bytes[4];
+  llvm::support::endian::write32le(Bytes, Value);
+  Out.append(Bytes, 4);
+}
+
+void appendLE64(std::string &Out, uint64_t Value) {
+  char Bytes[8];
+  llvm::support::endian::write64le(Bytes, Value);
+  Out.append(Bytes, 8);
+}
+
+} // namespace
+
+bool writeSummary(llvm::StringRef Path,
+                  llvm::ArrayRef<FunctionSummary> Functions) {
+  std::string Out;
+  llvm::raw_string_ostream OS(Out);
+  OS << SummaryHeader << '\n';
+  for (const FunctionSummary &F : Functions) {
+    OS << "F\t" << static_cast<unsigned>(F.Flags) << '\t' << F.USR << '\t'
+       << F.Name << '\n';
+    for (const std::string &Callee : F.Callees)
+      OS << "C\t" << Callee << '\n';
+  }
+  return writeAtomically(Path, OS.str());
+}
+
+bool readSummary(llvm::StringRef Path, std::vector<FunctionSummary> &Functions,
+                 std::string &Error) {
+  auto Buffer = llvm::MemoryBuffer::getFile(Path, /*IsText=*/true);
+  if (!Buffer) {
+    Error = Buffer.getError().message();
+    return false;
+  }
+  llvm::StringRef Text = (*Buffer)->getBuffer();
+  auto [Header, Body] = Text.split('\n');
+  if (Header.rtrim() != SummaryHeader) {
+    Error = "not an hl-tidy summary";
+    return false;
+  }
+  FunctionSummary *Current = nullptr;
+  while (!Body.empty()) {
+    auto [Line, Rest] = Body.split('\n');
+    Body = Rest;
+    llvm::SmallVector<llvm::StringRef, 4> Fields;
+    Line.rtrim("\r").split(Fields, '\t', 3);
+    if (Fields.size() == 4 && Fields[0] == "F") {
+      FunctionSummary &F = Functions.emplace_back();
+      unsigned Flags = 0;
+      Fields[1].getAsInteger(10, Flags);
+      F.Flags = static_cast<uint8_t>(Flags);
+      F.USR = Fields[2].str();
+      F.Name = Fields[3].str();
+      Current = &F;
+    } else if (Fields.size() == 2 && Fields[0] == "C" && Current) {
+      Current->Callees.push_back(Fields[1].str());
+    }
+  }
+  return true;
+}
+
+std::optional<size_t> buildHotIndex(llvm::ArrayRef<FunctionSummary> Functions,
+                                    llvm::StringRef Path, std::string &Error) {
+  // Inline functions and templates are defined in many TUs; merge them.
+  struct Node {
+    llvm::StringRef Name;
+    uint8_t Flags = 0;
+    llvm::SmallVector<llvm::StringRef, 8> Callees;
+  };
+  llvm::StringMap<Node> Graph;
+  for (const FunctionSummary &F : Functions) {
+    Node &N = Graph[F.USR];
+    if (N.Name.empty())
+      N.Name = F.Name;
+    N.Flags |= F.Flags;
+    for (const std::string &Callee : F.Callees)
+      N.Callees.push_back(Callee);
+  }
+
+  // Hot USR -> name of the root it is reached from.
+  llvm::StringMap<llvm::StringRef> Hot;
+  std::vector<llvm::StringRef> Worklist;
+  for (const auto &Entry : Graph)
+    if (Entry.second.Flags & FunctionSummary::Root) {
+      Hot.try_emplace(Entry.first(), Entry.second.Name);
+      Worklist.push_back(Entry.first());
+    }
+  while (!Worklist.empty()) {
+    llvm::StringRef Caller = Worklist.back();
+    Worklist.pop_back();
+    llvm::StringRef Root = Hot.lookup(Caller);
+    for (llvm::StringRef Callee : Graph.find(Caller)->second.Callees) {
+      auto It = Graph.find(Callee);
+      // Declared but defined nowhere in the program: nothing to report in.
+      if (It == Graph.end() || (It->second.Flags & FunctionSummary::Cold))
+        continue;
+      if (Hot.try_emplace(It->first(), Root).second)
+        Worklist.push_back(It->first());
+    }
+  }
+  for (const auto &Entry : Graph)
+    if (Entry.second.Flags & FunctionSummary::Profiled)
+      Hot.try_emplace(Entry.first(), Entry.second.Name);
+
+  std::string Strings;
+  llvm::StringMap<uint32_t> StringOffsets;
+  std::vector<std::pair<uint64_t, uint32_t>> Records;
+  Records.reserve(Hot.size());
+  for (const auto &Entry : Hot) {
+    auto Inserted = StringOffsets.try_emplace(Entry.second, Strings.size());
+    if (Inserted.second) {
+      Strings += Entry.second;
+      Strings += '\0';
+    }
+    Records.emplace_back(llvm::xxHash64(Entry.first()),
+                         Inserted.first->second);
+  }
+  llvm::sort(Records);
+  Records.erase(std::unique(Records.begin(), Records.end(),
+                            [](const auto &A, const auto &B) {
+                              return A.first == B.first;
+                            }),
+                Records.end());
+
+  std::string Body;
+  Body.reserve(Records.size() * IndexRecordSize + Strings.size());
+  for (const auto &Record : Records) {
+    appendLE64(Body, Record.first);
+    appendLE32(Body, Record.second);
+    appendLE32(Body, 0);
+  }
+  Body += Strings;
+
+  std::string Out(IndexMagic);
+  appendLE32(Out, static_cast<uint32_t>(Records.size()));
+  appendLE32(Out, 0);
+  appendLE64(Out, IndexHeaderSize + Records.size() * IndexRecordSize);
+  appendLE64(Out, llvm::xxHash64(Body));
+  Out += Body;
+  if (!writeAtomically(Path, Out)) {
+    Error = "cannot write " + Path.str();
+    return std::nullopt;
+  }
+  return Records.size();
+}
+
+std::unique_ptr<HotIndex> HotIndex::open(llvm::StringRef Path,
+                                         std::string &Error) {
+  // Large files are mapped rather than read.
+  auto Buffer = llvm::MemoryBuffer::getFile(Path, /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+  if (!Buffer) {
+    Error = Buffer.getError().message();
+    return nullptr;
+  }
+  llvm::StringRef Data = (*Buffer)->getBuffer();
+  if (Data.size() < IndexHeaderSize || !Data.starts_with(IndexMagic)) {
+    Error = "not an hl-tidy hot-path index";
+    return nullptr;
+  }
+  using namespace llvm::support;
+  uint32_t Count = endian::read32le(Data.data() + 8);
+  uint64_t StringsOffset = endian::read64le(Data.data() + 16);
+  if (StringsOffset != IndexHeaderSize + uint64_t(Count) * IndexRecordSize ||
+      StringsOffset > Data.size()) {
+    Error = "truncated hot-path index";
+    return nullptr;
+  }
+
+  auto Index = std::make_unique<HotIndex>();
+  Index->Records = Data.data() + IndexHeaderSize;
+  Index->Count = Count;
+  Index->Strings = Data.drop_front(StringsOffset);
+  Index->Digest = endian::read64le(Data.data() + 24);
+  Index->Buffer = std::move(*Buffer);
+  return Index;
+}
+
+std::shared_ptr<const HotIndex> HotIndex::acquire(llvm::StringRef Path) {
+  struct Entry {
+    llvm::sys::TimePoint<> ModTime;
+    uint64_t Size = 0;
+    std::shared_ptr<const HotIndex> Opened;
+  };
+  static std::mutex Mutex;
+  static llvm::StringMap<Entry> Opened;
+
+  llvm::sys::fs::file_status Status;
+  bool Exists = !llvm::sys::fs::status(Path, Status);
+
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto It = Opened.find(Path);
+  if (It != Opened.end() &&
+      (!Exists || (It->second.ModTime == Status.getLastModificationTime() &&
+                   It->second.Size == Status.getSize())))
+    return It->second.Opened;
+
+  Entry &Slot = Opened[Path];
+  if (Exists) {
+    Slot.ModTime = Status.getLastModificationTime();
+    Slot.Size = Status.getSize();
+  }
+  std::string Error;
+  Slot.Opened = open(Path, Error);
+  if (!Slot.Opened)
+    llvm::errs() << "hl-module.HotIndex: cannot open '" << Path
+                 << "': " << Error << "\n";
+  return Slot.Opened;
+}
+
+std::optional<llvm::StringRef> HotIndex::rootOf(llvm::StringRef USR) const {
+  using namespace llvm::support;
+  uint64_t Hash = llvm::xxHash64(USR);
+  uint32_t Low = 0, High = Count;
+  while (Low < High) {
+    uint32_t Mid = Low + (High - Low) / 2;
+    const char *Record = Records + size_t(Mid) * IndexRecordSize;
+    uint64_t MidHash = endian::read64le(Record);
+    if (MidHash < Hash) {
+      Low = Mid + 1;
+    } else if (MidHash > Hash) {
+      High = Mid;
+    } else {
+      uint32_t Offset = endian::read32le(Record + 8);
+      if (Offset >= Strings.size())
+        return std::nullopt;
+      return Strings.drop_front(Offset).take_until(
+          [](char C) { return C == '\0'; });
+    }
+  }
+  return std::nullopt;
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
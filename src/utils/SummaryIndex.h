@@ -0,0 +1,113 @@
+//===--- SummaryIndex.h - Cross-TU hot-path summaries and index -*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// Hot-path scoping (HotPath.h) stops at the TU boundary: a request handler
+// that calls into helpers defined in another TU does not make them hot.  The
+// two-phase mode carries hotness across TUs:
+//
+//   1. With `hl-module.SummaryDir` set, every TU writes a summary of the
+//      functions it defines: USR, name, whether it is a hot root (annotated
+//      or matching `hl-module.HotFunctions`), whether it is hot in the
+//      profile, whether it is `[[gnu::cold]]`, and the USRs it calls.
+//   2. `hl-tidy-index -o hot.idx <SummaryDir>` merges the summaries,
+//      propagates hotness from the roots over the whole-program call graph
+//      and writes the index.
+//   3. With `hl-module.HotIndex=hot.idx`, the checks treat every function in
+//      the index as hot.
+//
+// Only the result of the propagation is stored, as a table of fixed-size
+// records sorted by USR hash.  The file is memory-mapped and searched in
+// place, so opening it costs the same for a ten-TU and a ten-thousand-TU
+// program and a TU only touches the pages its own functions hash to.
+//
+//   header   "HLHOTIX1", u32 record count, u32 reserved,
+//            u64 string table offset, u64 content hash
+//   records  { u64 xxHash64(USR), u32 root name offset, u32 reserved }
+//   strings  NUL-terminated root names
+//
+// All integers are little-endian.  This file only depends on LLVMSupport, so
+// hl-tidy-index does not link clang.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_SUMMARY_INDEX_H
+#define HL_TIDY_UTILS_SUMMARY_INDEX_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+/// One function definition in a phase-one summary.
+struct FunctionSummary {
+  enum : uint8_t {
+    /// Annotated hot or named by hl-module.HotFunctions; hotness flows to
+    /// its callees.
+    Root = 1,
+    /// Hot in the profile; hot itself, but the profile already accounts for
+    /// its callees.
+    Profiled = 2,
+    /// [[gnu::cold]]; hotness never flows into it.
+    Cold = 4,
+  };
+
+  std::string USR;
+  std::string Name;
+  uint8_t Flags = 0;
+  std::vector<std::string> Callees;
+};
+
+/// Write the summary of one TU to \p Path, atomically.
+bool writeSummary(llvm::StringRef Path,
+                  llvm::ArrayRef<FunctionSummary> Functions);
+
+/// Append the functions of the summary at \p Path to \p Functions.
+bool readSummary(llvm::StringRef Path, std::vector<FunctionSummary> &Functions,
+                 std::string &Error);
+
+/// Merge \p Functions from all summaries, propagate hotness and write the
+/// index to \p Path.  Returns the number of hot functions.
+std::optional<size_t> buildHotIndex(llvm::ArrayRef<FunctionSummary> Functions,
+                                    llvm::StringRef Path, std::string &Error);
+
+/// A memory-mapped index written by buildHotIndex().
+class HotIndex {
+public:
+  /// Map the index at \p Path, or return null if it is missing or corrupt.
+  static std::unique_ptr<HotIndex> open(llvm::StringRef Path,
+                                        std::string &Error);
+
+  /// Return the index named by \p Path, opening it on first use in the
+  /// process; errors are reported once.  Shared by all TUs and threads.
+  static std::shared_ptr<const HotIndex> acquire(llvm::StringRef Path);
+
+  /// The root through which the function with \p USR is hot, if it is.
+  std::optional<llvm::StringRef> rootOf(llvm::StringRef USR) const;
+
+  /// Hash of the index contents, for cache keys.
+  uint64_t digest() const { return Digest; }
+
+private:
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  const char *Records = nullptr;
+  uint32_t Count = 0;
+  llvm::StringRef Strings;
+  uint64_t Digest = 0;
+};
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_SUMMARY_INDEX_H
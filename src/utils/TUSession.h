@@ -0,0 +1,61 @@
+//===--- TUSession.h - State shared by the checks of one TU -----*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// TranslationUnitCache.h hands out per-ASTContext analysis objects, but some
+// module-wide state has to exist before there is an ASTContext: it is set up
+// from the check constructors and from registerPPCallbacks().  clang-tidy
+// creates all checks for a TU together and destroys them together, so a
+// shared_ptr held by each check gives an object that lives exactly as long
+// as the TU's checks do.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_TU_SESSION_H
+#define HL_TIDY_UTILS_TU_SESSION_H
+
+#include "clang-tidy/ClangTidyDiagnosticConsumer.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+/// Return the \p T shared by all checks created for the file \p Context is
+/// currently processing, creating it with \p Make() if no live instance
+/// exists.  \p Make may return null to leave the feature disabled.
+template <typename T, typename MakeFn>
+std::shared_ptr<T> acquireTUSession(clang::tidy::ClangTidyContext &Context,
+                                    MakeFn Make) {
+  struct Entry {
+    std::string MainFile;
+    std::weak_ptr<T> Session;
+  };
+  static std::mutex RegistryMutex;
+  static llvm::DenseMap<const clang::tidy::ClangTidyContext *, Entry>
+      Registry;
+
+  std::string MainFile = Context.getCurrentFile().str();
+  std::lock_guard<std::mutex> Lock(RegistryMutex);
+  Entry &Slot = Registry[&Context];
+  if (Slot.MainFile == MainFile) {
+    if (auto Existing = Slot.Session.lock())
+      return Existing;
+  }
+  std::shared_ptr<T> Session = Make();
+  Slot.MainFile = std::move(MainFile);
+  Slot.Session = Session;
+  return Session;
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_TU_SESSION_H
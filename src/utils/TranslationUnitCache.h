@@ -0,0 +1,116 @@
+//===--- TranslationUnitCache.h - Per-TU shared analysis state --*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// clang-tidy creates a fresh set of check objects for every translation unit,
+// but the checks have no place to share work with each other.  This header
+// provides a tiny registry that lazily builds one instance of an analysis
+// object per ASTContext and hands the same instance to every check that asks
+// for it.  The instance is released together with the ASTContext.
+//
+// The registry is shared by all threads of a process (see hl-tidy-run), but
+// an ASTContext is only ever used, and destroyed, by one thread, so the lock
+// only guards the map itself and objects are built outside it.  Each thread
+// also remembers the last object it got for each type, so the lookups every
+// matcher callback makes (StdSymbols::get, LoopContext::get) do not take the
+// lock at all.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_TRANSLATION_UNIT_CACHE_H
+#define HL_TIDY_UTILS_TRANSLATION_UNIT_CACHE_H
+
+#include "clang/AST/ASTContext.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+namespace detail {
+
+template <typename T> struct PerTUStorage {
+  std::mutex Mutex;
+  llvm::DenseMap<const clang::ASTContext *, std::unique_ptr<T>> Map;
+};
+
+template <typename T> PerTUStorage<T> &perTUStorage() {
+  static PerTUStorage<T> Storage;
+  return Storage;
+}
+
+/// The last object of type T this thread looked up, and its ASTContext.
+template <typename T> struct LastLookup {
+  const clang::ASTContext *Ctx = nullptr;
+  T *Object = nullptr;
+};
+
+template <typename T> LastLookup<T> &lastLookup() {
+  static thread_local LastLookup<T> Last;
+  return Last;
+}
+
+template <typename T> void releasePerTU(void *Ctx) {
+  // Runs on the thread that owns Ctx, the only one that can have cached
+  // it; a later ASTContext may reuse the address.
+  if (lastLookup<T>().Ctx == Ctx)
+    lastLookup<T>() = {};
+  auto &Storage = perTUStorage<T>();
+  std::unique_ptr<T> Released;
+  {
+    std::lock_guard<std::mutex> Lock(Storage.Mutex);
+    auto It = Storage.Map.find(static_cast<const clang::ASTContext *>(Ctx));
+    if (It == Storage.Map.end())
+      return;
+    Released = std::move(It->second);
+    Storage.Map.erase(It);
+  }
+}
+
+} // namespace detail
+
+/// Return the analysis object of type \p T for the translation unit owning
+/// \p Ctx, constructing it with `T(Ctx, Args...)` on first use.
+///
+/// T must be constructible from `clang::ASTContext &` and \p Args.  Only the
+/// first call for a TU uses \p Args, so they must not differ between the
+/// checks of one TU (module options do not).  The object lives until the
+/// ASTContext is destroyed, so it may keep raw pointers into the AST.
+template <typename T, typename... ArgTs>
+T &getPerTU(clang::ASTContext &Ctx, ArgTs &&...Args) {
+  detail::LastLookup<T> &Last = detail::lastLookup<T>();
+  if (Last.Ctx == &Ctx)
+    return *Last.Object;
+
+  auto &Storage = detail::perTUStorage<T>();
+  {
+    std::lock_guard<std::mutex> Lock(Storage.Mutex);
+    auto It = Storage.Map.find(&Ctx);
+    if (It != Storage.Map.end()) {
+      Last = {&Ctx, It->second.get()};
+      return *It->second;
+    }
+  }
+
+  // Building T may walk the whole AST; do it without blocking other TUs.
+  auto Built = std::make_unique<T>(Ctx, std::forward<ArgTs>(Args)...);
+  T &Result = *Built;
+  {
+    std::lock_guard<std::mutex> Lock(Storage.Mutex);
+    Storage.Map[&Ctx] = std::move(Built);
+  }
+  Ctx.AddDeallocation(&detail::releasePerTU<T>, &Ctx);
+  Last = {&Ctx, &Result};
+  return Result;
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_TRANSLATION_UNIT_CACHE_H
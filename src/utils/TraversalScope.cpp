@@ -0,0 +1,75 @@
+//===--- TraversalScope.cpp - Skip system and vendor code -----*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "TraversalScope.h"
+#include "ModuleOptions.h"
+#include "TranslationUnitCache.h"
+
+#include <vector>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+namespace {
+
+/// Marks a TU whose traversal scope has already been narrowed.  Every hl-*
+/// check gets the translation-unit callback; only the first one does work.
+struct ScopeApplied {
+  explicit ScopeApplied(clang::ASTContext &) {}
+  bool Done = false;
+};
+
+} // namespace
+
+PathFilter::PathFilter(const clang::tidy::ClangTidyContext &Context)
+    : ExcludeSystemHeaders(
+          getModuleFlag(Context, "ExcludeSystemHeaders", false)),
+      Analyzed(getModuleRegex(Context, "AnalyzedPaths")),
+      Excluded(getModuleRegex(Context, "ExcludedPaths")) {}
+
+bool PathFilter::shouldAnalyze(const clang::SourceManager &SM,
+                               clang::SourceLocation Loc) const {
+  if (Loc.isInvalid())
+    return true;
+  Loc = SM.getExpansionLoc(Loc);
+  if (SM.isInMainFile(Loc))
+    return true;
+  if (ExcludeSystemHeaders && SM.isInSystemHeader(Loc))
+    return false;
+  if (!Analyzed && !Excluded)
+    return true;
+
+  llvm::StringRef File = SM.getFilename(Loc);
+  if (File.empty())
+    return true;
+  if (Analyzed && !Analyzed->match(File))
+    return false;
+  if (Excluded && Excluded->match(File))
+    return false;
+  return true;
+}
+
+void PathFilter::applyTo(clang::ASTContext &Ctx) const {
+  auto &Applied = getPerTU<ScopeApplied>(Ctx);
+  if (Applied.Done)
+    return;
+  Applied.Done = true;
+
+  const clang::SourceManager &SM = Ctx.getSourceManager();
+  std::vector<clang::Decl *> Scope;
+  bool Dropped = false;
+  for (clang::Decl *D : Ctx.getTranslationUnitDecl()->decls()) {
+    if (shouldAnalyze(SM, D->getLocation()))
+      Scope.push_back(D);
+    else
+      Dropped = true;
+  }
+  // Leave the default scope (the TU itself) alone when nothing is excluded.
+  if (Dropped)
+    Ctx.setTraversalScope(Scope);
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
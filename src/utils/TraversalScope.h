@@ -0,0 +1,68 @@
+//===--- TraversalScope.h - Skip system and vendor code -------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// Checks normally match everything in the TU and rely on clang-tidy's
+// HeaderFilterRegex to drop diagnostics from headers afterwards, so the
+// matchers still pay for every node of boost, abseil or generated protobuf
+// code.  PathFilter reads the hl-module.* path options and, once per TU,
+// narrows the ASTContext traversal scope to the top-level declarations that
+// pass it, so excluded code is never visited at all.
+//
+//   hl-module.ExcludeSystemHeaders  skip declarations in system headers
+//   hl-module.AnalyzedPaths         regex; only files matching it are visited
+//   hl-module.ExcludedPaths         regex; files matching it are skipped
+//
+// The main file is always analysed.  Filtering works on top-level
+// declarations (namespaces, classes, functions at TU scope), keyed on the
+// file their location expands to.
+//
+// NOTE: the traversal scope belongs to the ASTContext, so it also applies to
+// every other check running in the same clang-tidy process.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_TRAVERSAL_SCOPE_H
+#define HL_TIDY_UTILS_TRAVERSAL_SCOPE_H
+
+#include "clang-tidy/ClangTidyDiagnosticConsumer.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/Basic/SourceManager.h"
+#include "llvm/Support/Regex.h"
+
+#include <optional>
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+class PathFilter {
+public:
+  /// Read the filter options for the file \p Context is processing.
+  explicit PathFilter(const clang::tidy::ClangTidyContext &Context);
+
+  /// True if any option restricts what is analysed.
+  bool isEnabled() const {
+    return ExcludeSystemHeaders || Analyzed || Excluded;
+  }
+
+  /// Whether code at \p Loc should be visited.
+  bool shouldAnalyze(const clang::SourceManager &SM,
+                     clang::SourceLocation Loc) const;
+
+  /// Narrow the traversal scope of \p Ctx to the top-level declarations
+  /// that pass the filter.  Only the first call per TU has an effect.
+  void applyTo(clang::ASTContext &Ctx) const;
+
+private:
+  bool ExcludeSystemHeaders;
+  std::optional<llvm::Regex> Analyzed;
+  std::optional<llvm::Regex> Excluded;
+};
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_TRAVERSAL_SCOPE_H
@@ -0,0 +1,575 @@
+//===--- VariableUses.cpp - How a local variable is used --------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+
+#include "VariableUses.h"
+
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/ParentMapContext.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "llvm/ADT/StringSwitch.h"
+
+using namespace clang::ast_matchers;
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+namespace {
+
+/// std::move, std::forward and the functions that take their argument's
+/// value away.
+bool isTransfer(const clang::FunctionDecl *Callee) {
+  if (!Callee || !Callee->isInStdNamespace() || !Callee->getIdentifier())
+    return false;
+  return llvm::StringSwitch<bool>(Callee->getName())
+      .Cases("move", "forward", "move_if_noexcept", "swap", "exchange", true)
+      .Default(false);
+}
+
+/// Standard container members that store a copy of a const reference
+/// argument.
+bool isInsertion(const clang::FunctionDecl *Callee) {
+  const auto *Method = llvm::dyn_cast<clang::CXXMethodDecl>(Callee);
+  if (!Method || !Method->getParent()->isInStdNamespace() ||
+      !Method->getIdentifier())
+    return false;
+  return llvm::StringSwitch<bool>(Method->getName())
+      .Cases("push_back", "push_front", "insert", "emplace", "emplace_back",
+             true)
+      .Cases("emplace_front", "emplace_hint", "try_emplace",
+             "insert_or_assign", true)
+      .Default(false);
+}
+
+/// True if \p Method is the non-const half of a const / non-const pair such
+/// as operator[], front() or begin(), which a non-const object selects even
+/// when it is only read.
+bool hasConstOverload(const clang::CXXMethodDecl *Method) {
+  for (const clang::NamedDecl *D : Method->getParent()->lookup(
+           Method->getDeclName())) {
+    const auto *Other = llvm::dyn_cast<clang::CXXMethodDecl>(D);
+    if (Other && Other != Method && Other->isConst() &&
+        Other->getNumParams() == Method->getNumParams())
+      return true;
+  }
+  return false;
+}
+
+/// Index of \p Arg among the arguments of \p Call, or -1.
+template <typename CallT> int argumentIndex(const CallT *Call,
+                                            const clang::Expr *Arg) {
+  for (unsigned I = 0, N = Call->getNumArgs(); I != N; ++I)
+    if (Call->getArg(I) == Arg)
+      return static_cast<int>(I);
+  return -1;
+}
+
+/// Passing the variable, or one of its elements if \p Element, to parameter
+/// \p Index of \p Callee.
+void classifyArgument(const clang::FunctionDecl *Callee, int Index,
+                      bool Element, VariableUses &Uses) {
+  if (!Callee || Index < 0 ||
+      static_cast<unsigned>(Index) >= Callee->getNumParams()) {
+    // Through a function pointer, or into a C variadic.
+    Uses.Escaped = true;
+    return;
+  }
+  clang::QualType Param = Callee->getParamDecl(Index)->getType();
+  if (Param->isRValueReferenceType())
+    Uses.Moved = true;
+  else if (Param->isLValueReferenceType() &&
+           !Param.getNonReferenceType().isConstQualified())
+    Uses.Modifiers.push_back(Callee);
+  else if (Param->isLValueReferenceType() && isInsertion(Callee) && !Element)
+    Uses.Copied = true;
+  // By value: a record goes through a CXXConstructExpr, a scalar is read.
+}
+
+/// A reference from inside a lambda body to the variable it captured.
+void classifyCapture(const clang::DeclRefExpr *Ref, const clang::ValueDecl *Var,
+                     clang::ASTContext &Ctx, VariableUses &Uses) {
+  clang::DynTypedNodeList Parents = Ctx.getParents(*Ref);
+  while (!Parents.empty()) {
+    if (const auto *Lambda = Parents[0].get<clang::LambdaExpr>()) {
+      for (const clang::LambdaCapture &C : Lambda->captures()) {
+        if (!C.capturesVariable() || C.getCapturedVar() != Var)
+          continue;
+        if (C.getCaptureKind() == clang::LCK_ByRef)
+          Uses.Escaped = true;
+        else
+          Uses.Copied = true;
+        return;
+      }
+    }
+    Parents = Ctx.getParents(Parents[0]);
+  }
+  Uses.Escaped = true;
+}
+
+/// The variable initializes the implicit range variable of a range-for:
+/// the elements are modified if the loop variable is a non-const reference.
+void classifyRange(const clang::VarDecl *Range, clang::ASTContext &Ctx,
+                   VariableUses &Uses) {
+  for (const clang::DynTypedNode &Stmt : Ctx.getParents(*Range)) {
+    for (const clang::DynTypedNode &Loop : Ctx.getParents(Stmt)) {
+      const auto *For = Loop.get<clang::CXXForRangeStmt>();
+      if (!For || For->getRangeStmt() != Stmt.get<clang::Stmt>())
+        continue;
+      clang::QualType Element = For->getLoopVariable()->getType();
+      if (Element->isReferenceType() &&
+          !Element.getNonReferenceType().isConstQualified())
+        Uses.Modifiers.push_back(nullptr);
+      return;
+    }
+  }
+  Uses.Escaped = true;
+}
+
+/// Standard functions that only read through the iterators they are given:
+/// the non-modifying algorithms and std::next / std::prev, and the
+/// constructors and range members of standard classes, which copy the
+/// range.
+bool readsThrough(const clang::FunctionDecl *Callee) {
+  if (!Callee || !Callee->getIdentifier())
+    return false;
+  if (const auto *Method = llvm::dyn_cast<clang::CXXMethodDecl>(Callee)) {
+    if (!Method->getParent()->isInStdNamespace())
+      return false;
+    return llvm::isa<clang::CXXConstructorDecl>(Method) ||
+           llvm::StringSwitch<bool>(Method->getName())
+               .Cases("insert", "assign", "append", "replace", true)
+               .Default(false);
+  }
+  if (!Callee->isInStdNamespace())
+    return false;
+  return llvm::StringSwitch<bool>(Callee->getName())
+      .Cases("find", "find_if", "find_if_not", "find_first_of",
+             "adjacent_find", true)
+      .Cases("count", "count_if", "all_of", "any_of", "none_of", true)
+      .Cases("equal", "mismatch", "search", "search_n", "includes", true)
+      .Cases("is_sorted", "is_sorted_until", "is_partitioned", "is_heap",
+             "lexicographical_compare", true)
+      .Cases("lower_bound", "upper_bound", "equal_range", "binary_search",
+             true)
+      .Cases("min_element", "max_element", "minmax_element", true)
+      .Cases("accumulate", "reduce", "inner_product", "distance", true)
+      .Cases("next", "prev", true)
+      .Default(false);
+}
+
+/// How many local iterator variables classifyHandle() follows in a chain.
+constexpr unsigned MaxHandleDepth = 4;
+
+/// True if \p T, returned by value from a non-const accessor, can write to
+/// the object it came from: a pointer to non-const, or an iterator.
+bool isMutableHandle(clang::QualType T) {
+  if (T->isPointerType())
+    return !T->getPointeeType().isConstQualified();
+  return T->isRecordType();
+}
+
+bool isComparison(clang::OverloadedOperatorKind Op) {
+  switch (Op) {
+  case clang::OO_EqualEqual:
+  case clang::OO_ExclaimEqual:
+  case clang::OO_Less:
+  case clang::OO_Greater:
+  case clang::OO_LessEqual:
+  case clang::OO_GreaterEqual:
+  case clang::OO_Spaceship:
+    return true;
+  default:
+    return false;
+  }
+}
+
+void classifyUse(const clang::Expr *E, bool Element,
+                 const clang::DeclRefExpr *Ref, const clang::ValueDecl *Var,
+                 clang::ASTContext &Ctx, VariableUses &Uses, unsigned Depth);
+
+/// An iterator or pointer \p E that a non-const accessor returned into the
+/// variable.  Comparing, advancing and reading through it is a read; what
+/// is done to an element it reaches is classified like the element itself.
+/// Handing it to a function modifies the variable, since the function can
+/// write through it, unless the function is known to only read through it
+/// (readsThrough()); anything else escapes.
+void classifyHandle(const clang::Expr *E, clang::ASTContext &Ctx,
+                    VariableUses &Uses, unsigned Depth) {
+  for (;;) {
+    clang::DynTypedNodeList Parents = Ctx.getParents(*E);
+    if (Parents.empty())
+      return;
+    const clang::DynTypedNode &Parent = Parents[0];
+
+    if (const auto *Bound = Parent.get<clang::VarDecl>()) {
+      // A local iterator: follow its own references through the statement
+      // that declares it.
+      clang::DynTypedNodeList Decls = Ctx.getParents(*Bound);
+      const clang::Stmt *Scope = nullptr;
+      if (!Decls.empty() && Decls[0].get<clang::DeclStmt>()) {
+        clang::DynTypedNodeList Scopes = Ctx.getParents(Decls[0]);
+        if (!Scopes.empty())
+          Scope = Scopes[0].get<clang::Stmt>();
+      }
+      if (!Scope || Bound->isImplicit() || !Bound->hasLocalStorage() ||
+          Depth >= MaxHandleDepth) {
+        Uses.Escaped = true;
+        return;
+      }
+      auto Refs = match(
+          findAll(declRefExpr(to(varDecl(equalsNode(Bound)))).bind("ref")),
+          *Scope, Ctx);
+      for (const BoundNodes &Node : Refs)
+        classifyHandle(Node.getNodeAs<clang::DeclRefExpr>("ref"), Ctx, Uses,
+                       Depth + 1);
+      return;
+    }
+
+    const auto *P = Parent.get<clang::Expr>();
+    if (!P)
+      return;
+
+    if (const auto *Cast = llvm::dyn_cast<clang::ImplicitCastExpr>(P)) {
+      if (Cast->getCastKind() == clang::CK_PointerToBoolean)
+        return;
+      E = P;
+      continue;
+    }
+    if (llvm::isa<clang::ParenExpr, clang::MaterializeTemporaryExpr,
+                  clang::CXXBindTemporaryExpr, clang::ExprWithCleanups>(P)) {
+      E = P;
+      continue;
+    }
+    if (const auto *Construct = llvm::dyn_cast<clang::CXXConstructExpr>(P)) {
+      if (Construct->getConstructor()->isCopyOrMoveConstructor()) {
+        E = P;
+        continue;
+      }
+    }
+
+    if (const auto *Unary = llvm::dyn_cast<clang::UnaryOperator>(P)) {
+      if (Unary->isIncrementDecrementOp()) {
+        E = P;
+        continue;
+      }
+      if (Unary->getOpcode() == clang::UO_Deref)
+        classifyUse(P, /*Element=*/true, nullptr, nullptr, Ctx, Uses, Depth);
+      else if (Unary->getOpcode() == clang::UO_AddrOf)
+        Uses.Escaped = true;
+      return;
+    }
+
+    if (const auto *Subscript = llvm::dyn_cast<clang::ArraySubscriptExpr>(P)) {
+      if (Subscript->getBase() == E)
+        classifyUse(P, /*Element=*/true, nullptr, nullptr, Ctx, Uses, Depth);
+      return;
+    }
+
+    if (const auto *Member = llvm::dyn_cast<clang::MemberExpr>(P)) {
+      if (!Member->isArrow() || Member->getBase() != E) {
+        Uses.Escaped = true;
+        return;
+      }
+      const auto *Method =
+          llvm::dyn_cast<clang::CXXMethodDecl>(Member->getMemberDecl());
+      if (!Method)
+        classifyUse(P, /*Element=*/true, nullptr, nullptr, Ctx, Uses, Depth);
+      else if (!Method->isStatic() && !Method->isConst())
+        Uses.Modifiers.push_back(Method);
+      return;
+    }
+
+    if (const auto *Binary = llvm::dyn_cast<clang::BinaryOperator>(P)) {
+      if (Binary->isComparisonOp() ||
+          (Binary->isAssignmentOp() && Binary->getLHS() == E))
+        return;
+      if (Binary->isAdditiveOp()) {
+        E = P;
+        continue;
+      }
+      Uses.Escaped = true;
+      return;
+    }
+
+    if (const auto *Op = llvm::dyn_cast<clang::CXXOperatorCallExpr>(P)) {
+      clang::OverloadedOperatorKind Kind = Op->getOperator();
+      if (isComparison(Kind))
+        return;
+      if (Op->getArg(0) != E) {
+        Uses.Escaped = true;
+        return;
+      }
+      switch (Kind) {
+      case clang::OO_Star:
+      case clang::OO_Subscript:
+        classifyUse(P, /*Element=*/true, nullptr, nullptr, Ctx, Uses, Depth);
+        return;
+      case clang::OO_Arrow:
+      case clang::OO_PlusPlus:
+      case clang::OO_MinusMinus:
+      case clang::OO_Plus:
+      case clang::OO_Minus:
+      case clang::OO_PlusEqual:
+      case clang::OO_MinusEqual:
+        E = P;
+        continue;
+      case clang::OO_Equal:
+        return;
+      default:
+        Uses.Escaped = true;
+        return;
+      }
+    }
+
+    // Writing through an iterator changes elements but cannot resize the
+    // variable, so it is not attributed to the callee.
+    if (const auto *Construct = llvm::dyn_cast<clang::CXXConstructExpr>(P)) {
+      if (!readsThrough(Construct->getConstructor()))
+        Uses.Modifiers.push_back(nullptr);
+      return;
+    }
+    if (const auto *Call = llvm::dyn_cast<clang::CallExpr>(P)) {
+      const clang::FunctionDecl *Callee = Call->getDirectCallee();
+      if (!readsThrough(Callee)) {
+        Uses.Modifiers.push_back(nullptr);
+        return;
+      }
+      // std::find() and the like return an iterator into the same range.
+      if (!llvm::isa<clang::CXXMethodDecl>(Callee) &&
+          Ctx.hasSameUnqualifiedType(P->getType(), E->getType())) {
+        E = P;
+        continue;
+      }
+      if (!llvm::isa<clang::CXXMethodDecl>(Callee) &&
+          isMutableHandle(P->getType()))
+        Uses.Escaped = true;
+      return;
+    }
+
+    Uses.Escaped = true;
+    return;
+  }
+}
+
+/// Walk up from \p E, which denotes the variable (or, if \p Element, one of
+/// its fields or elements), through the expressions that still denote it,
+/// to the one that consumes it.  \p Ref is the reference the walk started
+/// from, if any.
+void classifyUse(const clang::Expr *E, bool Element,
+                 const clang::DeclRefExpr *Ref, const clang::ValueDecl *Var,
+                 clang::ASTContext &Ctx, VariableUses &Uses, unsigned Depth) {
+  // Copying an element out is a read of the variable.
+  auto Copy = [&] {
+    if (!Element)
+      Uses.Copied = true;
+  };
+  for (;;) {
+    clang::DynTypedNodeList Parents = Ctx.getParents(*E);
+    if (Parents.empty())
+      return;
+    const clang::DynTypedNode &Parent = Parents[0];
+
+    if (Parent.get<clang::ReturnStmt>()) {
+      // A local or parameter named by `return` is moved from; a field of it
+      // is copied.
+      if (E == Ref && !Var->getType()->isReferenceType())
+        Uses.Moved = true;
+      else
+        Copy();
+      return;
+    }
+
+    if (const auto *Bound = Parent.get<clang::VarDecl>()) {
+      clang::QualType T = Bound->getType();
+      if (!T->isReferenceType() || T.getNonReferenceType().isConstQualified())
+        return;
+      if (Bound->isImplicit())
+        classifyRange(Bound, Ctx, Uses);
+      else
+        Uses.Escaped = true;
+      return;
+    }
+
+    const auto *P = Parent.get<clang::Expr>();
+    if (!P)
+      return;
+
+    if (llvm::isa<clang::ParenExpr>(P)) {
+      E = P;
+      continue;
+    }
+
+    if (const auto *Cast = llvm::dyn_cast<clang::ImplicitCastExpr>(P)) {
+      if (Cast->getCastKind() == clang::CK_LValueToRValue)
+        return;
+      if (Cast->getCastKind() == clang::CK_ArrayToPointerDecay) {
+        // Indexing an array member still denotes (part of) the variable.
+        clang::DynTypedNodeList Users = Ctx.getParents(*Cast);
+        const auto *Subscript =
+            Users.empty() ? nullptr
+                          : Users[0].get<clang::ArraySubscriptExpr>();
+        if (!Subscript || Subscript->getBase() != Cast) {
+          Uses.Escaped = true;
+          return;
+        }
+        E = Subscript;
+        continue;
+      }
+      E = P;
+      continue;
+    }
+
+    if (const auto *Cond =
+            llvm::dyn_cast<clang::AbstractConditionalOperator>(P)) {
+      if (Cond->getCond() == E)
+        return;
+      E = P;
+      continue;
+    }
+
+    if (const auto *Member = llvm::dyn_cast<clang::MemberExpr>(P)) {
+      if (Member->getBase() != E || Member->isArrow())
+        return;
+      if (const auto *Method =
+              llvm::dyn_cast<clang::CXXMethodDecl>(Member->getMemberDecl())) {
+        if (Method->isStatic() || Method->isConst())
+          return;
+        if (!hasConstOverload(Method)) {
+          Uses.Modifiers.push_back(Method);
+          return;
+        }
+        // An accessor: what happens to the element or iterator it returns
+        // decides.
+        clang::DynTypedNodeList Users = Ctx.getParents(*Member);
+        const auto *Call =
+            Users.empty() ? nullptr : Users[0].get<clang::CXXMemberCallExpr>();
+        if (!Call)
+          return;
+        if (!Method->getReturnType()->isLValueReferenceType()) {
+          if (isMutableHandle(Method->getReturnType()))
+            classifyHandle(Call, Ctx, Uses, Depth);
+          return;
+        }
+        E = Call;
+        Element = true;
+        continue;
+      }
+      E = P;
+      continue;
+    }
+
+    if (const auto *Op = llvm::dyn_cast<clang::CXXOperatorCallExpr>(P)) {
+      int Index = argumentIndex(Op, E);
+      const clang::FunctionDecl *Callee = Op->getDirectCallee();
+      if (const auto *Method =
+              llvm::dyn_cast_or_null<clang::CXXMethodDecl>(Callee)) {
+        if (Index == 0) {
+          if (Method->isConst())
+            return;
+          if (!hasConstOverload(Method)) {
+            Uses.Modifiers.push_back(Method);
+            return;
+          }
+          if (!Method->getReturnType()->isLValueReferenceType()) {
+            if (isMutableHandle(Method->getReturnType()))
+              classifyHandle(Op, Ctx, Uses, Depth);
+            return;
+          }
+          E = Op;
+          Element = true;
+          continue;
+        }
+        if (Method->isCopyAssignmentOperator()) {
+          Copy();
+        } else {
+          classifyArgument(Method, Index - 1, Element, Uses);
+        }
+        return;
+      }
+      classifyArgument(Callee, Index, Element, Uses);
+      return;
+    }
+
+    if (const auto *Call = llvm::dyn_cast<clang::CXXMemberCallExpr>(P)) {
+      classifyArgument(Call->getMethodDecl(), argumentIndex(Call, E), Element,
+                       Uses);
+      return;
+    }
+
+    if (const auto *Call = llvm::dyn_cast<clang::CallExpr>(P)) {
+      const clang::FunctionDecl *Callee = Call->getDirectCallee();
+      if (isTransfer(Callee))
+        Uses.Moved = true;
+      else
+        classifyArgument(Callee, argumentIndex(Call, E), Element, Uses);
+      return;
+    }
+
+    if (const auto *Construct = llvm::dyn_cast<clang::CXXConstructExpr>(P)) {
+      const clang::CXXConstructorDecl *Ctor = Construct->getConstructor();
+      if (Ctor->isCopyConstructor())
+        Copy();
+      else if (Ctor->isMoveConstructor())
+        Uses.Moved = true;
+      else
+        classifyArgument(Ctor, argumentIndex(Construct, E), Element, Uses);
+      return;
+    }
+
+    if (const auto *Unary = llvm::dyn_cast<clang::UnaryOperator>(P)) {
+      if (Unary->getOpcode() == clang::UO_AddrOf)
+        Uses.Escaped = true;
+      else if (Unary->isIncrementDecrementOp())
+        Uses.Modifiers.push_back(nullptr);
+      return;
+    }
+
+    if (const auto *Binary = llvm::dyn_cast<clang::BinaryOperator>(P)) {
+      if (Binary->isAssignmentOp() && Binary->getLHS() == E) {
+        Uses.Modifiers.push_back(nullptr);
+      } else if (Binary->isCommaOp() && Binary->getRHS() == E) {
+        E = P;
+        continue;
+      }
+      return;
+    }
+
+    if (llvm::isa<clang::LambdaExpr>(P)) {
+      // The initializer of a by-reference capture.
+      Uses.Escaped = true;
+      return;
+    }
+
+    return;
+  }
+}
+
+void classify(const clang::DeclRefExpr *Ref, const clang::ValueDecl *Var,
+              clang::ASTContext &Ctx, VariableUses &Uses) {
+  ++Uses.References;
+  if (Ref->refersToEnclosingVariableOrCapture()) {
+    classifyCapture(Ref, Var, Ctx, Uses);
+    return;
+  }
+  classifyUse(Ref, /*Element=*/false, Ref, Var, Ctx, Uses, 0);
+}
+
+} // namespace
+
+VariableUses analyzeUses(const clang::ValueDecl *Var, const clang::Stmt *Scope,
+                         clang::ASTContext &Ctx) {
+  VariableUses Uses;
+  if (!Var || !Scope)
+    return Uses;
+  auto Refs = match(
+      findAll(declRefExpr(to(decl(equalsNode(Var)))).bind("ref")), *Scope,
+      Ctx);
+  for (const BoundNodes &Node : Refs)
+    classify(Node.getNodeAs<clang::DeclRefExpr>("ref"), Var, Ctx, Uses);
+  return Uses;
+}
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
@@ -0,0 +1,84 @@
+//===--- VariableUses.h - How a local variable is used ----------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// Checks that suggest a different declaration for a variable (hoist it out
+// of a loop, take it by reference instead of by value) need to know what the
+// code does with it: whether it is only read, modified in place, moved from,
+// copied elsewhere, or whether a reference to it outlives the statement that
+// made it.  analyzeUses() classifies every reference to the variable inside
+// a statement once, by looking at the expression that consumes it:
+//
+//   - a const member function, a by-value or const-reference argument, a
+//     built-in read: read;
+//   - a non-const member function or operator, a non-const lvalue reference
+//     argument, a built-in assignment or increment: modified;
+//   - std::move / std::forward / std::swap, a move constructor, an rvalue
+//     reference argument, `return`: moved;
+//   - a copy constructor, a by-copy lambda capture, or a const reference
+//     argument of a standard container's push_back / insert / emplace:
+//     copied;
+//   - `&x`, a by-reference lambda capture, a non-const reference variable:
+//     escaped.
+//
+// Field accesses (`x.name`) are classified like the variable itself, and so
+// are elements returned by reference from a non-const accessor that has a
+// const overload (`v[i]`, `v.front()`), except that copying an element out
+// is a read.  Iterators and pointers returned by value from such accessors
+// (`v.begin()`, `m.find(k)`) are followed, through local iterator variables
+// as well: comparing or reading through them is a read, writing through
+// them, or handing them to a function (`std::sort`), modifies the variable
+// unless the function is a non-modifying standard algorithm (`std::find`).
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_UTILS_VARIABLE_USES_H
+#define HL_TIDY_UTILS_VARIABLE_USES_H
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Decl.h"
+#include "clang/AST/Stmt.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace hl {
+namespace tidy {
+namespace utils {
+
+struct VariableUses {
+  /// Functions that modify the variable: its non-const member functions and
+  /// operators, and functions taking it by non-const lvalue reference.  Null
+  /// for built-in assignments and increments, and for writes through an
+  /// iterator into it.
+  llvm::SmallVector<const clang::FunctionDecl *, 4> Modifiers;
+  bool Moved = false;
+  bool Copied = false;
+  bool Escaped = false;
+  /// Number of references to the variable.
+  unsigned References = 0;
+
+  bool isModified() const { return !Modifiers.empty(); }
+  /// True if the variable is only ever read.
+  bool isReadOnly() const { return !isModified() && !Moved && !Escaped; }
+
+  /// Add the uses of another variable, e.g. another binding of the same
+  /// structured binding declaration.
+  void merge(const VariableUses &Other) {
+    Modifiers.append(Other.Modifiers.begin(), Other.Modifiers.end());
+    Moved |= Other.Moved;
+    Copied |= Other.Copied;
+    Escaped |= Other.Escaped;
+    References += Other.References;
+  }
+};
+
+/// Classify every reference to \p Var inside \p Scope.  \p Var is a
+/// variable, a parameter or a structured binding.
+VariableUses analyzeUses(const clang::ValueDecl *Var, const clang::Stmt *Scope,
+                         clang::ASTContext &Ctx);
+
+} // namespace utils
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_UTILS_VARIABLE_USES_H
@@ -0,0 +1,124 @@
+// RUN: %clang_tidy -checks='-*,hl-perf-atomic-memory-order' %s -- -std=c++17 \
+// RUN:   2>&1 | %FileCheck %s --implicit-check-not='warning:'
+// RUN: rm -f %t.cpp && cp %s %t.cpp
+// RUN: %clang_tidy -checks='-*,hl-perf-atomic-memory-order' -fix %t.cpp \
+// RUN:   -- -std=c++17 > /dev/null 2>&1
+// RUN: %FileCheck --check-prefix=FIXED %s < %t.cpp
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+struct Metrics {
+  std::atomic<long> Requests{0};
+  std::atomic<long> Errors{0};
+};
+
+Metrics Stats;
+
+// Other translation units can reach the fields, so they are not rewritten.
+void handle(bool Failed) {
+  // CHECK: :[[@LINE+3]]:3: warning: '++' on counter 'Stats.Requests' uses the default seq_cst ordering; this translation unit only updates 'Stats.Requests', never using it to order other memory, so std::memory_order_relaxed is enough
+  // CHECK: :[[@LINE-9]]:21: note: not rewritten automatically: 'Stats.Requests' is reachable from other translation units, which may use it to order memory
+  // FIXED: {{^}}  ++Stats.Requests;{{$}}
+  ++Stats.Requests;
+  // CHECK: :[[@LINE+3]]:18: warning: 'fetch_add()' on counter 'Stats.Errors' uses the default seq_cst ordering
+  // FIXED: {{^}}    Stats.Errors.fetch_add(1);{{$}}
+  if (Failed)
+    Stats.Errors.fetch_add(1);
+}
+
+namespace {
+std::atomic<long> Retries{0};
+} // namespace
+
+void retry() {
+  // CHECK: :[[@LINE+2]]:3: warning: '++' on counter 'Retries'
+  // FIXED: {{^}}  Retries.fetch_add(1, std::memory_order_relaxed);{{$}}
+  ++Retries;
+}
+
+// Internal, but waited on through a pointer, which needs the ordering.
+namespace {
+std::atomic<int> Finished{0};
+std::atomic<int> *Watched = &Finished;
+} // namespace
+
+void finish() {
+  // CHECK: :[[@LINE+3]]:11: warning: '++' on counter 'Finished'
+  // CHECK: note: not rewritten automatically: 'Finished' is captured by reference or has its address taken
+  // FIXED: {{^}}  Finished++;{{$}}
+  Finished++;
+}
+
+void waitAll(int N) {
+  // CHECK: :[[@LINE+1]]:19: warning: 'load()' on '*Watched' inside a loop
+  while (Watched->load() < N) {
+  }
+}
+
+// Updated like a counter, but its value is returned, and the caller may
+// use it to order other memory.
+std::atomic<unsigned> Seq{0};
+
+void bump() { Seq.fetch_add(1); } // no warning
+
+unsigned version() { return Seq.load(); } // no warning
+
+// A flag that publishes data.
+std::atomic<bool> Ready{false};
+std::vector<int> Data;
+
+void consume() {
+  // CHECK: :[[@LINE+1]]:17: warning: 'load()' on 'Ready' inside a loop uses the default seq_cst ordering, which adds a barrier on every iteration on ARM and POWER; std::memory_order_acquire is enough unless the algorithm needs a single total order over several atomics
+  while (!Ready.load())
+    std::this_thread::yield();
+}
+
+void produce() {
+  Data.push_back(1);
+  Ready.store(true); // no warning
+}
+
+// Updated like a counter, but its value decides when the lock is taken.
+std::atomic<unsigned> Next{0};
+std::atomic<unsigned> Serving{0};
+
+void lock() {
+  unsigned Ticket = Next.fetch_add(1); // no warning
+  // CHECK: :[[@LINE+1]]:18: warning: 'load()' on 'Serving' inside a loop{{.*}}std::memory_order_acquire
+  while (Serving.load() != Ticket) {
+  }
+}
+
+void unlock() { Serving.fetch_add(1); } // no warning
+
+std::atomic<int> Progress{0};
+
+void run(int N) {
+  for (int I = 0; I < N; ++I)
+    // CHECK: :[[@LINE+1]]:14: warning: '=' on 'Progress' inside a loop uses the default seq_cst ordering, a full fence on every iteration; std::memory_order_release is enough
+    Progress = I;
+}
+
+int countEven(const std::vector<int> &Values) {
+  // CHECK: :[[@LINE+1]]:20: warning: 'Even' is a local atomic that never leaves this function: no other thread can reach it, so its 2 operations pay for locked instructions and fences for nothing; use a plain 'int'
+  std::atomic<int> Even{0};
+  for (int V : Values)
+    if (V % 2 == 0)
+      ++Even;
+  return Even.load();
+}
+
+// Shared with a thread, so not reported as local; only updated, so a
+// counter, but captured by reference, so not rewritten.
+void countInThread() {
+  std::atomic<int> Done{0};
+  // CHECK: :[[@LINE+3]]:33: warning: 'fetch_add()' on counter 'Done'
+  // CHECK: :[[@LINE-2]]:20: note: not rewritten automatically: 'Done' is captured by reference or has its address taken, so code using it through a pointer may rely on its ordering
+  // FIXED: {{^}}  std::thread Worker([&] { Done.fetch_add(1); });{{$}}
+  std::thread Worker([&] { Done.fetch_add(1); });
+  Worker.join();
+}
+
+void tick() { Stats.Requests.fetch_add(1, std::memory_order_relaxed); } // no warning
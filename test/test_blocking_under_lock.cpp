@@ -0,0 +1,100 @@
+// RUN: %clang_tidy -checks='-*,hl-perf-blocking-under-lock' %s -- -std=c++17 \
+// RUN:   2>&1 | %FileCheck %s --implicit-check-not='warning:'
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+std::mutex M;
+std::vector<std::string> Lines;
+
+void append(int Fd, const std::string &Line) {
+  std::lock_guard<std::mutex> Guard(M);
+  Lines.push_back(Line);
+  // CHECK: :[[@LINE+2]]:3: warning: 'write' can block in the kernel while 'M' is held: every other thread that needs 'M' waits for it too; do it before taking the lock or after releasing it
+  // CHECK: :[[@LINE-3]]:3: note: 'M' is locked here by std::lock_guard 'Guard'
+  write(Fd, Line.data(), Line.size());
+  // CHECK: :[[@LINE+1]]:3: warning: 'fsync' can block in the kernel while 'M' is held
+  fsync(Fd);
+}
+
+void report() {
+  std::unique_lock<std::mutex> Lock(M);
+  std::size_t Count = Lines.size();
+  // CHECK: :[[@LINE+1]]:3: warning: output to 'std::cout' takes the stream lock and can block on the terminal or pipe while 'M' is held
+  std::cout << "lines: " << Count << '\n';
+  Lock.unlock();
+  std::cout << "done\n"; // no warning
+}
+
+void backoff() {
+  M.lock();
+  // CHECK: :[[@LINE+2]]:3: warning: 'std::this_thread::sleep_for' can block in the kernel while 'M' is held
+  // CHECK: :[[@LINE-2]]:3: note: 'M' is locked here by lock()
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  M.unlock();
+}
+
+void flush(int Fd, bool Err, const std::string &Line) {
+  M.lock();
+  if (Err) {
+    M.unlock();
+    fsync(Fd); // no warning: released on this path
+    return;
+  }
+  // CHECK: :[[@LINE+2]]:3: warning: 'write' can block in the kernel while 'M' is held
+  // CHECK: :[[@LINE-7]]:3: note: 'M' is locked here by lock()
+  write(Fd, Line.data(), Line.size());
+  M.unlock();
+}
+
+std::mutex FileLock;
+
+void save(const std::string &Path) {
+  std::lock_guard<std::mutex> Outer(M);
+  {
+    std::lock_guard<std::mutex> Inner(FileLock);
+    // CHECK: :[[@LINE+2]]:19: warning: opening a 'std::ofstream' can block on the disk while 'FileLock' is held
+    // CHECK: :[[@LINE-2]]:5: note: 'FileLock' is locked here by std::lock_guard 'Inner'
+    std::ofstream Out(Path);
+    if (!Out.is_open()) // no warning
+      return;
+    for (const std::string &Line : Lines)
+      // CHECK: :[[@LINE+1]]:11: warning: 'std::ofstream' I/O can block on the disk while 'FileLock' is held
+      Out << Line;
+  }
+}
+
+struct Node {
+  int Value;
+  Node *Next;
+};
+
+Node *Head = nullptr;
+
+void push(int Value) {
+  std::lock_guard<std::mutex> Guard(M);
+  // CHECK: :[[@LINE+1]]:10: warning: 'new' can take the allocator's lock or fault in pages while 'M' is held
+  Head = new Node{Value, Head};
+}
+
+void pushPrepared(int Value) {
+  Node *N = new Node{Value, nullptr}; // no warning
+  std::lock_guard<std::mutex> Guard(M);
+  N->Next = Head;
+  Head = N;
+}
+
+void defer() {
+  std::lock_guard<std::mutex> Guard(M);
+  // Runs later, not under the lock.
+  auto Print = [] { std::cout << "later\n"; }; // no warning
+  Lines.emplace_back("deferred");
+  (void)Print;
+}
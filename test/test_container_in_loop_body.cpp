@@ -0,0 +1,132 @@
+// RUN: %clang_tidy -checks='-*,hl-perf-container-in-loop-body' %s -- -std=c++17 \
+// RUN:   2>&1 | %FileCheck %s --implicit-check-not='warning:'
+// RUN: rm -f %t.cpp && cp %s %t.cpp
+// RUN: %clang_tidy -checks='-*,hl-perf-container-in-loop-body' -fix %t.cpp \
+// RUN:   -- -std=c++17 > /dev/null 2>&1
+// RUN: %FileCheck --check-prefix=FIXED %s < %t.cpp
+
+#include <iomanip>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+void sink(const std::vector<int> &V);
+void publish(const std::string &S);
+
+void scratchVector(const std::vector<std::vector<int>> &Rows) {
+  // FIXED: {{^}}  std::vector<int> Doubled;{{$}}
+  // FIXED-NEXT: {{^}}  for (const auto &Row : Rows) {{{$}}
+  for (const auto &Row : Rows) {
+    // CHECK: :[[@LINE+2]]:22: warning: std::vector 'Doubled' is constructed and destroyed on every loop iteration
+    // FIXED: {{^}}    Doubled.clear();{{$}}
+    std::vector<int> Doubled;
+    for (int V : Row)
+      Doubled.push_back(2 * V);
+    sink(Doubled);
+  }
+}
+
+void readLines(std::istream &In, int N) {
+  for (int I = 0; I < N; ++I) {
+    // CHECK: :[[@LINE+1]]:17: warning: std::string 'Line' is constructed and destroyed on every loop iteration
+    std::string Line;
+    std::getline(In, Line);
+    publish(Line);
+  }
+}
+
+void formatEach(const std::vector<int> &Values) {
+  // FIXED: {{^}}  std::ostringstream Out;{{$}}
+  // FIXED-NEXT: {{^}}  for (int V : Values) {{{$}}
+  for (int V : Values) {
+    // CHECK: :[[@LINE+4]]:24: warning: std::ostringstream 'Out' is constructed and destroyed on every loop iteration
+    // CHECK: note: str("") and clear() reset the contents and error state but keep the flags, precision, width, fill and locale, which this loop does not change
+    // CHECK: note: constructing a stream also copies the global locale
+    // FIXED: {{^}}    Out.str(""); Out.clear();{{$}}
+    std::ostringstream Out;
+    Out << "value=" << V;
+    publish(Out.str());
+  }
+}
+
+void formatPrices(const std::vector<double> &Prices) {
+  for (double P : Prices) {
+    // std::fixed and the precision would outlive the iteration.
+    // CHECK: :[[@LINE+3]]:24: warning: std::ostringstream 'Out' is constructed and destroyed on every loop iteration
+    // CHECK: note: not hoisted automatically: the loop changes the formatting of 'Out'
+    // CHECK: note: constructing a stream also copies the global locale
+    std::ostringstream Out;
+    Out << std::fixed << std::setprecision(2) << P;
+    publish(Out.str());
+  }
+}
+
+void countWords(const std::vector<std::vector<std::string>> &Docs) {
+  for (const auto &Doc : Docs) {
+    // CHECK: :[[@LINE+2]]:42: warning: std::unordered_map 'Counts' is constructed and destroyed on every loop iteration
+    // CHECK: note: clear() keeps the bucket array but still frees every node
+    std::unordered_map<std::string, int> Counts;
+    for (const auto &Word : Doc)
+      ++Counts[Word];
+  }
+}
+
+void sizedCopy(const std::vector<int> &Src, int N) {
+  while (N-- > 0) {
+    // Constructed with a size: reported, but not rewritten.
+    // CHECK: :[[@LINE+2]]:22: warning: std::vector 'Buffer' is constructed and destroyed on every loop iteration
+    // CHECK: note: once hoisted, give it its initial value with assign()
+    std::vector<int> Buffer(Src.size());
+    sink(Buffer);
+  }
+}
+
+void aliased(std::vector<std::vector<int> *> &Out, int N) {
+  for (int I = 0; I < N; ++I) {
+    // CHECK: :[[@LINE+2]]:22: warning: std::vector 'Local' is constructed and destroyed on every loop iteration
+    // CHECK: note: not hoisted automatically: a pointer or reference to 'Local'
+    std::vector<int> Local;
+    Local.push_back(I);
+    Out.push_back(&Local);
+  }
+}
+
+// Good: the storage is handed off every iteration.
+std::vector<std::vector<int>> moved(int N) {
+  std::vector<std::vector<int>> Rows;
+  for (int I = 0; I < N; ++I) {
+    std::vector<int> Row;
+    Row.push_back(I);
+    Rows.push_back(std::move(Row)); // no warning
+  }
+  return Rows;
+}
+
+// Good: never filled, so never allocates.
+void neverFilled(int N) {
+  for (int I = 0; I < N; ++I) {
+    std::vector<int> Empty;
+    sink(Empty); // no warning
+  }
+}
+
+// Good: a short literal fits the string's inline buffer.
+void shortLiteral(int N) {
+  for (int I = 0; I < N; ++I) {
+    std::string Tag = "id";
+    publish(Tag); // no warning
+  }
+}
+
+// Good: declared outside the loop already.
+void hoisted(const std::vector<std::vector<int>> &Rows) {
+  std::vector<int> Doubled;
+  for (const auto &Row : Rows) {
+    Doubled.clear();
+    for (int V : Row)
+      Doubled.push_back(2 * V);
+    sink(Doubled);
+  }
+}
@@ -0,0 +1,42 @@
+// Warnings carry a score: base cost x 10 per enclosing loop.
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-std-endl,hl-perf-avoid-virtual-in-loop' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.CostModel, value: true}]}' \
+// RUN:   %s -- -std=c++17 2>&1 | %FileCheck %s --check-prefix=SCORE
+//
+// The report lists the most expensive ones first.
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-std-endl,hl-perf-avoid-virtual-in-loop' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.CostReport, value: "2"}, {key: hl-module.CostLoopIterations, value: "100"}]}' \
+// RUN:   %s -- -std=c++17 2>&1 | %FileCheck %s --check-prefix=REPORT
+
+#include <iostream>
+#include <vector>
+
+struct Shape {
+  virtual ~Shape() = default;
+  virtual double area() const = 0;
+};
+
+void printStartup() {
+  // SCORE: test_cost_model.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: std::endl forces a stream flush {{.*}} [cost 2000: stream flush]
+  std::cout << "ready" << std::endl;
+}
+
+double totalArea(const std::vector<std::vector<Shape *>> &Groups) {
+  double Total = 0;
+  for (const auto &Group : Groups)
+    for (const Shape *S : Group)
+      // SCORE: test_cost_model.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: virtual call to 'area' inside a loop{{.*}} [cost 500: indirect call]
+      Total += S->area();
+  return Total;
+}
+
+void dumpAreas(const std::vector<Shape *> &Shapes) {
+  for (const Shape *S : Shapes)
+    // SCORE: test_cost_model.cpp:[[@LINE+2]]:{{[0-9]+}}: warning: virtual call to 'area' inside a loop{{.*}} [cost 50: indirect call]
+    // SCORE: test_cost_model.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: std::endl forces a stream flush {{.*}} [cost 20000: stream flush]
+    std::cout << S->area() << std::endl;
+}
+
+// REPORT: hl-tidy: most expensive findings in test_cost_model.cpp (2 of 4):
+// REPORT-NEXT: {{ +}}200000  {{.*}}test_cost_model.cpp:[[@LINE-4]]:{{[0-9]+}}: std::endl forces a stream flush {{.*}} [hl-perf-avoid-std-endl]
+// REPORT-NEXT: {{ +}}50000  {{.*}}test_cost_model.cpp:[[@LINE-13]]:{{[0-9]+}}: virtual call to 'area' inside a loop{{.*}} [hl-perf-avoid-virtual-in-loop]
@@ -0,0 +1,44 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: echo '        -:    0:Source:test_coverage.cpp' > %t/run.gcov
+// RUN: echo '       50:   23:  std::vector<int> Out;' >> %t/run.gcov
+// RUN: echo '     5000:   29:    Out.push_back(V);' >> %t/run.gcov
+// RUN: echo '        2:   34:  std::vector<int> Out;' >> %t/run.gcov
+// RUN: echo '        3:   36:    Out.push_back(V);' >> %t/run.gcov
+// RUN: echo '        4:   41:  int Written = 0;' >> %t/run.gcov
+// RUN: echo '    #####:   43:    S.write(V + Written);' >> %t/run.gcov
+//
+// Loops that ran fewer than 10 times are not reported; the others say how often.
+// RUN: %clang_tidy -checks='-*,hl-perf-prefer-reserve,hl-perf-avoid-virtual-in-loop' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.CoverageFile, value: "%t/run.gcov"}, {key: hl-module.CoverageMinCount, value: "10"}]}' \
+// RUN:   %s -- -std=c++17 2>&1 | %FileCheck %s
+
+#include <vector>
+
+struct Sink {
+  virtual ~Sink() = default;
+  virtual void write(int Value) = 0;
+};
+
+std::vector<int> collect(const std::vector<int> &In) {
+  std::vector<int> Out;
+  for (int V : In)
+    // CHECK: test_coverage.cpp:[[@LINE+4]]:{{[0-9]+}}: warning: push_back/emplace_back inside a loop without reserve()
+    // CHECK: note: the loop body ran 5000 times in the coverage run (100 iterations per entry on average)
+    // CHECK: note: the coverage run appended 100 elements per loop entry on average; consider reserve(100) before the loop
+    // CHECK-NOT: warning:
+    Out.push_back(V);
+  return Out;
+}
+
+std::vector<int> rarely(const std::vector<int> &In) {
+  std::vector<int> Out;
+  for (int V : In)
+    Out.push_back(V);
+  return Out;
+}
+
+void flush(Sink &S, const std::vector<int> &Values) {
+  int Written = 0;
+  for (int V : Values)
+    S.write(V + Written);
+}
@@ -0,0 +1,63 @@
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-std-function,hl-perf-avoid-std-endl' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.Deduplicate, value: true}]}' \
+// RUN:   %s -- -std=c++17 2>&1 | %FileCheck %s --implicit-check-not='warning:'
+
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+// With hl-module.Deduplicate, code inside a class or function template is
+// diagnosed once in the primary template instead of once per instantiation.
+
+template <typename T> struct Handler {
+  // CHECK: test_deduplicate.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: std::function causes heap allocation
+  std::function<void(T)> Callback;
+};
+
+template <typename T> void subscribe() {
+  // CHECK: test_deduplicate.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: std::function causes heap allocation
+  std::function<void(T)> Fn = [](T) {};
+  Fn(T());
+}
+
+void instantiate() {
+  Handler<int> A;
+  Handler<double> B;
+  Handler<char> C;
+  subscribe<int>();
+  subscribe<long>();
+  subscribe<char>();
+}
+
+// A macro expanded several times is diagnosed once, at its first expansion:
+// every expansion shares the spelling location of std::endl.
+#define LOG_LINE(Msg) std::cout << Msg << std::endl
+
+void logAll() {
+  // CHECK: warning: std::endl forces a stream flush on every call
+  LOG_LINE("one");
+  LOG_LINE("two");
+  LOG_LINE("three");
+}
+
+// Distinct spellings are still reported separately.
+void logTwice() {
+  // CHECK: test_deduplicate.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: std::endl forces a stream flush on every call
+  std::cout << "a" << std::endl;
+  // CHECK: test_deduplicate.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: std::endl forces a stream flush on every call
+  std::cout << "b" << std::endl;
+}
+
+// A call on a dependent stream only resolves to std::endl in the
+// instantiations, which the check keeps seeing; the two instantiations
+// share one location and are reported once.
+template <typename Stream> void flushTo(Stream &Out) {
+  // CHECK: test_deduplicate.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: std::endl forces a stream flush on every call
+  Out << std::endl;
+}
+
+void flushBoth() {
+  std::ostringstream Buffer;
+  flushTo(std::cout);
+  flushTo(Buffer);
+}
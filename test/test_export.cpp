@@ -0,0 +1,45 @@
+// RUN: rm -rf %t && mkdir -p %t
+//
+// NDJSON: one record per warning, notes and fix-its folded in.
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-std-endl,hl-perf-avoid-virtual-in-loop' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.ExportDir, value: "%t/ndjson"}]}' \
+// RUN:   %s -- -std=c++20 > /dev/null 2>&1
+// RUN: cat %t/ndjson/test_export.cpp.*.ndjson | %FileCheck %s --check-prefix=NDJSON
+//
+// SARIF, with paths relative to ExportRoot.
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-std-endl,hl-perf-avoid-virtual-in-loop' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.ExportDir, value: "%t/sarif"}, {key: hl-module.ExportFormat, value: sarif}, {key: hl-module.ExportRoot, value: "%S"}]}' \
+// RUN:   %s -- -std=c++20 > /dev/null 2>&1
+// RUN: cat %t/sarif/test_export.cpp.*.sarif | %FileCheck %s --check-prefix=SARIF
+
+#include <iostream>
+
+struct Shape {
+  virtual ~Shape() = default;
+  virtual double area() const = 0;
+};
+
+double total(Shape **Shapes, int N, int M) {
+  double Sum = 0;
+  for (int I = 0; I < N; ++I)
+    for (int J = 0; J < M; ++J)
+      // NDJSON: {"fingerprint":"{{[0-9a-f]+}}","check":"hl-perf-avoid-virtual-in-loop","level":"warning","message":"virtual call to 'area' inside a loop: {{[^"]*}}","file":"{{[^"]*}}test_export.cpp","line":[[@LINE+1]],"column":{{[0-9]+}},"standard":"C++20","loopDepth":2,"notes":[{"message":"consider CRTP{{.*}}
+      Sum += Shapes[I * M + J]->area();
+  // NDJSON-SAME: "suggestions":[{"alternative":"CRTP","since":""}],"fixes":[]}
+  return Sum;
+}
+
+void report(double Sum) {
+  // NDJSON: {"fingerprint":"{{[0-9a-f]+}}","check":"hl-perf-avoid-std-endl",{{.*}}"line":[[@LINE+3]],{{.*}}"loopDepth":0,"notes":[{"message":"if you need an explicit flush
+  // NDJSON-SAME: "suggestions":[],"fixes":[{"file":"{{[^"]*}}test_export.cpp","line":[[@LINE+2]],"column":{{[0-9]+}},"endLine":[[@LINE+2]],"endColumn":{{[0-9]+}},"replacement":"'\\n'"}]}
+  // NDJSON-NOT: "check"
+  std::cout << Sum << std::endl;
+}
+
+// SARIF: {"version":"2.1.0",{{.*}}"driver":{"name":"hl-tidy"
+// SARIF-SAME: "ruleId":"hl-perf-avoid-virtual-in-loop"
+// SARIF-SAME: "uri":"test_export.cpp"
+// SARIF-SAME: "partialFingerprints":{"hlTidy/v1":"{{[0-9a-f]+}}"}
+// SARIF-SAME: "properties":{"standard":"C++20","loopDepth":2,
+// SARIF-SAME: "ruleId":"hl-perf-avoid-std-endl"
+// SARIF-SAME: "insertedContent":{"text":"'\\n'"}
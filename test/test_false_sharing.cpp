@@ -0,0 +1,98 @@
+// RUN: %clang_tidy -checks='-*,hl-perf-false-sharing' %s -- -std=c++17 \
+// RUN:   --target=x86_64-linux-gnu 2>&1 \
+// RUN:   | %FileCheck %s --implicit-check-not='warning:'
+// RUN: rm -f %t.cpp && cp %s %t.cpp
+// RUN: %clang_tidy -checks='-*,hl-perf-false-sharing' -fix %t.cpp \
+// RUN:   -- -std=c++17 --target=x86_64-linux-gnu > /dev/null 2>&1
+// RUN: %FileCheck --check-prefix=FIXED %s < %t.cpp
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+
+struct Stats {
+  std::atomic<long> Hits;
+  // CHECK: :[[@LINE+4]]:21: warning: 'Misses' (std::atomic) can share a 64-byte cache line with 'Hits' (std::atomic), which starts 8 bytes before it: threads using one keep invalidating the other's line
+  // CHECK: note: 'Hits' is declared here
+  // CHECK: note: alignas(64) follows the DestructiveInterferenceBytes option; std::hardware_destructive_interference_size in <new> varies with the target and the standard library
+  // FIXED: {{^}}  alignas(64) std::atomic<long> Misses;{{$}}
+  std::atomic<long> Misses;
+};
+
+struct Queue {
+  std::mutex Lock;
+  std::vector<int> Items;
+  // CHECK: :[[@LINE+1]]:21: warning: 'Closed' (std::atomic) can share a 64-byte cache line with 'Lock' (std::mutex), which starts 64 bytes before it
+  std::atomic<bool> Closed;
+};
+
+// A plain counter bumped in the loop that polls the flag.
+struct Worker {
+  std::atomic<bool> Stop{false};
+  // CHECK: :[[@LINE+3]]:8: warning: 'Stop' (std::atomic) can share a 64-byte cache line with 'Processed', which is written inside a loop: every write invalidates the line for the threads using 'Stop'
+  // CHECK: note: 'Stop' is declared here
+  // FIXED: {{^}}  alignas(64) long Processed = 0;{{$}}
+  long Processed = 0;
+
+  void run() {
+    while (!Stop.load())
+      ++Processed;
+  }
+};
+
+struct Shard {
+  std::atomic<int> Refs;
+};
+
+// Nested records are flattened.
+struct Table {
+  Shard Left;
+  // CHECK: :[[@LINE+2]]:9: warning: 'Right.Refs' (std::atomic) can share a 64-byte cache line with 'Left.Refs' (std::atomic), which starts 4 bytes before it
+  // FIXED: {{^}}  alignas(64) Shard Right;{{$}}
+  Shard Right;
+};
+
+// CHECK: :[[@LINE+2]]:19: warning: 'PerThread' stores 16 'std::atomic<long>' elements of 8 bytes contiguously: up to 8 of them share each 64-byte cache line, so threads working on different elements keep invalidating each other's line
+// CHECK: note: give each element its own line with a wrapper such as 'struct alignas(64) Padded { std::atomic<long> Value; }'
+std::atomic<long> PerThread[16];
+
+// CHECK: :[[@LINE+1]]:27: warning: 'Locks' stores 4 'std::mutex' elements of 40 bytes contiguously: up to 2 of them share each 64-byte cache line
+std::array<std::mutex, 4> Locks;
+
+struct Slot {
+  std::atomic<unsigned> Seq;
+  unsigned Value;
+};
+
+// CHECK: :[[@LINE+1]]:19: warning: 'Ring' stores its 'Slot' (holding a std::atomic) elements of 8 bytes contiguously: up to 8 of them share each 64-byte cache line
+std::vector<Slot> Ring;
+
+// Good: already a line apart, or only one synchronisation object.
+struct Aligned {
+  std::atomic<long> Head;
+  alignas(64) std::atomic<long> Tail;
+}; // no warning
+
+struct Spaced {
+  std::atomic<long> Head;
+  char Pad[64];
+  std::atomic<long> Tail;
+}; // no warning
+
+struct Guarded {
+  std::mutex Lock;
+  long Total = 0;
+
+  void add(long N) {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Total += N;
+  }
+}; // no warning
+
+struct alignas(64) PaddedCounter {
+  std::atomic<long> Value;
+};
+
+PaddedCounter Counters[16]; // no warning
@@ -0,0 +1,60 @@
+// Two TUs from this file: the server (SERVER) defines the annotated handler,
+// the library the helpers it calls.  On its own the library has no hot path.
+// RUN: rm -rf %t && mkdir -p %t/summaries
+// RUN: cp %s %t/server.cpp && cp %s %t/library.cpp
+//
+// Phase one: every TU writes its summary.
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-cout-cerr' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.SummaryDir, value: "%t/summaries"}]}' \
+// RUN:   %t/server.cpp -- -std=c++17 -DSERVER 2>&1 | %FileCheck %s --check-prefix=PHASE1
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-cout-cerr' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.SummaryDir, value: "%t/summaries"}]}' \
+// RUN:   %t/library.cpp -- -std=c++17 2>&1 | %FileCheck %s --check-prefix=PHASE1
+//
+// Phase two: merge, propagate, index.
+// RUN: %hl_tidy_index -o %t/hot.idx %t/summaries 2>&1 | %FileCheck %s --check-prefix=INDEX
+// RUN: head -c 8 %t/hot.idx | %FileCheck %s --check-prefix=MAGIC
+//
+// The library now knows which of its functions the server makes hot.
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-cout-cerr' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.HotIndex, value: "%t/hot.idx"}]}' \
+// RUN:   %t/library.cpp -- -std=c++17 2>&1 | %FileCheck %s --check-prefix=LIBRARY
+
+// PHASE1-NOT: hot path from
+// INDEX: hl-tidy-index: 2 summaries, {{[0-9]+}} definitions, 3 hot functions
+// MAGIC: HLHOTIX1
+
+#include <iostream>
+
+void formatReply(const char *Text);
+[[gnu::cold]] void reportFailure();
+
+#ifdef SERVER
+
+[[gnu::hot]] void handleRequest() {
+  formatReply("ok");
+  reportFailure();
+}
+
+#else
+
+static void appendLine(const char *Text) {
+  // LIBRARY: library.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: std::cout uses a global mutex {{.*}} [hot path from 'handleRequest']
+  std::cout << Text << '\n';
+}
+
+void formatReply(const char *Text) {
+  appendLine(Text);
+}
+
+void reportFailure() {
+  // LIBRARY: library.cpp:[[@LINE+1]]:{{[0-9]+}}: remark: std::cerr uses a global mutex
+  std::cerr << "failure\n";
+}
+
+void selfTest() {
+  // LIBRARY: library.cpp:[[@LINE+1]]:{{[0-9]+}}: remark: std::cout uses a global mutex
+  std::cout << "self test\n";
+}
+
+#endif
@@ -0,0 +1,60 @@
+// Annotated roots only; cold findings become remarks.
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-cout-cerr' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.HotPathScoping, value: true}]}' \
+// RUN:   %s -- -std=c++17 2>&1 | %FileCheck %s --check-prefix=ANNOT
+//
+// Roots by name as well, hot findings escalated to errors (clang-tidy then
+// exits non-zero), cold findings dropped.
+// RUN: (%clang_tidy -checks='-*,hl-perf-avoid-cout-cerr' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.HotFunctions, value: "(^|::)handle[A-Z]"}, {key: hl-module.HotPathLevel, value: error}, {key: hl-module.ColdPathLevel, value: ignore}]}' \
+// RUN:   %s -- -std=c++17 || true) 2>&1 | %FileCheck %s --check-prefix=NAMED --implicit-check-not='{{warning|remark}}:'
+
+#include <iostream>
+
+void logLine(const char *Text) {
+  // ANNOT: test_hot_path.cpp:[[@LINE+2]]:{{[0-9]+}}: warning: std::cout uses a global mutex {{.*}} [hot path from 'tick']
+  // NAMED: test_hot_path.cpp:[[@LINE+1]]:{{[0-9]+}}: error: std::cout uses a global mutex {{.*}} [hot path from '{{tick|HttpServer::handleRequest|handleSignal}}']
+  std::cout << Text << '\n';
+}
+
+[[gnu::cold]] void reportFailure() {
+  // ANNOT: test_hot_path.cpp:[[@LINE+1]]:{{[0-9]+}}: remark: std::cerr uses a global mutex
+  std::cerr << "failure\n";
+}
+
+[[gnu::hot]] void tick() {
+  logLine("tick");
+  reportFailure();
+}
+
+struct HttpServer {
+  void handleRequest();
+};
+
+void HttpServer::handleRequest() {
+  // ANNOT: test_hot_path.cpp:[[@LINE+2]]:{{[0-9]+}}: remark: std::clog uses a global mutex
+  // NAMED: test_hot_path.cpp:[[@LINE+1]]:{{[0-9]+}}: error: std::clog uses a global mutex {{.*}} [hot path from 'HttpServer::handleRequest']
+  std::clog << "request\n";
+  auto Log = [] { logLine("request"); };
+  Log();
+}
+
+// A free function has no leading '::' in its qualified name.
+void handleSignal() {
+  // ANNOT: test_hot_path.cpp:[[@LINE+2]]:{{[0-9]+}}: remark: std::clog uses a global mutex
+  // NAMED: test_hot_path.cpp:[[@LINE+1]]:{{[0-9]+}}: error: std::clog uses a global mutex {{.*}} [hot path from 'handleSignal']
+  std::clog << "signal\n";
+  logLine("signal");
+}
+
+[[clang::annotate("hl::hot")]] void drainQueue() {
+  // ANNOT: test_hot_path.cpp:[[@LINE+2]]:{{[0-9]+}}: warning: std::cerr uses a global mutex {{.*}} [hot path from 'drainQueue']
+  // NAMED: test_hot_path.cpp:[[@LINE+1]]:{{[0-9]+}}: error: std::cerr uses a global mutex {{.*}} [hot path from 'drainQueue']
+  std::cerr << "drained\n";
+}
+
+int main() {
+  // ANNOT: test_hot_path.cpp:[[@LINE+1]]:{{[0-9]+}}: remark: std::cout uses a global mutex
+  std::cout << "starting\n";
+  tick();
+}
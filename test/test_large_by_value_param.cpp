@@ -0,0 +1,128 @@
+// RUN: %clang_tidy -checks='-*,hl-perf-large-by-value-param' %s -- -std=c++20 \
+// RUN:   2>&1 | %FileCheck %s --implicit-check-not='warning:'
+// RUN: rm -f %t.cpp && cp %s %t.cpp
+// RUN: %clang_tidy -checks='-*,hl-perf-large-by-value-param' -fix %t.cpp \
+// RUN:   -- -std=c++20 > /dev/null 2>&1
+// RUN: %FileCheck --check-prefix=FIXED %s < %t.cpp
+
+// The std::span fix-it includes <span>.
+// FIXED: {{^}}#include <span>{{$}}
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct Order {
+  int Id;
+  std::vector<std::string> Tags;
+};
+
+struct Session;
+
+struct Matrix {
+  double Values[32];
+};
+
+struct Point {
+  int X, Y;
+};
+
+int countAll(const std::vector<int> &Keys);
+
+// CHECK: :[[@LINE+2]]:39: warning: parameter 'Names' is taken by value but only read: every call copies '{{.*}}', which allocates heap memory; take it as 'const std::map<int, std::string> &'
+// FIXED: {{^}}int lookup(const std::map<int, std::string> &Names, int Key) {{{$}}
+int lookup(std::map<int, std::string> Names, int Key) {
+  auto It = Names.find(Key);
+  return It == Names.end() ? 0 : static_cast<int>(It->second.size());
+}
+
+// CHECK: :[[@LINE+2]]:27: warning: parameter 'S' is taken by value but only read
+// FIXED: {{^}}bool hasColon(const std::string &S) {{{$}}
+bool hasColon(std::string S) {
+  return std::find(S.begin(), S.end(), ':') != S.end();
+}
+
+// CHECK: :[[@LINE+2]]:21: warning: parameter 'M' is taken by value but only read: every call copies 'Matrix', which copies 256 bytes; take it as 'const Matrix &'
+// FIXED: {{^}}double trace(const Matrix &M) {{{$}}
+double trace(Matrix M) { return M.Values[0] + M.Values[31]; }
+
+// CHECK: :[[@LINE+2]]:37: warning: parameter 'S' is taken by value but only read: every call copies '{{.*}}', which increments an atomic reference count
+// FIXED: {{^}}bool alive(const std::shared_ptr<Session> &S) { return S.get() != nullptr; }{{$}}
+bool alive(std::shared_ptr<Session> S) { return S.get() != nullptr; }
+
+// CHECK: :[[@LINE+3]]:28: warning: parameter 'Values' is taken by value but only read: every call copies '{{.*}}', which allocates heap memory; take it as 'std::span<const long>'
+// CHECK: note: 'Values' is only sized, indexed and iterated
+// FIXED: {{^}}long sum(std::span<const long> Values) {{{$}}
+long sum(std::vector<long> Values) {
+  long S = 0;
+  for (long V : Values)
+    S += V;
+  return S + Values[0] + static_cast<long>(Values.size());
+}
+
+struct Cache {
+  // FIXED: {{^}}  int hits(const std::vector<int> &Keys) const;{{$}}
+  int hits(std::vector<int> Keys) const;
+  virtual int misses(std::vector<int> Keys) { return countAll(Keys); } // no warning
+};
+
+// CHECK: :[[@LINE+2]]:34: warning: parameter 'Keys' is taken by value but only read{{.*}}take it as 'const std::vector<int> &'
+// FIXED: {{^}}int Cache::hits(const std::vector<int> &Keys) const { return countAll(Keys); }{{$}}
+int Cache::hits(std::vector<int> Keys) const { return countAll(Keys); }
+
+// CHECK: :[[@LINE+2]]:20: warning: parameter 'O' is taken by value but only read
+// CHECK: note: the address of the function is taken or its signature comes from a macro
+int tagCount(Order O) { return static_cast<int>(O.Tags.size()); }
+int (*TagCounter)(Order) = &tagCount;
+
+class Widget {
+public:
+  // CHECK: :[[@LINE+1]]:31: warning: by-value parameter 'Label' is copied again but never moved: copying '{{.*}}' allocates heap memory; std::move it into its destination at its last use
+  explicit Widget(std::string Label) : Label(Label) {}
+
+  // CHECK: :[[@LINE+1]]:27: warning: by-value parameter 'Tag' is copied again but never moved
+  void addTag(std::string Tag) { Tags.push_back(Tag); }
+
+  // CHECK: :[[@LINE+2]]:29: warning: sink parameter 'Title' is moved from, but no call in this translation unit passes an rvalue: every call copies '{{.*}}', which allocates heap memory
+  // CHECK: note: std::move the argument at the call sites that no longer need it
+  void setTitle(std::string Title) { this->Title = std::move(Title); }
+
+  void setFooter(std::string Footer) { this->Footer = std::move(Footer); } // no warning
+
+private:
+  std::string Label, Title, Footer;
+  std::vector<std::string> Tags;
+};
+
+void configure(Widget &W, const std::string &Name) {
+  W.setTitle(Name);
+  W.setFooter(Name);
+  W.setFooter(Name + "!");
+}
+
+// Good: a working copy, cheap to copy, or already by reference.
+std::string upper(std::string S) {
+  for (char &C : S)
+    C = static_cast<char>(C & ~0x20);
+  return S; // no warning
+}
+
+int norm(Point P) { return P.X * P.X + P.Y * P.Y; } // no warning
+
+// Good: modified through an iterator, so a const reference would not compile.
+int median(std::vector<int> P) { // no warning
+  std::sort(P.begin(), P.end());
+  return P[P.size() / 2];
+}
+
+int bump(std::map<int, int> Counts, int Key) { // no warning
+  auto It = Counts.find(Key);
+  if (It == Counts.end())
+    return 0;
+  It->second += 1;
+  return It->second;
+}
+
+int size(const std::vector<int> &V) { return static_cast<int>(V.size()); } // no warning
@@ -0,0 +1,88 @@
+// RUN: %clang_tidy -checks='-*,hl-perf-lock-in-loop' %s -- -std=c++17 \
+// RUN:   2>&1 | %FileCheck %s --implicit-check-not='warning:'
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+std::mutex M;
+std::vector<int> Items;
+
+void log(const char *Message);
+void send(const std::vector<int> &Batch);
+void audit(unsigned long Count);
+void process(int Item);
+
+void addAll(const std::vector<int> &Values) {
+  for (int V : Values) {
+    // CHECK: :[[@LINE+1]]:33: warning: 'std::lock_guard' locks 'M' on every iteration of the loop: each acquisition is an atomic read-modify-write, and a contended one puts the thread to sleep; take the lock once around the loop, or collect the items and lock once per batch
+    std::lock_guard<std::mutex> Guard(M);
+    Items.push_back(V);
+  }
+}
+
+void addAllUnlocked(const std::vector<int> &Values) {
+  for (int V : Values) {
+    // CHECK: :[[@LINE+1]]:7: warning: 'lock()' locks 'M' on every iteration of the loop
+    M.lock();
+    Items.push_back(V);
+    M.unlock();
+  }
+}
+
+std::mutex A, B;
+
+void transfer(int N) {
+  while (N-- > 0) {
+    // CHECK: :[[@LINE+1]]:22: warning: 'std::scoped_lock' locks 'A' on every iteration of the loop
+    std::scoped_lock Both(A, B);
+    Items.push_back(N);
+  }
+}
+
+// One acquisition for the whole batch.
+int sum() {
+  std::lock_guard<std::mutex> Guard(M); // no warning
+  int Total = 0;
+  for (int V : Items)
+    Total += V;
+  return Total;
+}
+
+std::condition_variable Ready;
+
+// The guard is handed to the condition variable: per item by design.
+void consume() {
+  for (;;) {
+    std::unique_lock<std::mutex> Lock(M); // no warning
+    Ready.wait(Lock, [] { return !Items.empty(); });
+    int Item = Items.back();
+    Items.pop_back();
+    Lock.unlock();
+    process(Item);
+  }
+}
+
+// Unlocked before the rest of the iteration runs.
+void drain() {
+  while (true) {
+    std::unique_lock<std::mutex> Lock(M); // no warning
+    if (Items.empty())
+      return;
+    int Item = Items.back();
+    Items.pop_back();
+    Lock.unlock();
+    process(Item);
+  }
+}
+
+void flush(std::vector<int> &Batch) {
+  // CHECK: :[[@LINE+2]]:31: warning: 'std::lock_guard' holds 'M' across 5 statements, 4 calls into code outside this translation unit and 0 loops: every thread that needs 'M' waits for all of it; move the work that does not touch the shared state out of the critical section
+  // CHECK: :[[@LINE+2]]:3: note: 'log' is not defined in this translation unit and runs with 'M' held
+  std::lock_guard<std::mutex> Guard(M);
+  log("flush");
+  send(Batch);
+  log("sent");
+  audit(Batch.size());
+  Batch.clear();
+}
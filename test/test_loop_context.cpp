@@ -0,0 +1,59 @@
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-virtual-in-loop,hl-perf-prefer-reserve' %s -- -std=c++17 \
+// RUN:   2>&1 | %FileCheck %s --implicit-check-not='warning:'
+//
+// Loop-scoped checks share utils::LoopContext: each call site must be
+// reported exactly once, however many loops surround it.
+
+#include <vector>
+
+struct Shape {
+  virtual ~Shape() = default;
+  virtual double area() const = 0;
+};
+
+double deeplyNested(const std::vector<Shape *> &Shapes, int N) {
+  double Sum = 0;
+  for (int I = 0; I < N; ++I) {
+    for (int J = 0; J < N; ++J) {
+      int K = 0;
+      while (K < N) {
+        do {
+          // CHECK: test_loop_context.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: virtual call to 'area' inside a loop
+          Sum += Shapes[K]->area();
+        } while (++K < J);
+      }
+    }
+  }
+  return Sum;
+}
+
+double rangeFor(const std::vector<Shape *> &Shapes) {
+  double Sum = 0;
+  for (const Shape *S : Shapes) {
+    // CHECK: test_loop_context.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: virtual call to 'area' inside a loop
+    Sum += S->area();
+  }
+  return Sum;
+}
+
+double initRunsOnce(const std::vector<Shape *> &Shapes) {
+  // The for-init statement runs once, not per iteration: no warning.
+  double Sum = 0;
+  for (double First = Shapes[0]->area(); Sum < First; Sum += 1.0) {
+  }
+  return Sum;
+}
+
+double outsideLoop(const Shape &S) {
+  return S.area(); // no warning
+}
+
+std::vector<int> nestedPush(int N) {
+  std::vector<int> Out;
+  for (int I = 0; I < N; ++I)
+    for (int J = 0; J < N; ++J)
+      for (int K = 0; K < N; ++K)
+        // CHECK: test_loop_context.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: push_back/emplace_back inside a loop without reserve()
+        Out.push_back(I * J * K);
+  return Out;
+}
@@ -0,0 +1,69 @@
+// RUN: %clang_tidy -checks='-*,hl-modernize-prefer-contains' %s -- \
+// RUN:   -std=c++20 2>&1 | %FileCheck %s --implicit-check-not='warning:'
+
+#include <map>
+#include <set>
+#include <unordered_map>
+
+// The find()/end() comparison is matched from the comparison operator, so
+// every spelling of it is covered without walking parents of find().
+
+bool notEqual(const std::map<int, int> &M, int K) {
+  // CHECK: test_prefer_contains.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: find(k) != end() for existence check is verbose
+  return M.find(K) != M.end();
+}
+
+bool equal(const std::set<int> &S, int K) {
+  // CHECK: test_prefer_contains.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: find(k) != end() for existence check is verbose
+  return S.find(K) == S.end();
+}
+
+bool reversed(const std::unordered_map<int, int> &M, int K) {
+  // CHECK: test_prefer_contains.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: find(k) != end() for existence check is verbose
+  return M.end() != M.find(K);
+}
+
+bool parenthesized(std::map<int, int> &M, int K) {
+  // CHECK: test_prefer_contains.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: find(k) != end() for existence check is verbose
+  return (M.find(K)) != M.cend();
+}
+
+// Non-const map: find() returns iterator, cend() returns const_iterator, so
+// the find() result goes through an iterator conversion.
+bool converted(std::map<int, int> &M, int K) {
+  // CHECK: test_prefer_contains.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: find(k) != end() for existence check is verbose
+  return M.cend() != M.find(K);
+}
+
+// A user type whose != is synthesised from == in C++20 (rewritten
+// comparison).  Reported exactly once.
+struct Table {
+  struct Iter {
+    int Pos;
+    bool operator==(const Iter &) const = default;
+  };
+  Iter find(int) const { return {0}; }
+  Iter end() const { return {1}; }
+  bool contains(int) const { return false; }
+};
+
+bool rewritten(const Table &T, int K) {
+  // CHECK: test_prefer_contains.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: find(k) != end() for existence check is verbose
+  return T.find(K) != T.end();
+}
+
+// Good: the iterator is used, not just compared.
+int useIterator(const std::map<int, int> &M, int K) {
+  auto It = M.find(K);
+  if (It != M.end())
+    return It->second;
+  return 0;
+}
+
+// Good: compared with something other than end().
+bool compareIterators(const std::map<int, int> &M, int A, int B) {
+  return M.find(A) == M.find(B);
+}
+
+// Good: already uses contains().
+bool good(const std::map<int, int> &M, int K) { return M.contains(K); }
@@ -0,0 +1,51 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: echo 'main;HttpServer::handleRequest;render 90' > %t/perf.folded
+// RUN: echo 'main;loadConfig 4' >> %t/perf.folded
+// RUN: echo 'main 6' >> %t/perf.folded
+//
+// Every warning inside a function carries the function's share of samples.
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-std-endl' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.ProfileFile, value: "%t/perf.folded"}]}' \
+// RUN:   %s -- -std=c++17 2>&1 | %FileCheck %s --check-prefix=ALL
+//
+// Warnings below the threshold are dropped with their notes.
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-std-endl' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.ProfileFile, value: "%t/perf.folded"}, {key: hl-module.ProfileMinHotness, value: "5"}]}' \
+// RUN:   %s -- -std=c++17 2>&1 | %FileCheck %s --check-prefix=HOT --implicit-check-not='{{warning|note}}:'
+//
+// The export carries the hotness as a field only, so the message and the
+// fingerprint are those of a run without a profile.
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-std-endl' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.ExportDir, value: "%t/plain"}]}' \
+// RUN:   %s -- -std=c++17 > /dev/null 2>&1
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-std-endl' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.ExportDir, value: "%t/profiled"}, {key: hl-module.ProfileFile, value: "%t/perf.folded"}]}' \
+// RUN:   %s -- -std=c++17 > /dev/null 2>&1
+// RUN: cat %t/plain/*.ndjson %t/profiled/*.ndjson | %FileCheck %s --check-prefix=EXPORT
+//
+// EXPORT: {"fingerprint":"[[FP:[0-9a-f]+]]",{{.*}}"message":"std::endl forces a stream flush{{[^"[]*}}",
+// EXPORT-NOT: "hotness"
+// EXPORT: {"fingerprint":"[[FP]]",{{.*}}"message":"std::endl forces a stream flush{{[^"[]*}}",{{.*}}"hotness":9
+
+#include <iostream>
+
+struct HttpServer {
+  void handleRequest(int Status);
+};
+
+void HttpServer::handleRequest(int Status) {
+  // ALL: test_profile.cpp:[[@LINE+2]]:{{[0-9]+}}: warning: std::endl forces a stream flush {{.*}} [90.0% of profile samples]
+  // HOT: test_profile.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: std::endl forces a stream flush {{.*}} [90.0% of profile samples]
+  std::cout << Status << std::endl;
+  // HOT: note: if you need an explicit flush
+}
+
+void loadConfig() {
+  // ALL: test_profile.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: std::endl forces a stream flush {{.*}} [4.0% of profile samples]
+  std::cout << "loaded" << std::endl;
+}
+
+void neverSampled() {
+  // ALL: test_profile.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: std::endl forces a stream flush {{.*}} [0.0% of profile samples]
+  std::cout << "unused" << std::endl;
+}
@@ -0,0 +1,117 @@
+// RUN: %clang_tidy -checks='-*,hl-perf-range-for-copy' %s -- -std=c++17 \
+// RUN:   2>&1 | %FileCheck %s --implicit-check-not='warning:'
+// RUN: rm -f %t.cpp && cp %s %t.cpp
+// RUN: %clang_tidy -checks='-*,hl-perf-range-for-copy' -fix %t.cpp \
+// RUN:   -- -std=c++17 > /dev/null 2>&1
+// RUN: %FileCheck --check-prefix=FIXED %s < %t.cpp
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct Order {
+  int Id;
+  std::vector<std::string> Tags;
+};
+
+struct Session;
+
+struct Matrix {
+  double Values[32];
+};
+
+struct Point {
+  int X, Y;
+};
+
+size_t totalLength(const std::vector<std::string> &Names) {
+  size_t N = 0;
+  // CHECK: :[[@LINE+2]]:13: warning: range-for variable 'Name' copies every element: copying '{{.*}}' allocates heap memory
+  // FIXED: {{^}}  for (const auto &Name : Names){{$}}
+  for (auto Name : Names)
+    N += Name.size();
+  return N;
+}
+
+size_t countTags(const std::vector<Order> &Orders) {
+  size_t N = 0;
+  // CHECK: :[[@LINE+2]]:14: warning: range-for variable 'O' copies every element: copying 'Order' allocates heap memory for member 'Tags' (std::vector)
+  // FIXED: {{^}}  for (const Order &O : Orders){{$}}
+  for (Order O : Orders)
+    N += O.Tags.size();
+  return N;
+}
+
+int touchAll(const std::vector<std::shared_ptr<Session>> &Sessions) {
+  int Live = 0;
+  // CHECK: :[[@LINE+1]]:19: warning: range-for variable 'S' copies every element: copying '{{.*}}' increments an atomic reference count
+  for (const auto S : Sessions)
+    Live += S != nullptr;
+  return Live;
+}
+
+double trace(const std::vector<Matrix> &Ms) {
+  double Sum = 0;
+  // CHECK: :[[@LINE+1]]:13: warning: range-for variable 'M' copies every element: copying 'Matrix' copies 256 bytes
+  for (auto M : Ms)
+    Sum += M.Values[0];
+  return Sum;
+}
+
+int sumKeys(const std::map<int, std::string> &Names) {
+  int Sum = 0;
+  // CHECK: :[[@LINE+2]]:13: warning: range-for variable '[K, V]' copies every element
+  // FIXED: {{^}}  for (const auto &[K, V] : Names){{$}}
+  for (auto [K, V] : Names)
+    Sum += K + static_cast<int>(V.size());
+  return Sum;
+}
+
+std::vector<std::string> upperCased(const std::vector<std::string> &In) {
+  std::vector<std::string> Out;
+  // CHECK: :[[@LINE+2]]:13: warning: range-for variable 'S' copies every element
+  // CHECK: note: 'S' is modified in the loop body
+  for (auto S : In) {
+    for (char &C : S)
+      C = static_cast<char>(C & ~0x20);
+    Out.push_back(S);
+  }
+  return Out;
+}
+
+std::vector<std::string> load();
+
+std::vector<std::string> keepLong(const std::vector<std::string> &In) {
+  std::vector<std::string> Out;
+  // CHECK: :[[@LINE+2]]:13: warning: range-for variable 'S' copies every element
+  // CHECK: note: 'S' is moved from; iterating by 'auto &&' would move out of the container's elements
+  for (auto S : In)
+    if (S.size() > 8)
+      Out.push_back(std::move(S));
+  // CHECK: :[[@LINE+2]]:13: warning: range-for variable 'S' copies every element
+  // FIXED: {{^}}  for (auto &&S : load()){{$}}
+  for (auto S : load())
+    Out.push_back(std::move(S));
+  // CHECK: :[[@LINE+3]]:19: warning: range-for variable 'S' copies every element
+  // CHECK: note: 'S' is const, so moving from it copies
+  // FIXED: {{^}}  for (const auto S : load()){{$}}
+  for (const auto S : load())
+    Out.push_back(std::move(S));
+  return Out;
+}
+
+// Good: cheap to copy, already by reference, or a conversion.
+int cheap(const std::vector<Point> &Ps, const std::vector<std::string> &Names,
+          const std::vector<const char *> &Raw) {
+  int Sum = 0;
+  for (Point P : Ps)
+    Sum += P.X; // no warning
+  for (const auto &Name : Names)
+    Sum += static_cast<int>(Name.size()); // no warning
+  for (std::string S : Raw)
+    Sum += static_cast<int>(S.size()); // no warning
+  return Sum;
+}
@@ -0,0 +1,43 @@
+// RUN: rm -rf %t && mkdir -p %t
+//
+// The first run misses and records the diagnostics.
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-std-endl,hl-perf-avoid-std-function' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.CacheFile, value: "%t/hl.cache"}]}' \
+// RUN:   %s -- -std=c++17 2>&1 | %FileCheck %s --implicit-check-not='warning:'
+// RUN: head -c 8 %t/hl.cache | %FileCheck %s --check-prefix=MAGIC
+//
+// The second run is served from the cache: same warnings, notes and fix-its.
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-std-endl,hl-perf-avoid-std-function' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.CacheFile, value: "%t/hl.cache"}]}' \
+// RUN:   -export-fixes=%t/fixes.yaml \
+// RUN:   %s -- -std=c++17 2>&1 | %FileCheck %s --implicit-check-not='warning:'
+// RUN: %FileCheck %s --check-prefix=FIXES < %t/fixes.yaml
+//
+// A -D flag changes the <built-in> buffer and therefore the key, so the
+// entry above is not replayed for it.
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-std-endl,hl-perf-avoid-std-function' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.CacheFile, value: "%t/hl.cache"}]}' \
+// RUN:   %s -- -std=c++17 -DHL_EXTRA 2>&1 \
+// RUN:   | %FileCheck %s --check-prefixes=CHECK,EXTRA --implicit-check-not='warning:'
+
+// MAGIC: HLTCACHE
+// FIXES: ReplacementText:{{.*}}\n
+
+#include <functional>
+#include <iostream>
+
+// CHECK: test_result_cache.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: std::function causes heap allocation
+std::function<void()> OnShutdown;
+
+void flush() {
+  // CHECK: test_result_cache.cpp:[[@LINE+2]]:{{[0-9]+}}: warning: std::endl forces a stream flush
+  // CHECK: test_result_cache.cpp:[[@LINE+1]]:{{[0-9]+}}: note: if you need an explicit flush
+  std::cout << "done" << std::endl;
+}
+
+#ifdef HL_EXTRA
+void flushAgain() {
+  // EXTRA: test_result_cache.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: std::endl forces a stream flush
+  std::cout << "again" << std::endl;
+}
+#endif
@@ -0,0 +1,103 @@
+// RUN: %clang_tidy -checks='-*,hl-perf-string-concat-in-loop' %s -- \
+// RUN:   -std=c++17 2>&1 | %FileCheck %s --implicit-check-not='warning:'
+// RUN: rm -f %t.cpp && cp %s %t.cpp
+// RUN: %clang_tidy -checks='-*,hl-perf-string-concat-in-loop' -fix %t.cpp \
+// RUN:   -- -std=c++17 > /dev/null 2>&1
+// RUN: %FileCheck --check-prefix=FIXED %s < %t.cpp
+// RUN: rm -f %t.cpp && cp %s %t.cpp
+// RUN: %clang_tidy -checks='-*,hl-perf-string-concat-in-loop' -fix %t.cpp \
+// RUN:   -- -std=c++20 > /dev/null 2>&1
+// RUN: %FileCheck --check-prefix=FIXED20 %s < %t.cpp
+
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <vector>
+
+std::string joinAll(const std::vector<std::string> &Parts) {
+  std::string Out;
+  for (const std::string &P : Parts)
+    // CHECK: :[[@LINE+3]]:9: warning: 'Out = Out + ...' copies 'Out' into a new string on every iteration, which is quadratic in its final length; append to 'Out' in place
+    // FIXED: {{^}}    Out += P;{{$}}
+    // FIXED20: {{^}}    Out += P;{{$}}
+    Out = Out + P;
+  return Out;
+}
+
+std::string render(const std::vector<std::string> &Names) {
+  std::string Html;
+  for (const std::string &N : Names)
+    // CHECK: :[[@LINE+3]]:10: warning: 'Html = Html + ...' copies 'Html' into a new string on every iteration
+    // FIXED: {{^}}    Html.append("<li>").append(N).append("</li>");{{$}}
+    // FIXED20: {{^}}    std::format_to(std::back_inserter(Html), "<li>{}</li>", N);{{$}}
+    Html = Html + "<li>" + N + "</li>";
+  return Html;
+}
+
+std::string csv(const std::vector<std::string> &Fields) {
+  std::string Line;
+  for (const std::string &F : Fields) {
+    // CHECK: :[[@LINE+3]]:10: warning: 'Line += ...' builds its right-hand side in a temporary string on every iteration and then copies it into 'Line'; append the pieces to 'Line' directly
+    // FIXED: {{^}}    Line.append(F).append(1, ',');{{$}}
+    // FIXED20: {{^}}    std::format_to(std::back_inserter(Line), "{},", F);{{$}}
+    Line += F + ',';
+  }
+  return Line;
+}
+
+std::string prefixes(const std::vector<std::string> &Words) {
+  std::string Line;
+  for (const std::string &W : Words)
+    // CHECK: :[[@LINE+4]]:10: warning: 'Line = Line + ...' copies 'Line' into a new string on every iteration
+    // CHECK: note: not rewritten automatically: a later piece reads 'Line', which appending in place would already have changed
+    // FIXED: {{^}}    Line = Line + W + Line.substr(0, 3);{{$}}
+    // FIXED20: {{^}}    Line = Line + W + Line.substr(0, 3);{{$}}
+    Line = Line + W + Line.substr(0, 3);
+  return Line;
+}
+
+std::string concatAll(const std::vector<std::string> &Parts) {
+  // CHECK: :[[@LINE+1]]:10: warning: std::accumulate over std::string computes 'init = init + *it' before C++20, copying the whole result into a new string for every element; append the elements in a range-for loop instead
+  return std::accumulate(Parts.begin(), Parts.end(), std::string());
+}
+
+std::string key(const std::string &Tenant, const std::string &Id) {
+  // CHECK: :[[@LINE+7]]:21: warning: operator+ chain of 5 std::string operands grows a temporary piece by piece, reallocating as it goes; reserve the final length and append the pieces
+  // FIXED: {{^}}  std::string Key;{{$}}
+  // FIXED-NEXT: {{^}}  Key.reserve(7 + Tenant.size() + 1 + Id.size() + 3);{{$}}
+  // FIXED-NEXT: {{^}}  Key.append("tenant/").append(Tenant).append(1, ':').append(Id).append("/v1");{{$}}
+  // FIXED20: {{^}}  std::string Key;{{$}}
+  // FIXED20-NEXT: {{^}}  Key.reserve(7 + Tenant.size() + 1 + Id.size() + 3);{{$}}
+  // FIXED20-NEXT: {{^}}  std::format_to(std::back_inserter(Key), "tenant/{}:{}/v1", Tenant, Id);{{$}}
+  std::string Key = "tenant/" + Tenant + ':' + Id + "/v1";
+  return Key;
+}
+
+// A byte appended as a character: "{}" would print it as a number.
+std::string operator+(const std::string &S, std::uint8_t Byte);
+
+std::string frame(const std::string &Head, std::uint8_t Kind,
+                  const std::string &Body) {
+  // CHECK: :[[@LINE+7]]:23: warning: operator+ chain of 4 std::string operands
+  // FIXED: {{^}}  std::string Frame;{{$}}
+  // FIXED-NEXT: {{^}}  Frame.reserve(Head.size() + 1 + Body.size() + 1);{{$}}
+  // FIXED-NEXT: {{^}}  Frame.append(Head).append(1, Kind).append(Body).append(1, ';');{{$}}
+  // FIXED20: {{^}}  std::string Frame;{{$}}
+  // FIXED20-NEXT: {{^}}  Frame.reserve(Head.size() + 1 + Body.size() + 1);{{$}}
+  // FIXED20-NEXT: {{^}}  Frame.append(Head).append(1, Kind).append(Body).append(1, ';');{{$}}
+  std::string Frame = Head + Kind + Body + ';';
+  return Frame;
+}
+
+void log(const std::string &Line);
+
+void trace(const std::string &Op, const std::string &Id) {
+  // CHECK: :[[@LINE+1]]:7: warning: operator+ chain of 4 std::string operands
+  log("op=" + Op + " id=" + Id);
+}
+
+std::string greet(const std::string &Name) {
+  std::string Greeting = "Hello, " + Name; // no warning
+  Greeting = Greeting + "!";               // no warning: not in a loop
+  return Greeting;
+}
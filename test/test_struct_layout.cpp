@@ -0,0 +1,169 @@
+// RUN: %clang_tidy -checks='-*,hl-perf-struct-layout' %s -- -std=c++17 \
+// RUN:   --target=x86_64-linux-gnu 2>&1 \
+// RUN:   | %FileCheck %s --implicit-check-not='warning:'
+// RUN: rm -f %t.cpp && cp %s %t.cpp
+// RUN: %clang_tidy -checks='-*,hl-perf-struct-layout' -fix %t.cpp \
+// RUN:   -- -std=c++17 --target=x86_64-linux-gnu > /dev/null 2>&1
+// RUN: %FileCheck --check-prefix=FIXED %s < %t.cpp
+// RUN: %clang_tidy -checks='-*,hl-perf-struct-layout' %s -- -std=c++20 \
+// RUN:   --target=x86_64-linux-gnu 2>&1 | %FileCheck --check-prefix=CHECK20 %s
+
+#include <cstddef>
+#include <cstdint>
+
+// CHECK: :[[@LINE+12]]:8: warning: 'Order' is 48 bytes, 24 of them padding; ordering its fields by decreasing alignment makes it 24 bytes, 2 per 64-byte cache line instead of 1
+// CHECK: note: 7-byte hole before 'Price'
+// CHECK: note: 7-byte hole before 'Id'
+// CHECK: note: 7 bytes of tail padding after 'Flags'
+// CHECK: note: suggested field order: Price, Id, Qty, Side, Kind, Active, Flags
+// FIXED: {{^}}  double Price; // limit price{{$}}
+// FIXED-NEXT: {{^}}  long Id;{{$}}
+// FIXED-NEXT: {{^}}  int Qty;{{$}}
+// FIXED-NEXT: {{^}}  char Side;{{$}}
+// FIXED-NEXT: {{^}}  char Kind;{{$}}
+// FIXED-NEXT: {{^}}  bool Active;{{$}}
+// FIXED-NEXT: {{^}}  char Flags;{{$}}
+struct Order {
+  char Side;
+  double Price; // limit price
+  char Kind;
+  int Qty;
+  bool Active;
+  long Id;
+  char Flags;
+};
+
+// Bit-fields move together.
+// CHECK: :[[@LINE+6]]:8: warning: 'Header' is 24 bytes, 12 of them padding; ordering its fields by decreasing alignment makes it 16 bytes, 4 per 64-byte cache line instead of 2
+// CHECK: note: suggested field order: Version, Kind, Prio, Port, Dirty
+// FIXED: {{^}}  uint64_t Version;{{$}}
+// FIXED-NEXT: {{^}}  unsigned Kind : 4;{{$}}
+// FIXED-NEXT: {{^}}  unsigned Prio : 4;{{$}}
+// FIXED-NEXT: {{^}}  uint16_t Port;{{$}}
+struct Header {
+  bool Dirty;
+  uint64_t Version;
+  unsigned Kind : 4;
+  unsigned Prio : 4;
+  uint16_t Port;
+};
+
+// CHECK: :[[@LINE+3]]:8: warning: 'Quote' is 32 bytes, 14 of them padding{{.*}}makes it 24 bytes
+// CHECK: note: not reordered automatically: 'Quote' is aggregate-initialized in this translation unit
+// FIXED: {{^}}  char Venue;{{$}}
+struct Quote {
+  char Venue;
+  double Bid;
+  char Side;
+  double Ask;
+};
+
+Quote makeQuote() { return Quote{1, 100.25, 'B', 100.5}; }
+
+// CHECK: :[[@LINE+2]]:8: warning: 'Conn' is 32 bytes, 14 of them padding
+// CHECK: note: not reordered automatically: 'Conn' initializes its fields in constructor member-initializer lists
+struct Conn {
+  char State;
+  double Rtt;
+  char Retries;
+  double Loss;
+  Conn() : State(0), Rtt(0), Retries(0), Loss(0) {}
+};
+
+// A doc comment moves with its field.
+// CHECK: :[[@LINE+7]]:8: warning: 'Job' is 32 bytes, 14 of them padding
+// FIXED: {{^}}  /// When the job was queued.{{$}}
+// FIXED-NEXT: {{^}}  double Enqueued;{{$}}
+// FIXED-NEXT: {{^}}  double Deadline;{{$}}
+// FIXED-NEXT: {{^}}  char Prio;{{$}}
+// FIXED-NEXT: {{^}}  char State;{{$}}
+struct Job {
+  char Prio;
+  /// When the job was queued.
+  double Enqueued;
+  char State;
+  double Deadline;
+};
+
+// Reordering would change which of 'In' and 'Guard' is built first.
+struct Handle {
+  ~Handle();
+  int Fd;
+};
+
+struct Lock {
+  ~Lock();
+  void *Owner;
+};
+
+// CHECK: :[[@LINE+3]]:8: warning: 'Session' is 24 bytes, 10 of them padding
+// CHECK: note: not reordered automatically: 'Session' has fields with non-trivial constructors or destructors, which run in declaration order
+// FIXED: {{^}}  char Tag;{{$}}
+struct Session {
+  char Tag;
+  Handle In;
+  char Kind;
+  Lock Guard;
+};
+
+#if __cplusplus >= 202002L
+// CHECK20: :[[@LINE+2]]:8: warning: 'Bid' is 24 bytes, 14 of them padding
+// CHECK20: note: not reordered automatically: 'Bid' has a defaulted comparison, which compares its fields in declaration order
+struct Bid {
+  char Currency;
+  double Amount;
+  char Venue;
+  friend bool operator==(const Bid &, const Bid &) = default;
+};
+#endif
+
+// CHECK: :[[@LINE+4]]:8: warning: 'Window' is 32 bytes, 14 of them padding
+// CHECK: note: suggested field order: Start, End, Mode, Unit
+// CHECK: note: not reordered automatically: 'Window' initializes a field from another field in a default member initializer, which runs in declaration order
+// FIXED: {{^}}  char Mode;{{$}}
+struct Window {
+  char Mode;
+  double Start = 0;
+  char Unit;
+  double End = Start + 1;
+};
+
+// CHECK: :[[@LINE+7]]:12: warning: packed record 'WireHeader' places 'Length' at offset 1, which is not a multiple of its 4-byte alignment: every access is an unaligned load or store and cannot be atomic (2 misaligned fields)
+// CHECK: note: suggested field order: Length, Flags, Type, Ver
+// CHECK: note: not reordered automatically: 'WireHeader' is packed, so its layout is likely an external format
+// FIXED: {{^}}struct __attribute__((packed)) WireHeader {{{$}}
+// FIXED-NEXT: {{^}}  uint8_t Type;{{$}}
+struct __attribute__((packed)) WireHeader {
+  uint8_t Type;
+  uint32_t Length;
+  uint16_t Flags;
+  uint8_t Ver;
+};
+
+#pragma pack(push, 1)
+// CHECK: :[[@LINE+4]]:11: warning: packed record 'Legacy' places 'Offset' at offset 1
+// CHECK: note: not reordered automatically: 'Legacy' is used in offsetof in this translation unit
+struct Legacy {
+  char Tag;
+  int64_t Offset;
+};
+#pragma pack(pop)
+
+static_assert(offsetof(Legacy, Offset) == 1, "wire format");
+
+// Good: small, already dense, or padding no order can remove.
+struct Small {
+  char A;
+  int B;
+}; // no warning
+
+struct Dense {
+  double A;
+  int B;
+  int C;
+}; // no warning
+
+struct Tail {
+  double A;
+  char B;
+}; // no warning
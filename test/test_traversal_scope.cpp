@@ -0,0 +1,35 @@
+// RUN: rm -rf %t && mkdir -p %t/vendor
+// RUN: echo '#include <functional>' > %t/vendor/lib.h
+// RUN: echo 'inline std::function<void()> VendorCallback;' >> %t/vendor/lib.h
+//
+// Without path options the vendor header is analysed like any other file.
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-std-function' -header-filter='.*' \
+// RUN:   %s -- -std=c++17 -I%t 2>&1 \
+// RUN:   | %FileCheck %s --check-prefixes=CHECK,VENDOR
+//
+// hl-module.ExcludedPaths removes it from the traversal entirely.
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-std-function' -header-filter='.*' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.ExcludedPaths, value: "/vendor/"}]}' \
+// RUN:   %s -- -std=c++17 -I%t 2>&1 \
+// RUN:   | %FileCheck %s --implicit-check-not='lib.h:{{.*}}warning:'
+//
+// So does AnalyzedPaths when it does not cover the vendor directory.
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-std-function' -header-filter='.*' \
+// RUN:   -config='{CheckOptions: [{key: hl-module.AnalyzedPaths, value: "/project/src/"}]}' \
+// RUN:   %s -- -std=c++17 -I%t 2>&1 \
+// RUN:   | %FileCheck %s --implicit-check-not='lib.h:{{.*}}warning:'
+//
+// ExcludeSystemHeaders applies the same to -isystem directories.
+// RUN: %clang_tidy -checks='-*,hl-perf-avoid-std-function' -header-filter='.*' \
+// RUN:   -system-headers \
+// RUN:   -config='{CheckOptions: [{key: hl-module.ExcludeSystemHeaders, value: true}]}' \
+// RUN:   %s -- -std=c++17 -isystem %t 2>&1 \
+// RUN:   | %FileCheck %s --implicit-check-not='lib.h:{{.*}}warning:'
+
+#include "vendor/lib.h"
+
+// VENDOR: lib.h:2:{{[0-9]+}}: warning: std::function causes heap allocation
+
+// The main file is always analysed.
+// CHECK: test_traversal_scope.cpp:[[@LINE+1]]:{{[0-9]+}}: warning: std::function causes heap allocation
+std::function<void(int)> MainCallback;
@@ -0,0 +1,103 @@
+//===--- HlTidyIndex.cpp - Cross-TU hot-path index builder ------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// hl-tidy-index is the second phase of cross-TU hot-path scoping (see
+// src/utils/SummaryIndex.h): it reads the summaries a first clang-tidy or
+// hl-tidy-run pass wrote with `hl-module.SummaryDir`, propagates hotness over
+// the call graph of the whole program and writes the index the second pass
+// reads with `hl-module.HotIndex`.
+//
+//   hl-tidy-index -o hot.idx build/hl-summaries
+//
+// Arguments are summary files or directories searched for `*.hlsum`.
+//
+//===----------------------------------------------------------------------===//
+
+#include "utils/SummaryIndex.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using hl::tidy::utils::FunctionSummary;
+
+static cl::OptionCategory IndexCategory("hl-tidy-index options");
+
+static cl::opt<std::string> Output("o", cl::desc("Index file to write"),
+                                   cl::Required, cl::cat(IndexCategory));
+
+static cl::opt<bool> Quiet("quiet", cl::desc("Do not print the index summary"),
+                           cl::init(false), cl::cat(IndexCategory));
+
+static cl::list<std::string>
+    Inputs(cl::Positional, cl::desc("<summary file or directory>..."),
+           cl::OneOrMore, cl::cat(IndexCategory));
+
+/// Append the summaries named by \p Input to \p Paths.
+static bool collect(StringRef Input, std::vector<std::string> &Paths) {
+  if (!sys::fs::is_directory(Input)) {
+    if (!sys::fs::exists(Input)) {
+      errs() << "hl-tidy-index: no such file or directory '" << Input
+             << "'\n";
+      return false;
+    }
+    Paths.push_back(Input.str());
+    return true;
+  }
+  std::error_code EC;
+  for (sys::fs::recursive_directory_iterator It(Input, EC), End;
+       It != End && !EC; It.increment(EC))
+    if (sys::path::extension(It->path()) == ".hlsum")
+      Paths.push_back(It->path());
+  if (EC) {
+    errs() << "hl-tidy-index: cannot read '" << Input << "': " << EC.message()
+           << "\n";
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, const char **argv) {
+  InitLLVM X(argc, argv);
+  cl::HideUnrelatedOptions(IndexCategory);
+  cl::ParseCommandLineOptions(
+      argc, argv, "Build the cross-TU hot-path index from hl-* summaries\n");
+
+  std::vector<std::string> Paths;
+  for (const std::string &Input : Inputs)
+    if (!collect(Input, Paths))
+      return 1;
+  // Directory order is unspecified; the merge keeps the first name it sees.
+  llvm::sort(Paths);
+
+  std::vector<FunctionSummary> Functions;
+  for (const std::string &Path : Paths) {
+    std::string Error;
+    if (!hl::tidy::utils::readSummary(Path, Functions, Error)) {
+      errs() << "hl-tidy-index: " << Path << ": " << Error << "\n";
+      return 1;
+    }
+  }
+
+  std::string Error;
+  std::optional<size_t> Hot =
+      hl::tidy::utils::buildHotIndex(Functions, Output, Error);
+  if (!Hot) {
+    errs() << "hl-tidy-index: " << Error << "\n";
+    return 1;
+  }
+  if (!Quiet)
+    errs() << "hl-tidy-index: " << Paths.size() << " summaries, "
+           << Functions.size() << " definitions, " << *Hot
+           << " hot functions\n";
+  return 0;
+}
@@ -0,0 +1,528 @@
+//===--- HlTidyRun.cpp - In-process parallel hl-* driver --------*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// hl-tidy-run analyses every translation unit of a compile database with the
+// hl-* checks inside one process, instead of starting one clang-tidy per TU:
+//
+//   - the checks are linked in, so nothing is loaded per TU;
+//   - TUs are ordered by estimated cost, largest first.  The estimate is the
+//     wall time recorded for the file by the previous run, or its size scaled
+//     by the average time per byte of the files that do have a record;
+//   - the sorted TUs are dealt round-robin onto one queue per worker thread.
+//     A worker takes the most expensive TU from its own queue and, once that
+//     is empty, steals the most expensive TU from the queue with the most
+//     estimated work left, so a large TU never starts last;
+//   - diagnostics are printed in file-name order, as soon as all earlier TUs
+//     are done, so the output does not depend on scheduling;
+//   - every file is stat'ed and read once per run and shared by all workers
+//     (SharedFileSystem.h), and TUs that start with the same includes are
+//     parsed against one PCH built from those includes (PrefixPCH.h).
+//
+// Only hl-* checks and clang-diagnostic-* are available: the clang-tidy
+// modules are not linked in.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PrefixPCH.h"
+#include "SharedFileSystem.h"
+
+#include "clang-tidy/ClangTidy.h"
+#include "clang-tidy/ClangTidyDiagnosticConsumer.h"
+#include "clang-tidy/ClangTidyOptions.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Regex.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/thread.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace clang::tidy;
+using namespace hl::tidy::run;
+using namespace llvm;
+
+static cl::OptionCategory RunCategory("hl-tidy-run options");
+
+static cl::opt<std::string>
+    BuildPath("p", cl::desc("Build directory containing compile_commands.json"),
+              cl::init("."), cl::cat(RunCategory));
+
+static cl::opt<unsigned>
+    Jobs("j", cl::desc("Number of worker threads (default: all cores)"),
+         cl::init(0), cl::cat(RunCategory));
+
+static cl::opt<std::string>
+    Checks("checks", cl::desc("Same as clang-tidy -checks"),
+           cl::init(""), cl::cat(RunCategory));
+
+static cl::opt<std::string>
+    Config("config", cl::desc("Same as clang-tidy -config"), cl::init(""),
+           cl::cat(RunCategory));
+
+static cl::opt<std::string>
+    WarningsAsErrors("warnings-as-errors",
+                     cl::desc("Same as clang-tidy -warnings-as-errors"),
+                     cl::init(""), cl::cat(RunCategory));
+
+static cl::opt<std::string>
+    HeaderFilter("header-filter", cl::desc("Same as clang-tidy -header-filter"),
+                 cl::init(""), cl::cat(RunCategory));
+
+static cl::opt<std::string> TimingsFile(
+    "timings",
+    cl::desc("Per-file wall times used to order the next run (default: "
+             "<build dir>/.hl-tidy-run-timings.json)"),
+    cl::init(""), cl::cat(RunCategory));
+
+static cl::opt<bool>
+    ShareFiles("share-files",
+               cl::desc("Read each file once per run and share it between "
+                        "TUs (default: on)"),
+               cl::init(true), cl::cat(RunCategory));
+
+static cl::opt<bool> SharePreambles(
+    "share-preambles",
+    cl::desc("Parse TUs that start with the same includes against one PCH "
+             "of those includes (default: on)"),
+    cl::init(true), cl::cat(RunCategory));
+
+static cl::opt<unsigned> PreambleMinShare(
+    "preamble-min-share",
+    cl::desc("Only build a PCH for an include prefix at least this many TUs "
+             "start with (default: 4)"),
+    cl::init(4), cl::cat(RunCategory));
+
+static cl::opt<std::string> PreambleDir(
+    "preamble-dir",
+    cl::desc("Where the shared PCHs are built; they are removed at exit "
+             "(default: <build dir>/.hl-tidy-run-pch)"),
+    cl::init(""), cl::cat(RunCategory));
+
+static cl::opt<bool> Quiet("quiet", cl::desc("Do not print the run summary"),
+                           cl::init(false), cl::cat(RunCategory));
+
+static cl::list<std::string>
+    FileFilters(cl::Positional,
+                cl::desc("[<regex>...] only analyse files matching one of "
+                         "these"),
+                cl::cat(RunCategory));
+
+namespace {
+
+/// Clang parses deeply nested code recursively; give workers the stack size
+/// clang uses for its own main thread.
+constexpr unsigned WorkerStackSize = 8 << 20;
+
+struct Unit {
+  std::string File;
+  double Cost = 0;
+};
+
+//===----------------------------------------------------------------------===//
+// Timings from previous runs
+//===----------------------------------------------------------------------===//
+
+StringMap<double> loadTimings(StringRef Path) {
+  StringMap<double> Timings;
+  auto Buffer = MemoryBuffer::getFile(Path);
+  if (!Buffer)
+    return Timings;
+  Expected<json::Value> Parsed = json::parse((*Buffer)->getBuffer());
+  if (!Parsed) {
+    consumeError(Parsed.takeError());
+    return Timings;
+  }
+  const json::Object *Root = Parsed->getAsObject();
+  const json::Object *Files = Root ? Root->getObject("files") : nullptr;
+  if (!Files)
+    return Timings;
+  for (const auto &Entry : *Files)
+    if (std::optional<double> Seconds = Entry.second.getAsNumber())
+      Timings[Entry.first.str()] = *Seconds;
+  return Timings;
+}
+
+void storeTimings(StringRef Path, const StringMap<double> &Timings) {
+  std::vector<StringRef> Files;
+  for (const auto &Entry : Timings)
+    Files.push_back(Entry.getKey());
+  llvm::sort(Files);
+
+  SmallString<256> TmpPath(Path);
+  TmpPath += ".tmp";
+  std::error_code EC;
+  {
+    raw_fd_ostream OS(TmpPath, EC, sys::fs::OF_Text);
+    if (EC) {
+      errs() << "hl-tidy-run: cannot write " << TmpPath << ": "
+             << EC.message() << "\n";
+      return;
+    }
+    json::OStream J(OS, 2);
+    J.object([&] {
+      J.attribute("version", 1);
+      J.attributeObject("files", [&] {
+        for (StringRef File : Files)
+          J.attribute(File, Timings.lookup(File));
+      });
+    });
+    OS << "\n";
+  }
+  if ((EC = sys::fs::rename(TmpPath, Path)))
+    errs() << "hl-tidy-run: cannot write " << Path << ": " << EC.message()
+           << "\n";
+}
+
+/// Estimate the cost of each unit from \p Timings, falling back to its size
+/// scaled by the time per byte observed for files that do have a timing.
+void estimateCosts(std::vector<Unit> &Units, const StringMap<double> &Timings) {
+  std::vector<uint64_t> Sizes(Units.size(), 0);
+  double KnownSeconds = 0, KnownBytes = 0;
+  for (size_t I = 0; I < Units.size(); ++I) {
+    sys::fs::file_size(Units[I].File, Sizes[I]);
+    auto It = Timings.find(Units[I].File);
+    if (It != Timings.end() && Sizes[I]) {
+      KnownSeconds += It->second;
+      KnownBytes += Sizes[I];
+    }
+  }
+  double SecondsPerByte = KnownBytes ? KnownSeconds / KnownBytes : 1e-6;
+  for (size_t I = 0; I < Units.size(); ++I) {
+    auto It = Timings.find(Units[I].File);
+    Units[I].Cost =
+        It != Timings.end() ? It->second : Sizes[I] * SecondsPerByte;
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Work-stealing scheduler
+//===----------------------------------------------------------------------===//
+
+/// One worker's queue of unit indices, most expensive first.  The owner and
+/// thieves both take from the front: the point of stealing here is to start
+/// the largest remaining TU as early as possible.
+class WorkQueue {
+public:
+  void push(size_t Index, double Cost) {
+    Items.push_back(Index);
+    Remaining += Cost;
+  }
+
+  std::optional<size_t> take(const std::vector<Unit> &Units) {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    if (Items.empty())
+      return std::nullopt;
+    size_t Index = Items.front();
+    Items.pop_front();
+    Remaining -= Units[Index].Cost;
+    return Index;
+  }
+
+  /// Estimated cost left in the queue, or nothing if it is empty.
+  std::optional<double> remaining() {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    if (Items.empty())
+      return std::nullopt;
+    return Remaining;
+  }
+
+private:
+  std::mutex Mutex;
+  std::deque<size_t> Items;
+  double Remaining = 0;
+};
+
+class Scheduler {
+public:
+  Scheduler(const std::vector<Unit> &Units, unsigned Workers)
+      : Units(Units), Queues(Workers) {
+    std::vector<size_t> Order(Units.size());
+    for (size_t I = 0; I < Order.size(); ++I)
+      Order[I] = I;
+    std::stable_sort(Order.begin(), Order.end(), [&](size_t A, size_t B) {
+      return Units[A].Cost > Units[B].Cost;
+    });
+    for (size_t I = 0; I < Order.size(); ++I)
+      Queues[I % Workers].push(Order[I], Units[Order[I]].Cost);
+  }
+
+  /// Next unit for worker \p Self, or nothing once all queues are empty.
+  std::optional<size_t> next(unsigned Self) {
+    if (std::optional<size_t> Own = Queues[Self].take(Units))
+      return Own;
+    while (true) {
+      WorkQueue *Victim = nullptr;
+      double Most = 0;
+      for (WorkQueue &Queue : Queues) {
+        std::optional<double> Remaining = Queue.remaining();
+        if (Remaining && (!Victim || *Remaining > Most)) {
+          Victim = &Queue;
+          Most = *Remaining;
+        }
+      }
+      if (!Victim)
+        return std::nullopt;
+      // Someone else may have emptied it meanwhile; look again.
+      if (std::optional<size_t> Stolen = Victim->take(Units))
+        return Stolen;
+    }
+  }
+
+private:
+  const std::vector<Unit> &Units;
+  std::vector<WorkQueue> Queues;
+};
+
+/// Results handed from the workers to the printing thread in file order.
+class ResultBoard {
+public:
+  explicit ResultBoard(size_t Size) : Results(Size), Done(Size, false) {}
+
+  void publish(size_t Index, std::vector<ClangTidyError> Errors) {
+    {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      Results[Index] = std::move(Errors);
+      Done[Index] = true;
+    }
+    Ready.notify_all();
+  }
+
+  std::vector<ClangTidyError> wait(size_t Index) {
+    std::unique_lock<std::mutex> Lock(Mutex);
+    Ready.wait(Lock, [&] { return Done[Index]; });
+    return std::move(Results[Index]);
+  }
+
+private:
+  std::mutex Mutex;
+  std::condition_variable Ready;
+  std::vector<std::vector<ClangTidyError>> Results;
+  std::vector<bool> Done;
+};
+
+//===----------------------------------------------------------------------===//
+// Options
+//===----------------------------------------------------------------------===//
+
+bool hasCompilerErrors(const std::vector<ClangTidyError> &Errors) {
+  return llvm::any_of(Errors, [](const ClangTidyError &Error) {
+    return Error.DiagnosticName == "clang-diagnostic-error";
+  });
+}
+
+std::unique_ptr<ClangTidyOptionsProvider>
+makeOptionsProvider(const std::optional<ClangTidyOptions> &ConfigOptions,
+                    IntrusiveRefCntPtr<vfs::FileSystem> FS) {
+  ClangTidyGlobalOptions GlobalOptions;
+  ClangTidyOptions DefaultOptions = ClangTidyOptions::getDefaults();
+  ClangTidyOptions OverrideOptions;
+  if (!Checks.empty())
+    OverrideOptions.Checks = Checks;
+  if (!WarningsAsErrors.empty())
+    OverrideOptions.WarningsAsErrors = WarningsAsErrors;
+  if (HeaderFilter.getNumOccurrences())
+    OverrideOptions.HeaderFilterRegex = HeaderFilter;
+
+  if (ConfigOptions)
+    return std::make_unique<ConfigOptionsProvider>(
+        std::move(GlobalOptions), std::move(DefaultOptions), *ConfigOptions,
+        std::move(OverrideOptions), std::move(FS));
+  return std::make_unique<FileOptionsProvider>(
+      std::move(GlobalOptions), std::move(DefaultOptions),
+      std::move(OverrideOptions), std::move(FS));
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+  InitLLVM X(argc, argv);
+  cl::HideUnrelatedOptions(RunCategory);
+  cl::ParseCommandLineOptions(
+      argc, argv, "Run the hl-* checks over a compile database in parallel\n");
+
+  std::string ErrorMessage;
+  std::unique_ptr<clang::tooling::CompilationDatabase> Compilations =
+      clang::tooling::CompilationDatabase::loadFromDirectory(BuildPath,
+                                                             ErrorMessage);
+  if (!Compilations) {
+    errs() << "hl-tidy-run: " << ErrorMessage << "\n";
+    return 1;
+  }
+
+  std::optional<ClangTidyOptions> ConfigOptions;
+  if (!Config.empty()) {
+    ErrorOr<ClangTidyOptions> Parsed =
+        parseConfiguration(MemoryBufferRef(Config, "-config"));
+    if (!Parsed) {
+      errs() << "hl-tidy-run: invalid -config: " << Parsed.getError().message()
+             << "\n";
+      return 1;
+    }
+    ConfigOptions = std::move(*Parsed);
+  }
+
+  std::vector<Regex> Filters;
+  for (const std::string &Pattern : FileFilters) {
+    Regex Re(Pattern);
+    std::string Error;
+    if (!Re.isValid(Error)) {
+      errs() << "hl-tidy-run: invalid regex '" << Pattern << "': " << Error
+             << "\n";
+      return 1;
+    }
+    Filters.push_back(std::move(Re));
+  }
+
+  // getAllFiles() comes out of a hash map; sort it for a stable output.
+  std::vector<Unit> Units;
+  for (const std::string &File : Compilations->getAllFiles()) {
+    if (!Filters.empty() && llvm::none_of(Filters, [&](const Regex &Re) {
+          return Re.match(File);
+        }))
+      continue;
+    Units.push_back({File, 0});
+  }
+  llvm::sort(Units,
+             [](const Unit &A, const Unit &B) { return A.File < B.File; });
+  if (Units.empty()) {
+    errs() << "hl-tidy-run: no files to analyse\n";
+    return 1;
+  }
+
+  SmallString<256> TimingsPath(TimingsFile);
+  if (TimingsPath.empty()) {
+    TimingsPath = BuildPath;
+    sys::path::append(TimingsPath, ".hl-tidy-run-timings.json");
+  }
+  StringMap<double> Timings = loadTimings(TimingsPath);
+  estimateCosts(Units, Timings);
+
+  unsigned Workers = Jobs ? Jobs.getValue()
+                          : std::max(1u, std::thread::hardware_concurrency());
+  Workers = static_cast<unsigned>(std::min<size_t>(Workers, Units.size()));
+
+  // Every worker gets its own file system, for its own working directory;
+  // with -share-files they all answer from the same cache.  Planning and
+  // printing read the main sources outside the parse, so they do not go
+  // through the cache, which keeps files read a second time.
+  SharedFileCache FileCache;
+  auto MakeBaseFS = [&](bool Cached) {
+    IntrusiveRefCntPtr<vfs::FileSystem> Physical(
+        vfs::createPhysicalFileSystem());
+    if (Cached && ShareFiles)
+      Physical = makeIntrusiveRefCnt<CachingFileSystem>(FileCache,
+                                                        std::move(Physical));
+    return makeIntrusiveRefCnt<vfs::OverlayFileSystem>(std::move(Physical));
+  };
+
+  std::optional<PrefixPCHs> Preambles;
+  if (SharePreambles) {
+    SmallString<256> Dir(PreambleDir);
+    if (Dir.empty()) {
+      Dir = BuildPath;
+      sys::path::append(Dir, ".hl-tidy-run-pch");
+    }
+    sys::fs::make_absolute(Dir);
+    Preambles.emplace(*Compilations, Dir.str().str(),
+                      std::max(2u, PreambleMinShare.getValue()));
+    std::vector<std::string> Files;
+    for (const Unit &U : Units)
+      Files.push_back(U.File);
+    auto PlanFS = MakeBaseFS(false);
+    Preambles->plan(Files, *makeOptionsProvider(ConfigOptions, PlanFS),
+                    *PlanFS);
+  }
+
+  Scheduler Work(Units, Workers);
+  ResultBoard Board(Units.size());
+  std::vector<double> Seconds(Units.size(), 0);
+  auto Start = std::chrono::steady_clock::now();
+
+  std::vector<llvm::thread> Threads;
+  for (unsigned W = 0; W < Workers; ++W) {
+    Threads.emplace_back(WorkerStackSize, [&, W] {
+      IntrusiveRefCntPtr<vfs::OverlayFileSystem> BaseFS = MakeBaseFS(true);
+      ClangTidyContext Context(makeOptionsProvider(ConfigOptions, BaseFS));
+      while (std::optional<size_t> Index = Work.next(W)) {
+        auto UnitStart = std::chrono::steady_clock::now();
+        std::vector<std::string> PCHArgs;
+        if (Preambles)
+          PCHArgs = Preambles->argumentsFor(*Index, BaseFS);
+        std::vector<ClangTidyError> Errors = runClangTidy(
+            Context, PrefixedCompilations(*Compilations, PCHArgs),
+            {Units[*Index].File}, BaseFS, /*ApplyAnyFix=*/false);
+        if (!PCHArgs.empty() && hasCompilerErrors(Errors)) {
+          // Blame the PCH only if the TU compiles without it.
+          std::vector<ClangTidyError> Retry =
+              runClangTidy(Context, *Compilations, {Units[*Index].File},
+                           BaseFS, /*ApplyAnyFix=*/false);
+          if (!hasCompilerErrors(Retry)) {
+            Preambles->discard(*Index);
+            Errors = std::move(Retry);
+          }
+        }
+        Seconds[*Index] = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - UnitStart)
+                              .count();
+        Board.publish(*Index, std::move(Errors));
+      }
+    });
+  }
+
+  // Print in file order while the workers keep going.
+  IntrusiveRefCntPtr<vfs::OverlayFileSystem> PrintFS = MakeBaseFS(false);
+  ClangTidyContext PrintContext(makeOptionsProvider(ConfigOptions, PrintFS));
+  unsigned WarningsAsErrorsCount = 0;
+  unsigned CompilerErrors = 0;
+  for (size_t I = 0; I < Units.size(); ++I) {
+    std::vector<ClangTidyError> Errors = Board.wait(I);
+    if (hasCompilerErrors(Errors))
+      ++CompilerErrors;
+    handleErrors(Errors, PrintContext, FB_NoFix, WarningsAsErrorsCount,
+                 PrintFS);
+  }
+  for (llvm::thread &T : Threads)
+    T.join();
+
+  double Wall = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - Start)
+                    .count();
+  for (size_t I = 0; I < Units.size(); ++I)
+    Timings[Units[I].File] = Seconds[I];
+  storeTimings(TimingsPath, Timings);
+
+  if (!Quiet) {
+    errs() << "hl-tidy-run: " << Units.size() << " files, " << Workers
+           << " threads, " << format("%.2f", Wall) << "s wall";
+    if (ShareFiles)
+      errs() << ", " << FileCache.fileCount() << " files shared";
+    if (Preambles)
+      errs() << ", " << Preambles->builtCount() << " shared PCHs";
+    errs() << "\n";
+  }
+  if (CompilerErrors)
+    errs() << "hl-tidy-run: found compiler errors\n";
+  if (WarningsAsErrorsCount)
+    errs() << "hl-tidy-run: " << WarningsAsErrorsCount
+           << " warning(s) treated as errors\n";
+  return CompilerErrors || WarningsAsErrorsCount ? 1 : 0;
+}
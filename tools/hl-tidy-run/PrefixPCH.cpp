@@ -0,0 +1,347 @@
+//===--- PrefixPCH.cpp - PCHs shared by TUs with a common prefix ----------===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+//===----------------------------------------------------------------------===//
+
+#include "PrefixPCH.h"
+
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/FrontendActions.h"
+#include "clang/Lex/PreprocessorOptions.h"
+#include "clang/Tooling/ArgumentsAdjusters.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+#include <optional>
+
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace hl {
+namespace tidy {
+namespace run {
+
+namespace {
+
+/// A database holding the one command the prefix header is built with.
+class FixedCommand : public CompilationDatabase {
+public:
+  explicit FixedCommand(CompileCommand Command) : Command(std::move(Command)) {}
+  std::vector<CompileCommand>
+  getCompileCommands(StringRef FilePath) const override {
+    return {Command};
+  }
+
+private:
+  CompileCommand Command;
+};
+
+class PCHActionFactory : public FrontendActionFactory {
+public:
+  explicit PCHActionFactory(StringRef Output) : Output(Output) {}
+
+  std::unique_ptr<clang::FrontendAction> create() override {
+    return std::make_unique<clang::GeneratePCHAction>();
+  }
+
+  bool runInvocation(std::shared_ptr<clang::CompilerInvocation> Invocation,
+                     clang::FileManager *Files,
+                     std::shared_ptr<clang::PCHContainerOperations> PCHOps,
+                     clang::DiagnosticConsumer *DiagConsumer) override {
+    // runClangTidy() sets this for the TUs that will load the PCH; the
+    // predefined macros have to agree.
+    Invocation->getPreprocessorOpts().SetUpStaticAnalyzer = true;
+    Invocation->getFrontendOpts().ProgramAction = clang::frontend::GeneratePCH;
+    Invocation->getFrontendOpts().OutputFile = Output;
+    return FrontendActionFactory::runInvocation(
+        std::move(Invocation), Files, std::move(PCHOps), DiagConsumer);
+  }
+
+private:
+  std::string Output;
+};
+
+bool isSameFile(StringRef Arg, const CompileCommand &Command) {
+  if (Arg == Command.Filename)
+    return true;
+  SmallString<256> A(Arg), F(Command.Filename);
+  sys::fs::make_absolute(Command.Directory, A);
+  sys::fs::make_absolute(Command.Directory, F);
+  sys::path::remove_dots(A, /*remove_dot_dot=*/true);
+  sys::path::remove_dots(F, /*remove_dot_dot=*/true);
+  return A == F;
+}
+
+/// The compiler arguments of \p Command, without the compiler itself, the
+/// input and the outputs.  ClangTool drops the outputs anyway; removing them
+/// here lets TUs with otherwise equal flags share a prefix.
+std::vector<std::string> flagsOf(const CompileCommand &Command) {
+  std::vector<std::string> Flags;
+  const std::vector<std::string> &Args = Command.CommandLine;
+  for (size_t I = 1; I < Args.size(); ++I) {
+    StringRef Arg = Args[I];
+    if (Arg == "-o" || Arg == "-MF" || Arg == "-MT" || Arg == "-MQ") {
+      ++I;
+      continue;
+    }
+    if (Arg == "-c" || Arg == "-MD" || Arg == "-MMD")
+      continue;
+    if (!Arg.empty() && Arg.front() != '-' && isSameFile(Arg, Command))
+      continue;
+    Flags.push_back(Args[I]);
+  }
+  return Flags;
+}
+
+void appendKey(std::string &Key, ArrayRef<std::string> Parts) {
+  for (const std::string &Part : Parts) {
+    Key += Part;
+    Key += '\0';
+  }
+  Key += '\1';
+}
+
+} // namespace
+
+std::vector<std::string> leadingIncludes(StringRef Source, StringRef Directory,
+                                         vfs::FileSystem &FS) {
+  std::vector<std::string> Includes;
+  bool InComment = false;
+  while (!Source.empty()) {
+    StringRef Line;
+    std::tie(Line, Source) = Source.split('\n');
+    Line = Line.trim();
+    if (InComment) {
+      size_t End = Line.find("*/");
+      if (End == StringRef::npos)
+        continue;
+      Line = Line.drop_front(End + 2).trim();
+      InComment = false;
+    }
+    if (Line.consume_front("/*")) {
+      size_t End = Line.find("*/");
+      if (End == StringRef::npos) {
+        InComment = true;
+        continue;
+      }
+      Line = Line.drop_front(End + 2).trim();
+    }
+    if (Line.empty() || Line.consume_front("//"))
+      continue;
+
+    // Anything but a plain #include ends the prefix: a #define or #if
+    // before an include can change what it means.
+    if (!Line.consume_front("#"))
+      break;
+    Line = Line.ltrim();
+    if (!Line.consume_front("include"))
+      break;
+    Line = Line.ltrim();
+    if (Line.empty() || (Line.front() != '<' && Line.front() != '"'))
+      break;
+    char Close = Line.front() == '<' ? '>' : '"';
+    size_t End = Line.find(Close, 1);
+    if (End == StringRef::npos)
+      break;
+    StringRef Rest = Line.drop_front(End + 1).trim();
+    if (!Rest.empty() && !Rest.consume_front("//"))
+      break;
+
+    if (Close == '"') {
+      SmallString<256> Local(Directory);
+      sys::path::append(Local, Line.slice(1, End));
+      ErrorOr<vfs::Status> S = FS.status(Local);
+      if (S && S->isRegularFile()) {
+        Includes.push_back(("#include \"" + Local + "\"").str());
+        continue;
+      }
+    }
+    Includes.push_back(("#include " + Line.take_front(End + 1)).str());
+  }
+  return Includes;
+}
+
+std::vector<CompileCommand>
+PrefixedCompilations::getCompileCommands(StringRef FilePath) const {
+  std::vector<CompileCommand> Commands = Base.getCompileCommands(FilePath);
+  for (CompileCommand &Command : Commands)
+    if (!Command.CommandLine.empty())
+      Command.CommandLine.insert(Command.CommandLine.begin() + 1,
+                                 Arguments.begin(), Arguments.end());
+  return Commands;
+}
+
+PrefixPCHs::~PrefixPCHs() {
+  for (const std::unique_ptr<Prefix> &P : Prefixes) {
+    sys::fs::remove(P->HeaderPath);
+    sys::fs::remove(P->PCHPath);
+  }
+  // Only succeeds if nothing else lives there.
+  sys::fs::remove(Directory);
+}
+
+void PrefixPCHs::plan(ArrayRef<std::string> Files,
+                      clang::tidy::ClangTidyOptionsProvider &Options,
+                      vfs::FileSystem &FS) {
+  struct Candidate {
+    CompileCommand Command;
+    std::vector<std::string> Args;
+    std::string FlagKey;
+    std::vector<std::string> Includes;
+  };
+  std::vector<std::optional<Candidate>> Candidates(Files.size());
+  PrefixOf.assign(Files.size(), -1);
+
+  for (size_t I = 0; I < Files.size(); ++I) {
+    std::vector<CompileCommand> Commands =
+        Compilations.getCompileCommands(Files[I]);
+    if (Commands.size() != 1 || Commands.front().CommandLine.empty())
+      continue;
+    // A TU parsed with a PCH is never result-cached (CacheSession::attach
+    // cannot see the PCH's headers change), so TUs with hl-module.CacheFile
+    // set are left to the cache.
+    clang::tidy::ClangTidyOptions Opts = Options.getOptions(Files[I]);
+    auto CacheFile = Opts.CheckOptions.find("hl-module.CacheFile");
+    if (CacheFile != Opts.CheckOptions.end() &&
+        !CacheFile->second.Value.empty())
+      continue;
+    Candidate C;
+    C.Command = std::move(Commands.front());
+
+    SmallString<256> Path(Files[I]);
+    sys::fs::make_absolute(C.Command.Directory, Path);
+    ErrorOr<std::unique_ptr<MemoryBuffer>> Source = FS.getBufferForFile(Path);
+    if (!Source)
+      continue;
+    C.Includes = leadingIncludes((*Source)->getBuffer(),
+                                 sys::path::parent_path(Path), FS);
+    if (C.Includes.empty())
+      continue;
+
+    // The flags the TU is parsed with, in runClangTidy()'s order.
+    C.Args.push_back(C.Command.CommandLine.front());
+    if (Opts.ExtraArgsBefore)
+      C.Args.insert(C.Args.end(), Opts.ExtraArgsBefore->begin(),
+                    Opts.ExtraArgsBefore->end());
+    std::vector<std::string> Flags = flagsOf(C.Command);
+    C.Args.insert(C.Args.end(), Flags.begin(), Flags.end());
+    if (Opts.ExtraArgs)
+      C.Args.insert(C.Args.end(), Opts.ExtraArgs->begin(),
+                    Opts.ExtraArgs->end());
+    C.Args.push_back("-x");
+    C.Args.push_back(sys::path::extension(Path) == ".c" ? "c-header"
+                                                        : "c++-header");
+
+    C.FlagKey = C.Command.Directory;
+    C.FlagKey += '\1';
+    appendKey(C.FlagKey, C.Args);
+    Candidates[I] = std::move(C);
+  }
+
+  // How many TUs start with each prefix, per set of flags.
+  StringMap<unsigned> Counts;
+  for (const std::optional<Candidate> &C : Candidates) {
+    if (!C)
+      continue;
+    std::string Key = C->FlagKey;
+    for (const std::string &Include : C->Includes) {
+      appendKey(Key, Include);
+      ++Counts[Key];
+    }
+  }
+
+  StringMap<int> PrefixIndex;
+  for (size_t I = 0; I < Files.size(); ++I) {
+    const std::optional<Candidate> &C = Candidates[I];
+    if (!C)
+      continue;
+    std::string Key = C->FlagKey, Longest;
+    size_t Length = 0;
+    for (size_t N = 0; N < C->Includes.size(); ++N) {
+      appendKey(Key, C->Includes[N]);
+      if (Counts.lookup(Key) < MinShare)
+        break;
+      Longest = Key;
+      Length = N + 1;
+    }
+    if (!Length)
+      continue;
+
+    auto Inserted = PrefixIndex.try_emplace(Longest, Prefixes.size());
+    if (Inserted.second) {
+      auto P = std::make_unique<Prefix>();
+      SmallString<16> Name;
+      raw_svector_ostream(Name) << format_hex_no_prefix(xxHash64(Longest), 16);
+      SmallString<256> Base(Directory);
+      sys::path::append(Base, Name);
+      P->HeaderPath = (Base + ".h").str();
+      P->PCHPath = (Base + ".pch").str();
+      for (size_t N = 0; N < Length; ++N)
+        P->Source += C->Includes[N] + "\n";
+      P->Command.Directory = C->Command.Directory;
+      P->Command.Filename = P->HeaderPath;
+      P->Command.CommandLine = C->Args;
+      P->Command.CommandLine.push_back(P->HeaderPath);
+      Prefixes.push_back(std::move(P));
+    }
+    PrefixOf[I] = Inserted.first->second;
+  }
+
+  if (!Prefixes.empty())
+    sys::fs::create_directories(Directory);
+}
+
+std::vector<std::string>
+PrefixPCHs::argumentsFor(size_t Index,
+                         IntrusiveRefCntPtr<vfs::FileSystem> FS) {
+  if (Index >= PrefixOf.size() || PrefixOf[Index] < 0)
+    return {};
+  Prefix &P = *Prefixes[PrefixOf[Index]];
+  std::call_once(P.Once, [&] { P.Ok = build(P, std::move(FS)); });
+  if (!P.Ok || P.Discarded)
+    return {};
+  return {"-include-pch", P.PCHPath};
+}
+
+void PrefixPCHs::discard(size_t Index) {
+  if (Index < PrefixOf.size() && PrefixOf[Index] >= 0)
+    Prefixes[PrefixOf[Index]]->Discarded = true;
+}
+
+bool PrefixPCHs::build(Prefix &P, IntrusiveRefCntPtr<vfs::FileSystem> FS) {
+  {
+    std::error_code EC;
+    raw_fd_ostream OS(P.HeaderPath, EC, sys::fs::OF_Text);
+    if (EC)
+      return false;
+    OS << P.Source;
+  }
+
+  FixedCommand Database(P.Command);
+  ClangTool Tool(Database, {P.HeaderPath},
+                 std::make_shared<clang::PCHContainerOperations>(),
+                 std::move(FS));
+  // A prefix that does not compile on its own is simply not shared; the
+  // TUs report their own errors.
+  clang::IgnoringDiagConsumer Ignore;
+  Tool.setDiagnosticConsumer(&Ignore);
+  Tool.appendArgumentsAdjuster(getStripPluginsAdjuster());
+  PCHActionFactory Factory(P.PCHPath);
+  if (Tool.run(&Factory) != 0)
+    return false;
+  ++Built;
+  return true;
+}
+
+} // namespace run
+} // namespace tidy
+} // namespace hl
@@ -0,0 +1,126 @@
+//===--- PrefixPCH.h - PCHs shared by TUs with a common prefix --*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// Most of the parse time of a small TU goes to the headers at its top, and
+// in a project many TUs start with the same ones.  Before the run,
+// PrefixPCHs reads the leading `#include` lines of every TU (only includes,
+// blank lines and comments; the first other line ends the prefix) and
+// groups the TUs by compile flags.  Each TU is assigned the longest prefix
+// of its includes that at least `MinShare` TUs with the same flags start
+// with.  The first worker to need a prefix writes it to a header, builds a
+// PCH from it with the group's flags, and every TU of the group is then
+// parsed with `-include-pch`: the headers are parsed once per prefix, and the
+// TU's own `#include` lines find them already included.
+//
+// Quoted includes that resolve next to the TU are written with their
+// absolute path, so the prefix header finds the same files.  If a TU fails
+// to compile with its PCH but compiles without it (say, a header without an
+// include guard), the PCH is dropped for the rest of its group.
+//
+// TUs whose configuration sets `hl-module.CacheFile` get no prefix: the
+// result cache keys a TU on the files the preprocessor enters, which does
+// not include the headers of a PCH, so it never caches a TU parsed with one.
+// Sharing is turned off for them rather than teaching the key about PCH
+// inputs, since a cache hit skips the parse altogether.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_RUN_PREFIX_PCH_H
+#define HL_TIDY_RUN_PREFIX_PCH_H
+
+#include "clang-tidy/ClangTidyOptions.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/VirtualFileSystem.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace hl {
+namespace tidy {
+namespace run {
+
+/// Return the leading `#include` lines of \p Source, a file in \p Directory.
+std::vector<std::string> leadingIncludes(llvm::StringRef Source,
+                                         llvm::StringRef Directory,
+                                         llvm::vfs::FileSystem &FS);
+
+/// Forwards to \p Base, with \p Arguments added right after the compiler.
+class PrefixedCompilations : public clang::tooling::CompilationDatabase {
+public:
+  PrefixedCompilations(const clang::tooling::CompilationDatabase &Base,
+                       std::vector<std::string> Arguments)
+      : Base(Base), Arguments(std::move(Arguments)) {}
+
+  std::vector<clang::tooling::CompileCommand>
+  getCompileCommands(llvm::StringRef FilePath) const override;
+  std::vector<std::string> getAllFiles() const override {
+    return Base.getAllFiles();
+  }
+
+private:
+  const clang::tooling::CompilationDatabase &Base;
+  std::vector<std::string> Arguments;
+};
+
+class PrefixPCHs {
+public:
+  PrefixPCHs(const clang::tooling::CompilationDatabase &Compilations,
+             std::string Directory, unsigned MinShare)
+      : Compilations(Compilations), Directory(std::move(Directory)),
+        MinShare(MinShare) {}
+  /// Remove the headers and PCHs written by this run.
+  ~PrefixPCHs();
+
+  /// Assign a shared prefix to each of \p Files.  \p Options supplies the
+  /// ExtraArgs clang-tidy adds per file, which are part of the flags.
+  void plan(llvm::ArrayRef<std::string> Files,
+            clang::tidy::ClangTidyOptionsProvider &Options,
+            llvm::vfs::FileSystem &FS);
+
+  /// Arguments that make TU \p Index use its prefix PCH, building the PCH
+  /// through \p FS if this is the first TU to ask.  Empty if the TU has no
+  /// shared prefix or its PCH could not be built.  Thread-safe.
+  std::vector<std::string>
+  argumentsFor(size_t Index, llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS);
+
+  /// Stop handing out the PCH of TU \p Index's group.  Thread-safe.
+  void discard(size_t Index);
+
+  /// Number of PCHs built so far.
+  unsigned builtCount() const { return Built; }
+
+private:
+  struct Prefix {
+    clang::tooling::CompileCommand Command;
+    std::string Source;
+    std::string HeaderPath;
+    std::string PCHPath;
+    std::once_flag Once;
+    bool Ok = false;
+    std::atomic<bool> Discarded{false};
+  };
+
+  bool build(Prefix &P, llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS);
+
+  const clang::tooling::CompilationDatabase &Compilations;
+  std::string Directory;
+  unsigned MinShare;
+  std::vector<std::unique_ptr<Prefix>> Prefixes;
+  /// Index into Prefixes for each TU, or -1.
+  std::vector<int> PrefixOf;
+  std::atomic<unsigned> Built{0};
+};
+
+} // namespace run
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_RUN_PREFIX_PCH_H
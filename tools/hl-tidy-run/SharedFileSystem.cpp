@@ -0,0 +1,134 @@
+//===--- SharedFileSystem.cpp - File cache shared by all workers ----------===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+//===----------------------------------------------------------------------===//
+
+#include "SharedFileSystem.h"
+
+#include "llvm/ADT/SmallString.h"
+
+using namespace llvm;
+
+namespace hl {
+namespace tidy {
+namespace run {
+
+namespace {
+
+/// A file whose contents belong to the SharedFileCache.
+class SharedFile : public vfs::File {
+public:
+  SharedFile(vfs::Status S, const MemoryBuffer &Buffer)
+      : S(std::move(S)), Buffer(Buffer) {}
+
+  ErrorOr<vfs::Status> status() override { return S; }
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>>
+  getBuffer(const Twine &Name, int64_t FileSize, bool RequiresNullTerminator,
+            bool IsVolatile) override {
+    // The cached buffer was read with a terminator, so any view satisfies
+    // RequiresNullTerminator.
+    return MemoryBuffer::getMemBuffer(Buffer.getMemBufferRef(),
+                                      RequiresNullTerminator);
+  }
+
+  std::error_code close() override { return {}; }
+
+private:
+  vfs::Status S;
+  const MemoryBuffer &Buffer;
+};
+
+} // namespace
+
+ErrorOr<vfs::Status> SharedFileCache::status(StringRef Path,
+                                             vfs::FileSystem &FS) {
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    auto It = Stats.find(Path);
+    if (It != Stats.end())
+      return It->second;
+  }
+  // Stat outside the lock; if another worker got there first its answer is
+  // kept, which is the same one.
+  ErrorOr<vfs::Status> S = FS.status(Path);
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return Stats.try_emplace(Path, std::move(S)).first->second;
+}
+
+bool SharedFileCache::shouldShare(StringRef Path) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return Files.count(Path) || !ReadOnce.insert(Path).second;
+}
+
+ErrorOr<std::pair<vfs::Status, const MemoryBuffer *>>
+SharedFileCache::open(StringRef Path, vfs::FileSystem &FS) {
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    auto It = Files.find(Path);
+    if (It != Files.end())
+      return std::make_pair(It->second->Status, It->second->Buffer.get());
+  }
+
+  ErrorOr<std::unique_ptr<vfs::File>> File = FS.openFileForRead(Path);
+  if (!File)
+    return File.getError();
+  ErrorOr<vfs::Status> S = (*File)->status();
+  if (!S)
+    return S.getError();
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+      (*File)->getBuffer(Path, S->getSize(), /*RequiresNullTerminator=*/true,
+                         /*IsVolatile=*/false);
+  if (!Buffer)
+    return Buffer.getError();
+
+  auto Entry = std::make_unique<CachedFile>();
+  Entry->Status = std::move(*S);
+  Entry->Buffer = std::move(*Buffer);
+
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto Inserted = Files.try_emplace(Path, std::move(Entry));
+  const CachedFile &Cached = *Inserted.first->second;
+  Stats.insert_or_assign(Path, Cached.Status);
+  return std::make_pair(Cached.Status, Cached.Buffer.get());
+}
+
+size_t SharedFileCache::fileCount() {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return Files.size();
+}
+
+ErrorOr<vfs::Status> CachingFileSystem::status(const Twine &Path) {
+  SmallString<256> Absolute;
+  Path.toVector(Absolute);
+  std::string Requested(Absolute.str());
+  if (std::error_code EC = makeAbsolute(Absolute))
+    return EC;
+  ErrorOr<vfs::Status> S = Cache.status(Absolute, getUnderlyingFS());
+  if (!S)
+    return S;
+  return vfs::Status::copyWithNewName(*S, Requested);
+}
+
+ErrorOr<std::unique_ptr<vfs::File>>
+CachingFileSystem::openFileForRead(const Twine &Path) {
+  SmallString<256> Absolute;
+  Path.toVector(Absolute);
+  std::string Requested(Absolute.str());
+  if (std::error_code EC = makeAbsolute(Absolute))
+    return EC;
+  if (!Cache.shouldShare(Absolute))
+    return ProxyFileSystem::openFileForRead(Path);
+  auto Opened = Cache.open(Absolute, getUnderlyingFS());
+  if (!Opened)
+    return Opened.getError();
+  return std::unique_ptr<vfs::File>(std::make_unique<SharedFile>(
+      vfs::Status::copyWithNewName(Opened->first, Requested),
+      *Opened->second));
+}
+
+} // namespace run
+} // namespace tidy
+} // namespace hl
@@ -0,0 +1,93 @@
+//===--- SharedFileSystem.h - File cache shared by all workers --*- C++ -*-===//
+// Author: Aleksandr Loshkarev
+//
+// High-Load Performance clang-tidy checks
+//
+// Every TU of a project pulls in mostly the same headers, and each TU gets a
+// fresh FileManager, so without help every worker stats and reads <regex>,
+// <iostream> and friends once per TU.  SharedFileCache keeps, for the whole
+// run, the result of every stat and the contents of every file read by more
+// than one TU, keyed by absolute path.  A file is read normally the first
+// time; from the second read on its contents are held in the MemoryBuffer
+// the physical file system returned, which is a read-only mapping for all
+// but small files, and handed to each TU as a non-owning view: a header is
+// read twice per run and never copied.  Main sources, read by one TU, are
+// not kept, so the cache grows with the headers of the project rather than
+// with the number of TUs.
+//
+// The cache assumes the sources do not change while the run is in progress;
+// negative stats (the misses of header search) are cached as well.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef HL_TIDY_RUN_SHARED_FILE_SYSTEM_H
+#define HL_TIDY_RUN_SHARED_FILE_SYSTEM_H
+
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/VirtualFileSystem.h"
+
+#include <memory>
+#include <mutex>
+
+namespace hl {
+namespace tidy {
+namespace run {
+
+/// Stats and file contents shared by all workers.  Thread-safe.
+class SharedFileCache {
+public:
+  /// Status of the absolute path \p Path, asking \p FS on the first request.
+  llvm::ErrorOr<llvm::vfs::Status> status(llvm::StringRef Path,
+                                          llvm::vfs::FileSystem &FS);
+
+  /// True if the absolute path \p Path has been read before, so that it is
+  /// worth keeping; records this read otherwise.
+  bool shouldShare(llvm::StringRef Path);
+
+  /// Status and contents of the absolute path \p Path, reading it through
+  /// \p FS on the first request.  The buffer lives as long as the cache.
+  llvm::ErrorOr<std::pair<llvm::vfs::Status, const llvm::MemoryBuffer *>>
+  open(llvm::StringRef Path, llvm::vfs::FileSystem &FS);
+
+  /// Number of files kept so far.
+  size_t fileCount();
+
+private:
+  struct CachedFile {
+    llvm::vfs::Status Status;
+    std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  };
+
+  std::mutex Mutex;
+  llvm::StringMap<llvm::ErrorOr<llvm::vfs::Status>> Stats;
+  llvm::StringMap<std::unique_ptr<CachedFile>> Files;
+  /// Files read once, whose contents were not kept.
+  llvm::StringSet<> ReadOnce;
+};
+
+/// A per-worker view of the physical file system that answers stats and
+/// reads from \p Cache.  The working directory stays per instance.
+class CachingFileSystem : public llvm::vfs::ProxyFileSystem {
+public:
+  CachingFileSystem(SharedFileCache &Cache,
+                    llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS)
+      : ProxyFileSystem(std::move(FS)), Cache(Cache) {}
+
+  llvm::ErrorOr<llvm::vfs::Status> status(const llvm::Twine &Path) override;
+  llvm::ErrorOr<std::unique_ptr<llvm::vfs::File>>
+  openFileForRead(const llvm::Twine &Path) override;
+
+private:
+  SharedFileCache &Cache;
+};
+
+} // namespace run
+} // namespace tidy
+} // namespace hl
+
+#endif // HL_TIDY_RUN_SHARED_FILE_SYSTEM_H
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+# Author: Aleksandr Loshkarev
+"""Rank the most expensive hl-tidy findings across a whole project.
+
+`hl-module.CostReport` prints the top findings of each translation unit, and
+of the whole run only when one process analyses several TUs (hl-tidy-run).
+With `hl-module.CostModel` and `hl-module.ExportDir` set, every scored
+finding is exported with its `cost`; this tool merges those records, NDJSON
+or SARIF, and prints the project-wide top N in the same format:
+
+  hl_tidy_cost_report.py /tmp/hl-export -n 20
+
+A finding in a header is exported by every TU that includes it; records with
+the same fingerprint are counted once.
+"""
+
+import argparse
+import glob
+import json
+import os
+import sys
+
+
+def ndjson_findings(path):
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            try:
+                record = json.loads(line)
+            except ValueError:
+                sys.stderr.write("warning: skipping a line of %s\n" % path)
+                continue
+            if "cost" not in record:
+                continue
+            location = "%s:%s:%s" % (record.get("file", ""),
+                                     record.get("line", 0),
+                                     record.get("column", 0))
+            yield (record["cost"], location, record.get("message", ""),
+                   record.get("check", ""), record.get("fingerprint"))
+
+
+def sarif_findings(path):
+    with open(path) as f:
+        try:
+            log = json.load(f)
+        except ValueError:
+            sys.stderr.write("warning: skipping %s\n" % path)
+            return
+    for run in log.get("runs", []):
+        for result in run.get("results", []):
+            properties = result.get("properties", {})
+            if "cost" not in properties:
+                continue
+            location = ""
+            for loc in result.get("locations", [])[:1]:
+                physical = loc.get("physicalLocation", {})
+                region = physical.get("region", {})
+                location = "%s:%s:%s" % (
+                    physical.get("artifactLocation", {}).get("uri", ""),
+                    region.get("startLine", 0), region.get("startColumn", 0))
+            yield (properties["cost"], location,
+                   result.get("message", {}).get("text", ""),
+                   result.get("ruleId", ""),
+                   result.get("partialFingerprints", {}).get("hlTidy/v1"))
+
+
+def merge(export_dir):
+    findings = {}
+    units = 0
+    for path in sorted(glob.glob(os.path.join(export_dir, "*"))):
+        if path.endswith(".ndjson"):
+            records = ndjson_findings(path)
+        elif path.endswith(".sarif"):
+            records = sarif_findings(path)
+        else:
+            continue
+        units += 1
+        for cost, location, message, check, fingerprint in records:
+            key = fingerprint or (check, location, message)
+            findings[key] = (cost, location, message, check)
+    return list(findings.values()), units
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawTextHelpFormatter)
+    parser.add_argument("export_dir",
+                        help="directory given as hl-module.ExportDir")
+    parser.add_argument("-n", "--top", type=int, default=20,
+                        help="number of findings to list (default 20)")
+    args = parser.parse_args()
+
+    findings, units = merge(args.export_dir)
+    if not findings:
+        sys.exit("error: no scored findings in %s; set hl-module.CostModel"
+                 % args.export_dir)
+
+    # Best first; ties in location order, as the per-TU report does.
+    findings.sort(key=lambda f: (-f[0], f[1]))
+    top = findings[:args.top]
+    sys.stdout.write(
+        "hl-tidy: most expensive findings in %d translation units "
+        "(%d of %d):\n" % (units, len(top), len(findings)))
+    for cost, location, message, check in top:
+        sys.stdout.write("  %12.0f  %s: %s [%s]\n" %
+                         (cost, location, message, check))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+# Author: Aleksandr Loshkarev
+"""Aggregate hl-tidy per-TU metrics across a compile database.
+
+Each clang-tidy run with `hl-module.MetricsDir` set writes one JSON file per
+translation unit.  This tool sums them per check and per bound node ID and
+prints a table sorted by callback time, so expensive low-yield checks stand
+out:
+
+  hl_tidy_metrics_merge.py /tmp/hl-metrics -p build/compile_commands.json
+
+With -p, only TUs listed in the compile database are counted and TUs that
+have no metrics file are reported.
+"""
+
+import argparse
+import glob
+import json
+import os
+import sys
+
+COUNTERS = ("callbacks", "early_returns", "deduplicated", "warnings", "notes",
+            "callback_ns")
+
+
+def load_compile_db(path):
+    with open(path) as f:
+        entries = json.load(f)
+    files = set()
+    for entry in entries:
+        name = entry["file"]
+        if not os.path.isabs(name):
+            name = os.path.join(entry.get("directory", ""), name)
+        files.add(os.path.normpath(name))
+    return files
+
+
+def merge(metrics_dir, only_files):
+    totals = {}
+    seen = set()
+    for path in sorted(glob.glob(os.path.join(metrics_dir, "*.json"))):
+        with open(path) as f:
+            try:
+                data = json.load(f)
+            except ValueError:
+                data = None
+        if not isinstance(data, dict) or "checks" not in data:
+            sys.stderr.write("warning: skipping %s\n" % path)
+            continue
+        tu = os.path.normpath(data.get("file", ""))
+        if only_files is not None and tu not in only_files:
+            continue
+        seen.add(tu)
+        for check, counters in data.get("checks", {}).items():
+            total = totals.setdefault(check, dict.fromkeys(COUNTERS, 0))
+            total.setdefault("tus", 0)
+            total.setdefault("bound_ids", {})
+            total["tus"] += 1
+            for key in COUNTERS:
+                total[key] += counters.get(key, 0)
+            for node_id, count in counters.get("bound_ids", {}).items():
+                total["bound_ids"][node_id] = (
+                    total["bound_ids"].get(node_id, 0) + count)
+    return totals, seen
+
+
+def print_table(totals, out):
+    header = "%-44s %6s %11s %7s %8s %9s %7s %10s" % (
+        "check", "TUs", "callbacks", "silent", "dedup", "warnings", "notes",
+        "time (ms)")
+    out.write(header + "\n" + "-" * len(header) + "\n")
+    for check, t in sorted(totals.items(),
+                           key=lambda kv: kv[1]["callback_ns"],
+                           reverse=True):
+        silent = (100.0 * t["early_returns"] / t["callbacks"]
+                  if t["callbacks"] else 0.0)
+        out.write("%-44s %6d %11d %6.1f%% %8d %9d %7d %10.1f\n" % (
+            check, t["tus"], t["callbacks"], silent, t["deduplicated"],
+            t["warnings"], t["notes"], t["callback_ns"] / 1e6))
+        for node_id, count in sorted(t["bound_ids"].items(),
+                                     key=lambda kv: kv[1], reverse=True):
+            out.write("    %-40s %11d\n" % (node_id, count))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawTextHelpFormatter)
+    parser.add_argument("metrics_dir",
+                        help="directory given as hl-module.MetricsDir")
+    parser.add_argument("-p", "--compile-db",
+                        help="compile_commands.json to restrict and "
+                             "cross-check against")
+    parser.add_argument("--json", help="also write merged totals here")
+    args = parser.parse_args()
+
+    only_files = load_compile_db(args.compile_db) if args.compile_db else None
+    totals, seen = merge(args.metrics_dir, only_files)
+    if not totals:
+        sys.exit("error: no metrics found in %s" % args.metrics_dir)
+
+    print_table(totals, sys.stdout)
+
+    if only_files is not None:
+        missing = sorted(only_files - seen)
+        sys.stdout.write("\n%d of %d TUs have metrics\n" %
+                         (len(seen), len(only_files)))
+        for name in missing[:20]:
+            sys.stdout.write("  missing: %s\n" % name)
+        if len(missing) > 20:
+            sys.stdout.write("  ... and %d more\n" % (len(missing) - 20))
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"tus": len(seen), "checks": totals}, f, indent=2,
+                      sort_keys=True)
+            f.write("\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())